@@ -0,0 +1,399 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "archiver.h"
+#include "dir_walker.h"
+#include "libarchive_wrapper.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/* Fixed modification time of every corpus file, so archives of a corpus are byte-identical across runs. */
+constexpr time_t CORPUS_MTIME = 1700000000;
+/* Bytes written per write() while generating file contents. */
+constexpr size_t GENERATE_BUFFER_SIZE = 0x100000;
+
+/* splitmix64: small, fast and identical on every platform, unlike std::mt19937 distributions */
+class Random {
+public:
+    explicit Random(uint64_t seed) : State(seed) {}
+
+    uint64_t Next(){
+        uint64_t z = (State += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t Below(uint64_t bound){
+        return Next() % bound;
+    }
+
+private:
+    uint64_t State;
+};
+
+enum class Content { Random, Text, Mixed };
+
+const char* const WORDS[] = {
+    "archive", "backup", "stream", "header", "entry", "block", "frame", "codec",
+    "the", "of", "and", "to", "in", "is", "for", "with", "file", "directory",
+    "compress", "extract", "record", "value", "table", "index", "offset", "size",
+    "time", "mode", "owner", "group", "link", "path", "data", "chunk", "store",
+    "error", "status", "read", "write", "queue", "thread", "worker", "buffer",
+};
+
+/* Fills buffer with length bytes of the given kind of content. */
+void Fill(Random& random, Content content, char* buffer, size_t length){
+    if(content == Content::Mixed){
+        /* alternate 64 KiB runs of text and random bytes, like typical binaries with embedded strings */
+        content = (random.Next() & 1) ? Content::Text : Content::Random;
+    }
+    if(content == Content::Random){
+        size_t position = 0;
+        for(; position + 8 <= length; position += 8){
+            uint64_t word = random.Next();
+            memcpy(buffer + position, &word, sizeof(word));
+        }
+        for(; position < length; position++){
+            buffer[position] = static_cast<char>(random.Next());
+        }
+        return;
+    }
+    size_t position = 0;
+    size_t wordsOnLine = 0;
+    while(position < length){
+        const char* word = WORDS[random.Below(sizeof(WORDS) / sizeof(WORDS[0]))];
+        for(; *word && position < length; word++){
+            buffer[position++] = *word;
+        }
+        if(position < length){
+            buffer[position++] = (++wordsOnLine % 12 == 0) ? '\n' : ' ';
+        }
+    }
+}
+
+bool WriteCorpusFile(const fs::path& path, uint64_t size, Content content, Random& random, std::vector<char>& buffer){
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0){
+        return false;
+    }
+    bool written = true;
+    uint64_t remaining = size;
+    while(remaining > 0 && written){
+        size_t length = static_cast<size_t>(std::min<uint64_t>(remaining, content == Content::Mixed ? 0x10000 : buffer.size()));
+        Fill(random, content, buffer.data(), length);
+        written = write(fd, buffer.data(), length) == static_cast<ssize_t>(length);
+        remaining -= length;
+    }
+    struct timespec times[2] = {{CORPUS_MTIME, 0}, {CORPUS_MTIME, 0}};
+    futimens(fd, times);
+    return close(fd) == 0 && written;
+}
+
+/**
+ * @brief Description of one synthetic corpus, scaled by --scale.
+ */
+struct Corpus {
+    std::string name;
+    /** Number of files, spread over directories of filesPerDirectory files each. */
+    uint64_t files = 0;
+    uint64_t filesPerDirectory = 0;
+    /** File sizes are drawn uniformly from [minSize, maxSize]. */
+    uint64_t minSize = 0;
+    uint64_t maxSize = 0;
+    Content content = Content::Random;
+    /** Non-zero: the files hang off chains of this many nested directories. */
+    unsigned int depth = 0;
+};
+
+std::vector<Corpus> Corpora(double scale){
+    auto count = [scale](uint64_t n) { return std::max<uint64_t>(1, static_cast<uint64_t>(std::llround(n * scale))); };
+    return {
+        {"tiny", count(1000000), 1000, 1, 1024, Content::Text, 0},
+        {"huge", 4, 4, count(1ULL << 30), count(1ULL << 30), Content::Mixed, 0},
+        {"random", count(64), 64, 16 << 20, 16 << 20, Content::Random, 0},
+        {"text", count(64), 64, 16 << 20, 16 << 20, Content::Text, 0},
+        {"deep", count(16) * 128, 1, 1, 8192, Content::Text, 128},
+    };
+}
+
+/* Path of the directory that receives file number index of the corpus. */
+fs::path DirectoryOf(const Corpus& corpus, const fs::path& root, uint64_t index){
+    fs::path directory = root;
+    if(corpus.depth > 0){
+        /* one file per level: chain index / depth, level index % depth */
+        directory /= "chain" + std::to_string(index / corpus.depth);
+        for(unsigned int level = 0; level <= index % corpus.depth; level++){
+            directory /= "d" + std::to_string(level);
+        }
+    } else {
+        directory /= "dir" + std::to_string(index / corpus.filesPerDirectory);
+    }
+    return directory;
+}
+
+/* Spec line stored beside a generated corpus, so a later run can reuse it. */
+std::string Signature(const Corpus& corpus){
+    std::ostringstream out;
+    out << corpus.name << ' ' << corpus.files << ' ' << corpus.filesPerDirectory << ' ' << corpus.minSize << ' '
+        << corpus.maxSize << ' ' << static_cast<int>(corpus.content) << ' ' << corpus.depth;
+    return out.str();
+}
+
+/**
+ * @brief Creates the corpus below root unless an identical one is already there.
+ * @param bytes Receives the total size of the files.
+ */
+bool Generate(const Corpus& corpus, const fs::path& root, uint64_t& bytes){
+    /* FNV-1a of the name, as std::hash differs between standard libraries */
+    uint64_t seed = 0xcbf29ce484222325ULL;
+    for(char c : corpus.name){
+        seed = (seed ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+    }
+    Random random(seed);
+    bytes = 0;
+    std::vector<uint64_t> sizes(corpus.files);
+    for(auto& size : sizes){
+        size = corpus.minSize + random.Below(corpus.maxSize - corpus.minSize + 1);
+        bytes += size;
+    }
+
+    fs::path signature = root.string() + ".spec";
+    std::ifstream existing(signature);
+    std::string line;
+    if(fs::is_directory(root) && std::getline(existing, line) && line == Signature(corpus)){
+        return true;
+    }
+    std::error_code error;
+    fs::remove_all(root, error);
+    fs::remove(signature, error);
+
+    std::vector<char> buffer(GENERATE_BUFFER_SIZE);
+    fs::path directory;
+    for(uint64_t index = 0; index < corpus.files; index++){
+        fs::path target = DirectoryOf(corpus, root, index);
+        if(target != directory){
+            fs::create_directories(target, error);
+            directory = target;
+        }
+        if(!WriteCorpusFile(directory / ("f" + std::to_string(index)), sizes[index], corpus.content, random, buffer)){
+            std::cerr << "Cannot write corpus " << corpus.name << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    std::ofstream(signature) << Signature(corpus) << std::endl;
+    return true;
+}
+
+/**
+ * @brief Timing and memory of one phase, measured in a child process of its own
+ *        so that the peak RSS belongs to that phase alone.
+ */
+struct PhaseResult {
+    std::string name;
+    bool ok = false;
+    double seconds = 0;
+    long peakRssKiB = 0;
+};
+
+PhaseResult RunPhase(const std::string& name, const std::function<bool()>& body){
+    PhaseResult result;
+    result.name = name;
+    std::cout.flush();
+    auto start = std::chrono::steady_clock::now();
+    pid_t child = fork();
+    if(child == 0){
+        /* the archiver reports progress on stdout, which may carry the JSON */
+        int null = open("/dev/null", O_WRONLY);
+        if(null >= 0){
+            dup2(null, STDOUT_FILENO);
+        }
+        _exit(body() ? 0 : 1);
+    }
+    int status = 0;
+    struct rusage usage {};
+    if(child < 0 || wait4(child, &status, 0, &usage) != child){
+        return result;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    result.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    result.seconds = elapsed.count();
+    result.peakRssKiB = usage.ru_maxrss;
+    return result;
+}
+
+void DropCaches(){
+    std::ofstream dropCaches("/proc/sys/vm/drop_caches");
+    sync();
+    dropCaches << "3" << std::endl;
+}
+
+std::string JsonString(const std::string& value){
+    std::string out = "\"";
+    for(char c : value){
+        if(c == '"' || c == '\\'){
+            out += '\\';
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+void PrintPhase(std::ostream& out, const PhaseResult& phase, uint64_t files, uint64_t bytes){
+    double seconds = std::max(phase.seconds, 1e-9);
+    out << "        " << JsonString(phase.name) << ": {\"ok\": " << (phase.ok ? "true" : "false")
+        << ", \"seconds\": " << phase.seconds
+        << ", \"mb_per_s\": " << bytes / 1e6 / seconds
+        << ", \"files_per_s\": " << files / seconds
+        << ", \"peak_rss_kib\": " << phase.peakRssKiB << "}";
+}
+
+} // namespace
+
+/**
+ * @brief Times packing and unpacking of reproducible synthetic corpora.
+ *
+ * Each corpus is generated once below the work directory from a fixed seed
+ * and reused by later runs with the same --scale. Its phases run in forked
+ * children: "walk" (DirWalker only), "pack" (Archiver::ArchiveItem), "list"
+ * and "unpack" (Archiver::Extract into a scratch directory), each reporting
+ * MB/s and files/s over the corpus' logical size and the child's peak RSS.
+ * The results are printed as JSON, so runs of two builds can be compared.
+ *
+ * Corpora at scale 1: tiny (1M files of 1 B-1 KiB), huge (4 files of 1 GiB
+ * of mixed content), random (1 GiB incompressible), text (1 GiB of words)
+ * and deep (2048 files in chains of 128 nested directories).
+ *
+ * Usage: bttf_bench [--work <directory>] [--corpus <name>[,<name>...]] [--scale <factor>]
+ *                   [--codec <codec>] [--level <level>] [--threads <n>] [--cold] [--json <file>]
+ */
+int
+main(int argc, char** argv){
+    fs::path work = fs::temp_directory_path() / "bttf_bench";
+    std::string only;
+    double scale = 1.0;
+    bool cold = false;
+    std::string jsonFile;
+    ArchiverOptions options;
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--work" && hasValue){
+            work = argv[++i];
+        } else if(arg == "--corpus" && hasValue){
+            only = std::string(",") + argv[++i] + ",";
+        } else if(arg == "--scale" && hasValue){
+            scale = std::stod(argv[++i]);
+        } else if(arg == "--codec" && hasValue){
+            if(!ParseCodec(argv[++i], options.codec)){
+                std::cerr << "Unknown codec " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if(arg == "--level" && hasValue){
+            options.level = std::stoi(argv[++i]);
+        } else if(arg == "--threads" && hasValue){
+            options.threads = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if(arg == "--cold"){
+            cold = true;
+        } else if(arg == "--json" && hasValue){
+            jsonFile = argv[++i];
+        } else {
+            std::cout << "Usage: bttf_bench [--work <directory>] [--corpus <name>[,<name>...]] [--scale <factor>]" << std::endl
+                      << "                  [--codec <codec>] [--level <level>] [--threads <n>] [--cold] [--json <file>]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::ofstream jsonStream;
+    if(!jsonFile.empty()){
+        jsonStream.open(jsonFile);
+    }
+    std::ostream& json = jsonFile.empty() ? std::cout : jsonStream;
+    json << "{\n  \"codec\": " << JsonString(CodecName(options.codec)) << ", \"level\": " << options.level
+         << ", \"threads\": " << options.threads << ", \"scale\": " << scale << ", \"cold\": " << (cold ? "true" : "false")
+         << ",\n  \"corpora\": [";
+
+    bool failed = false;
+    bool first = true;
+    for(const auto& corpus : Corpora(scale)){
+        if(!only.empty() && only.find("," + corpus.name + ",") == std::string::npos){
+            continue;
+        }
+        fs::path root = work / "corpus" / corpus.name;
+        fs::path archive = work / (corpus.name + CodecExtension(options.codec));
+        fs::path scratch = work / ("unpack_" + corpus.name);
+        std::error_code error;
+        fs::create_directories(root.parent_path(), error);
+
+        std::cerr << "Generating " << corpus.name << "..." << std::endl;
+        uint64_t bytes = 0;
+        auto generateStart = std::chrono::steady_clock::now();
+        if(!Generate(corpus, root, bytes)){
+            return 1;
+        }
+        std::chrono::duration<double> generateSeconds = std::chrono::steady_clock::now() - generateStart;
+
+        std::vector<PhaseResult> phases;
+        auto phase = [&](const std::string& name, const std::function<bool()>& body) {
+            if(cold){
+                DropCaches();
+            }
+            std::cerr << "Running " << corpus.name << "/" << name << "..." << std::endl;
+            phases.push_back(RunPhase(name, body));
+            failed = failed || !phases.back().ok;
+        };
+
+        phase("walk", [&]() {
+            DirWalker walker(options.walkerThreads);
+            return walker.Walk(root.string(), [](const WalkEntry&) {}) == Success;
+        });
+        fs::remove(archive, error);
+        phase("pack", [&]() {
+            Archiver archiver(archive.string(), std::make_unique<LibArchiveWrapper>(), options);
+            return archiver.ArchiveItem(fs::directory_entry(root)) == Success;
+        });
+        phase("list", [&]() {
+            Archiver archiver(std::make_unique<LibArchiveWrapper>(), options);
+            return archiver.List(archive.string(), [](const ArchiveListEntry&) {}) == Success;
+        });
+        fs::remove_all(scratch, error);
+        fs::create_directories(scratch, error);
+        phase("unpack", [&]() {
+            Archiver archiver(std::make_unique<LibArchiveWrapper>(), options);
+            return chdir(scratch.c_str()) == 0 && archiver.Extract(archive.string()) == Success;
+        });
+        uint64_t archiveBytes = fs::file_size(archive, error);
+        fs::remove_all(scratch, error);
+
+        json << (first ? "\n" : ",\n") << "    {\"name\": " << JsonString(corpus.name) << ", \"files\": " << corpus.files
+             << ", \"bytes\": " << bytes << ", \"archive_bytes\": " << (error ? 0 : archiveBytes)
+             << ", \"generate_seconds\": " << generateSeconds.count() << ",\n      \"phases\": {\n";
+        for(size_t i = 0; i < phases.size(); i++){
+            PrintPhase(json, phases[i], corpus.files, bytes);
+            json << (i + 1 < phases.size() ? ",\n" : "\n");
+        }
+        json << "      }}";
+        first = false;
+    }
+    json << "\n  ]\n}" << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include "archiver.tpp"
+#include "libarchive_wrapper.h"
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Packs a directory once per run with each backend and returns the
+ *        fastest time per data block in nanoseconds.
+ *
+ * Uncompressed tar written to a callback that drops it, so the time left is
+ * reading the files plus the per-block calls into libarchive. Writes the
+ * number of blocks of one run to blocks.
+ */
+template<typename Backend>
+static double
+BestBlockTime(const fs::path& root, const fs::path& scratch, int runs, uint64_t& blocks){
+    double best = 0;
+    for(int run = 0; run < runs; run++){
+        ArchiverOptions options;
+        options.codec = Codec::None;
+        options.pipelined = false;
+        options.outputCallback = [](const char*, size_t){ return true; };
+        BasicArchiver<Backend> archiver(scratch.string(), std::make_unique<LibArchiveWrapper>(), options);
+        auto start = std::chrono::steady_clock::now();
+        if(archiver.ArchiveItem(fs::directory_entry(root)) != Success || archiver.Finish() != Success){
+            std::cerr << "packing " << root << " failed" << std::endl;
+            return -1;
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        blocks = (archiver.GetStats().bytesRead + DATA_BLOCK_SIZE - 1) / DATA_BLOCK_SIZE;
+        double perBlock = blocks > 0 ? elapsed.count() / blocks : 0;
+        if(run == 0 || perBlock < best){
+            best = perBlock;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Compares the per-block cost of packing through the ILibArchiveWrapper
+ *        vtable with the statically dispatched Archiver.
+ *
+ * BasicArchiver<ILibArchiveWrapper> is the archiver as it was before the
+ * backend became a template parameter: every libarchive call is virtual.
+ * Archiver calls the final LibArchiveWrapper, so the calls are inlined. Run
+ * it on a warm directory with many files to see the difference.
+ *
+ * Usage: dispatch_bench <directory> [runs]
+ */
+int
+main(int argc, char** argv){
+    if(argc < 2){
+        std::cout << "Usage: dispatch_bench <directory> [runs]" << std::endl;
+        return 1;
+    }
+    fs::path root = argv[1];
+    int runs = argc > 2 ? std::stoi(argv[2]) : 5;
+    fs::path scratch = fs::temp_directory_path() / "dispatch_bench.tar";
+
+    uint64_t blocks = 0;
+    double dynamic = BestBlockTime<ILibArchiveWrapper>(root, scratch, runs, blocks);
+    double direct = BestBlockTime<LibArchiveWrapper>(root, scratch, runs, blocks);
+    std::error_code error;
+    fs::remove(scratch.string() + MANIFEST_SUFFIX, error);
+    if(dynamic < 0 || direct < 0){
+        return 1;
+    }
+
+    std::cout << blocks << " blocks of " << DATA_BLOCK_SIZE << " bytes, best of " << runs << " runs" << std::endl;
+    std::cout << "virtual dispatch: " << dynamic << " ns per block" << std::endl;
+    std::cout << "static dispatch:  " << direct << " ns per block" << std::endl;
+    std::cout << "difference:       " << dynamic - direct << " ns per block" << std::endl;
+    return 0;
+}
@@ -18,6 +18,11 @@ public:
     virtual int archive_read_free(struct archive* a) = 0;
     virtual struct archive* archive_write_new() = 0;
     virtual int archive_write_add_filter_xz(struct archive* a) = 0;
+    virtual int archive_write_add_filter_zstd(struct archive* a) = 0;
+    virtual int archive_write_add_filter_lz4(struct archive* a) = 0;
+    virtual int archive_write_add_filter_gzip(struct archive* a) = 0;
+    virtual int archive_write_add_filter_none(struct archive* a) = 0;
+    virtual int archive_write_set_filter_option(struct archive* a, const char* module, const char* option, const char* value) = 0;
     virtual int archive_write_set_format_pax_restricted(struct archive* a) = 0;
     virtual int archive_write_open_filename(struct archive* a, const char* filename) = 0;
     virtual int archive_write_header(struct archive* a, struct archive_entry* entry) = 0;
@@ -39,6 +44,28 @@ public:
     virtual int64_t archive_entry_size(struct archive_entry* entry) = 0;
     virtual const char* archive_entry_pathname(struct archive_entry* entry) = 0;
     virtual int archive_write_data_block(struct archive* a, const void* buff, size_t size, int64_t offset) = 0;
+    virtual struct archive_entry* archive_entry_clone(struct archive_entry* entry) = 0;
+    virtual unsigned int archive_entry_filetype(struct archive_entry* entry) = 0;
+    virtual const char* archive_entry_hardlink(struct archive_entry* entry) = 0;
+    virtual int archive_read_open(struct archive* a, void* client_data, archive_open_callback* open_callback, archive_read_callback* read_callback, archive_close_callback* close_callback) = 0;
+    virtual int archive_write_open(struct archive* a, void* client_data, archive_open_callback* open_callback, archive_write_callback* write_callback, archive_close_callback* close_callback) = 0;
+    virtual int archive_write_set_bytes_per_block(struct archive* a, int bytes_per_block) = 0;
+    virtual int archive_write_set_format_raw(struct archive* a) = 0;
+    virtual int archive_read_data_skip(struct archive* a) = 0;
+    virtual unsigned int archive_entry_mode(struct archive_entry* entry) = 0;
+    virtual time_t archive_entry_mtime(struct archive_entry* entry) = 0;
+    virtual long archive_entry_mtime_nsec(struct archive_entry* entry) = 0;
+    virtual void archive_entry_set_mtime(struct archive_entry* entry, time_t sec, long nsec) = 0;
+    virtual int archive_write_open_fd(struct archive* a, int fd) = 0;
+    virtual int archive_read_open_fd(struct archive* a, int fd, size_t block_size) = 0;
+    virtual int archive_write_set_bytes_in_last_block(struct archive* a, int bytes_in_last_block) = 0;
+    virtual void archive_entry_sparse_add_entry(struct archive_entry* entry, la_int64_t offset, la_int64_t length) = 0;
+    virtual int archive_entry_sparse_count(struct archive_entry* entry) = 0;
+    virtual void archive_entry_set_hardlink(struct archive_entry* entry, const char* target) = 0;
+    virtual void archive_entry_xattr_add_entry(struct archive_entry* entry, const char* name, const void* value, size_t size) = 0;
+    virtual int archive_entry_xattr_reset(struct archive_entry* entry) = 0;
+    virtual int archive_entry_xattr_next(struct archive_entry* entry, const char** name, const void** value, size_t* size) = 0;
+    virtual la_int64_t archive_filter_bytes(struct archive* a, int filter) = 0;
 };
 
 #endif
\ No newline at end of file
@@ -1,28 +1,274 @@
 #ifndef ARCHIVER_H
 #define ARCHIVER_H
 
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <vector>
 #include <filesystem>
+#include "checkpoint.h"
+#include "codec.h"
+#include "disk_writer.h"
+#include "read_pipeline.h"
+#include "size_estimator.h"
 #include "status.h"
 #include "IExplorer.h"
 #include "ILibarchive_wrapper.h"
 
 namespace fs = std::filesystem;
 
-class Archiver {
+/** Size of the writes issued to an output descriptor or callback, a multiple of the page size. */
+#define ARCHIVE_OUTPUT_BLOCK_SIZE 0x100000
+
+/**
+ * @brief Tunables applied when an archive is opened for writing.
+ */
+struct ArchiverOptions {
+    /** Compression filter of the archive. */
+    Codec codec = Codec::Xz;
+    /** Compression level, CODEC_DEFAULT_LEVEL keeps the codec's default. */
+    int level = CODEC_DEFAULT_LEVEL;
+    /** zstd only: long-distance matching with a ZSTD_LONG_WINDOW_LOG window. */
+    bool longMode = false;
+    /** Number of compression threads (xz and zstd), 0 means one per available core. */
+    unsigned int threads = 0;
+    /** Read files on a separate thread so disk I/O overlaps with compression. */
+    bool pipelined = true;
+    /**
+     * Pipelined mode: bytes of upcoming files opened and hinted to the kernel
+     * with posix_fadvise(WILLNEED) while the current file is compressed;
+     * 0 disables the prefetch window.
+     */
+    uint64_t prefetchBytes = PREFETCH_WINDOW_BYTES;
+    /**
+     * Number of directory walker threads, 0 means one per available core.
+     * The parallel walk reports files in the order its workers find them,
+     * which changes from run to run.
+     */
+    unsigned int walkerThreads = 0;
+    /**
+     * Walk directories in sorted order on one thread instead, so packing the
+     * same tree twice with the same options gives a byte-identical archive.
+     */
+    bool reproducible = false;
+    /** Number of writer threads used by Extract, 0 means one per available core, 1 disables the pool. */
+    unsigned int extractThreads = 0;
+    /**
+     * Manifest of a previous archive. When set, only files that are new or
+     * changed since then are archived and deleted files are recorded as
+     * whiteout entries; empty archives everything.
+     */
+    std::string baseManifest;
+    /**
+     * Chunk store directory of the deduplicating backend. When set, archives
+     * are written as chunk lists referencing the store instead of compressed
+     * tar streams; when extracting it overrides the store recorded in the
+     * archive.
+     */
+    std::string dedupStore;
+    /**
+     * Write the archive as independently compressed frames with a trailing
+     * table of contents, so ExtractPath can restore single entries without
+     * decoding the whole stream. Needs the xz, zstd or lz4 codec.
+     */
+    bool seekable = false;
+    /**
+     * Seekable archives written to a named file: every checkpointBytes of
+     * output the archive is synced at the next frame boundary and a
+     * checkpoint is appended to a journal beside it (archive name +
+     * CHECKPOINT_SUFFIX). A run with the same items that finds the journal
+     * keeps the archive up to the last checkpoint and continues after the
+     * last file it covers. Directories are walked in sorted order on one
+     * thread so the resume point is well defined. Not combinable with
+     * incremental mode or the dedup backend.
+     */
+    bool checkpoint = false;
+    /** With checkpoint, archive bytes written between two checkpoints. */
+    uint64_t checkpointBytes = CHECKPOINT_INTERVAL_BYTES;
+    /**
+     * Descriptor the archive is written to instead of the named file, e.g. a
+     * pipe or stdout; -1 writes the file. The descriptor is not closed. The
+     * manifest is still written beside the archive name.
+     */
+    int outputFd = -1;
+    /**
+     * In-process consumer of the archive bytes, used instead of the named
+     * file when set. It receives ARCHIVE_OUTPUT_BLOCK_SIZE blocks, except for
+     * the last one, and returns false to abort the archive.
+     */
+    std::function<bool(const char* data, size_t length)> outputCallback;
+    /**
+     * Directory Extract restores the archive into, created if missing; empty
+     * restores into the working directory. Whiteouts are applied below it.
+     */
+    std::string extractDirectory;
+    /** Descriptor Extract and List read the archive from instead of the named file, -1 reads the file. */
+    int inputFd = -1;
+    /**
+     * Use io_uring for the archive file and for reading source files, with
+     * several reads and writes in flight. Falls back to blocking I/O where
+     * the kernel has no io_uring. Not used for descriptors, callbacks and
+     * seekable frames.
+     */
+    bool ioUring = false;
+    /** With ioUring, write the archive file with O_DIRECT so it bypasses the page cache. */
+    bool directIo = false;
+    /**
+     * Let Extract create regular files, directories and hard links itself,
+     * with openat() relative to cached directory descriptors, fallocate()
+     * from the entry size and directory metadata applied in one batch at the
+     * end, instead of through libarchive's disk writer. Other entry types
+     * still go through libarchive.
+     */
+    bool nativeWriter = false;
+    /** With nativeWriter, when extracted files are flushed to stable storage. */
+    Durability durability = Durability::None;
+    /**
+     * Record the XXH64 of every archived file in a CHECKSUMS_NAME entry at
+     * the end of the archive, checked by Verify. Not written by the dedup
+     * backend, whose store checks its chunks itself.
+     */
+    bool checksums = true;
+};
+
+/**
+ * @brief One entry of an archive as reported by Archiver::List.
+ */
+struct ArchiveListEntry {
+    std::string path;
+    int64_t size = 0;
+    /** File type and permission bits, as in st_mode. */
+    unsigned int mode = 0;
+    /** Modification time in nanoseconds since the epoch. */
+    int64_t mtime = 0;
+};
+
+/**
+ * @brief Outcome of Archiver::Verify.
+ */
+struct VerifyResult {
+    /** Regular files whose content was read and hashed, hard links excluded. */
+    uint64_t files = 0;
+    /** Files whose content matches the recorded checksum. */
+    uint64_t verified = 0;
+    /** Files whose content differs from the recorded checksum. */
+    std::vector<std::string> mismatched;
+    /** Files with a recorded checksum that are not in the archive. */
+    std::vector<std::string> missing;
+    /** Files without a recorded checksum, e.g. appended by another tool. */
+    std::vector<std::string> unrecorded;
+};
+
+/**
+ * @brief Counters of the operations run by an Archiver, see Archiver::GetStats.
+ *
+ * Packing: bytesRead is the file data read from disk and bytesWritten the
+ * archive size. Extracting: bytesRead is the archive size and bytesWritten
+ * the file data written to disk.
+ *
+ * The phase times are nanoseconds spent by the archiving thread in each
+ * phase, so they add up to roughly totalNs; only walkNs runs on the reader
+ * thread in pipelined mode and overlaps readNs, which is then the time spent
+ * waiting for the reader.
+ */
+struct ArchiverStats {
+    /** Regular files archived or extracted, hard links included. */
+    uint64_t files = 0;
+    uint64_t bytesRead = 0;
+    /** Not counted for the dedup backend, whose output is the chunk store. */
+    uint64_t bytesWritten = 0;
+    /** File data bytes per archive byte, 0 while either is unknown. */
+    double compressionRatio = 0;
+    /** Waiting for the directory walker. */
+    uint64_t walkNs = 0;
+    /** Packing: reading files; extracting: reading and decoding the archive. */
+    uint64_t readNs = 0;
+    /** Compressing and formatting entries, and libarchive's own writes to a file or descriptor. */
+    uint64_t compressNs = 0;
+    /** Packing: writes to an output callback, io_uring or seekable frames; extracting: writes to disk. */
+    uint64_t writeNs = 0;
+    /** Completing entries: entry padding, manifest records, and when extracting the writer pool and deferred metadata. */
+    uint64_t finishEntryNs = 0;
+    /** Wall time of ArchiveItem, Extract and Finish. */
+    uint64_t totalNs = 0;
+};
+
+/**
+ * @brief Writes, lists and extracts archives through a libarchive backend.
+ *
+ * The backend is a template parameter so the per-block libarchive calls are
+ * made on the concrete type: with a final class such as LibArchiveWrapper
+ * the compiler resolves and inlines them instead of going through the
+ * ILibArchiveWrapper vtable. Any class derived from ILibArchiveWrapper works,
+ * ILibArchiveWrapper itself included, which keeps the virtual dispatch.
+ *
+ * The implementation is in archiver.tpp; src/archiver.cpp instantiates it
+ * for LibArchiveWrapper, see Archiver.
+ */
+template<typename Backend>
+class BasicArchiver {
 public:
-    Archiver(std::unique_ptr<ILibArchiveWrapper> libarchive);
-    Archiver(std::string filename, std::unique_ptr<ILibArchiveWrapper> libarchive);
-    Archiver(IExplorer& explorer, std::unique_ptr<ILibArchiveWrapper> libarchive);
+    BasicArchiver(std::unique_ptr<Backend> libarchive, ArchiverOptions options = {});
+    BasicArchiver(std::string filename, std::unique_ptr<Backend> libarchive, ArchiverOptions options = {});
+    BasicArchiver(IExplorer& explorer, std::unique_ptr<Backend> libarchive, ArchiverOptions options = {});
 
-    ~Archiver();
+    ~BasicArchiver();
 
     Status Extract(std::string location);
+    Status ExtractPath(std::string location, std::string path, std::string destination);
+    Status List(std::string location, const std::function<void(const ArchiveListEntry&)>& callback);
     Status ArchiveItem(fs::directory_entry location);
+    /**
+     * @brief Decodes the archive and checks every file against the checksum
+     *        recorded when it was written; nothing is written to disk.
+     *
+     * Hashing, and for seekable archives decoding as well, is spread over
+     * ArchiverOptions::extractThreads threads. Counted in the stats like an
+     * extraction, with the verified file data as bytesWritten.
+     *
+     * @return Success, ChecksumMismatch if a file differs or is missing,
+     *         NotFound if the archive has no checksums, or the error that
+     *         stopped reading it.
+     */
+    Status Verify(std::string location, VerifyResult& result);
+    /**
+     * @brief Completes the archive being written and closes its writer.
+     *
+     * Called by the destructor if not called before. Afterwards the stats
+     * include the final flush of the compressor.
+     *
+     * @return Success, or WriteFailed if the end of the archive could not be written.
+     */
+    Status Finish();
+    /**
+     * @brief Counters of all operations run so far; may be called from
+     *        another thread while one is in progress.
+     */
+    ArchiverStats GetStats() const;
+    /**
+     * @brief Estimates the size of a file or tree, its archive size and the
+     *        time to compress it with the configured codec and level.
+     *
+     * Walks the tree and compresses a sample of its files, see
+     * SizeEstimator. Nothing is added to the archive.
+     */
+    SizeEstimate Estimate(fs::directory_entry location);
+    /**
+     * @brief Compressor of the configured codec and level for a
+     *        SizeEstimator; valid as long as the archiver.
+     */
+    SizeEstimator::Compressor SampleCompressor();
 
 private:
     class Impl; 
     std::unique_ptr<Impl> pImpl;
 };
 
+class LibArchiveWrapper;
+
+/** @brief Archiver of the application, calling libarchive directly. */
+using Archiver = BasicArchiver<LibArchiveWrapper>;
+
+extern template class BasicArchiver<LibArchiveWrapper>;
+
 #endif // ARCHIVER_H
\ No newline at end of file
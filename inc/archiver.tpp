@@ -0,0 +1,2913 @@
+#ifndef ARCHIVER_TPP
+#define ARCHIVER_TPP
+
+/*
+ * Implementation of BasicArchiver. Included by src/archiver.cpp, which
+ * instantiates it for LibArchiveWrapper, and by code that needs another
+ * backend, e.g. the tests with MockLibArchiveWrapper.
+ */
+
+#include "archiver.h"
+#include "ILibarchive_wrapper.h"
+#include "read_pipeline.h"
+#include "dir_walker.h"
+#include "extract_pool.h"
+#include "logs.h"
+#include "mapped_file.h"
+#include "manifest.h"
+#include "dedup_store.h"
+#include "seekable.h"
+#include "io_ring.h"
+#include "link_table.h"
+#include "sparse.h"
+#include "xxhash64.h"
+#include "checksums.h"
+#include "checkpoint.h"
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <utility>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "explorer.h"
+
+#define DATA_BLOCK_SIZE 0x4000
+/* Name prefix of an entry that records a deleted file, for listings only. */
+#define WHITEOUT_PREFIX ".wh."
+/* pax attribute (an xattr record) that marks a whiteout and holds the deleted path. */
+#define WHITEOUT_XATTR "bttf.whiteout"
+/* Directory hashes collected from a base manifest between two compactions. */
+#define BASE_DIRS_COMPACT_STEP 0x100000
+        
+/**
+ * @brief Name of the archive created when the caller does not give one.
+ */
+inline std::string DefaultArchiveName(const ArchiverOptions& options){
+    return "default_archive" + (options.dedupStore.empty() ? CodecExtension(options.codec) : std::string(DEDUP_ARCHIVE_EXTENSION));
+}
+
+/**
+ * @brief Counters behind Archiver::GetStats.
+ *
+ * Relaxed atomics: every counter is updated by one thread at a time, and a
+ * reader only needs each value on its own, not a consistent set.
+ */
+struct StatCounters {
+    std::atomic<uint64_t> files{0};
+    /* file contents read when packing, written when extracting */
+    std::atomic<uint64_t> dataBytes{0};
+    /* archive written when packing, read when extracting */
+    std::atomic<uint64_t> archiveBytes{0};
+    std::atomic<uint64_t> walk{0};
+    std::atomic<uint64_t> read{0};
+    std::atomic<uint64_t> compress{0};
+    std::atomic<uint64_t> write{0};
+    std::atomic<uint64_t> finishEntry{0};
+    std::atomic<uint64_t> total{0};
+};
+
+/**
+ * @brief Adds the nanoseconds between its construction and destruction to a
+ *        phase counter.
+ *
+ * Time another phase accumulated meanwhile on the same thread, e.g. output
+ * writes made from inside a compression call, can be left out by passing
+ * that phase's counter as nested.
+ */
+class PhaseTimer {
+public:
+    explicit PhaseTimer(std::atomic<uint64_t>& counter, const std::atomic<uint64_t>* nested = nullptr)
+        : Counter(counter), Nested(nested), Start(Now()), NestedStart(nested ? nested->load(std::memory_order_relaxed) : 0) {}
+
+    ~PhaseTimer(){
+        uint64_t elapsed = Now() - Start;
+        if(Nested != nullptr){
+            elapsed -= std::min(elapsed, Nested->load(std::memory_order_relaxed) - NestedStart);
+        }
+        Counter.fetch_add(elapsed, std::memory_order_relaxed);
+    }
+
+    static uint64_t Now(){
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    std::atomic<uint64_t>& Counter;
+    const std::atomic<uint64_t>* Nested;
+    uint64_t Start;
+    uint64_t NestedStart;
+};
+
+/* This class provides multiple constructors, allowing it to be used in different ways depending on changing requirements:
+ * - The user can provide their own function to specify items to archive during object execution.
+ * - The user can provide a filename and then call the ArchiveItem method to archive a specific item.
+ */
+template<typename Backend>
+class BasicArchiver<Backend>::Impl {
+public:
+    Impl(std::unique_ptr<Backend> libarchive, ArchiverOptions options = {})
+    : libarchive(std::move(libarchive)), Options(options) {}
+
+    /**
+     * @brief Constructs an Archiver object and initializes the archive for writing.
+     * 
+     * This constructor creates a new archive object, sets up the compression filter
+     * selected in the options, and configures the archive format to be PAX
+     * restricted. It then attempts to open the specified file for writing the
+     * archive. If any operation fails, an appropriate error message is logged,
+     * and an exception is thrown.
+     * 
+     * @param filename The name of the file to be used for the archive.
+     * @param options Tunables for the archive, e.g. the codec, its level and the
+     *        number of compression threads.
+     * 
+     * @throws std::runtime_error If the compression filter cannot be set up,
+     *         the archive file cannot be opened for writing or the base
+     *         manifest of an incremental archive cannot be read.
+     * 
+     * @note XZ stays the default codec for its ability to produce archives with
+     *       minimal size; zstd and lz4 trade ratio for throughput.
+     *
+     * With ArchiverOptions::dedupStore set, no tar stream is created; the file
+     * receives the chunk lists of a DedupArchive instead.
+     */
+    Impl(std::string filename, std::unique_ptr<Backend> libarchive, ArchiverOptions options = {})
+        : libarchive(std::move(libarchive)), Options(options), Writing(true) {
+        ManifestName = filename + MANIFEST_SUFFIX;
+        if (!options.dedupStore.empty()) {
+            if (!options.baseManifest.empty()) {
+                throw std::runtime_error("Incremental mode is not supported by the dedup backend");
+            }
+            if (options.seekable) {
+                throw std::runtime_error("Seekable mode is not supported by the dedup backend");
+            }
+            if (options.outputFd >= 0 || options.outputCallback) {
+                throw std::runtime_error("The dedup backend can only write to a named file");
+            }
+            if (options.checkpoint) {
+                throw std::runtime_error("Checkpoints are not supported by the dedup backend");
+            }
+            Dedup = DedupArchive::Create(filename, options.dedupStore, options.level);
+            if (Dedup == nullptr) {
+                throw std::runtime_error("Failed to open chunk store " + options.dedupStore);
+            }
+            return;
+        }
+
+        if (options.checkpoint) {
+            if (!options.seekable || options.outputFd >= 0 || options.outputCallback) {
+                throw std::runtime_error("Checkpoints need a seekable archive written to a named file");
+            }
+            if (!options.baseManifest.empty()) {
+                throw std::runtime_error("Checkpoints are not supported in incremental mode");
+            }
+        }
+
+        Archive = this->libarchive->archive_write_new();
+        if (options.seekable) {
+            OpenSeekable(filename);
+        } else {
+            if (AddCompressionFilter(Archive) != ARCHIVE_OK) {
+                throw std::runtime_error("Failed to set up " + CodecName(options.codec) + " compression");
+            }
+            this->libarchive->archive_write_set_format_pax_restricted(Archive);
+
+            if (OpenOutput(filename) != ARCHIVE_OK) {
+                throw std::runtime_error("Failed to open archive file");
+            }
+        }
+
+        if (!options.baseManifest.empty()) {
+            Base = Manifest::Open(options.baseManifest);
+            if (Base == nullptr) {
+                throw std::runtime_error("Failed to open base manifest " + options.baseManifest);
+            }
+            BaseState.assign(Base->Size(), Unseen);
+            CollectBaseDirs();
+        }
+    }
+
+    /**
+     * @brief Constructs an Archiver object and initializes it with a default archive name.
+     * 
+     * This constructor also archives the location provided by the given IExplorer instance.
+     * 
+     * @param explorer A pointer to an IExplorer instance used to retrieve the location to be archived.
+     */
+    Impl(IExplorer* explorer, std::unique_ptr<Backend> libarchive, ArchiverOptions options = {}) 
+        : Impl(DefaultArchiveName(options), std::move(libarchive), options) {
+        ArchiveItem(explorer->GetLocation());
+    }
+
+    /**
+     * @brief Destructor for the Archiver class.
+     * 
+     * This destructor ensures proper cleanup of resources used by the Archiver object.
+     * It performs the following actions:
+     * - Closes and frees the main archive object if it is not null.
+     * - Closes the file stream associated with the archive if it is open.
+     * - Closes and frees any additional archive file object if it is not null.
+     * 
+     * Proper cleanup is essential to avoid resource leaks and ensure that all
+     * allocated resources are released when the Archiver object is destroyed.
+     * The archive is completed with Finish first, unless that was done already.
+     */
+    ~Impl() {
+        Finish();
+        if (Archive != nullptr) {
+            libarchive->archive_write_free(Archive);
+        }
+
+        if (FileWithArchive.is_open()) {
+            FileWithArchive.close();
+        }
+
+        if (ArchiveFile != nullptr) {
+            libarchive->archive_write_close(ArchiveFile);
+            libarchive->archive_write_free(ArchiveFile);
+        }
+    }
+
+    /**
+     * @brief Archives a specified item (file or directory) at the given location.
+     *
+     * This function determines whether the provided location corresponds to a 
+     * directory or a regular file and processes it accordingly. Unsupported 
+     * file types are logged for debugging purposes.
+     *
+     * Every archived file is recorded in a manifest written beside the archive
+     * (archive name + MANIFEST_SUFFIX). In incremental mode files unchanged
+     * since the base manifest are skipped and carried over into the new
+     * manifest, and files missing from the tree are added as whiteouts after
+     * the archived files. A path whose type changed gets its whiteout as soon
+     * as the walk finds it, ahead of the files below it.
+     *
+     * When a checkpointed archive was resumed, items completed before the
+     * interruption are skipped and the interrupted one continues after its
+     * last checkpointed file.
+     *
+     * @param location A std::filesystem::directory_entry representing the 
+     *        file or directory to be archived.
+     * 
+     * @return Status indicating the result of the archiving operation:
+     *         - Success: If the item was successfully archived.
+     *         - Other status codes may indicate specific errors or issues.
+     */
+    Status ArchiveItem(std::filesystem::directory_entry location){
+        PhaseTimer timer(Stats.total);
+        //Use below line if archive shall contain the relative path.
+        CutArchivePath(location.path());
+        //Use below line if archive shall contain the absolute path.
+        //PathOfItemToArchive = location.path();
+        /* link targets are stored relative to the item, so links never span items */
+        Links.Clear();
+
+        std::string resumeAfter;
+        if(Journal != nullptr){
+            std::string item = location.path().string();
+            if(std::find(ResumedItems.begin(), ResumedItems.end(), item) != ResumedItems.end()){
+                std::cout << item << " was archived before the interruption" << std::endl;
+                return Success;
+            }
+            resumeAfter = item == Resumed.item ? Resumed.last : std::string();
+            Progress.item = item;
+        }
+
+        std::cout << "Operation in progress... " << std::endl;
+        
+        Status status = Success;
+        if(fs::is_directory(location)){
+            status = AddDirectory(location, resumeAfter);
+        }
+        else if(fs::is_regular_file(location)){
+            if(IsUnchanged(location.path().string())){
+                debug_print("Unchanged, skipping", location.path());
+            }
+            else if(resumeAfter == location.path().string()){
+                info_print("Archived before the interruption, skipping", location.path());
+            }
+            else if(Options.pipelined){
+                bool pending = true;
+                ReadPipeline pipeline([&pending, &location](std::string& path) {
+                    path = location.path().string();
+                    return std::exchange(pending, false);
+                }, Options.ioUring, HardLinks(), Options.prefetchBytes);
+                status = WritePipeline(pipeline);
+            } else {
+                status = AddFile(location);
+            }
+        }
+        else{
+            warning_print("Unsupported file type", location.path());
+        }
+
+        Status snapshotStatus = FinishSnapshot();
+        if(status == Success){
+            status = snapshotStatus;
+        }
+        if(Dedup && Dedup->Flush() != Success && status == Success){
+            status = WriteFailed;
+        }
+        UpdateArchiveBytes();
+        std::cout << "Operation finished!" << std::endl;
+
+        return status;
+    }
+
+    /**
+     * @brief Completes the archive being written: the table of contents of a
+     *        seekable archive, the end of the tar stream and the final flush of
+     *        the compressor, or the chunk lists of the dedup backend.
+     *
+     * Runs once; later calls return the first result. Nothing to do for an
+     * Archiver that only reads archives.
+     *
+     * @return Success, or WriteFailed if the end of the archive could not be written.
+     */
+    Status Finish(){
+        if(!Writing || Finished){
+            return FinishStatus;
+        }
+        Finished = true;
+        PhaseTimer timer(Stats.total);
+        PhaseTimer compressTimer(Stats.compress, &Stats.write);
+        if(Dedup){
+            FinishStatus = Dedup->Close();
+            return FinishStatus;
+        }
+        if(WriteChecksums() != Success){
+            FinishStatus = WriteFailed;
+        }
+        if(OutputFd >= 0 && !FinishSeekable()){
+            FinishStatus = WriteFailed;
+        }
+        if(Archive != nullptr && libarchive->archive_write_close(Archive) != ARCHIVE_OK){
+            error_print("Failed to close archive", libarchive->archive_error_string(Archive));
+            FinishStatus = WriteFailed;
+        }
+        /* a failed archive keeps its journal, a new run continues after the last checkpoint */
+        if(Journal != nullptr && FinishStatus == Success){
+            Journal->Remove();
+        }
+        Journal.reset();
+        UpdateArchiveBytes();
+        return FinishStatus;
+    }
+
+    ArchiverStats GetStats() const {
+        ArchiverStats stats;
+        uint64_t dataBytes = Stats.dataBytes.load(std::memory_order_relaxed);
+        uint64_t archiveBytes = Stats.archiveBytes.load(std::memory_order_relaxed);
+        stats.files = Stats.files.load(std::memory_order_relaxed);
+        stats.bytesRead = Writing ? dataBytes : archiveBytes;
+        stats.bytesWritten = Writing ? archiveBytes : dataBytes;
+        stats.compressionRatio = archiveBytes > 0 ? static_cast<double>(dataBytes) / archiveBytes : 0;
+        stats.walkNs = Stats.walk.load(std::memory_order_relaxed);
+        stats.readNs = Stats.read.load(std::memory_order_relaxed);
+        stats.compressNs = Stats.compress.load(std::memory_order_relaxed);
+        stats.writeNs = Stats.write.load(std::memory_order_relaxed);
+        stats.finishEntryNs = Stats.finishEntry.load(std::memory_order_relaxed);
+        stats.totalNs = Stats.total.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    /**
+     * @brief Compresses data on its own with the codec and level of the
+     *        options, single-threaded, and counts the compressed bytes.
+     *
+     * Uses a raw-format writer of its own, so it may run on any thread while
+     * the archive is written.
+     */
+    bool CompressSample(const char* data, size_t length, uint64_t& compressed){
+        compressed = 0;
+        struct archive* sample = libarchive->archive_write_new();
+        if(sample == nullptr){
+            return false;
+        }
+        bool ok = AddCompressionFilter(sample, false) == ARCHIVE_OK
+            && libarchive->archive_write_set_format_raw(sample) == ARCHIVE_OK
+            && libarchive->archive_write_set_bytes_per_block(sample, 0) == ARCHIVE_OK
+            && libarchive->archive_write_open(sample, &compressed, nullptr, &Impl::CountWrite, nullptr) == ARCHIVE_OK;
+        if(ok){
+            struct archive_entry* entry = libarchive->archive_entry_new();
+            libarchive->archive_entry_set_filetype(entry, AE_IFREG);
+            ok = libarchive->archive_write_header(sample, entry) == ARCHIVE_OK
+                && libarchive->archive_write_data(sample, data, length) >= 0;
+            libarchive->archive_entry_free(entry);
+        }
+        ok = libarchive->archive_write_close(sample) == ARCHIVE_OK && ok;
+        if(!ok){
+            warning_print("Failed to compress sample", libarchive->archive_error_string(sample));
+        }
+        libarchive->archive_write_free(sample);
+        return ok;
+    }
+
+    /** libarchive write callback counting the bytes of a compressed sample. */
+    static la_ssize_t CountWrite(struct archive*, void* client, const void*, size_t length){
+        *static_cast<uint64_t*>(client) += length;
+        return static_cast<la_ssize_t>(length);
+    }
+
+    SizeEstimate Estimate(const fs::directory_entry& location, const SizeEstimator::Compressor& compress){
+        return SizeEstimator::Estimate(location.path().string(), compress, Options.walkerThreads);
+    }
+
+    /**
+     * @brief Extracts the contents of an archive file to the specified location.
+     *
+     * This function reads an archive file, extracts its contents, and writes them
+     * to the specified location on disk. It uses libarchive for handling archive
+     * files and supports multiple archive formats and compression methods.
+     *
+     * Unless ArchiverOptions::extractThreads is 1, this thread only decodes: small
+     * regular files are buffered and created by a pool of writer threads, while
+     * directories, links and large files are written here, streaming. Directories
+     * are created by this thread's disk writer, which is closed only after the
+     * pool has finished, so their permissions and times are applied after all
+     * children exist.
+     *
+     * With ArchiverOptions::nativeWriter, regular files, directories and hard
+     * links are created by a DiskWriter shared with the pool, and its Finish
+     * applies the directory metadata and the durability policy at the end.
+     *
+     * Dedup archives are recognised by their header and restored from their
+     * chunk store instead.
+     *
+     * Whiteout entries of an incremental archive are not extracted; they delete
+     * the file they stand for, so extracting a full archive followed by its
+     * incremental ones reproduces the latest tree. Whiteouts whose path is
+     * absolute, contains ".." or leads through a symbolic link are refused.
+     *
+     * @param location The file path of the archive to be extracted.
+     * @return Status indicating the result of the extraction process:
+     *         - Success: Extraction completed successfully.
+     *         - CriticalError: Failed to create archive reader or writer.
+     *         - CannotOpenFile: Failed to open the specified archive file.
+     *         - AccessFileFailed: Failed to read or write archive headers or entries.
+     *
+     */
+    Status Extract(std::string location){
+        PhaseTimer timer(Stats.total);
+        struct archive_entry *entry;
+        int flags = ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM | ARCHIVE_EXTRACT_FFLAGS;
+        int error_code;
+        Status status = Success;
+
+        std::cout << "Operation in progress... " << std::endl;
+
+        if(!Options.extractDirectory.empty()){
+            std::error_code ec;
+            fs::create_directories(Options.extractDirectory, ec);
+            if(ec){
+                error_print("Cannot create", Options.extractDirectory, ":", ec.message());
+                return CannotOpenFile;
+            }
+        }
+
+        if(Options.inputFd < 0 && DedupArchive::IsDedupArchive(location)){
+            status = DedupArchive::Extract(location, Options.dedupStore, Options.extractDirectory);
+            std::cout << "Operation finished!" << std::endl;
+            return status;
+        }
+
+        /* archive reader configuration */
+        Archive = libarchive->archive_read_new();
+        if(Archive == NULL){
+            error_print("Failed to create archive reader");
+            return CriticalError;
+        }
+        libarchive->archive_read_support_filter_all(Archive);
+        libarchive->archive_read_support_format_all(Archive);
+
+        /* configure creating elements on disk */
+        ArchiveFile = libarchive->archive_write_disk_new();
+        if(ArchiveFile == NULL){
+            error_print("Failed to create archive writer");
+            return CloseExtract(CriticalError);
+        }
+        libarchive->archive_write_disk_set_options(ArchiveFile, flags);
+        libarchive->archive_write_disk_set_standard_lookup(ArchiveFile);
+        
+        error_code = OpenInput(location);
+        if(error_code != ARCHIVE_OK) {
+            error_print("Failed to open archive file", location);
+            error_print("error code: ", error_code);
+            return CloseExtract(CannotOpenFile);
+        }
+
+        std::unique_ptr<DiskWriter> native;
+        if(Options.nativeWriter){
+            native = DiskWriter::Open(Options.extractDirectory.empty() ? "." : Options.extractDirectory, Options.durability);
+            if(!native){
+                return CloseExtract(CriticalError);
+            }
+        }
+
+        /* small files are written by a pool of writer threads */
+        std::unique_ptr<ExtractPool> pool;
+        unsigned int writers = Options.extractThreads == 0 ? std::thread::hardware_concurrency() : Options.extractThreads;
+        if(writers > 1){
+            pool = std::make_unique<ExtractPool>(*libarchive, writers, flags, native.get());
+        }
+
+        do {
+            error_code = ReadHeader(&entry);
+            if (error_code == ARCHIVE_EOF){
+                break;
+            }
+            if (error_code < ARCHIVE_OK){
+                status = AccessFileFailed;
+                error_print("Failed to read archive header", libarchive->archive_error_string(Archive));
+                break;
+            }
+
+            const char* pathname = libarchive->archive_entry_pathname(entry);
+            std::string deleted;
+            if(WhiteoutTarget(entry, deleted)){
+                /* the pool may still be writing below the path */
+                if(pool){
+                    pool->Drain();
+                }
+                Status entryStatus = RemoveWhiteoutTarget(deleted);
+                if(entryStatus != Success && status == Success){
+                    status = entryStatus;
+                }
+                continue;
+            }
+            if(pathname != nullptr && (strcmp(pathname, SEEKABLE_TOC_NAME) == 0 || strcmp(pathname, CHECKSUMS_NAME) == 0)){
+                continue;
+            }
+            if(libarchive->archive_entry_filetype(entry) == AE_IFREG){
+                Stats.files.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            if(pool && IsPoolEntry(entry)){
+                if(!native){
+                    RebaseEntry(entry);
+                }
+                Status entryStatus = SubmitEntry(*pool, entry);
+                if(entryStatus != Success && status == Success){
+                    status = entryStatus;
+                }
+                continue;
+            }
+            /* a hard link needs its target on disk */
+            if(pool && libarchive->archive_entry_hardlink(entry) != nullptr){
+                pool->Drain();
+            }
+
+            if(native && IsNativeEntry(entry)){
+                Status entryStatus = WriteNative(*native, entry);
+                if(entryStatus != Success && status == Success){
+                    status = entryStatus;
+                }
+                continue;
+            }
+
+            RebaseEntry(entry);
+            {
+                PhaseTimer writeTimer(Stats.write);
+                error_code = libarchive->archive_write_header(ArchiveFile, entry);
+            }
+            if (error_code < ARCHIVE_OK){
+                error_print("Failed to write archive header", location);
+                status = AccessFileFailed;
+                break;
+            }
+
+            Status entryStatus = ArchiveEntries(entry);
+            if(entryStatus != Success){
+                debug_print("ArchiveEntries finished with status", entryStatus);
+                if(status == Success){
+                    status = entryStatus;
+                }
+            }
+        } while(true);
+
+        PhaseTimer finishTimer(Stats.finishEntry);
+        if(pool){
+            Status poolStatus = pool->Finish();
+            if(poolStatus != Success && status == Success){
+                status = poolStatus;
+            }
+        }
+        if(native){
+            Status nativeStatus = native->Finish();
+            if(nativeStatus != Success && status == Success){
+                status = nativeStatus;
+            }
+        }
+
+        std::cout << "Operation finished!" << std::endl;
+
+        /* clean up; closing the disk writer applies the deferred directory metadata */
+        Stats.archiveBytes.fetch_add(libarchive->archive_filter_bytes(Archive, -1), std::memory_order_relaxed);
+        return CloseExtract(status);
+    }
+
+    /**
+     * @brief Restores a single entry of a seekable archive.
+     *
+     * The table of contents is located from the end of the file and read from
+     * its own frame. Only the frame holding the entry is decompressed, so the
+     * cost does not depend on the size of the archive.
+     *
+     * @param location The file path of the archive.
+     * @param path Path of the entry inside the archive.
+     * @param destination Directory the entry is restored into.
+     * @return Status Success, CannotOpenFile if the file cannot be opened or is
+     *         not a seekable archive, NotFound if the archive has no such entry,
+     *         or the status of the failed read or write.
+     */
+    Status ExtractPath(const std::string& location, const std::string& path, const std::string& destination){
+        int fd = OpenArchiveFd(location);
+        if(fd < 0){
+            error_print("Failed to open archive file", location);
+            return CannotOpenFile;
+        }
+
+        TocEntry frame;
+        std::string toc;
+        Status status = ReadToc(fd, toc);
+        if(status != Success){
+            error_print("Not a seekable archive", location);
+            CloseArchiveFd(fd);
+            return status;
+        }
+
+        if(!FindTocEntry(toc, path, frame)){
+            error_print("No such entry", path);
+            CloseArchiveFd(fd);
+            return NotFound;
+        }
+        status = ReadFrameEntry(fd, frame, path, destination, nullptr);
+        CloseArchiveFd(fd);
+        return status;
+    }
+
+    /**
+     * @brief Reports every entry of an archive without extracting it.
+     *
+     * Seekable archives are listed from their table of contents, which costs
+     * one small frame. Other archives are scanned header by header and the
+     * entry data is skipped with archive_read_data_skip, which libarchive
+     * turns into seeks when the archive is not compressed; compressed streams
+     * still have to be decoded.
+     *
+     * @param location The file path of the archive.
+     * @param callback Called for every entry, in archive order.
+     * @return Status Success, CriticalError if no reader can be created,
+     *         CannotOpenFile if the archive cannot be opened, or
+     *         AccessFileFailed if a header cannot be read.
+     */
+    Status List(const std::string& location, const std::function<void(const ArchiveListEntry&)>& callback){
+        int fd = OpenArchiveFd(location);
+        if(fd < 0){
+            error_print("Failed to open archive file", location);
+            return CannotOpenFile;
+        }
+        std::string toc;
+        bool seekable = ReadToc(fd, toc) == Success;
+        CloseArchiveFd(fd);
+        if(seekable){
+            size_t position = 0;
+            ArchiveListEntry item;
+            TocEntry entry;
+            while(NextTocEntry(toc, position, item.path, entry)){
+                if(item.path == CHECKSUMS_NAME){
+                    continue;
+                }
+                item.size = entry.size;
+                item.mode = entry.mode;
+                item.mtime = entry.mtime;
+                callback(item);
+            }
+            return Success;
+        }
+
+        Archive = libarchive->archive_read_new();
+        if(Archive == NULL){
+            error_print("Failed to create archive reader");
+            return CriticalError;
+        }
+        libarchive->archive_read_support_filter_all(Archive);
+        libarchive->archive_read_support_format_all(Archive);
+
+        Status status = Success;
+        if(OpenInput(location, false) != ARCHIVE_OK){
+            error_print("Failed to open archive file", location);
+            status = CannotOpenFile;
+        }
+        struct archive_entry *entry;
+        while(status == Success){
+            int error_code = libarchive->archive_read_next_header(Archive, &entry);
+            if(error_code == ARCHIVE_EOF){
+                break;
+            }
+            if(error_code < ARCHIVE_WARN){
+                error_print("Failed to read archive header", libarchive->archive_error_string(Archive));
+                status = AccessFileFailed;
+                break;
+            }
+            const char* pathname = libarchive->archive_entry_pathname(entry);
+            if(pathname != nullptr && strcmp(pathname, SEEKABLE_TOC_NAME) != 0 && strcmp(pathname, CHECKSUMS_NAME) != 0){
+                ArchiveListEntry item;
+                item.path = pathname;
+                item.size = libarchive->archive_entry_size(entry);
+                item.mode = libarchive->archive_entry_mode(entry);
+                item.mtime = libarchive->archive_entry_mtime(entry) * 1000000000LL + libarchive->archive_entry_mtime_nsec(entry);
+                callback(item);
+            }
+            if(libarchive->archive_read_data_skip(Archive) < ARCHIVE_WARN){
+                error_print("Failed to skip archive data", libarchive->archive_error_string(Archive));
+                status = AccessFileFailed;
+            }
+        }
+
+        libarchive->archive_read_close(Archive);
+        libarchive->archive_read_free(Archive);
+        Archive = NULL;
+        return status;
+    }
+
+    /**
+     * @brief Checks the content of every regular file of an archive against
+     *        the checksums recorded when it was written, without writing
+     *        anything to disk.
+     *
+     * Seekable archives are verified frame by frame, the frames decoded and
+     * hashed in parallel on extractThreads threads. Other archives are
+     * decoded by this thread, which hands the data to a HashPool of
+     * extractThreads hashing threads.
+     *
+     * @param location The file path of the archive.
+     * @param result Receives the counts and the paths that failed.
+     * @return Status Success if every file matches its checksum,
+     *         ChecksumMismatch if a file differs or is missing, NotFound if
+     *         the archive has no checksums, CannotOpenFile if it cannot be
+     *         opened or is a dedup archive, or AccessFileFailed if it cannot
+     *         be read.
+     */
+    Status Verify(const std::string& location, VerifyResult& result){
+        PhaseTimer timer(Stats.total);
+        result = VerifyResult();
+        if(Options.inputFd < 0 && DedupArchive::IsDedupArchive(location)){
+            info_print("Dedup archives are not verified, their chunks are checked by the store");
+            return CannotOpenFile;
+        }
+        unsigned int threads = Options.extractThreads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : Options.extractThreads;
+        std::vector<std::pair<std::string, uint64_t>> digests;
+        std::string recorded;
+        bool hasRecorded = false;
+
+        int fd = OpenArchiveFd(location);
+        if(fd < 0){
+            error_print("Failed to open archive file", location);
+            return CannotOpenFile;
+        }
+        std::string toc;
+        TocEntry tocFrame;
+        /* a plain xz archive is one stream, which LocateToc takes for the TOC frame */
+        bool seekable = LocateToc(fd, tocFrame) && tocFrame.frameOffset > 0 && ReadToc(fd, toc) == Success;
+        Status status = seekable ? VerifyFrames(fd, toc, threads, digests, recorded, hasRecorded)
+            : VerifyStream(location, threads, digests, recorded, hasRecorded);
+        CloseArchiveFd(fd);
+        if(status != Success){
+            return status;
+        }
+        return CompareChecksums(digests, hasRecorded, recorded, result);
+    }
+
+private:
+    private:
+    /* private fields */
+    std::unique_ptr<Backend> libarchive;
+    struct archive* Archive = nullptr;
+    struct archive* ArchiveFile = nullptr;
+    std::ofstream FileWithArchive;
+    std::string PathOfItemToArchive;
+    ArchiverOptions Options;
+    std::vector<char> ReadBuffer;
+
+    /* State of a base manifest entry during an incremental run. */
+    enum BaseEntryState : unsigned char {
+        Unseen,
+        Changed,
+        Unchanged,
+        /* replaced by a directory, whiteout already queued */
+        Deleted
+    };
+    std::string ManifestName;
+    ManifestWriter Snapshot;
+    std::unique_ptr<Manifest> Base;
+    std::vector<unsigned char> BaseState;
+    /* sorted hashes of the directories holding base entries, see CollectBaseDirs */
+    std::vector<uint64_t> BaseDirs;
+    /* whiteouts of changed types found by the walk, written by the archiving thread */
+    std::mutex WhiteoutLock;
+    std::vector<std::string> PendingWhiteouts;
+    std::unique_ptr<DedupArchive> Dedup;
+    /* first archived path of every multiply linked file */
+    LinkTable Links;
+
+    /* constructed to write an archive, completed once by Finish */
+    bool Writing = false;
+    bool Finished = false;
+    Status FinishStatus = Success;
+    StatCounters Stats;
+
+    /* seekable output: frame being compressed and the table of contents */
+    int OutputFd = -1;
+    bool OwnsOutputFd = true;
+
+    /* io_uring archive file I/O, null when disabled or unavailable */
+    std::unique_ptr<RingOutput> RingOut;
+    std::unique_ptr<RingInput> RingIn;
+    struct archive* Frame = nullptr;
+    uint64_t OutputOffset = 0;
+    uint64_t FrameOffset = 0;
+    uint64_t FrameRawSize = 0;
+    std::vector<std::pair<std::string, TocEntry>> FrameEntries;
+    std::string Toc;
+    /* checksum list of the files written so far, see checksums.h */
+    std::string Checksums;
+    /* newest mtime of the archived files, the mtime of the checksum list */
+    int64_t NewestMtime = 0;
+
+    /* checkpointing: the journal, the progress it held when the archive was
+       opened and what the next checkpoint appends */
+    std::unique_ptr<CheckpointJournal> Journal;
+    Checkpoint Resumed;
+    std::vector<std::string> ResumedItems;
+    Checkpoint Progress;
+    uint64_t CheckpointOffset = 0;
+    size_t CheckpointTocSize = 0;
+    size_t CheckpointChecksumsSize = 0;
+
+    /**
+     * @brief A byte range of the archive file read by libarchive.
+     */
+    struct FrameSource {
+        int fd;
+        uint64_t position;
+        uint64_t end;
+        std::vector<char> buffer;
+    };
+
+    /**
+     * @brief Hashes the data of the current entry of reader into sink, holes
+     *        of sparse entries as zeros.
+     * @return ARCHIVE_OK, or the error code of the failed read.
+     */
+    template<typename Sink>
+    int HashEntryData(struct archive* reader, struct archive_entry* entry, Sink& sink){
+        uint64_t position = 0;
+        while(true){
+            const void* buff;
+            size_t size;
+            la_int64_t offset;
+            int error_code = libarchive->archive_read_data_block(reader, &buff, &size, &offset);
+            if(error_code == ARCHIVE_EOF){
+                break;
+            }
+            if(error_code < ARCHIVE_WARN){
+                error_print("Failed to read archive data", libarchive->archive_error_string(reader));
+                return error_code;
+            }
+            if(static_cast<uint64_t>(offset) > position){
+                sink.Zeros(offset - position);
+                position = offset;
+            }
+            sink.Update(buff, size);
+            position += size;
+            Stats.dataBytes.fetch_add(size, std::memory_order_relaxed);
+        }
+        uint64_t size = libarchive->archive_entry_size(entry);
+        if(size > position){
+            sink.Zeros(size - position);
+        }
+        return ARCHIVE_OK;
+    }
+
+    /** Reads the data of the current entry of reader into data. */
+    bool ReadEntryText(struct archive* reader, std::string& data){
+        while(true){
+            const void* buff;
+            size_t size;
+            la_int64_t offset;
+            int error_code = libarchive->archive_read_data_block(reader, &buff, &size, &offset);
+            if(error_code == ARCHIVE_EOF){
+                return true;
+            }
+            if(error_code < ARCHIVE_WARN){
+                error_print("Failed to read archive data", libarchive->archive_error_string(reader));
+                return false;
+            }
+            data.append(static_cast<const char*>(buff), size);
+        }
+    }
+
+    /** Tells whether an entry carries file data covered by the checksums. */
+    bool IsHashedEntry(struct archive_entry* entry){
+        const char* pathname = libarchive->archive_entry_pathname(entry);
+        std::string deleted;
+        return pathname != nullptr
+            && libarchive->archive_entry_filetype(entry) == AE_IFREG
+            && libarchive->archive_entry_hardlink(entry) == nullptr
+            && strcmp(pathname, SEEKABLE_TOC_NAME) != 0
+            && !WhiteoutTarget(entry, deleted);
+    }
+
+    /**
+     * @brief Decodes the archive as one stream and hashes its files on a HashPool.
+     */
+    Status VerifyStream(const std::string& location, unsigned int threads, std::vector<std::pair<std::string, uint64_t>>& digests, std::string& recorded, bool& hasRecorded){
+        Archive = libarchive->archive_read_new();
+        if(Archive == NULL){
+            error_print("Failed to create archive reader");
+            return CriticalError;
+        }
+        libarchive->archive_read_support_filter_all(Archive);
+        libarchive->archive_read_support_format_all(Archive);
+
+        Status status = Success;
+        if(OpenInput(location) != ARCHIVE_OK){
+            error_print("Failed to open archive file", location);
+            status = CannotOpenFile;
+        }
+        HashPool pool(threads);
+        struct archive_entry* entry;
+        while(status == Success){
+            int error_code = ReadHeader(&entry);
+            if(error_code == ARCHIVE_EOF){
+                break;
+            }
+            if(error_code < ARCHIVE_WARN){
+                error_print("Failed to read archive header", libarchive->archive_error_string(Archive));
+                status = AccessFileFailed;
+                break;
+            }
+            const char* pathname = libarchive->archive_entry_pathname(entry);
+            if(pathname != nullptr && strcmp(pathname, CHECKSUMS_NAME) == 0){
+                hasRecorded = ReadEntryText(Archive, recorded);
+                continue;
+            }
+            if(!IsHashedEntry(entry)){
+                continue;
+            }
+            Stats.files.fetch_add(1, std::memory_order_relaxed);
+            pool.Begin(pathname);
+            PhaseTimer readTimer(Stats.read);
+            if(HashEntryData(Archive, entry, pool) != ARCHIVE_OK){
+                status = AccessFileFailed;
+            }
+            pool.End();
+        }
+        digests = pool.Finish();
+
+        Stats.archiveBytes.fetch_add(libarchive->archive_filter_bytes(Archive, -1), std::memory_order_relaxed);
+        libarchive->archive_read_close(Archive);
+        libarchive->archive_read_free(Archive);
+        Archive = NULL;
+        return status;
+    }
+
+    /**
+     * @brief XXH64 of one entry, with the interface HashEntryData expects.
+     */
+    struct EntryHash {
+        Xxh64 hash;
+
+        void Update(const void* data, size_t length){
+            hash.Update(data, length);
+        }
+
+        void Zeros(uint64_t length){
+            for(uint64_t hashed = 0; hashed < length;){
+                size_t step = std::min<uint64_t>(length - hashed, SPARSE_ZEROS_SIZE);
+                hash.Update(SparseZeros(), step);
+                hashed += step;
+            }
+        }
+    };
+
+    /**
+     * @brief Decodes and hashes the frames of a seekable archive in parallel.
+     *
+     * Every thread takes the next frame, decodes it with a reader of its own
+     * and hashes its entries; frames hold whole entries, so no entry spans
+     * two threads.
+     */
+    Status VerifyFrames(int fd, const std::string& toc, unsigned int threads, std::vector<std::pair<std::string, uint64_t>>& digests, std::string& recorded, bool& hasRecorded){
+        std::map<uint64_t, uint64_t> frameSizes;
+        size_t position = 0;
+        std::string path;
+        TocEntry tocEntry;
+        while(NextTocEntry(toc, position, path, tocEntry)){
+            frameSizes[tocEntry.frameOffset] = tocEntry.frameSize;
+        }
+        std::vector<std::pair<uint64_t, uint64_t>> frames(frameSizes.begin(), frameSizes.end());
+
+        std::atomic<size_t> next{0};
+        std::mutex lock;
+        Status status = Success;
+        auto verifyFrames = [&]() {
+            std::vector<std::pair<std::string, uint64_t>> local;
+            std::string text;
+            bool hasText = false;
+            Status localStatus = Success;
+            for(size_t index = next++; index < frames.size() && localStatus == Success; index = next++){
+                FrameSource source{fd, frames[index].first, frames[index].first + frames[index].second, std::vector<char>(DATA_BLOCK_SIZE)};
+                struct archive* reader = libarchive->archive_read_new();
+                if(reader == NULL){
+                    localStatus = CriticalError;
+                    break;
+                }
+                libarchive->archive_read_support_filter_all(reader);
+                libarchive->archive_read_support_format_all(reader);
+                if(libarchive->archive_read_open(reader, &source, nullptr, &Impl::FrameRead, nullptr) != ARCHIVE_OK){
+                    error_print("Failed to open frame", libarchive->archive_error_string(reader));
+                    localStatus = AccessFileFailed;
+                }
+                struct archive_entry* entry;
+                while(localStatus == Success){
+                    int error_code = libarchive->archive_read_next_header(reader, &entry);
+                    if(error_code == ARCHIVE_EOF){
+                        break;
+                    }
+                    if(error_code < ARCHIVE_WARN){
+                        error_print("Failed to read archive header", libarchive->archive_error_string(reader));
+                        localStatus = AccessFileFailed;
+                        break;
+                    }
+                    const char* pathname = libarchive->archive_entry_pathname(entry);
+                    if(pathname != nullptr && strcmp(pathname, CHECKSUMS_NAME) == 0){
+                        hasText = ReadEntryText(reader, text);
+                        continue;
+                    }
+                    if(!IsHashedEntry(entry)){
+                        continue;
+                    }
+                    Stats.files.fetch_add(1, std::memory_order_relaxed);
+                    EntryHash hash;
+                    if(HashEntryData(reader, entry, hash) != ARCHIVE_OK){
+                        localStatus = AccessFileFailed;
+                        break;
+                    }
+                    local.emplace_back(pathname, hash.hash.Digest());
+                }
+                libarchive->archive_read_close(reader);
+                libarchive->archive_read_free(reader);
+                Stats.archiveBytes.fetch_add(frames[index].second, std::memory_order_relaxed);
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            digests.insert(digests.end(), local.begin(), local.end());
+            if(hasText){
+                recorded = std::move(text);
+                hasRecorded = true;
+            }
+            if(localStatus != Success && status == Success){
+                status = localStatus;
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for(unsigned int i = 1; i < std::min<size_t>(threads, frames.size()); i++){
+            workers.emplace_back(verifyFrames);
+        }
+        verifyFrames();
+        for(auto& worker : workers){
+            worker.join();
+        }
+        return status;
+    }
+
+    /**
+     * @brief Compares the computed digests with the recorded checksum list.
+     */
+    Status CompareChecksums(const std::vector<std::pair<std::string, uint64_t>>& digests, bool hasRecorded, const std::string& recorded, VerifyResult& result){
+        result.files = digests.size();
+        if(!hasRecorded){
+            error_print("The archive has no checksums");
+            return NotFound;
+        }
+        std::map<std::string, uint64_t> expected;
+        if(!ParseChecksums(recorded, expected)){
+            error_print("Malformed checksum list");
+            return AccessFileFailed;
+        }
+        for(const auto& [path, digest] : digests){
+            auto checksum = expected.find(path);
+            if(checksum == expected.end()){
+                result.unrecorded.push_back(path);
+                continue;
+            }
+            if(checksum->second == digest){
+                result.verified++;
+            } else {
+                result.mismatched.push_back(path);
+            }
+            expected.erase(checksum);
+        }
+        for(const auto& [path, digest] : expected){
+            result.missing.push_back(path);
+        }
+        return result.mismatched.empty() && result.missing.empty() ? Success : ChecksumMismatch;
+    }
+
+    /**
+     * @brief Records the content checksum of a file whose data was archived.
+     */
+    void RecordChecksum(const std::string& location, uint64_t digest){
+        if(Options.checksums && !Dedup){
+            AppendChecksum(Checksums, ArchivePath(location), digest);
+        }
+    }
+
+    /**
+     * @brief Writes the checksum list as the CHECKSUMS_NAME entry.
+     *
+     * It follows all files since a tar header precedes the data it describes,
+     * while a file's digest is only known once its data has been written.
+     * It carries the newest mtime of the archived files rather than the
+     * current time, so archives of the same tree stay byte-identical.
+     */
+    Status WriteChecksums(){
+        if(!Options.checksums || Archive == nullptr){
+            return Success;
+        }
+        Status status = WriteEntryHeader(CHECKSUMS_NAME, Checksums.size(), NewestMtime);
+        if(status == Success && !Checksums.empty()){
+            status = WriteBlock(Checksums.data(), Checksums.size(), CHECKSUMS_NAME);
+        }
+        if(FinishEntry() != Success && status == Success){
+            status = WriteFailed;
+        }
+        return status;
+    }
+
+    /**
+     * @brief Adds the compression filter selected in the options.
+     *
+     * The level is passed as the filter's compression-level option. For zstd,
+     * long mode enables long-distance matching with a ZSTD_LONG_WINDOW_LOG
+     * window.
+     *
+     * @param archive The archive writer to configure.
+     * @param threaded Apply the thread count of the options.
+     * @return ARCHIVE_OK, or the error code of the failed libarchive call.
+     */
+    int AddCompressionFilter(struct archive* archive, bool threaded = true){
+        int error_code = ARCHIVE_OK;
+        switch(Options.codec){
+        case Codec::Xz:
+            error_code = libarchive->archive_write_add_filter_xz(archive);
+            break;
+        case Codec::Zstd:
+            error_code = libarchive->archive_write_add_filter_zstd(archive);
+            break;
+        case Codec::Lz4:
+            error_code = libarchive->archive_write_add_filter_lz4(archive);
+            break;
+        case Codec::Gzip:
+            error_code = libarchive->archive_write_add_filter_gzip(archive);
+            break;
+        case Codec::None:
+            return libarchive->archive_write_add_filter_none(archive);
+        }
+        if(error_code != ARCHIVE_OK){
+            error_print("Failed to add compression filter", libarchive->archive_error_string(archive));
+            return error_code;
+        }
+
+        std::string module = CodecName(Options.codec);
+        if(Options.level != CODEC_DEFAULT_LEVEL){
+            std::string level = std::to_string(Options.level);
+            error_code = libarchive->archive_write_set_filter_option(archive, module.c_str(), "compression-level", level.c_str());
+            if(error_code < ARCHIVE_OK){
+                warning_print("Unsupported compression level", level, libarchive->archive_error_string(archive));
+                return error_code;
+            }
+        }
+        if(Options.codec == Codec::Zstd && Options.longMode){
+            std::string windowLog = std::to_string(ZSTD_LONG_WINDOW_LOG);
+            if(libarchive->archive_write_set_filter_option(archive, module.c_str(), "long", windowLog.c_str()) < ARCHIVE_OK){
+                warning_print("zstd long mode not available", libarchive->archive_error_string(archive));
+            }
+        }
+        if(threaded && IsThreadedCodec(Options.codec)){
+            SetCompressionThreads(archive, Options.threads);
+        }
+        return ARCHIVE_OK;
+    }
+
+    /**
+     * @brief Enables multi-threaded compression for xz and zstd.
+     *
+     * liblzma and libzstd split the stream into independent blocks and compress
+     * them on the requested number of worker threads. If libarchive was built
+     * without threaded support the option is rejected and compression silently
+     * stays single-threaded.
+     *
+     * @param archive The archive writer to configure.
+     * @param threads Number of worker threads, 0 selects one per available core.
+     */
+    void SetCompressionThreads(struct archive* archive, unsigned int threads){
+        if(threads == 0){
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::string module = CodecName(Options.codec);
+        std::string value = std::to_string(threads);
+        if(libarchive->archive_write_set_filter_option(archive, module.c_str(), "threads", value.c_str()) < ARCHIVE_OK){
+            warning_print("Threaded compression not available, using single thread", libarchive->archive_error_string(archive));
+        }
+    }
+
+    /**
+     * @brief Sets up the seekable output.
+     *
+     * libarchive writes an uncompressed tar stream into TarWrite, unblocked,
+     * so the stream position is known at every entry boundary. The stream is
+     * compressed frame by frame by nested raw-format writers with the selected
+     * filter, whose output goes to the archive file through FrameWrite.
+     *
+     * @throws std::runtime_error If the codec cannot produce frames or the
+     *         archive file cannot be opened.
+     */
+    void OpenSeekable(const std::string& filename){
+        if (!IsSeekableCodec(Options.codec)) {
+            throw std::runtime_error("Seekable archives need the xz, zstd or lz4 codec");
+        }
+        if (Options.outputCallback) {
+            throw std::runtime_error("Seekable archives cannot be written to a callback");
+        }
+        OwnsOutputFd = Options.outputFd < 0;
+        if (Options.checkpoint) {
+            OutputFd = OpenCheckpointed(filename);
+        } else {
+            OutputFd = OwnsOutputFd ? open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : Options.outputFd;
+        }
+        if (OutputFd < 0) {
+            throw std::runtime_error("Failed to open archive file");
+        }
+        libarchive->archive_write_add_filter_none(Archive);
+        libarchive->archive_write_set_format_pax_restricted(Archive);
+        libarchive->archive_write_set_bytes_per_block(Archive, 0);
+        if (!StartFrame()) {
+            throw std::runtime_error("Failed to set up " + CodecName(Options.codec) + " compression");
+        }
+        if (libarchive->archive_write_open(Archive, this, nullptr, &Impl::TarWrite, nullptr) != ARCHIVE_OK) {
+            throw std::runtime_error("Failed to open archive file");
+        }
+    }
+
+    /**
+     * @brief Opens the archive file of a checkpointed run and its journal.
+     *
+     * When the journal of an interrupted run is found and the file holds
+     * every byte it covers, the file is cut back to the last checkpoint and
+     * the table of contents, checksums and manifest entries written up to
+     * there are restored; otherwise the archive and journal start empty.
+     *
+     * @return The descriptor, positioned where writing continues, or -1.
+     */
+    int OpenCheckpointed(const std::string& filename){
+        std::string journalName = filename + CHECKPOINT_SUFFIX;
+        Journal = CheckpointJournal::Resume(journalName, Options.codec, Resumed, ResumedItems);
+        if (Journal != nullptr) {
+            int fd = open(filename.c_str(), O_WRONLY | O_CLOEXEC);
+            struct stat st;
+            if (fd >= 0 && fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_size) >= Resumed.offset
+                && ftruncate(fd, Resumed.offset) == 0 && lseek(fd, Resumed.offset, SEEK_SET) == static_cast<off_t>(Resumed.offset)) {
+                OutputOffset = CheckpointOffset = Resumed.offset;
+                Toc = Resumed.toc;
+                CheckpointTocSize = Toc.size();
+                if (Options.checksums) {
+                    Checksums = Resumed.checksums;
+                    CheckpointChecksumsSize = Checksums.size();
+                }
+                size_t position = 0;
+                ManifestEntry record;
+                while (NextRecord(Resumed.records, position, record)) {
+                    Snapshot.Add(record);
+                }
+                /* only the resume point is needed from here on */
+                Resumed.toc = Resumed.checksums = Resumed.records = std::string();
+                std::cout << "Resuming " << filename << " after " << Resumed.last << std::endl;
+                return fd;
+            }
+            warning_print("Archive does not hold what its journal records, starting over", filename);
+            if (fd >= 0) {
+                close(fd);
+            }
+            Resumed = Checkpoint();
+            ResumedItems.clear();
+        }
+
+        int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd >= 0) {
+            Journal = CheckpointJournal::Create(journalName, Options.codec);
+            if (Journal == nullptr) {
+                close(fd);
+                throw std::runtime_error("Failed to create checkpoint journal " + journalName);
+            }
+        }
+        return fd;
+    }
+
+    /**
+     * @brief Appends a checkpoint once a frame has been completed and
+     *        ArchiverOptions::checkpointBytes were written since the last one.
+     *
+     * Called after a file was recorded. With no frame open, every recorded
+     * file lies in completed frames; the archive is synced before the
+     * checkpoint that lets a restarted run continue after them. A failed
+     * checkpoint is retried at the next opportunity.
+     */
+    void WriteCheckpoint(){
+        if(Journal == nullptr || Frame != nullptr || OutputOffset - CheckpointOffset < Options.checkpointBytes){
+            return;
+        }
+        PhaseTimer timer(Stats.write);
+        if(fdatasync(OutputFd) != 0){
+            warning_print("Failed to sync archive, checkpoint skipped:", strerror(errno));
+            return;
+        }
+        Progress.offset = OutputOffset;
+        Progress.toc = Toc.substr(CheckpointTocSize);
+        Progress.checksums = Checksums.substr(CheckpointChecksumsSize);
+        if(Journal->Append(Progress) != Success){
+            return;
+        }
+        CheckpointOffset = OutputOffset;
+        CheckpointTocSize = Toc.size();
+        CheckpointChecksumsSize = Checksums.size();
+        Progress.records.clear();
+    }
+
+    /**
+     * @brief Opens the archive writer on its destination.
+     *
+     * A descriptor or callback gets ARCHIVE_OUTPUT_BLOCK_SIZE writes, which
+     * keeps pipes and network sinks busy with few system calls, and a short
+     * last block instead of padding.
+     *
+     * @return ARCHIVE_OK, or the libarchive error code.
+     */
+    int OpenOutput(const std::string& filename){
+        if (Options.outputFd < 0 && !Options.outputCallback && Options.ioUring) {
+            RingOut = RingOutput::Open(filename, Options.directIo);
+            if (RingOut != nullptr) {
+                /* same blocking as archive_write_open_filename, so the bytes do not change */
+                libarchive->archive_write_set_bytes_in_last_block(Archive, 1);
+                return libarchive->archive_write_open(Archive, this, nullptr, &Impl::RingWrite, &Impl::RingClose);
+            }
+            warning_print("io_uring unavailable, writing", filename, "with write()");
+        }
+        if (Options.outputFd < 0 && !Options.outputCallback) {
+            return libarchive->archive_write_open_filename(Archive, filename.c_str());
+        }
+        libarchive->archive_write_set_bytes_per_block(Archive, ARCHIVE_OUTPUT_BLOCK_SIZE);
+        libarchive->archive_write_set_bytes_in_last_block(Archive, 1);
+        if (Options.outputCallback) {
+            return libarchive->archive_write_open(Archive, this, nullptr, &Impl::CallbackWrite, nullptr);
+        }
+        return libarchive->archive_write_open_fd(Archive, Options.outputFd);
+    }
+
+    /** libarchive write callback forwarding the archive to outputCallback. */
+    static la_ssize_t CallbackWrite(struct archive*, void* client, const void* buffer, size_t length){
+        Impl* self = static_cast<Impl*>(client);
+        PhaseTimer timer(self->Stats.write);
+        if(!self->Options.outputCallback(static_cast<const char*>(buffer), length)){
+            error_print("Archive output callback failed");
+            return -1;
+        }
+        return static_cast<la_ssize_t>(length);
+    }
+
+    /** libarchive write callback of the io_uring output. */
+    static la_ssize_t RingWrite(struct archive*, void* client, const void* buffer, size_t length){
+        Impl* self = static_cast<Impl*>(client);
+        PhaseTimer timer(self->Stats.write);
+        return self->RingOut->Write(static_cast<const char*>(buffer), length) ? static_cast<la_ssize_t>(length) : -1;
+    }
+
+    static int RingClose(struct archive*, void* client){
+        Impl* self = static_cast<Impl*>(client);
+        return self->RingOut->Close() ? ARCHIVE_OK : ARCHIVE_FATAL;
+    }
+
+    /** libarchive read callback of the io_uring input. */
+    static la_ssize_t RingRead(struct archive*, void* client, const void** buffer){
+        Impl* self = static_cast<Impl*>(client);
+        const char* data = nullptr;
+        ssize_t length = self->RingIn->Read(&data);
+        *buffer = data;
+        return length;
+    }
+
+    /**
+     * @brief Opens the archive reader on the input descriptor or the named file.
+     * @param readAhead Read the named file through io_uring if enabled; off
+     *        where data is skipped, as plain files can seek over it.
+     * @return ARCHIVE_OK, or the libarchive error code.
+     */
+    int OpenInput(const std::string& location, bool readAhead = true){
+        if (Options.inputFd >= 0) {
+            return libarchive->archive_read_open_fd(Archive, Options.inputFd, DATA_BLOCK_SIZE);
+        }
+        RingIn = readAhead && Options.ioUring ? RingInput::Open(location) : nullptr;
+        if (RingIn != nullptr) {
+            return libarchive->archive_read_open(Archive, this, nullptr, &Impl::RingRead, nullptr);
+        }
+        return libarchive->archive_read_open_filename(Archive, location.c_str(), DATA_BLOCK_SIZE);
+    }
+
+    /**
+     * @brief Frees the reader and the disk writer of Extract, whichever were created.
+     *
+     * Archive holds a read handle here, which the destructor would release
+     * as a write handle, so every return of Extract goes through this.
+     */
+    Status CloseExtract(Status status){
+        if (Archive != nullptr) {
+            libarchive->archive_read_close(Archive);
+            libarchive->archive_read_free(Archive);
+            Archive = NULL;
+        }
+        if (ArchiveFile != nullptr) {
+            libarchive->archive_write_close(ArchiveFile);
+            libarchive->archive_write_free(ArchiveFile);
+            ArchiveFile = NULL;
+        }
+        return status;
+    }
+
+    /** Descriptor for positioned reads of the archive: the input descriptor, or the named file opened. */
+    int OpenArchiveFd(const std::string& location){
+        return Options.inputFd >= 0 ? Options.inputFd : open(location.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+
+    void CloseArchiveFd(int fd){
+        if (fd != Options.inputFd) {
+            close(fd);
+        }
+    }
+
+    /** libarchive write callback of the uncompressed tar stream. */
+    static la_ssize_t TarWrite(struct archive*, void* client, const void* buffer, size_t length){
+        Impl* self = static_cast<Impl*>(client);
+        if(self->Frame == nullptr && !self->StartFrame()){
+            return -1;
+        }
+        if(self->libarchive->archive_write_data(self->Frame, buffer, length) < 0){
+            error_print("Failed to compress frame", self->libarchive->archive_error_string(self->Frame));
+            return -1;
+        }
+        self->FrameRawSize += length;
+        return static_cast<la_ssize_t>(length);
+    }
+
+    /** libarchive write callback of the compressed frames. */
+    static la_ssize_t FrameWrite(struct archive*, void* client, const void* buffer, size_t length){
+        Impl* self = static_cast<Impl*>(client);
+        PhaseTimer timer(self->Stats.write);
+        const char* bytes = static_cast<const char*>(buffer);
+        for(size_t done = 0; done < length;){
+            ssize_t written = write(self->OutputFd, bytes + done, length - done);
+            if(written < 0 && errno == EINTR){
+                continue;
+            }
+            if(written <= 0){
+                error_print("Failed to write archive file:", strerror(errno));
+                return -1;
+            }
+            done += written;
+        }
+        self->OutputOffset += length;
+        self->Stats.archiveBytes.fetch_add(length, std::memory_order_relaxed);
+        return static_cast<la_ssize_t>(length);
+    }
+
+    /**
+     * @brief Opens a new frame, an independent compressed stream holding a raw payload.
+     */
+    bool StartFrame(){
+        Frame = libarchive->archive_write_new();
+        if(Frame == nullptr){
+            return false;
+        }
+        /* frames are far smaller than the block size of the threaded encoders */
+        bool ok = AddCompressionFilter(Frame, false) == ARCHIVE_OK
+            && libarchive->archive_write_set_format_raw(Frame) == ARCHIVE_OK
+            && libarchive->archive_write_set_bytes_per_block(Frame, 0) == ARCHIVE_OK
+            && libarchive->archive_write_open(Frame, this, nullptr, &Impl::FrameWrite, nullptr) == ARCHIVE_OK;
+        if(ok){
+            struct archive_entry* entry = libarchive->archive_entry_new();
+            libarchive->archive_entry_set_filetype(entry, AE_IFREG);
+            ok = libarchive->archive_write_header(Frame, entry) == ARCHIVE_OK;
+            libarchive->archive_entry_free(entry);
+        }
+        if(!ok){
+            error_print("Failed to start frame", libarchive->archive_error_string(Frame));
+            libarchive->archive_write_free(Frame);
+            Frame = nullptr;
+            return false;
+        }
+        FrameOffset = OutputOffset;
+        FrameRawSize = 0;
+        return true;
+    }
+
+    /**
+     * @brief Completes the current frame and records its entries in the table of contents.
+     */
+    bool EndFrame(){
+        if(Frame == nullptr){
+            return true;
+        }
+        bool ok = libarchive->archive_write_close(Frame) == ARCHIVE_OK;
+        libarchive->archive_write_free(Frame);
+        Frame = nullptr;
+
+        for(auto& [path, entry] : FrameEntries){
+            entry.frameOffset = FrameOffset;
+            entry.frameSize = OutputOffset - FrameOffset;
+            AppendTocEntry(Toc, path, entry);
+        }
+        FrameEntries.clear();
+        return ok;
+    }
+
+    /**
+     * @brief Completes an entry of a seekable archive.
+     *
+     * The entry padding is flushed and the frame is closed once it holds at
+     * least SEEKABLE_FRAME_SIZE bytes, so frames always start with a header.
+     */
+    Status FinishEntry(){
+        PhaseTimer timer(Stats.finishEntry, &Stats.write);
+        if(OutputFd < 0){
+            return Success;
+        }
+        if(libarchive->archive_write_finish_entry(Archive) < ARCHIVE_OK){
+            error_print("Failed to finish entry", libarchive->archive_error_string(Archive));
+            return WriteFailed;
+        }
+        if(FrameRawSize >= SEEKABLE_FRAME_SIZE && !EndFrame()){
+            return WriteFailed;
+        }
+        return Success;
+    }
+
+    /**
+     * @brief Writes the table of contents, the end of the tar stream and the trailer.
+     *
+     * The TOC entry and the end-of-archive blocks form the last frame.
+     *
+     * @return false if the archive could not be completed.
+     */
+    bool FinishSeekable(){
+        bool ok = EndFrame();
+        uint64_t tocOffset = OutputOffset;
+        ok = ok && WriteEntryHeader(SEEKABLE_TOC_NAME, Toc.size()) == Success
+            && WriteBlock(Toc.data(), Toc.size(), SEEKABLE_TOC_NAME) == Success;
+        ok = libarchive->archive_write_close(Archive) == ARCHIVE_OK && ok;
+        ok = EndFrame() && ok;
+
+        std::string trailer = SeekableTrailer(Options.codec, tocOffset);
+        ok = ok && (trailer.empty() || FrameWrite(nullptr, this, trailer.data(), trailer.size()) >= 0);
+        if(!ok){
+            warning_print("Failed to complete seekable archive, single entries cannot be extracted");
+        }
+        if(OwnsOutputFd){
+            close(OutputFd);
+        }
+        OutputFd = -1;
+        return ok;
+    }
+
+    /**
+     * @brief Reads the table of contents of a seekable archive.
+     * @return Success, CannotOpenFile if the file is not a seekable archive,
+     *         or the status of the failed read.
+     */
+    Status ReadToc(int fd, std::string& toc){
+        TocEntry frame;
+        if(!LocateToc(fd, frame)){
+            return CannotOpenFile;
+        }
+        Status status = ReadFrameEntry(fd, frame, SEEKABLE_TOC_NAME, "", &toc);
+        return status == NotFound ? CannotOpenFile : status;
+    }
+
+    /** libarchive read callback serving one frame of the archive file. */
+    static la_ssize_t FrameRead(struct archive*, void* client, const void** buffer){
+        FrameSource* source = static_cast<FrameSource*>(client);
+        size_t length = static_cast<size_t>(std::min<uint64_t>(source->buffer.size(), source->end - source->position));
+        if(length == 0){
+            return 0;
+        }
+        ssize_t bytesRead = pread(source->fd, source->buffer.data(), length, source->position);
+        if(bytesRead < 0){
+            return -1;
+        }
+        source->position += bytesRead;
+        *buffer = source->buffer.data();
+        return bytesRead;
+    }
+
+    /**
+     * @brief Decodes one frame and reads or restores the entry named path.
+     *
+     * @param data If set, receives the data of the entry; otherwise the entry
+     *        is written to disk below destination.
+     * @return Success, NotFound if the frame has no such entry, or an error status.
+     */
+    Status ReadFrameEntry(int fd, const TocEntry& frame, const std::string& path, const std::string& destination, std::string* data){
+        FrameSource source{fd, frame.frameOffset, frame.frameOffset + frame.frameSize, std::vector<char>(DATA_BLOCK_SIZE)};
+        Archive = libarchive->archive_read_new();
+        if(Archive == NULL){
+            return CriticalError;
+        }
+        libarchive->archive_read_support_filter_all(Archive);
+        libarchive->archive_read_support_format_all(Archive);
+
+        Status status = NotFound;
+        struct archive_entry *entry;
+        if(libarchive->archive_read_open(Archive, &source, nullptr, &Impl::FrameRead, nullptr) != ARCHIVE_OK){
+            error_print("Failed to open frame", libarchive->archive_error_string(Archive));
+            status = AccessFileFailed;
+        }
+        while(status == NotFound && libarchive->archive_read_next_header(Archive, &entry) == ARCHIVE_OK){
+            const char* pathname = libarchive->archive_entry_pathname(entry);
+            if(pathname == nullptr || path != pathname){
+                continue;
+            }
+            status = data != nullptr ? ReadEntryData(*data) : RestoreEntry(entry, destination);
+        }
+
+        libarchive->archive_read_close(Archive);
+        libarchive->archive_read_free(Archive);
+        Archive = NULL;
+        return status;
+    }
+
+    Status ReadEntryData(std::string& data){
+        while(true){
+            const void *buff;
+            size_t size;
+            la_int64_t offset;
+            int error_code = libarchive->archive_read_data_block(Archive, &buff, &size, &offset);
+            if (error_code == ARCHIVE_EOF){
+                return Success;
+            }
+            if (error_code < ARCHIVE_OK){
+                error_print("Failed to read archive data", libarchive->archive_error_string(Archive));
+                return AccessFileFailed;
+            }
+            data.append(static_cast<const char*>(buff), size);
+        }
+    }
+
+    Status RestoreEntry(archive_entry* entry, const std::string& destination){
+        ArchiveFile = libarchive->archive_write_disk_new();
+        if(ArchiveFile == NULL){
+            return CriticalError;
+        }
+        libarchive->archive_write_disk_set_options(ArchiveFile, ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM | ARCHIVE_EXTRACT_FFLAGS);
+        libarchive->archive_write_disk_set_standard_lookup(ArchiveFile);
+        if(!destination.empty()){
+            std::string target = (fs::path(destination) / libarchive->archive_entry_pathname(entry)).string();
+            libarchive->archive_entry_set_pathname(entry, target.c_str());
+        }
+
+        Status status = AccessFileFailed;
+        if(libarchive->archive_write_header(ArchiveFile, entry) >= ARCHIVE_OK){
+            status = ArchiveEntries(entry);
+        } else {
+            error_print("Failed to write archive header", libarchive->archive_error_string(ArchiveFile));
+        }
+        libarchive->archive_write_close(ArchiveFile);
+        libarchive->archive_write_free(ArchiveFile);
+        ArchiveFile = NULL;
+        return status;
+    }
+
+    /**
+     * @brief Adds a file to the archive.
+     *
+     * This function creates a new archive entry for the specified file and writes
+     * it to the archive. It handles setting the file's properties, such as size,
+     * type, and permissions, and writes the file's data to the archive.
+     *
+     * A file with several links is added to the link table only once its
+     * entry is complete, so a later link carries the data itself if this
+     * one failed.
+     *
+     * @param location The full path to the file to be added to the archive.
+     * @param useLinks Look the file up in and add it to the link table;
+     *        false archives its data in any case.
+     * 
+     * @return Status indicating the success or failure of the operation.
+     *         - Success: The file was successfully added to the archive.
+     *         - WriteFailed: Failed to write the archive header or file data.
+     */
+    Status AddFile(std::string location, bool useLinks = true){
+        std::error_code ec;
+        uint64_t size = fs::file_size(location, ec);
+        if(ec){
+            error_print("Failed to get file size for", location, ":", ec.message());
+            size = 0; // Set size to 0 as a fallback
+        }
+
+        int64_t mtime = 0;
+        std::vector<SparseRegion> regions;
+        bool sparse = false;
+        bool linked = false;
+        int fd = open(location.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if(fd >= 0 && fstat(fd, &st) == 0){
+            mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+            linked = useLinks && HardLinks() != nullptr && S_ISREG(st.st_mode) && st.st_nlink > 1;
+            sparse = FindDataRegions(fd, st, regions);
+        }
+        if(fd >= 0){
+            close(fd);
+        }
+        if(linked){
+            ManifestEntry record;
+            std::string target;
+            if(Links.Find(st.st_dev, st.st_ino, target, record.contentHash)){
+                return AddLink(location, target, st, record);
+            }
+        }
+
+        Status status = WriteHeader(location, size, mtime, sparse ? &regions : nullptr);
+        ManifestEntry record;
+        if(status == Success){
+            status = WriteData(location, size, record, sparse ? &regions : nullptr);
+            if(Dedup){
+                PhaseTimer timer(Stats.finishEntry);
+                Status endStatus = Dedup->EndFile(record.mtime, status == Success);
+                status = status == Success ? endStatus : status;
+            } else if(FinishEntry() != Success && status == Success){
+                status = WriteFailed;
+            }
+        }
+        if(status == Success){
+            record.size = size;
+            RecordFile(location, record);
+            RecordChecksum(location, record.contentHash);
+            if(linked){
+                Links.Add(st.st_dev, st.st_ino, location);
+                Links.SetContentHash(st.st_dev, st.st_ino, record.contentHash);
+            }
+            WriteCheckpoint();
+        }
+        return status;
+    }
+
+    /**
+     * @brief Adds a further link of a file that is already in the archive.
+     *
+     * Only a hardlink entry pointing at the first link is written; the data
+     * is not read again.
+     */
+    Status AddLink(const std::string& location, const std::string& target, const struct stat& st, ManifestEntry& record){
+        record.size = st.st_size;
+        record.mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+        record.inode = st.st_ino;
+        Status status = WriteLinkHeader(location, target, record.mtime);
+        if(FinishEntry() != Success && status == Success){
+            status = WriteFailed;
+        }
+        if(status == Success){
+            RecordFile(location, record);
+        }
+        return status;
+    }
+
+    /**
+     * @brief Link table of this archive, or nullptr where every entry has to
+     *        carry its own data.
+     *
+     * Chunk lists of the dedup backend have no notion of links, and an entry
+     * of a seekable archive must be restorable from its own frame.
+     */
+    LinkTable* HardLinks(){
+        return Dedup || Options.seekable ? nullptr : &Links;
+    }
+
+    /**
+     * @brief Returns the path of a file inside the archive.
+     *
+     * The leading part of the path (everything up to the archived item) is
+     * removed so the archive holds relative paths.
+     */
+    std::string ArchivePath(const std::string& location){
+        if (location.find(PathOfItemToArchive) == 0) {
+            return location.substr(PathOfItemToArchive.length());
+        }
+        return location; // Fallback to using the full path
+    }
+
+    /**
+     * @brief Writes the archive header of a regular file.
+     *
+     * @param location The full path to the file on disk.
+     * @param size Number of data bytes that will follow the header.
+     * @param mtime Modification time in nanoseconds since the epoch.
+     * @param regions Data regions of a sparse file, nullptr for a dense one.
+     * @return Status Success, or WriteFailed if libarchive rejected the header.
+     */
+    Status WriteHeader(const std::string& location, uint64_t size, int64_t mtime, const std::vector<SparseRegion>* regions = nullptr){
+        if(Dedup){
+            Dedup->BeginFile(ArchivePath(location));
+            return Success;
+        }
+        return WriteEntryHeader(ArchivePath(location), size, mtime, regions);
+    }
+
+    /**
+     * @brief Writes the next block of data of the current entry.
+     * @return Status Success, or WriteFailed if the block could not be written.
+     */
+    Status WriteBlock(const char* data, size_t length, const std::string& location){
+        PhaseTimer timer(Stats.compress, &Stats.write);
+        if(Dedup){
+            return Dedup->Write(data, length);
+        }
+        if(libarchive->archive_write_data(Archive, data, length) < ARCHIVE_OK){
+            error_print("Failed to write data for", location, ":", libarchive->archive_error_string(Archive));
+            return WriteFailed;
+        }
+        return Success;
+    }
+
+    /**
+     * @brief Writes a hardlink entry for location pointing at the earlier link target.
+     * @return Status Success, or WriteFailed if libarchive rejected the header.
+     */
+    Status WriteLinkHeader(const std::string& location, const std::string& target, int64_t mtime){
+        Status status = Success;
+        struct archive_entry *entry = libarchive->archive_entry_new();
+        std::string locationInArchive = ArchivePath(location);
+        debug_print("Adding hard link to archive:", locationInArchive);
+        libarchive->archive_entry_set_pathname(entry, locationInArchive.c_str());
+        libarchive->archive_entry_set_hardlink(entry, ArchivePath(target).c_str());
+        libarchive->archive_entry_set_size(entry, 0);
+        libarchive->archive_entry_set_filetype(entry, AE_IFREG);
+        libarchive->archive_entry_set_perm(entry, 0644);
+        libarchive->archive_entry_set_mtime(entry, mtime / 1000000000LL, mtime % 1000000000LL);
+
+        PhaseTimer timer(Stats.compress, &Stats.write);
+        if (libarchive->archive_write_header(Archive, entry) != ARCHIVE_OK) {
+            error_print("Failed to write archive header for", locationInArchive, ":", libarchive->archive_error_string(Archive));
+            status = WriteFailed;
+        }
+        libarchive->archive_entry_free(entry);
+        return status;
+    }
+
+    /**
+     * @brief Writes a hole of the current entry.
+     *
+     * The zeros are passed on like data: the pax writer drops them because
+     * they fall outside the sparse map, and the dedup store needs them to
+     * rebuild the file.
+     */
+    Status WriteHole(uint64_t length, const std::string& location){
+        Status status = Success;
+        while(length > 0 && status == Success){
+            size_t step = std::min<uint64_t>(length, SPARSE_ZEROS_SIZE);
+            status = WriteBlock(SparseZeros(), step, location);
+            length -= step;
+        }
+        return status;
+    }
+
+    /**
+     * @brief Writes the header of a regular file entry.
+     *
+     * In a seekable archive the entry is also queued for the table of
+     * contents of the current frame.
+     *
+     * @param locationInArchive Path of the entry inside the archive.
+     * @param size Number of data bytes that will follow the header.
+     * @param mtime Modification time in nanoseconds since the epoch.
+     * @param regions Data regions of a sparse file, recorded as the sparse
+     *        map of the entry; nullptr for a dense file.
+     * @param deleted Archive path of the deleted file if the entry is a
+     *        whiteout, which keeps it out of the table of contents.
+     * @return Status Success, or WriteFailed if libarchive rejected the header.
+     */
+    Status WriteEntryHeader(const std::string& locationInArchive, uint64_t size, int64_t mtime = 0,
+        const std::vector<SparseRegion>* regions = nullptr, const std::string* deleted = nullptr){
+        Status status = Success;
+        /* Create new entry to archive */
+        struct archive_entry *entry = libarchive->archive_entry_new();
+        debug_print("Adding file to archive:", locationInArchive);
+        libarchive->archive_entry_set_pathname(entry, locationInArchive.c_str());
+
+        libarchive->archive_entry_set_size(entry, size);
+        /* Set archive entry properties */
+        libarchive->archive_entry_set_filetype(entry, AE_IFREG);
+        /* set permissions */
+        libarchive->archive_entry_set_perm(entry, 0644);
+        libarchive->archive_entry_set_mtime(entry, mtime / 1000000000LL, mtime % 1000000000LL);
+        if(regions != nullptr){
+            for(const auto& region : *regions){
+                libarchive->archive_entry_sparse_add_entry(entry, region.offset, region.length);
+            }
+            if(regions->empty()){
+                /* a file that is all hole still needs a map to be sparse */
+                libarchive->archive_entry_sparse_add_entry(entry, size, 0);
+            }
+        }
+        if(deleted != nullptr){
+            libarchive->archive_entry_xattr_add_entry(entry, WHITEOUT_XATTR, deleted->data(), deleted->size());
+        }
+
+        if(OutputFd >= 0 && locationInArchive != SEEKABLE_TOC_NAME && deleted == nullptr){
+            TocEntry tocEntry;
+            tocEntry.size = size;
+            tocEntry.mtime = mtime;
+            tocEntry.mode = AE_IFREG | 0644;
+            FrameEntries.emplace_back(locationInArchive, tocEntry);
+        }
+
+        PhaseTimer timer(Stats.compress, &Stats.write);
+        if (libarchive->archive_write_header(Archive, entry) != ARCHIVE_OK) {
+            error_print("Failed to write archive header for", locationInArchive, ":", libarchive->archive_error_string(Archive));
+            status = WriteFailed;
+        }
+
+        libarchive->archive_entry_free(entry);
+
+        return status;
+    }
+
+    /**
+     * @brief Drains the reader stage and writes every file it produces.
+     *
+     * This is the compression/write stage of the pipeline. Headers and data are
+     * written in exactly the order the sequential AddFile path would produce
+     * them for the same walk order, so the resulting archive is byte-identical. A file whose header
+     * could not be written has its remaining chunks discarded.
+     *
+     * The reader adds a link to the link table once it was read, but writing
+     * its entry may still fail. A later link to it then carries the data
+     * itself, archived here with AddFile, and the links after that point at
+     * this one.
+     *
+     * @param pipeline The reader stage to drain.
+     * @return Status Success, or the first error encountered. Processing goes on
+     *         after a failed file, as with the sequential path.
+     */
+    Status WritePipeline(ReadPipeline& pipeline){
+        Status status = Success;
+        Status fileStatus = Success;
+        std::string location;
+        ManifestEntry record;
+        FileChunk chunk;
+        bool sparse = false;
+        bool link = false;
+        bool copied = false;
+        uint64_t position = 0;
+        /* failed entries, mapped to the later link archived in their place */
+        std::unordered_map<std::string, std::string> relinked;
+
+        while(NextChunk(pipeline, chunk)){
+            switch(chunk.kind){
+            case FileChunk::Begin:
+                /* the reader queued them before taking this file from the walk */
+                if(WritePendingWhiteouts() != Success && status == Success){
+                    status = WriteFailed;
+                }
+                location = chunk.path;
+                record.size = chunk.size;
+                record.mtime = chunk.mtime;
+                record.inode = chunk.inode;
+                sparse = chunk.sparse;
+                position = 0;
+                link = !chunk.linkTarget.empty();
+                copied = false;
+                if(link){
+                    auto failed = relinked.find(chunk.linkTarget);
+                    if(failed == relinked.end()){
+                        fileStatus = WriteLinkHeader(location, chunk.linkTarget, chunk.mtime);
+                    } else if(!failed->second.empty()){
+                        fileStatus = WriteLinkHeader(location, failed->second, chunk.mtime);
+                    } else {
+                        copied = true;
+                        fileStatus = AddFile(location, false);
+                        if(fileStatus == Success){
+                            failed->second = location;
+                        }
+                    }
+                    break;
+                }
+                fileStatus = WriteHeader(location, chunk.size, chunk.mtime, sparse ? &chunk.regions : nullptr);
+                break;
+            case FileChunk::Data:
+                if(fileStatus == Success && sparse && chunk.offset > position){
+                    fileStatus = WriteHole(chunk.offset - position, location);
+                    position = chunk.offset;
+                }
+                if(fileStatus == Success){
+                    fileStatus = WriteBlock(chunk.data, chunk.size, location);
+                }
+                Stats.dataBytes.fetch_add(chunk.size, std::memory_order_relaxed);
+                position += chunk.size;
+                break;
+            case FileChunk::End:
+                if(copied){
+                    if(fileStatus != Success){
+                        error_print("Failed for file", location);
+                        status = status == Success ? fileStatus : status;
+                    }
+                    break;
+                }
+                if(fileStatus == Success && sparse && chunk.status == Success && position < record.size){
+                    fileStatus = WriteHole(record.size - position, location);
+                }
+                if(fileStatus == Success){
+                    fileStatus = chunk.status;
+                }
+                if(Dedup){
+                    PhaseTimer timer(Stats.finishEntry);
+                    Status endStatus = Dedup->EndFile(record.mtime, fileStatus == Success);
+                    fileStatus = fileStatus == Success ? endStatus : fileStatus;
+                } else if(FinishEntry() != Success && fileStatus == Success){
+                    fileStatus = WriteFailed;
+                }
+                if(fileStatus != Success){
+                    error_print("Failed for file", location);
+                    if(status == Success){
+                        status = fileStatus;
+                    }
+                    if(!link){
+                        relinked.emplace(location, std::string());
+                    }
+                } else {
+                    record.contentHash = chunk.contentHash;
+                    RecordFile(location, record);
+                    if(!link){
+                        RecordChecksum(location, record.contentHash);
+                    }
+                    WriteCheckpoint();
+                }
+                break;
+            default:
+                break;
+            }
+            pipeline.Release(chunk);
+        }
+
+        return status;
+    }
+
+    /**
+     * @brief Writes data from a specified file location to an archive.
+     * 
+     * Files of at least MMAP_THRESHOLD bytes are memory mapped and passed to
+     * libarchive in MMAP_SLICE_SIZE slices straight from the page cache. Smaller
+     * files, and files that cannot be mapped, are read with read() into a
+     * reusable buffer of DATA_BLOCK_SIZE bytes. It handles errors during file
+     * reading and archive writing, ensuring proper error reporting.
+     * 
+     * Of a sparse file only the data regions are read; its holes are written
+     * with WriteHole and hashed as zeros.
+     *
+     * Exactly the size announced in the header is read and hashed: data
+     * appended meanwhile is left out, and a file that shrank before reaching
+     * it fails with WriteFailed.
+     *
+     * @param location A reference to a string containing the file path to read from.
+     * @param size Size of the file as written to its header.
+     * @param record Receives the modification time, inode and content hash of the file.
+     * @param regions Data regions of a sparse file, nullptr to read the whole file.
+     * @return Status Returns Success if the operation completes successfully, 
+     *         or WriteFailed if an error occurs during file reading or archive writing.
+     */
+    Status WriteData(std::string &location, uint64_t size, ManifestEntry &record, const std::vector<SparseRegion>* regions = nullptr)
+    {
+        Status status = Success;
+        int fd = open(location.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0)
+        {
+            error_print("Error opening file:", location);
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            return WriteFailed;
+        }
+
+        record.mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+        record.inode = st.st_ino;
+        Xxh64 hash;
+
+        std::shared_ptr<MappedFile> mapping;
+        if (regions == nullptr && S_ISREG(st.st_mode) && size >= MMAP_THRESHOLD)
+        {
+            mapping = MappedFile::Map(fd, size);
+        }
+
+        if (regions != nullptr)
+        {
+            status = WriteRegions(fd, *regions, size, location, hash);
+        }
+        else if (mapping)
+        {
+            for (uint64_t offset = 0; offset < mapping->Size();)
+            {
+                uint64_t length = mapping->Readable(offset, MMAP_SLICE_SIZE);
+                if (length == 0)
+                {
+                    error_print("File shrank while reading:", location);
+                    status = WriteFailed;
+                    break;
+                }
+                {
+                    /* the pages of the mapping are faulted in here */
+                    PhaseTimer timer(Stats.read);
+                    hash.Update(mapping->Data() + offset, length);
+                }
+                Stats.dataBytes.fetch_add(length, std::memory_order_relaxed);
+                status = WriteBlock(mapping->Data() + offset, length, location);
+                if (status != Success)
+                {
+                    break;
+                }
+                offset += length;
+            }
+        }
+        else
+        {
+            ReadBuffer.resize(DATA_BLOCK_SIZE);
+            for (uint64_t offset = 0; offset < size;)
+            {
+                ssize_t bytesRead = ReadFileData(fd, ReadBuffer.data(), std::min<uint64_t>(ReadBuffer.size(), size - offset));
+                if (bytesRead < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (bytesRead <= 0)
+                {
+                    error_print(bytesRead < 0 ? "Error reading file:" : "File shrank while reading:", location);
+                    status = WriteFailed;
+                    break;
+                }
+                offset += bytesRead;
+                hash.Update(ReadBuffer.data(), bytesRead);
+                status = WriteBlock(ReadBuffer.data(), bytesRead, location);
+                if (status != Success)
+                {
+                    break;
+                }
+            }
+        }
+
+        close(fd);
+        record.contentHash = hash.Digest();
+        return status;
+    }
+
+    /**
+     * @brief read(), or pread() at offset if not negative, timed and counted as file data read.
+     */
+    ssize_t ReadFileData(int fd, char* buffer, size_t length, int64_t offset = -1)
+    {
+        PhaseTimer timer(Stats.read);
+        ssize_t bytesRead = offset < 0 ? read(fd, buffer, length) : pread(fd, buffer, length, offset);
+        if (bytesRead > 0)
+        {
+            Stats.dataBytes.fetch_add(bytesRead, std::memory_order_relaxed);
+        }
+        return bytesRead;
+    }
+
+    /**
+     * @brief Writes the data regions of a sparse file and the holes between them.
+     * @return Status Success, or WriteFailed if a region could not be read or written.
+     */
+    Status WriteRegions(int fd, const std::vector<SparseRegion>& regions, uint64_t size, const std::string& location, Xxh64& hash)
+    {
+        ReadBuffer.resize(DATA_BLOCK_SIZE);
+        uint64_t position = 0;
+        for (const auto& region : regions)
+        {
+            Status status = WriteZeros(region.offset - position, location, hash);
+            position = region.offset;
+            while (status == Success && position < static_cast<uint64_t>(region.offset + region.length))
+            {
+                size_t length = std::min<uint64_t>(ReadBuffer.size(), region.offset + region.length - position);
+                ssize_t bytesRead = ReadFileData(fd, ReadBuffer.data(), length, position);
+                if (bytesRead < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (bytesRead <= 0)
+                {
+                    error_print("Error reading file:", location);
+                    return WriteFailed;
+                }
+                hash.Update(ReadBuffer.data(), bytesRead);
+                status = WriteBlock(ReadBuffer.data(), bytesRead, location);
+                position += bytesRead;
+            }
+            if (status != Success)
+            {
+                return status;
+            }
+        }
+        return WriteZeros(size - position, location, hash);
+    }
+
+    /**
+     * @brief Writes a hole of the current entry and adds its zeros to the content hash.
+     */
+    Status WriteZeros(uint64_t length, const std::string& location, Xxh64& hash)
+    {
+        for (uint64_t hashed = 0; hashed < length;)
+        {
+            size_t step = std::min<uint64_t>(length - hashed, SPARSE_ZEROS_SIZE);
+            hash.Update(SparseZeros(), step);
+            hashed += step;
+        }
+        return WriteHole(length, location);
+    }
+
+    /**
+     * @brief Adds a file to the archiver from the specified directory entry.
+     * 
+     * This function takes a directory entry as input and adds the corresponding
+     * file to the archiver by extracting its path and delegating to the overloaded
+     * AddFile function.
+     * 
+     * @param location The directory entry representing the file to be added.
+     * @return Status indicating the success or failure of the operation.
+     */
+    Status AddFile(fs::directory_entry location)
+    {
+        return AddFile(location.path());
+    }
+
+    /**
+     * @brief Extracts and returns the directory path of the given file location.
+     *
+     * This function takes a file location as input, identifies the last occurrence
+     * of the preferred path separator, and extracts the directory path up to and
+     * including that separator. The extracted path is stored in the member variable
+     * `PathOfItemToArchive` and returned as the result.
+     *
+     * @param location The full file path as a string.
+     * @return The directory path of the file as a string.
+     */
+    std::string CutArchivePath(std::string location){
+        size_t locationOfItemToArchiveInthePath = location.find_last_of(std::filesystem::path::preferred_separator);
+        PathOfItemToArchive = location.substr(0, locationOfItemToArchiveInthePath+1);
+        return PathOfItemToArchive;
+    }
+   
+    /**
+     * @brief Adds all files from a specified directory and its subdirectories to the archive.
+     * 
+     * The tree is walked by a parallel DirWalker that feeds files into the
+     * archiving stage as soon as they are found, in an order that differs
+     * between runs; reproducible and checkpointed runs use the sorted walk. In pipelined mode the file reads
+     * run on the reader stage thread while this thread compresses, so I/O wait is
+     * hidden behind CPU work. Otherwise files are processed one after another.
+     * Directories and symbolic links are skipped, only regular files are processed. If an error
+     * occurs while adding a file, the process continues, but a warning is logged
+     * for verification purposes.
+     * 
+     * @param location The directory entry representing the root directory to be archived.
+     * @param resumeAfter Last path archived before an interruption; the
+     *        walk continues after it. Empty archives the whole tree.
+     * @return Status Returns `Success` if all files were added successfully, or the first 
+     *         encountered error status if any file addition fails.
+     * 
+     * @warning If an error occurs while adding a file, the process continues, but the user
+     *          is advised to verify the archive for completeness.
+     */
+    Status AddDirectory(fs::directory_entry location, const std::string& resumeAfter = ""){
+        if(!fs::is_directory(location)){
+            error_print("Failed to open directory", location.path());
+            return AccessFileFailed;
+        }
+
+        /* incremental runs need size and mtime to spot unchanged files,
+           checkpoints and reproducible archives an order every run repeats */
+        DirWalker walker(Options.walkerThreads, Base != nullptr, Journal != nullptr || Options.reproducible);
+        if(!resumeAfter.empty()){
+            walker.ResumeAfter(resumeAfter);
+        }
+        walker.Start(location.path().string());
+
+        /* Yields the next regular file found by the walker that has to be archived. */
+        auto nextFile = [this, &walker](std::string& path) {
+            WalkEntry entry;
+            while(NextWalkEntry(walker, entry)){
+                NoteTypeChange(entry);
+                if(entry.type == DT_REG && !IsUnchanged(entry.path, entry.size, entry.mtime, entry.inode)){
+                    path = std::move(entry.path);
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        Status status = Success;
+        if(Options.pipelined){
+            ReadPipeline pipeline(nextFile, Options.ioUring, HardLinks(), Options.prefetchBytes);
+            status = WritePipeline(pipeline);
+            /* directories that replaced a file but hold nothing to archive */
+            Status whiteoutStatus = WritePendingWhiteouts();
+            return status != Success ? status : whiteoutStatus;
+        }
+
+        std::string path;
+        while(nextFile(path)){
+            if(WritePendingWhiteouts() != Success && status == Success){
+                status = WriteFailed;
+            }
+            Status fileStatus = AddFile(path);
+            if(fileStatus != Success){
+                error_print("Failed for file", path);
+                warning_print("Due to the significant reason of creating archive, the process will be continue but please verify the archive!");
+                if(status == Success){
+                    status = fileStatus;
+                }
+            }
+        }
+        if(WritePendingWhiteouts() != Success && status == Success){
+            status = WriteFailed;
+        }
+        return status;
+    }
+
+    /** DirWalker::Next, timed as the walk phase. */
+    bool NextWalkEntry(DirWalker& walker, WalkEntry& entry){
+        PhaseTimer timer(Stats.walk);
+        return walker.Next(entry);
+    }
+
+    /** ReadPipeline::Next, timed as the read phase: the wait for file data. */
+    bool NextChunk(ReadPipeline& pipeline, FileChunk& chunk){
+        PhaseTimer timer(Stats.read);
+        return pipeline.Next(chunk);
+    }
+
+    /**
+     * @brief Tells whether a file is unchanged since the base manifest.
+     *
+     * A file counts as unchanged when its size, modification time and inode
+     * all match the manifest. The matching base entry is marked as seen so it
+     * is not recorded as deleted. May run on the reader stage thread; BaseState
+     * is only read back once the pipeline has finished.
+     *
+     * @return true if the file can be skipped, always false outside incremental mode.
+     */
+    bool IsUnchanged(const std::string& location, uint64_t size, int64_t mtime, uint64_t inode){
+        if(Base == nullptr){
+            return false;
+        }
+        ManifestEntry previous;
+        size_t index;
+        if(!Base->Find(ArchivePath(location), previous, index)){
+            return false;
+        }
+        /* replaced by a directory earlier in the walk */
+        if(BaseState[index] == Deleted){
+            return false;
+        }
+        bool unchanged = previous.size == size && previous.mtime == mtime && previous.inode == inode;
+        BaseState[index] = unchanged ? Unchanged : Changed;
+        return unchanged;
+    }
+
+    bool IsUnchanged(const std::string& location){
+        struct stat st;
+        if(Base == nullptr || stat(location.c_str(), &st) != 0){
+            return false;
+        }
+        return IsUnchanged(location, st.st_size, st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec, st.st_ino);
+    }
+
+    /**
+     * @brief Adds an archived file to the manifest of this archive.
+     */
+    void RecordFile(const std::string& location, ManifestEntry record){
+        PhaseTimer timer(Stats.finishEntry);
+        std::string path = ArchivePath(location);
+        record.path = path;
+        Snapshot.Add(record);
+        NewestMtime = std::max(NewestMtime, record.mtime);
+        if(Journal != nullptr){
+            AppendRecord(Progress.records, record);
+            Progress.last = location;
+        }
+        Stats.files.fetch_add(1, std::memory_order_relaxed);
+        UpdateArchiveBytes();
+    }
+
+    /**
+     * @brief Publishes the size of the archive written so far to the stats.
+     *
+     * libarchive counts what it hands to the output, which is the archive
+     * itself unless frames are compressed separately; FrameWrite counts
+     * those. Excludes data still buffered in the compressor until Finish.
+     */
+    void UpdateArchiveBytes(){
+        if(Archive != nullptr && Writing && !Options.seekable){
+            Stats.archiveBytes.store(libarchive->archive_filter_bytes(Archive, -1), std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Collects the hashes of all directories holding base manifest entries.
+     *
+     * Only the manifest is read, so a new file found where a directory used
+     * to be is recognised without another pass over the tree. The list is
+     * compacted as it grows, as every entry repeats its parent directories.
+     */
+    void CollectBaseDirs(){
+        size_t compacted = 0;
+        for(size_t i = 0; i < Base->Size(); i++){
+            std::string_view path = Base->At(i).path;
+            for(size_t slash = path.find('/'); slash != std::string_view::npos; slash = path.find('/', slash + 1)){
+                BaseDirs.push_back(Xxh64::Hash(path.data(), slash));
+            }
+            if(BaseDirs.size() >= 2 * compacted + BASE_DIRS_COMPACT_STEP){
+                std::sort(BaseDirs.begin(), BaseDirs.end());
+                BaseDirs.erase(std::unique(BaseDirs.begin(), BaseDirs.end()), BaseDirs.end());
+                compacted = BaseDirs.size();
+            }
+        }
+        std::sort(BaseDirs.begin(), BaseDirs.end());
+        BaseDirs.erase(std::unique(BaseDirs.begin(), BaseDirs.end()), BaseDirs.end());
+        BaseDirs.shrink_to_fit();
+    }
+
+    /**
+     * @brief Queues a whiteout for a walked path whose type changed since the base manifest.
+     *
+     * A directory that replaced a base file, or a file that replaced a base
+     * directory, needs the old one deleted before anything at or below the
+     * path is extracted. The walker reports a directory before its entries,
+     * so the whiteout is queued before any of them is archived. A hash
+     * collision only queues a harmless whiteout for a new file. May run on
+     * the reader stage thread.
+     */
+    void NoteTypeChange(const WalkEntry& entry){
+        if(Base == nullptr || (entry.type != DT_DIR && entry.type != DT_REG)){
+            return;
+        }
+        std::string path = ArchivePath(entry.path);
+        if(entry.type == DT_DIR){
+            ManifestEntry previous;
+            size_t index;
+            if(!Base->Find(path, previous, index) || BaseState[index] == Deleted){
+                return;
+            }
+            BaseState[index] = Deleted;
+        } else if(!std::binary_search(BaseDirs.begin(), BaseDirs.end(), Xxh64::Hash(path.data(), path.size()))){
+            return;
+        }
+        std::lock_guard<std::mutex> lock(WhiteoutLock);
+        PendingWhiteouts.push_back(std::move(path));
+    }
+
+    /**
+     * @brief Writes the whiteouts queued by NoteTypeChange.
+     * @return Success, or WriteFailed if a whiteout could not be written.
+     */
+    Status WritePendingWhiteouts(){
+        std::vector<std::string> paths;
+        {
+            std::lock_guard<std::mutex> lock(WhiteoutLock);
+            paths.swap(PendingWhiteouts);
+        }
+        Status status = Success;
+        for(const auto& path : paths){
+            if(WriteWhiteout(path) != Success){
+                status = WriteFailed;
+            }
+        }
+        return status;
+    }
+
+    /**
+     * @brief Completes the manifest and writes it beside the archive.
+     *
+     * In incremental mode unchanged files are carried over from the base
+     * manifest, and every base entry the walk did not find again is written
+     * as a whiteout entry. Those follow the archived files, which is safe as
+     * paths whose type changed got their whiteouts from NoteTypeChange.
+     * The base manifest only applies to the first archived item.
+     *
+     * @return Success, or WriteFailed if a whiteout or the manifest could not be written.
+     */
+    Status FinishSnapshot(){
+        Status status = Success;
+        if(Base != nullptr){
+            for(size_t i = 0; i < BaseState.size(); i++){
+                ManifestEntry previous = Base->At(i);
+                if(BaseState[i] == Unchanged){
+                    Snapshot.Add(previous);
+                } else if(BaseState[i] == Unseen && WriteWhiteout(std::string(previous.path)) != Success){
+                    status = WriteFailed;
+                }
+            }
+            Base.reset();
+            BaseState.clear();
+            BaseDirs.clear();
+        }
+        if(!ManifestName.empty() && Snapshot.Write(ManifestName) != Success){
+            error_print("Failed to write manifest", ManifestName);
+            status = WriteFailed;
+        }
+        return status;
+    }
+
+    /**
+     * @brief Records a deleted file as an empty entry named dir/.wh.name.
+     *
+     * The entry is a whiteout through its WHITEOUT_XATTR attribute alone, so
+     * files whose names start with WHITEOUT_PREFIX are archived as they are;
+     * the prefix is repeated until the name differs from every file on disk.
+     */
+    Status WriteWhiteout(const std::string& path){
+        size_t slash = path.find_last_of('/');
+        size_t name = slash == std::string::npos ? 0 : slash + 1;
+        std::string whiteout = path;
+        struct stat st;
+        do {
+            whiteout.insert(name, WHITEOUT_PREFIX);
+        } while(lstat((PathOfItemToArchive + whiteout).c_str(), &st) == 0);
+
+        Status status = WriteEntryHeader(whiteout, 0, 0, nullptr, &path);
+        if(FinishEntry() != Success && status == Success){
+            status = WriteFailed;
+        }
+        return status;
+    }
+
+    /**
+     * @brief Tells whether an entry is a whiteout.
+     * @param deleted Receives the archive path of the deleted file.
+     */
+    bool WhiteoutTarget(archive_entry* entry, std::string& deleted){
+        const char* name = nullptr;
+        const void* value = nullptr;
+        size_t size = 0;
+        libarchive->archive_entry_xattr_reset(entry);
+        while(libarchive->archive_entry_xattr_next(entry, &name, &value, &size) == ARCHIVE_OK && name != nullptr){
+            if(strcmp(name, WHITEOUT_XATTR) == 0){
+                deleted.assign(static_cast<const char*>(value), size);
+                return true;
+            }
+            name = nullptr;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Path of an archive member on disk, below ArchiverOptions::extractDirectory if set.
+     */
+    std::string TargetPath(const std::string& pathname){
+        return Options.extractDirectory.empty() ? pathname : (fs::path(Options.extractDirectory) / pathname).string();
+    }
+
+    /**
+     * @brief Moves an entry written by the libarchive disk writer below
+     *        ArchiverOptions::extractDirectory, hard link target included.
+     *
+     * DiskWriter is opened on that directory instead, so entries it creates
+     * keep their archive paths.
+     */
+    void RebaseEntry(archive_entry* entry){
+        if(Options.extractDirectory.empty()){
+            return;
+        }
+        std::string pathname = TargetPath(libarchive->archive_entry_pathname(entry));
+        libarchive->archive_entry_set_pathname(entry, pathname.c_str());
+        const char* hardlink = libarchive->archive_entry_hardlink(entry);
+        if(hardlink != nullptr){
+            std::string target = TargetPath(hardlink);
+            libarchive->archive_entry_set_hardlink(entry, target.c_str());
+        }
+    }
+
+    /**
+     * @brief Deletes the file a whiteout entry stands for from the extraction target.
+     *
+     * The path must stay below the target: absolute paths, ".." and parent
+     * directories that are symbolic links are refused. A path whose parent
+     * is gone or has become a file has nothing left to delete.
+     *
+     * @param deleted Archive path of the deleted file.
+     * @return Success, or AccessFileFailed if the path was refused or could not be removed.
+     */
+    Status RemoveWhiteoutTarget(const std::string& deleted){
+        fs::path relative(deleted);
+        if(deleted.empty() || relative.is_absolute()){
+            error_print("Refusing to delete", deleted);
+            return AccessFileFailed;
+        }
+        for(const auto& part : relative){
+            if(part == ".."){
+                error_print("Refusing to delete", deleted);
+                return AccessFileFailed;
+            }
+        }
+
+        fs::path target = Options.extractDirectory.empty() ? fs::path(".") : fs::path(Options.extractDirectory);
+        for(auto part = relative.begin(); part != relative.end(); ++part){
+            if(part->empty() || *part == "."){
+                continue;
+            }
+            if(std::next(part) != relative.end()){
+                struct stat st;
+                fs::path parent = target / *part;
+                if(lstat(parent.c_str(), &st) != 0){
+                    return Success;
+                }
+                if(S_ISREG(st.st_mode)){
+                    return Success;
+                }
+                if(!S_ISDIR(st.st_mode)){
+                    error_print("Refusing to delete", deleted, "through", parent);
+                    return AccessFileFailed;
+                }
+            }
+            target /= *part;
+        }
+
+        std::error_code ec;
+        fs::remove_all(target, ec);
+        if(ec){
+            error_print("Failed to remove deleted file", target, ":", ec.message());
+            return AccessFileFailed;
+        }
+        return Success;
+    }
+
+    /** archive_read_next_header of the archive being extracted, timed as the read phase. */
+    int ReadHeader(archive_entry** entry){
+        PhaseTimer timer(Stats.read);
+        return libarchive->archive_read_next_header(Archive, entry);
+    }
+
+    /** archive_read_data_block of the archive being extracted, timed as the read phase. */
+    int ReadBlock(const void** buff, size_t* size, la_int64_t* offset){
+        PhaseTimer timer(Stats.read);
+        return libarchive->archive_read_data_block(Archive, buff, size, offset);
+    }
+
+    /**
+     * @brief Tells whether an entry is handed to the writer pool.
+     *
+     * Only plain regular files small enough to be buffered qualify; everything
+     * else keeps the ordering guarantees of the decoder thread.
+     */
+    bool IsPoolEntry(archive_entry* entry){
+        return libarchive->archive_entry_filetype(entry) == AE_IFREG
+            && libarchive->archive_entry_hardlink(entry) == nullptr
+            && libarchive->archive_entry_size(entry) <= POOL_ENTRY_LIMIT;
+    }
+
+    /**
+     * @brief Tells whether DiskWriter can create an entry: regular files,
+     *        hard links and directories.
+     */
+    bool IsNativeEntry(archive_entry* entry){
+        unsigned int type = libarchive->archive_entry_filetype(entry);
+        return type == AE_IFREG || type == AE_IFDIR;
+    }
+
+    /**
+     * @brief Creates the current entry with the native disk writer, streaming its data.
+     * @return Success, or AccessFileFailed if the entry could not be read or created.
+     */
+    Status WriteNative(DiskWriter& native, archive_entry* entry){
+        PhaseTimer timer(Stats.write, &Stats.read);
+        const char* pathname = libarchive->archive_entry_pathname(entry);
+        if(pathname == nullptr){
+            return AccessFileFailed;
+        }
+        DiskEntry diskEntry;
+        diskEntry.path = pathname;
+        diskEntry.mode = libarchive->archive_entry_mode(entry);
+        diskEntry.mtime = static_cast<int64_t>(libarchive->archive_entry_mtime(entry)) * 1000000000LL
+            + libarchive->archive_entry_mtime_nsec(entry);
+        diskEntry.size = libarchive->archive_entry_size(entry);
+        diskEntry.sparse = libarchive->archive_entry_sparse_count(entry) > 0;
+
+        const char* hardlink = libarchive->archive_entry_hardlink(entry);
+        if(hardlink != nullptr){
+            return native.Link(diskEntry, hardlink);
+        }
+        if(libarchive->archive_entry_filetype(entry) == AE_IFDIR){
+            return native.MakeDirectory(diskEntry);
+        }
+
+        DiskFile file;
+        Status status = native.BeginFile(diskEntry, file);
+        if(status != Success){
+            return status;
+        }
+        while(status == Success){
+            const void *buff;
+            size_t size;
+            la_int64_t offset;
+            int error_code = ReadBlock(&buff, &size, &offset);
+            if (error_code == ARCHIVE_EOF){
+                break;
+            }
+            if (error_code < ARCHIVE_OK){
+                error_print("Failed to read archive data", libarchive->archive_error_string(Archive));
+                status = AccessFileFailed;
+                break;
+            }
+            Stats.dataBytes.fetch_add(size, std::memory_order_relaxed);
+            status = native.WriteBlock(file, buff, size, offset);
+        }
+        Status endStatus = native.EndFile(file);
+        return status != Success ? status : endStatus;
+    }
+
+    /**
+     * @brief Buffers the data of the current entry and queues it on the writer pool.
+     * @return Success, or AccessFileFailed if the entry data could not be read.
+     */
+    Status SubmitEntry(ExtractPool& pool, archive_entry* entry){
+        /* buffering and queueing, which waits while the pool is behind */
+        PhaseTimer timer(Stats.write, &Stats.read);
+        ExtractJob job;
+        job.data.reserve(libarchive->archive_entry_size(entry));
+        while(true){
+            const void *buff;
+            size_t size;
+            la_int64_t offset;
+            int error_code = ReadBlock(&buff, &size, &offset);
+            if (error_code == ARCHIVE_EOF){
+                break;
+            }
+            if (error_code < ARCHIVE_OK){
+                error_print("Failed to read archive data", libarchive->archive_error_string(Archive));
+                return AccessFileFailed;
+            }
+            Stats.dataBytes.fetch_add(size, std::memory_order_relaxed);
+            job.data.insert(job.data.end(), static_cast<const char*>(buff), static_cast<const char*>(buff) + size);
+            job.blocks.emplace_back(offset, size);
+        }
+        job.entry = libarchive->archive_entry_clone(entry);
+        if(job.entry == nullptr){
+            return CriticalError;
+        }
+        pool.Submit(std::move(job));
+        return Success;
+    }
+
+    /**
+     * @brief Archives the provided entry by reading its data and writing it to the archive file.
+     *
+     * This function processes an archive entry by reading its data in blocks and writing
+     * those blocks to the destination archive file. It handles errors during both the
+     * reading and writing processes and logs debug messages for failures or completion.
+     *
+     * @param entry Pointer to the archive entry to be processed.
+     * @return Status Returns `Success` if the operation completes successfully, or 
+     *         `AccessFileFailed` if there is an error finalizing the entry.
+     *
+     * @note The function assumes that `Archive` and `ArchiveFile` are properly initialized
+     *       and valid.
+     *
+     * Error Handling:
+     * - If reading data from the archive fails, the function logs the error and stops processing.
+     * - If writing data to the archive file fails, the function logs the error and stops processing.
+     * - If finalizing the entry fails, the function logs the error and returns `AccessFileFailed`.
+     */
+    Status ArchiveEntries(archive_entry* entry){
+        Status status = Success;
+        int error_code = 0;
+
+        while(libarchive->archive_entry_size(entry) > 0){
+            const void *buff;
+            size_t size;
+            la_int64_t offset;
+            error_code = ReadBlock((const void **)&buff, &size, &offset);
+            if (error_code == ARCHIVE_EOF){
+                break;
+            }
+            if (error_code < ARCHIVE_OK){
+                error_print("Failed to read archive data", libarchive->archive_error_string(Archive));
+                break;
+            }
+            {
+                PhaseTimer timer(Stats.write);
+                error_code = libarchive->archive_write_data_block(ArchiveFile, buff, size, offset);
+            }
+            Stats.dataBytes.fetch_add(size, std::memory_order_relaxed);
+            if (error_code < ARCHIVE_OK){
+                error_print("Failed to write archive data", libarchive->archive_error_string(ArchiveFile));
+                break;
+            }
+            debug_print("Finished", libarchive->archive_entry_pathname(entry));
+        }
+
+        {
+            PhaseTimer timer(Stats.finishEntry);
+            error_code = libarchive->archive_write_finish_entry(ArchiveFile);
+        }
+        if (error_code < ARCHIVE_OK){
+            error_print(libarchive->archive_error_string(ArchiveFile));
+            status = AccessFileFailed;
+        }
+
+        return status;
+    }
+};
+
+template<typename Backend>
+BasicArchiver<Backend>::BasicArchiver(std::unique_ptr<Backend> libarchive, ArchiverOptions options): pImpl(std::make_unique<Impl>(std::move(libarchive), options)){}
+
+template<typename Backend>
+BasicArchiver<Backend>::BasicArchiver(std::string filename, std::unique_ptr<Backend> libarchive, ArchiverOptions options) : pImpl(std::make_unique<Impl>(filename, std::move(libarchive), options)){}
+
+template<typename Backend>
+BasicArchiver<Backend>::BasicArchiver(IExplorer& explorer, std::unique_ptr<Backend> libarchive, ArchiverOptions options) : pImpl(std::make_unique<Impl>(DefaultArchiveName(options), std::move(libarchive), options)) {
+    pImpl->ArchiveItem(explorer.GetLocation());
+}
+
+template<typename Backend>
+BasicArchiver<Backend>::~BasicArchiver() = default;
+
+template<typename Backend>
+Status BasicArchiver<Backend>::Extract(std::string location) {
+    return pImpl->Extract(location);
+}
+
+template<typename Backend>
+Status BasicArchiver<Backend>::ExtractPath(std::string location, std::string path, std::string destination) {
+    return pImpl->ExtractPath(location, path, destination);
+}
+
+template<typename Backend>
+Status BasicArchiver<Backend>::List(std::string location, const std::function<void(const ArchiveListEntry&)>& callback) {
+    return pImpl->List(location, callback);
+}
+
+template<typename Backend>
+Status BasicArchiver<Backend>::ArchiveItem(fs::directory_entry location) {
+    return pImpl->ArchiveItem(location);
+}
+
+template<typename Backend>
+Status BasicArchiver<Backend>::Finish() {
+    return pImpl->Finish();
+}
+
+template<typename Backend>
+ArchiverStats BasicArchiver<Backend>::GetStats() const {
+    return pImpl->GetStats();
+}
+
+template<typename Backend>
+Status BasicArchiver<Backend>::Verify(std::string location, VerifyResult& result) {
+    return pImpl->Verify(location, result);
+}
+
+template<typename Backend>
+SizeEstimate BasicArchiver<Backend>::Estimate(fs::directory_entry location) {
+    return pImpl->Estimate(location, SampleCompressor());
+}
+
+template<typename Backend>
+SizeEstimator::Compressor BasicArchiver<Backend>::SampleCompressor() {
+    Impl* impl = pImpl.get();
+    return [impl](const char* data, size_t length, uint64_t& compressed) {
+        return impl->CompressSample(data, length, compressed);
+    };
+}
+
+#endif // ARCHIVER_TPP
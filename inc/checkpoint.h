@@ -0,0 +1,89 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "codec.h"
+#include "manifest.h"
+#include "status.h"
+
+/** Suffix appended to the archive name to form the name of its checkpoint journal. */
+#define CHECKPOINT_SUFFIX ".journal"
+/** Archive bytes written between two checkpoints unless the options say otherwise. */
+#define CHECKPOINT_INTERVAL_BYTES 0x10000000
+
+/*
+ * Checkpoint journal
+ *
+ * A header naming the codec of the archive, followed by one record per
+ * checkpoint: the payload length and its XXH64, then the payload. A record
+ * is only appended once the archive bytes it covers are on stable storage,
+ * and a record torn by a crash fails the length or digest check and is
+ * dropped, so the journal always describes a prefix of the archive file
+ * that a restarted run can continue.
+ */
+
+/**
+ * @brief Progress of a checkpointed archive.
+ *
+ * Appended to the journal, toc, checksums and records hold what was added
+ * since the previous checkpoint; read back from it, everything up to the
+ * last checkpoint.
+ */
+struct Checkpoint {
+    /** Archive bytes covered, where a restarted run truncates the file and continues. */
+    uint64_t offset = 0;
+    /** Item being archived, and the last path of it archived completely, in walk order. */
+    std::string item;
+    std::string last;
+    /** Table of contents entries of the completed frames, see seekable.h. */
+    std::string toc;
+    /** Checksum list lines, see checksums.h. */
+    std::string checksums;
+    /** Manifest entries of the archived files, built with AppendRecord. */
+    std::string records;
+};
+
+void AppendRecord(std::string& records, const ManifestEntry& entry);
+/**
+ * @brief Reads the record at position and moves past it; the path points into records.
+ * @return false at the end of the records or if they are truncated.
+ */
+bool NextRecord(const std::string& records, size_t& position, ManifestEntry& entry);
+
+/**
+ * @brief Append-only journal of the checkpoints of one archive.
+ */
+class CheckpointJournal {
+public:
+    /** Creates the journal of a new archive, replacing any old one. */
+    static std::unique_ptr<CheckpointJournal> Create(const std::string& filename, Codec codec);
+    /**
+     * @brief Opens the journal an interrupted run left behind.
+     *
+     * A torn last record is cut off, so later checkpoints are appended after
+     * the intact ones.
+     *
+     * @param progress Receives everything up to the last checkpoint.
+     * @param doneItems Receives the items completed before progress.item.
+     * @return nullptr if there is no journal, it was written for another
+     *         codec or it holds no complete checkpoint.
+     */
+    static std::unique_ptr<CheckpointJournal> Resume(const std::string& filename, Codec codec,
+        Checkpoint& progress, std::vector<std::string>& doneItems);
+    ~CheckpointJournal();
+
+    /** Appends a checkpoint and flushes it to stable storage. */
+    Status Append(const Checkpoint& checkpoint);
+    /** Deletes the journal once its archive is complete. */
+    void Remove();
+
+private:
+    CheckpointJournal();
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+#endif // CHECKPOINT_H
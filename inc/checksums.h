@@ -0,0 +1,70 @@
+#ifndef CHECKSUMS_H
+#define CHECKSUMS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** Name of the tar entry holding the content checksums, written after all files. */
+#define CHECKSUMS_NAME ".bttf-xxh64"
+/** Data of an entry collected before it is handed to a hashing thread. */
+#define HASH_POOL_BLOCK_SIZE 0x100000
+/** Data waiting for the hashing threads, at most; the producer blocks beyond it. */
+#define HASH_POOL_QUEUE_BYTES 0x4000000
+
+/*
+ * Checksum list
+ *
+ * The XXH64 digest of every regular file's content, holes of sparse files
+ * included as zeros, one line per file in the format of xxhsum:
+ * 16 lowercase hex digits, two spaces and the path in the archive. A path
+ * holding a backslash or a newline is escaped as "\\" and "\n" and its line
+ * starts with a backslash, as coreutils' checksum tools do, so the entry can
+ * be checked with `xxhsum -c` after a plain extraction.
+ */
+
+void AppendChecksum(std::string& list, const std::string& path, uint64_t digest);
+/**
+ * @brief Reads a checksum list into a map from path to digest.
+ * @return false if a line is malformed.
+ */
+bool ParseChecksums(const std::string& list, std::map<std::string, uint64_t>& digests);
+
+/**
+ * @brief Hashes a sequence of entries with XXH64 on a set of threads.
+ *
+ * The producer passes the entries one after the other, each as Begin, its
+ * data and End. Entries are dealt out to the threads in turn, so one entry
+ * is always hashed by a single thread in order while the next ones are
+ * hashed by the others. Data is copied in blocks of up to
+ * HASH_POOL_BLOCK_SIZE, so the producer may reuse its buffers right away,
+ * and it blocks while HASH_POOL_QUEUE_BYTES are waiting to be hashed.
+ */
+class HashPool {
+public:
+    /** @param threads Hashing threads, 0 means one per available core. */
+    explicit HashPool(unsigned int threads = 0);
+    ~HashPool();
+
+    void Begin(const std::string& path);
+    void Update(const void* data, size_t length);
+    /** Adds length zero bytes, e.g. a hole of a sparse file, without queueing them. */
+    void Zeros(uint64_t length);
+    void End();
+
+    /**
+     * @brief Waits until every entry is hashed.
+     * @return Path and digest of every entry, in the order they were begun.
+     */
+    std::vector<std::pair<std::string, uint64_t>> Finish();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+#endif // CHECKSUMS_H
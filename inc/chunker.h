@@ -0,0 +1,43 @@
+#ifndef CHUNKER_H
+#define CHUNKER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/** Smallest chunk produced by the chunker, except for the tail of a file. */
+#define CHUNK_MIN_SIZE 0x4000
+/** Chunk size the cut-point masks are normalised around. */
+#define CHUNK_AVG_SIZE 0x10000
+/** Largest chunk, a cut is forced here if no boundary was found. */
+#define CHUNK_MAX_SIZE 0x40000
+
+/**
+ * @brief FastCDC content-defined chunker.
+ *
+ * Cut points are chosen where a gear rolling hash of the preceding bytes
+ * matches a mask, so they move with the content: inserting or removing
+ * bytes only changes the chunks around the edit and the rest of the file
+ * still deduplicates against earlier versions. The first CHUNK_MIN_SIZE
+ * bytes of a chunk are skipped, and normalised chunking uses a stricter
+ * mask below CHUNK_AVG_SIZE and a looser one above it, which keeps chunk
+ * sizes close to the average.
+ *
+ * The gear table is fixed; changing it would move every cut point and
+ * break deduplication against existing stores.
+ */
+class Chunker {
+public:
+    /**
+     * @brief Finds the end of the chunk starting at data.
+     *
+     * @param data Pending bytes of the file.
+     * @param length Number of pending bytes.
+     * @return Length of the chunk, at most CHUNK_MAX_SIZE. If no boundary is
+     *         found within length bytes, length (capped to CHUNK_MAX_SIZE) is
+     *         returned, so callers should only cut with less than
+     *         CHUNK_MAX_SIZE bytes pending at the end of a file.
+     */
+    static size_t FindCut(const unsigned char* data, size_t length);
+};
+
+#endif // CHUNKER_H
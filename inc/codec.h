@@ -0,0 +1,28 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <string>
+
+/**
+ * @brief Compression filter applied to the tar stream.
+ */
+enum class Codec {
+    Xz,
+    Zstd,
+    Lz4,
+    Gzip,
+    None
+};
+
+/** Level value meaning "use the codec's default level". */
+#define CODEC_DEFAULT_LEVEL (-1)
+/** zstd window log used for long-distance matching. */
+#define ZSTD_LONG_WINDOW_LOG 27
+
+std::string CodecName(Codec codec);
+std::string CodecExtension(Codec codec);
+bool ParseCodec(const std::string& name, Codec& codec);
+bool IsValidLevel(Codec codec, int level);
+bool IsThreadedCodec(Codec codec);
+
+#endif // CODEC_H
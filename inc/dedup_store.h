@@ -0,0 +1,104 @@
+#ifndef DEDUP_STORE_H
+#define DEDUP_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "status.h"
+
+/**
+ * @brief Identity of a chunk, 128 bits of XXH64 over its content.
+ *
+ * Two XXH64 digests with different seeds are combined, which keeps
+ * accidental collisions out of reach for any realistic store size.
+ */
+struct ChunkId {
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    static ChunkId Of(const void* data, size_t length);
+
+    bool operator==(const ChunkId& other) const {
+        return high == other.high && low == other.low;
+    }
+};
+
+/**
+ * @brief Local content-addressed store of compressed chunks.
+ *
+ * The store is a directory holding append-only pack files with the
+ * compressed chunks and an append-only index mapping every chunk id to its
+ * pack, offset and sizes. Each session writes a new pack, so packs are
+ * never rewritten. A chunk is compressed and stored only the first time it
+ * is seen; later copies just reference it. Chunks are compressed as raw
+ * LZMA2 with a dictionary no larger than a chunk, and stored uncompressed
+ * if that does not make them smaller.
+ *
+ * Several sessions, e.g. concurrent batch jobs, may use one store: the
+ * index is appended under an flock, and a chunk missing from the index
+ * read at Open is looked up again among the records appended since.
+ */
+class DedupStore {
+public:
+    /**
+     * @brief Opens the store in directory, creating it if needed.
+     * @param level xz preset 0-9 used for new chunks, CODEC_DEFAULT_LEVEL for the default.
+     * @return The store, or nullptr if the directory or index cannot be used.
+     */
+    static std::unique_ptr<DedupStore> Open(const std::string& directory, int level);
+    ~DedupStore();
+
+    Status Put(const char* data, size_t length, ChunkId& id);
+    Status Get(const ChunkId& id, std::vector<char>& data);
+    Status Flush();
+
+    /** Number of chunks stored by this session. */
+    uint64_t NewChunks() const;
+    /** Number of chunks found already stored. */
+    uint64_t DuplicateChunks() const;
+
+private:
+    DedupStore();
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/** Extension of a dedup archive, which holds the chunk lists of its files. */
+#define DEDUP_ARCHIVE_EXTENSION ".bttf"
+
+/**
+ * @brief Archive made of per-file chunk lists that reference a DedupStore.
+ *
+ * File data is split with the content-defined Chunker and every chunk is
+ * put into the store; the archive file itself only holds, per file, its
+ * path, size, mtime and the ids of its chunks, plus the location of the
+ * store. Data is chunked as it arrives, so at most CHUNK_MAX_SIZE bytes of
+ * a file are buffered regardless of its size.
+ */
+class DedupArchive {
+public:
+    /**
+     * @brief Creates the archive file and opens its store.
+     * @return The archive, or nullptr if the file or the store cannot be opened.
+     */
+    static std::unique_ptr<DedupArchive> Create(const std::string& filename, const std::string& store, int level);
+    ~DedupArchive();
+
+    void BeginFile(const std::string& path);
+    Status Write(const char* data, size_t length);
+    Status EndFile(int64_t mtime, bool keep);
+    Status Flush();
+    Status Close();
+
+    static bool IsDedupArchive(const std::string& filename);
+    static Status Extract(const std::string& filename, const std::string& store, const std::string& destination = "");
+
+private:
+    DedupArchive();
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+#endif // DEDUP_STORE_H
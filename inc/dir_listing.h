@@ -0,0 +1,74 @@
+#ifndef DIR_LISTING_H
+#define DIR_LISTING_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** Entries per page of a directory listing. */
+#define LISTING_PAGE_SIZE 50
+/** Pages collected by one pass over the directory when jumping ahead. */
+#define LISTING_SCAN_PAGES 16
+/** Page boundaries remembered per listing; further ones are thinned out. */
+#define LISTING_INDEX_LIMIT 1024
+
+/**
+ * @brief One entry of a directory listing.
+ */
+struct ListingEntry {
+    std::string name;
+    /** A directory, or a symbolic link to one. */
+    bool directory = false;
+};
+
+/**
+ * @brief Sorted, paginated view of a directory whose memory use does not
+ *        depend on the number of entries.
+ *
+ * Nothing but the current page is kept. A page is produced by one readdir
+ * pass that keeps the smallest names after the end of the previous page in
+ * a heap bounded by LISTING_SCAN_PAGES pages, so moving to the next or a
+ * previously visited page costs one pass and no stat calls beyond the
+ * page's own entries of unknown type. The last name before every page seen
+ * is remembered (at most LISTING_INDEX_LIMIT of them) as the starting point
+ * for later jumps; a page far from all of them is located by sampling the
+ * names, in a few passes whatever its position.
+ *
+ * Changes to the directory are detected with inotify, or where it is not
+ * available by comparing the directory's modification time; the cached
+ * page, count and page boundaries are then dropped. Not thread safe.
+ */
+class DirListing {
+public:
+    /**
+     * @brief Opens a directory for listing; nothing is read yet.
+     * @return The listing, or nullptr if path is not a readable directory.
+     */
+    static std::unique_ptr<DirListing> Open(const std::string& path, size_t pageSize = LISTING_PAGE_SIZE);
+    ~DirListing();
+
+    /** Number of entries, "." and ".." excluded. */
+    size_t Size();
+    size_t PageSize() const;
+    size_t PageCount();
+    /**
+     * @brief Entries of a page, sorted by name (byte order).
+     * @return The page, empty if it is past the end.
+     */
+    const std::vector<ListingEntry>& Page(size_t page);
+    /**
+     * @brief Entry at a position of the sorted listing.
+     * @return false if index is past the end.
+     */
+    bool At(size_t index, ListingEntry& entry);
+    /** Number of passes over the directory made so far. */
+    size_t Scans() const;
+
+private:
+    DirListing();
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+#endif // DIR_LISTING_H
@@ -0,0 +1,84 @@
+#ifndef DIR_WALKER_H
+#define DIR_WALKER_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include "status.h"
+
+/**
+ * @brief One filesystem object found by the DirWalker.
+ */
+struct WalkEntry {
+    /** Full path, built as root + "/" + relative path. */
+    std::string path;
+    /** Entry type as DT_* constant from <dirent.h>, DT_UNKNOWN if it could not be determined. */
+    unsigned char type = 0;
+    /** Inode number reported by the directory. */
+    uint64_t inode = 0;
+    /** Size in bytes, only filled for regular files when size statting is enabled. */
+    uint64_t size = 0;
+    /** Modification time in nanoseconds since the epoch, filled together with size. */
+    int64_t mtime = 0;
+};
+
+/**
+ * @brief Parallel, work-stealing directory tree walker.
+ *
+ * Directories are read with getdents64 relative to their parent's descriptor
+ * (openat), entry types come from d_type and statx is only issued when the
+ * filesystem does not report a type, or when sizes are requested. Every
+ * worker owns a deque of pending directories. It takes work from the back of
+ * its own deque and steals from the front of the others when it runs dry,
+ * so wide and deep trees both keep all workers busy. Symbolic links are
+ * reported but never followed, unreadable directories are skipped. A
+ * directory is always reported before any entry below it.
+ *
+ * An ordered walker instead reads the tree depth first on a single thread:
+ * the entries of every directory sorted by name, each directory followed
+ * right away by its contents. The order only depends on the tree, so a walk
+ * can be resumed after a given path.
+ */
+class DirWalker {
+public:
+    /** Called for every entry below the root; may run concurrently on several workers. */
+    using Visitor = std::function<void(const WalkEntry& entry)>;
+
+    /**
+     * @param threads Number of worker threads, 0 selects one per available core.
+     * @param statSizes Fill WalkEntry::size and WalkEntry::mtime for regular files
+     *        (costs one statx per file).
+     * @param ordered Walk in the sorted depth-first order; threads is ignored.
+     */
+    explicit DirWalker(unsigned int threads = 0, bool statSizes = false, bool ordered = false);
+    ~DirWalker();
+
+    /**
+     * @brief Ordered walks only: skips every entry up to and including path,
+     *        as reported by an earlier walk of the same root.
+     *
+     * Subtrees that lie entirely before path are not read at all. Call
+     * before Walk or Start; a path outside the root is ignored.
+     */
+    void ResumeAfter(const std::string& path);
+
+    Status Walk(const std::string& root, const Visitor& visit);
+
+    void Start(const std::string& root);
+    bool Next(WalkEntry& entry);
+    /**
+     * @brief Stops a walk in progress; may be called from another thread.
+     *
+     * Walk returns, and Next reports the end after the entries already
+     * buffered, once the workers finish their current directory. The walker
+     * cannot be used again afterwards.
+     */
+    void Stop();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+#endif // DIR_WALKER_H
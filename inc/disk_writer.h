@@ -0,0 +1,85 @@
+#ifndef DISK_WRITER_H
+#define DISK_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "status.h"
+
+/** Directory descriptors kept open by a DiskWriter; deeper trees reopen the rest. */
+#define DISK_WRITER_MAX_DIR_FDS 256
+
+/**
+ * @brief When extracted data is forced to stable storage.
+ */
+enum class Durability {
+    /** Leave write-back to the kernel. */
+    None,
+    /** One syncfs() of the destination filesystem after the last entry. */
+    SyncAtEnd,
+    /** fsync() every file before it is closed. */
+    PerFile
+};
+
+/**
+ * @brief Metadata of an entry restored by DiskWriter.
+ */
+struct DiskEntry {
+    /** Path relative to the destination; leading '/' is dropped, '..' is rejected. */
+    std::string path;
+    /** Permission bits, as in st_mode. */
+    unsigned int mode = 0;
+    /** Modification time in nanoseconds since the epoch. */
+    int64_t mtime = 0;
+    int64_t size = 0;
+    /** The entry has holes: the file is not preallocated, so unwritten ranges stay holes. */
+    bool sparse = false;
+};
+
+/**
+ * @brief A regular file being written by DiskWriter.
+ */
+struct DiskFile {
+    int fd = -1;
+    DiskEntry entry;
+};
+
+/**
+ * @brief Native extraction target for regular files, directories and hard links.
+ *
+ * Files are created with openat() relative to cached descriptors of their
+ * parent directories, so paths are resolved once per directory rather than
+ * once per file, and are preallocated with fallocate() from the size in the
+ * archive. Permissions and times of a file are set through its open
+ * descriptor when it is complete; those of directories, which change while
+ * their children are created, are applied in one batch by Finish(),
+ * deepest first. The writer is safe to use from several threads.
+ */
+class DiskWriter {
+public:
+    /**
+     * @brief Opens the destination directory.
+     * @return The writer, or nullptr if root cannot be opened.
+     */
+    static std::unique_ptr<DiskWriter> Open(const std::string& root, Durability durability);
+    ~DiskWriter();
+
+    Status BeginFile(const DiskEntry& entry, DiskFile& file);
+    Status WriteBlock(DiskFile& file, const void* data, size_t length, int64_t offset);
+    Status EndFile(DiskFile& file);
+
+    Status MakeDirectory(const DiskEntry& entry);
+    /** Creates entry.path as a hard link to target, both relative to the destination. */
+    Status Link(const DiskEntry& entry, const std::string& target);
+
+    /** Applies the deferred directory metadata and the durability policy. */
+    Status Finish();
+
+private:
+    DiskWriter();
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+#endif // DISK_WRITER_H
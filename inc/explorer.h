@@ -6,6 +6,8 @@
 #include <memory>
 #include "status.h"
 
+class SizeEstimator;
+
 namespace fs = std::filesystem;
 
 class Explorer : public IExplorer {
@@ -16,6 +18,11 @@ public:
 
     Status SelectItemToArchive(std::filesystem::directory_entry* location = nullptr);
     std::filesystem::directory_entry GetLocation();
+    /**
+     * @brief Shows estimated sizes, archive sizes and compression times next
+     *        to the listed directories, computed in the background by estimator.
+     */
+    void SetEstimator(std::unique_ptr<SizeEstimator> estimator);
 
 private:
     class Impl; // Forward declaration of implementation class
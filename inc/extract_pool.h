@@ -0,0 +1,52 @@
+#ifndef EXTRACT_POOL_H
+#define EXTRACT_POOL_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "ILibarchive_wrapper.h"
+#include "disk_writer.h"
+#include "status.h"
+
+/** Regular files up to this size are buffered and handed to the writer pool. */
+#define POOL_ENTRY_LIMIT 0x100000
+/** Upper bound of entry data buffered in the pool queue. */
+#define POOL_QUEUE_BYTES 0x4000000
+
+/**
+ * @brief A fully buffered archive entry waiting to be written to disk.
+ */
+struct ExtractJob {
+    /** A clone of the archive entry, owned by the job. */
+    struct archive_entry* entry = nullptr;
+    /** Entry data, the concatenation of all blocks. */
+    std::vector<char> data;
+    /** (offset in file, length) of every block in data, in order. */
+    std::vector<std::pair<int64_t, size_t>> blocks;
+};
+
+/**
+ * @brief Pool of writer threads that create extracted files in parallel.
+ *
+ * Each worker owns its own archive_write_disk handle, so file creation,
+ * data writes and metadata (open, write, fchmod, utimes, close) for
+ * different files run concurrently. The queue is bounded by
+ * POOL_QUEUE_BYTES so a fast decoder cannot buffer the whole archive.
+ * Given a DiskWriter, the workers create files through it instead and
+ * need no disk handles of their own.
+ */
+class ExtractPool {
+public:
+    ExtractPool(ILibArchiveWrapper& libarchive, unsigned int threads, int flags, DiskWriter* native = nullptr);
+    ~ExtractPool();
+
+    void Submit(ExtractJob job);
+    void Drain();
+    Status Finish();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+#endif // EXTRACT_POOL_H
@@ -0,0 +1,131 @@
+#ifndef IO_RING_H
+#define IO_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/** Size of each buffer of the archive file writer and reader. */
+#define RING_BUFFER_SIZE 0x100000
+/** Number of archive file writes or reads kept in flight. */
+#define RING_BUFFER_COUNT 4
+/** Number of source file reads the read pipeline keeps in flight. */
+#define RING_PIPELINE_DEPTH 8
+/** Attempts the read pipeline makes to queue a read with none in flight before it fails the file. */
+#define RING_QUEUE_ATTEMPTS 4
+/** Offset and length alignment required by O_DIRECT. */
+#define DIRECT_IO_ALIGNMENT 4096
+
+/**
+ * @brief Minimal io_uring submission and completion ring.
+ *
+ * Talks to the kernel through the raw io_uring_setup/io_uring_enter system
+ * calls, so no extra library is needed. Operations are queued with
+ * QueueRead/QueueWrite, handed to the kernel by Submit and reaped with
+ * Complete or WaitCompletion, identified by the tag given when queuing.
+ * Not thread safe; a ring belongs to one thread at a time.
+ */
+class IoRing {
+public:
+    /**
+     * @brief Sets up a ring with room for entries queued operations.
+     * @return The ring, or nullptr if the kernel has no usable io_uring.
+     */
+    static std::unique_ptr<IoRing> Create(unsigned entries);
+    ~IoRing();
+
+    /**
+     * @brief Registers buffers for fixed reads and writes.
+     * @return false if the kernel refused, e.g. over RLIMIT_MEMLOCK; plain
+     *         operations still work.
+     */
+    bool RegisterBuffers(const std::vector<struct iovec>& buffers);
+
+    /**
+     * @brief Queues a read or write of length bytes at offset.
+     * @param buffer Index of the registered buffer holding data, -1 if none.
+     * @return false if the submission queue is full.
+     */
+    bool QueueRead(int fd, void* data, unsigned length, uint64_t offset, int buffer, uint64_t tag);
+    bool QueueWrite(int fd, const void* data, unsigned length, uint64_t offset, int buffer, uint64_t tag);
+
+    /**
+     * @brief Submits the queued operations and waits for waitFor completions.
+     * @return false if the kernel rejected the submission.
+     */
+    bool Submit(unsigned waitFor);
+
+    /**
+     * @brief Takes a completion without waiting.
+     * @param result Bytes transferred, or a negative errno.
+     * @return false if no operation has completed.
+     */
+    bool Complete(uint64_t& tag, int& result);
+    bool WaitCompletion(uint64_t& tag, int& result);
+
+private:
+    IoRing();
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * @brief Sequential file writer with several writes in flight.
+ *
+ * Data is copied into RING_BUFFER_COUNT registered buffers of
+ * RING_BUFFER_SIZE bytes, each written as a whole while the next ones are
+ * being filled. With direct I/O the file is opened with O_DIRECT, so a
+ * multi-gigabyte archive does not evict the page cache; the last buffer is
+ * padded to DIRECT_IO_ALIGNMENT and the file truncated back to its size.
+ */
+class RingOutput {
+public:
+    /**
+     * @brief Creates or truncates filename.
+     * @param direct Use O_DIRECT where the filesystem supports it.
+     * @return The writer, or nullptr if io_uring is unavailable or the file
+     *         cannot be opened.
+     */
+    static std::unique_ptr<RingOutput> Open(const std::string& filename, bool direct);
+    ~RingOutput();
+
+    bool Write(const char* data, size_t length);
+    /** Writes the remaining data, waits for all writes and closes the file. */
+    bool Close();
+
+private:
+    RingOutput();
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * @brief Sequential file reader keeping RING_BUFFER_COUNT reads ahead.
+ */
+class RingInput {
+public:
+    /**
+     * @return The reader, or nullptr if io_uring is unavailable or filename
+     *         is not a regular file.
+     */
+    static std::unique_ptr<RingInput> Open(const std::string& filename);
+    ~RingInput();
+
+    /**
+     * @brief Returns the next block of the file.
+     * @param data Points to the block, valid until the next call.
+     * @return Length of the block, 0 at the end of the file, -1 on error.
+     */
+    ssize_t Read(const char** data);
+
+private:
+    RingInput();
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+#endif // IO_RING_H
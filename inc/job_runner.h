@@ -0,0 +1,96 @@
+#ifndef JOB_RUNNER_H
+#define JOB_RUNNER_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "archiver.h"
+#include "status.h"
+
+/**
+ * @brief What a batch job does.
+ */
+enum class JobKind {
+    /** Archive source into the archive file target. */
+    Pack,
+    /** Extract the archive file source into the directory target. */
+    Unpack
+};
+
+/**
+ * @brief One line of a job manifest.
+ */
+struct Job {
+    JobKind kind = JobKind::Pack;
+    std::string source;
+    std::string target;
+    /** Settings of the job; the thread counts and the prefetch window are set by JobRunner. */
+    ArchiverOptions options;
+};
+
+/**
+ * @brief Reads a job manifest, one job per line:
+ *
+ *     pack <directory> <archive> [codec=<name>] [level=<N>] [long] [reproducible]
+ *          [seekable] [checkpoint] [incremental=<manifest>] [dedup=<store>]
+ *     unpack <archive> <directory> [dedup=<store>] [native-writer]
+ *
+ * Fields are separated by blanks and may be double-quoted to contain them.
+ * Empty lines and lines starting with '#' are ignored. Settings a line does
+ * not give are taken from defaults.
+ *
+ * @return Success, CannotOpenFile if the manifest cannot be read, or
+ *         TooManyArgs if a line is malformed; jobs is then left empty.
+ */
+Status ParseJobManifest(const std::string& filename, const ArchiverOptions& defaults, std::vector<Job>& jobs);
+
+/**
+ * @brief Runs batch jobs concurrently under one thread and I/O budget.
+ *
+ * A fixed number of job slots, at most one per thread of the budget, take
+ * jobs in manifest order. A job starting takes its share of the threads no
+ * running job holds, split evenly with the slots still waiting to start
+ * one, so the threads of a finished job go to the next. The share is split
+ * between the stages of the job that run at the same time: directory
+ * walking and compression for a pack job, decoding and the writer pool for
+ * an unpack job. Every stage needs at least one thread, so with a budget
+ * smaller than twice the running jobs it may be exceeded by one thread per
+ * job; the pipeline reader thread, which mostly waits for the disk, is not
+ * counted either. The prefetch window is divided in proportion to the
+ * shares, bounding the data read ahead from disk at any time.
+ */
+class JobRunner {
+public:
+    /**
+     * @param threads Thread budget, 0 means one per available core.
+     * @param parallel Jobs run at the same time, 0 means one per thread of
+     *        the budget; never more than the budget or the number of jobs.
+     */
+    JobRunner(unsigned int threads = 0, unsigned int parallel = 0);
+    ~JobRunner();
+
+    /**
+     * @brief Runs every job and waits for all of them.
+     *
+     * @param execute Runs one job on the calling slot thread; the job's
+     *        options already hold its share of the budget.
+     * @param report Called after each job with its index and status, one
+     *        call at a time.
+     * @return The status of every job, in the order of jobs.
+     */
+    std::vector<Status> Run(const std::vector<Job>& jobs, const std::function<Status(const Job&)>& execute,
+                            const std::function<void(size_t index, Status status)>& report = {});
+
+    /**
+     * @brief Exit status of a batch: Success if every job succeeded,
+     *        otherwise the status of the first job that failed.
+     */
+    static Status Aggregate(const std::vector<Status>& statuses);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+#endif // JOB_RUNNER_H
@@ -3,7 +3,8 @@
 
 #include "ILibarchive_wrapper.h"
 
-class LibArchiveWrapper : public ILibArchiveWrapper {
+/* final, so the calls BasicArchiver makes on this type are resolved at compile time and inlined. */
+class LibArchiveWrapper final : public ILibArchiveWrapper {
 public:
     struct archive* archive_read_new() override {
         return ::archive_read_new();
@@ -41,6 +42,26 @@ public:
         return ::archive_write_add_filter_xz(a);
     }
 
+    int archive_write_add_filter_zstd(struct archive* a) override {
+        return ::archive_write_add_filter_zstd(a);
+    }
+
+    int archive_write_add_filter_lz4(struct archive* a) override {
+        return ::archive_write_add_filter_lz4(a);
+    }
+
+    int archive_write_add_filter_gzip(struct archive* a) override {
+        return ::archive_write_add_filter_gzip(a);
+    }
+
+    int archive_write_add_filter_none(struct archive* a) override {
+        return ::archive_write_add_filter_none(a);
+    }
+
+    int archive_write_set_filter_option(struct archive* a, const char* module, const char* option, const char* value) override {
+        return ::archive_write_set_filter_option(a, module, option, value);
+    }
+
     int archive_write_set_format_pax_restricted(struct archive* a) override {
         return ::archive_write_set_format_pax_restricted(a);
     }
@@ -124,6 +145,94 @@ public:
     int archive_write_data_block(struct archive* a, const void* buff, size_t size, int64_t offset) {
         return ::archive_write_data_block(a, buff, size, offset);
     }
+
+    struct archive_entry* archive_entry_clone(struct archive_entry* entry) override {
+        return ::archive_entry_clone(entry);
+    }
+
+    unsigned int archive_entry_filetype(struct archive_entry* entry) override {
+        return ::archive_entry_filetype(entry);
+    }
+
+    const char* archive_entry_hardlink(struct archive_entry* entry) override {
+        return ::archive_entry_hardlink(entry);
+    }
+
+    int archive_read_open(struct archive* a, void* client_data, archive_open_callback* open_callback, archive_read_callback* read_callback, archive_close_callback* close_callback) override {
+        return ::archive_read_open(a, client_data, open_callback, read_callback, close_callback);
+    }
+
+    int archive_write_open(struct archive* a, void* client_data, archive_open_callback* open_callback, archive_write_callback* write_callback, archive_close_callback* close_callback) override {
+        return ::archive_write_open(a, client_data, open_callback, write_callback, close_callback);
+    }
+
+    int archive_write_set_bytes_per_block(struct archive* a, int bytes_per_block) override {
+        return ::archive_write_set_bytes_per_block(a, bytes_per_block);
+    }
+
+    int archive_write_set_format_raw(struct archive* a) override {
+        return ::archive_write_set_format_raw(a);
+    }
+
+    int archive_read_data_skip(struct archive* a) override {
+        return ::archive_read_data_skip(a);
+    }
+
+    unsigned int archive_entry_mode(struct archive_entry* entry) override {
+        return ::archive_entry_mode(entry);
+    }
+
+    time_t archive_entry_mtime(struct archive_entry* entry) override {
+        return ::archive_entry_mtime(entry);
+    }
+
+    long archive_entry_mtime_nsec(struct archive_entry* entry) override {
+        return ::archive_entry_mtime_nsec(entry);
+    }
+
+    void archive_entry_set_mtime(struct archive_entry* entry, time_t sec, long nsec) override {
+        ::archive_entry_set_mtime(entry, sec, nsec);
+    }
+
+    int archive_write_open_fd(struct archive* a, int fd) override {
+        return ::archive_write_open_fd(a, fd);
+    }
+
+    int archive_read_open_fd(struct archive* a, int fd, size_t block_size) override {
+        return ::archive_read_open_fd(a, fd, block_size);
+    }
+
+    int archive_write_set_bytes_in_last_block(struct archive* a, int bytes_in_last_block) override {
+        return ::archive_write_set_bytes_in_last_block(a, bytes_in_last_block);
+    }
+
+    void archive_entry_sparse_add_entry(struct archive_entry* entry, la_int64_t offset, la_int64_t length) override {
+        ::archive_entry_sparse_add_entry(entry, offset, length);
+    }
+
+    int archive_entry_sparse_count(struct archive_entry* entry) override {
+        return ::archive_entry_sparse_count(entry);
+    }
+
+    void archive_entry_set_hardlink(struct archive_entry* entry, const char* target) override {
+        ::archive_entry_set_hardlink(entry, target);
+    }
+
+    void archive_entry_xattr_add_entry(struct archive_entry* entry, const char* name, const void* value, size_t size) override {
+        ::archive_entry_xattr_add_entry(entry, name, value, size);
+    }
+
+    int archive_entry_xattr_reset(struct archive_entry* entry) override {
+        return ::archive_entry_xattr_reset(entry);
+    }
+
+    int archive_entry_xattr_next(struct archive_entry* entry, const char** name, const void** value, size_t* size) override {
+        return ::archive_entry_xattr_next(entry, name, value, size);
+    }
+
+    la_int64_t archive_filter_bytes(struct archive* a, int filter) override {
+        return ::archive_filter_bytes(a, filter);
+    }
 };
 
 #endif
@@ -0,0 +1,40 @@
+#ifndef LINK_TABLE_H
+#define LINK_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Remembers the first archived path of every multiply linked file.
+ *
+ * Files are identified by (device, inode). Only files with more than one
+ * link need to be added, so trees with tens of millions of plain files cost
+ * nothing. The table is an open-addressing array of 32-byte slots plus one
+ * shared blob of paths, without a per-entry allocation. Not thread safe.
+ */
+class LinkTable {
+public:
+    LinkTable();
+    ~LinkTable();
+
+    /**
+     * @brief Looks up an earlier link of (device, inode).
+     * @param path Receives the path the file was first added with.
+     * @param contentHash Receives the hash set with SetContentHash, 0 if none.
+     * @return false if the file has not been added.
+     */
+    bool Find(uint64_t device, uint64_t inode, std::string& path, uint64_t& contentHash) const;
+    void Add(uint64_t device, uint64_t inode, const std::string& path);
+    /** Records the content hash of an added file for its later links. */
+    void SetContentHash(uint64_t device, uint64_t inode, uint64_t contentHash);
+    size_t Size() const;
+    void Clear();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+#endif // LINK_TABLE_H
@@ -1,25 +1,89 @@
 #ifndef _LOGS_H_
 #define _LOGS_H_
 
-#include <iostream>
-#include <string>
 #include <sstream>
 #include <string>
-#include <stdbool.h>
-#include <cstdlib>
 
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF 4
+
+/*
+ * Messages below LOG_MIN_LEVEL are removed at compile time, arguments
+ * included. Release builds (NDEBUG) drop debug messages unless the level is
+ * given explicitly, e.g. -DLOG_MIN_LEVEL=LOG_LEVEL_DEBUG.
+ */
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+/** Number of messages the log ring holds before new ones are dropped. */
+#define LOG_RING_SIZE 1024
+/** Longest message kept in the ring; longer ones are truncated. */
+#define LOG_MESSAGE_SIZE 256
 
-#define IS_DEBUGPRINT_ENABLE std::getenv("NAVTOR_DEBUG_LOG") == nullptr ? true : false
+/**
+ * @brief Reads the runtime log level from the NAVTOR_DEBUG_LOG environment
+ *        variable: unset means LOG_LEVEL_OFF, a level name ("debug", "info",
+ *        "warning", "error") that level, any other value LOG_LEVEL_DEBUG.
+ */
+int log_read_level();
+
+/** Runtime log level, read from the environment on first use only. */
+inline int log_runtime_level() {
+    static const int level = log_read_level();
+    return level;
+}
+
+/**
+ * @brief Queues a formatted message for the background log writer.
+ *
+ * Never blocks: a message that finds the ring full is dropped and counted,
+ * and the count is reported with the next message written.
+ */
+void log_submit(const std::string& message);
+
+/**
+ * @brief Waits until every message queued so far has been written.
+ */
+void log_flush();
 
-/* it may be move to the .tpp file */
 template<typename... Args>
-void debug_print(const std::string& format, Args... args) {
-    if (IS_DEBUGPRINT_ENABLE == true) {
-        return;
-    }
+void log_write(const std::string& format, const Args&... args) {
     std::ostringstream stream;
-    ((stream << args << " "), ...);
-    std::cout << format << " " << stream.str() << std::endl;
+    stream << format;
+    ((stream << " " << args), ...);
+    log_submit(stream.str());
 }
 
-#endif
\ No newline at end of file
+/**
+ * Logs the format string followed by the arguments, separated by spaces.
+ * Compiled out below LOG_MIN_LEVEL; otherwise the arguments are only
+ * evaluated and formatted when the runtime level lets the message through.
+ */
+#define log_print(level, ...) \
+    do { \
+        if constexpr ((level) >= LOG_MIN_LEVEL) { \
+            if ((level) >= log_runtime_level()) { \
+                log_write(__VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+/*
+ * Per-file and per-block progress goes to debug_print, which release builds
+ * compile out. Failures use warning_print when the operation carries on and
+ * error_print when it fails, so they stay available in every build.
+ */
+#define debug_print(...) log_print(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define info_print(...) log_print(LOG_LEVEL_INFO, __VA_ARGS__)
+#define warning_print(...) log_print(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define error_print(...) log_print(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif
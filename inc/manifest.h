@@ -0,0 +1,70 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "status.h"
+
+/** Suffix appended to the archive name to form the name of its manifest. */
+#define MANIFEST_SUFFIX ".manifest"
+
+/**
+ * @brief State of one archived file as recorded in a manifest.
+ */
+struct ManifestEntry {
+    /** Path of the file inside the archive. */
+    std::string_view path;
+    uint64_t size = 0;
+    /** Modification time in nanoseconds since the epoch. */
+    int64_t mtime = 0;
+    uint64_t inode = 0;
+    /** XXH64 of the file content. */
+    uint64_t contentHash = 0;
+};
+
+/**
+ * @brief Read-only view of a manifest file.
+ *
+ * The file holds fixed-size records sorted by path hash followed by a blob
+ * with all paths. It is memory mapped and searched with a binary search on
+ * the path hash, so lookups stay cheap for tens of millions of paths and
+ * only the touched pages are ever loaded.
+ */
+class Manifest {
+public:
+    static std::unique_ptr<Manifest> Open(const std::string& filename);
+    ~Manifest();
+
+    size_t Size() const;
+    bool Find(std::string_view path, ManifestEntry& entry, size_t& index) const;
+    ManifestEntry At(size_t index) const;
+
+private:
+    Manifest();
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * @brief Collects manifest entries and writes them as a sorted manifest file.
+ *
+ * Entries are kept as compact fixed-size records plus one shared path blob,
+ * without a per-entry allocation.
+ */
+class ManifestWriter {
+public:
+    ManifestWriter();
+    ~ManifestWriter();
+
+    void Add(const ManifestEntry& entry);
+    Status Write(const std::string& filename);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+#endif // MANIFEST_H
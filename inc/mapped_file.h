@@ -0,0 +1,54 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstdint>
+#include <memory>
+
+/** Files at least this large are read through mmap instead of read(). */
+#define MMAP_THRESHOLD 0x400000
+/** Size of the slices of a mapped file handed to the archive writer. */
+#define MMAP_SLICE_SIZE 0x100000
+
+/**
+ * @brief Read-only, sequentially advised memory mapping of a regular file.
+ *
+ * Lets the archiver pass file contents straight from the page cache to
+ * libarchive without copying them through an intermediate buffer. The
+ * mapping keeps its own descriptor so it can notice files that shrink
+ * while they are being archived.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Maps size bytes of the file opened as fd.
+     * @return The mapping, or nullptr if the file cannot be mapped (special
+     *         files, empty files, mmap failures). The caller keeps fd.
+     */
+    static std::shared_ptr<MappedFile> Map(int fd, uint64_t size);
+
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* Data() const { return Address; }
+    uint64_t Size() const { return Length; }
+
+    /**
+     * @brief Number of bytes that can safely be read at offset.
+     *
+     * Touching a page beyond the current end of file raises SIGBUS, so every
+     * slice is clamped against a fresh fstat() before it is handed out.
+     *
+     * @return min(length, bytes left in the file), 0 if the file shrank below offset.
+     */
+    uint64_t Readable(uint64_t offset, uint64_t length) const;
+
+private:
+    MappedFile(int fd, const char* address, uint64_t length);
+
+    int Fd;
+    const char* Address;
+    uint64_t Length;
+};
+
+#endif // MAPPED_FILE_H
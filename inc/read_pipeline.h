@@ -0,0 +1,120 @@
+#ifndef READ_PIPELINE_H
+#define READ_PIPELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "link_table.h"
+#include "mapped_file.h"
+#include "sparse.h"
+#include "status.h"
+
+#define PIPELINE_BUFFER_SIZE 0x10000
+#define PIPELINE_BUFFER_COUNT 32
+/** Default number of bytes of upcoming files hinted to the kernel ahead of being read. */
+#define PREFETCH_WINDOW_BYTES 0x2000000
+/** Upper bound of files held open in the prefetch window. */
+#define PREFETCH_WINDOW_FILES 256
+
+/**
+ * @brief Unit of work handed from the reader stage to the archive writer.
+ *
+ * Every file produces one Begin chunk, zero or more Data chunks and one End
+ * chunk, in that order. A single Finished chunk closes the stream.
+ */
+struct FileChunk {
+    enum Kind {
+        Begin,
+        Data,
+        End,
+        Finished
+    };
+
+    static constexpr size_t NoBuffer = SIZE_MAX;
+
+    Kind kind = Finished;
+    /** Begin: path of the file on disk. */
+    std::string path;
+    /** Begin: size of the file, Data: number of valid bytes in data. */
+    uint64_t size = 0;
+    /** Begin: modification time in nanoseconds since the epoch. */
+    int64_t mtime = 0;
+    /** Begin: inode number of the file. */
+    uint64_t inode = 0;
+    /** Begin: the file has holes; only its data regions are read. */
+    bool sparse = false;
+    /** Begin: data regions of a sparse file. */
+    std::vector<SparseRegion> regions;
+    /** Begin: path of an earlier hard link to the same file; no Data chunks follow. */
+    std::string linkTarget;
+    /** Data of a sparse file: offset of data in the file; the bytes before it since the last chunk are a hole. */
+    uint64_t offset = 0;
+    /** Data: file contents, valid until the chunk is released. */
+    const char* data = nullptr;
+    /** Data: slot of the pooled buffer backing data, NoBuffer for mapped slices. */
+    size_t buffer = NoBuffer;
+    /** Data: keeps the mapping of a large file alive while its slice is in flight. */
+    std::shared_ptr<const MappedFile> mapping;
+    /** End: result of reading the file. */
+    Status status = Success;
+    /** End: XXH64 of the file content, computed on the reader thread. */
+    uint64_t contentHash = 0;
+};
+
+/**
+ * @brief Reader stage of the archiving pipeline.
+ *
+ * A background thread pulls file paths from the source, reads their content
+ * into a bounded pool of reusable buffers and publishes the chunks through a
+ * lock-free SPSC queue. Files of at least MMAP_THRESHOLD bytes are mapped
+ * instead and published as slices of the mapping, without any copy. The
+ * consumer drains them with Next() and hands every chunk back with Release()
+ * so its buffer can be reused. Disk reads therefore overlap with compression
+ * on the consumer side.
+ *
+ * Sparse files are read region by region with pread(), skipping their
+ * holes; their Begin chunk carries the data regions and every Data chunk
+ * its offset, so the consumer can record the file as a sparse entry.
+ *
+ * The reader keeps a prefetch window of upcoming files: they are taken from
+ * the source, opened and hinted with posix_fadvise(WILLNEED) until the
+ * hinted bytes reach the window size, so the kernel fetches them while the
+ * current file is being read and compressed. This hides the open and seek
+ * latency of small files on rotating disks and network filesystems.
+ *
+ * Given a LinkTable, files with several links are looked up by device and
+ * inode: the first link is read as usual, every later one is published
+ * with the path of the first as linkTarget and is not read again. A link
+ * is only added to the table once it was read completely, so if that fails
+ * the next link is read in its place.
+ *
+ * With io_uring enabled, smaller files are read with up to
+ * RING_PIPELINE_DEPTH reads in flight into the pool, which is registered
+ * with the ring; where io_uring is unavailable plain read() is used.
+ */
+class ReadPipeline {
+public:
+    /** Produces the next file to read, returns false once there are no more. */
+    using FileSource = std::function<bool(std::string& path)>;
+
+    /**
+     * @param links Hard link table used and updated by the reader thread
+     *        while the pipeline runs; nullptr reads every link in full.
+     * @param prefetchBytes Size of the prefetch window, 0 opens one file at a time.
+     */
+    explicit ReadPipeline(FileSource source, bool ioRing = false, LinkTable* links = nullptr,
+        uint64_t prefetchBytes = PREFETCH_WINDOW_BYTES);
+    ~ReadPipeline();
+
+    bool Next(FileChunk& chunk);
+    void Release(const FileChunk& chunk);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+#endif // READ_PIPELINE_H
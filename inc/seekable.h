@@ -0,0 +1,48 @@
+#ifndef SEEKABLE_H
+#define SEEKABLE_H
+
+#include <cstdint>
+#include <string>
+#include "codec.h"
+
+/** Uncompressed tar bytes after which the current frame is closed at the next entry boundary. */
+#define SEEKABLE_FRAME_SIZE 0x400000
+/** Name of the tar entry holding the table of contents, always the last entry. */
+#define SEEKABLE_TOC_NAME ".bttf-toc"
+
+/*
+ * Layout of a seekable archive
+ *
+ * The tar stream is cut at entry boundaries into frames, and every frame is
+ * compressed as an independent xz stream, zstd frame or lz4 frame. The
+ * frames are simply concatenated, which plain decompressors read as one
+ * stream. The last tar entry is the table of contents, in a frame of its
+ * own, mapping every path to the compressed offset and size of the frame
+ * holding its header, along with the size, mode and mtime of the entry so
+ * the archive can be listed without decoding any other frame. The TOC frame is found from the end of the file:
+ * for xz through the stream footer and index of the last stream, for zstd
+ * and lz4 through a trailing skippable frame that both tools ignore.
+ */
+
+/**
+ * @brief Location and metadata of an entry in a seekable archive.
+ */
+struct TocEntry {
+    uint64_t frameOffset = 0;
+    uint64_t frameSize = 0;
+    uint64_t size = 0;
+    /** Modification time in nanoseconds since the epoch. */
+    int64_t mtime = 0;
+    uint32_t mode = 0;
+};
+
+bool IsSeekableCodec(Codec codec);
+
+void AppendTocEntry(std::string& toc, const std::string& path, const TocEntry& entry);
+bool NextTocEntry(const std::string& toc, size_t& position, std::string& path, TocEntry& entry);
+bool FindTocEntry(const std::string& toc, const std::string& path, TocEntry& entry);
+
+std::string SeekableTrailer(Codec codec, uint64_t tocOffset);
+bool LocateToc(int fd, TocEntry& toc);
+
+#endif // SEEKABLE_H
@@ -0,0 +1,93 @@
+#ifndef SIZE_ESTIMATOR_H
+#define SIZE_ESTIMATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+/** Files of a tree whose data is compressed to measure the codec, at most. */
+#define ESTIMATE_SAMPLE_FILES 12
+/** Bytes read and compressed from each sampled file, at most. */
+#define ESTIMATE_SAMPLE_BYTES 0x100000
+/** Trees scanned at the same time by a SizeEstimator. */
+#define ESTIMATE_PARALLEL_SCANS 2
+
+/**
+ * @brief Size of a file or tree and the measured cost of archiving it.
+ */
+struct SizeEstimate {
+    /** Regular files and their total size. */
+    uint64_t files = 0;
+    uint64_t bytes = 0;
+    /** File data compressed as a sample, what it compressed to, and how long that took. */
+    uint64_t sampleBytes = 0;
+    uint64_t sampleCompressed = 0;
+    uint64_t sampleNs = 0;
+    /** The whole tree was scanned; otherwise the counts so far. */
+    bool complete = false;
+
+    /** Expected archive size: bytes at the sampled ratio, or bytes itself before any sample. */
+    uint64_t ArchiveBytes() const;
+    /** Expected compression time in seconds at the sampled speed of one thread, 0 before any sample. */
+    double Seconds() const;
+};
+
+/**
+ * @brief Estimates the size, archive size and compression time of trees
+ *        in the background.
+ *
+ * Every tree is walked with a DirWalker for its file count and size. Files
+ * are sampled at exponentially spaced positions of the walk (the 1st, 2nd,
+ * 4th, 8th, ... non-empty file, up to ESTIMATE_SAMPLE_FILES), so small trees
+ * are sampled right away and large ones across a wider part of the tree.
+ * The first ESTIMATE_SAMPLE_BYTES of each sample are compressed with the
+ * given compressor, which gives the ratio and speed the estimate is
+ * extrapolated from. Results are available while the scan runs.
+ */
+class SizeEstimator {
+public:
+    /**
+     * Compresses data the way the archive would and returns the compressed
+     * size; false if it failed. Called from several threads at once.
+     */
+    using Compressor = std::function<bool(const char* data, size_t length, uint64_t& compressed)>;
+
+    /**
+     * @param compress Compressor of the configured codec.
+     * @param threads Walker threads per scan, 0 shares the available cores
+     *        between ESTIMATE_PARALLEL_SCANS scans.
+     */
+    SizeEstimator(Compressor compress, unsigned int threads = 0);
+    /** Cancels the scans still running. */
+    ~SizeEstimator();
+
+    /**
+     * @brief Queues a scan of path unless it is queued, running or done.
+     *        Up to ESTIMATE_PARALLEL_SCANS scans run at the same time, in the
+     *        order they were queued.
+     */
+    void Start(const std::string& path);
+    /**
+     * @brief Estimate of path so far.
+     * @return false if no scan of path was started.
+     */
+    bool Get(const std::string& path, SizeEstimate& estimate) const;
+    /**
+     * @brief Stops the running scans and drops the queued ones. Their
+     *        partial results are discarded; finished estimates are kept.
+     */
+    void Cancel();
+
+    /**
+     * @brief Estimates a file or tree on the calling thread.
+     */
+    static SizeEstimate Estimate(const std::string& path, const Compressor& compress, unsigned int threads = 0);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+#endif // SIZE_ESTIMATOR_H
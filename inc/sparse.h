@@ -0,0 +1,48 @@
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <sys/stat.h>
+
+/** Granularity of the zero-block scan used where the filesystem does not report holes. */
+#define SPARSE_SCAN_BLOCK 0x1000
+/** Size of the shared zero region that stands in for holes. */
+#define SPARSE_ZEROS_SIZE 0x4000000
+
+/**
+ * @brief A range of a sparse file that holds data.
+ */
+struct SparseRegion {
+    int64_t offset = 0;
+    int64_t length = 0;
+};
+
+/**
+ * @brief Finds the data regions of a file with holes.
+ *
+ * Only files that occupy fewer blocks than their size are examined. The
+ * holes are asked from the filesystem with SEEK_DATA/SEEK_HOLE; where it
+ * reports none, the file is scanned for zero blocks of SPARSE_SCAN_BLOCK
+ * bytes instead. The file offset of fd is back at the start afterwards.
+ *
+ * @param regions Receives the data regions in file order; a file that is
+ *        one big hole has none.
+ * @return true if the file has holes, false if it should be read whole.
+ */
+bool FindDataRegions(int fd, const struct stat& st, std::vector<SparseRegion>& regions);
+
+/** Tells whether length bytes at data are all zero. */
+bool IsZeroBlock(const char* data, size_t length);
+
+/**
+ * @brief SPARSE_ZEROS_SIZE read-only zero bytes for feeding holes to the
+ *        archive writer and the content hash.
+ *
+ * The pages are never written, so they all map the kernel's zero page and
+ * cost no memory.
+ */
+const char* SparseZeros();
+
+#endif // SPARSE_H
@@ -0,0 +1,102 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+
+/**
+ * @brief Bounded, lock-free single-producer/single-consumer ring buffer.
+ *
+ * Exactly one thread may call Push/TryPush and exactly one other thread may
+ * call Pop/TryPop. The head and tail indices live on separate cache lines so
+ * the producer and consumer do not false-share.
+ *
+ * @tparam T Element type, must be default constructible and movable.
+ * @tparam Capacity Number of slots, must be a power of two.
+ */
+template<typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    /**
+     * @brief Tries to append an element without blocking.
+     * @return true if the element was stored, false if the queue is full.
+     */
+    bool TryPush(T&& item){
+        size_t tail = Tail.load(std::memory_order_relaxed);
+        if(tail - Head.load(std::memory_order_acquire) == Capacity){
+            return false;
+        }
+        Slots[tail & (Capacity - 1)] = std::move(item);
+        Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Tries to take the oldest element without blocking.
+     * @return true if an element was taken, false if the queue is empty.
+     */
+    bool TryPop(T& item){
+        size_t head = Head.load(std::memory_order_relaxed);
+        if(head == Tail.load(std::memory_order_acquire)){
+            return false;
+        }
+        item = std::move(Slots[head & (Capacity - 1)]);
+        Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Appends an element, waiting while the queue is full.
+     */
+    void Push(T item){
+        Backoff backoff;
+        while(!TryPush(std::move(item))){
+            backoff.Wait();
+        }
+    }
+
+    /**
+     * @brief Takes the oldest element, waiting while the queue is empty.
+     */
+    void Pop(T& item){
+        Backoff backoff;
+        while(!TryPop(item)){
+            backoff.Wait();
+        }
+    }
+
+    /**
+     * @brief Spin, then yield, then sleep while waiting for the other side.
+     *
+     * Keeps the hand-off latency low when both stages run at similar speed
+     * without burning a core when one of them is stalled on I/O.
+     */
+    class Backoff {
+    public:
+        void Wait(){
+            if(Spins < 64){
+                Spins++;
+            } else if(Spins < 128){
+                Spins++;
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+
+    private:
+        unsigned int Spins = 0;
+    };
+
+private:
+    alignas(64) std::atomic<size_t> Head{0};
+    alignas(64) std::atomic<size_t> Tail{0};
+    alignas(64) T Slots[Capacity];
+};
+
+#endif // SPSC_QUEUE_H
@@ -9,6 +9,24 @@ enum Status{
     WriteFailed,
     TooManyArgs,
     UserExit,
+    NotFound,
+    ChecksumMismatch,
 };
 
+/** Name of a status as printed in reports, e.g. "CannotOpenFile". */
+inline const char* StatusName(Status status){
+    switch(status){
+    case Success: return "Success";
+    case CriticalError: return "CriticalError";
+    case CannotOpenFile: return "CannotOpenFile";
+    case AccessFileFailed: return "AccessFileFailed";
+    case WriteFailed: return "WriteFailed";
+    case TooManyArgs: return "TooManyArgs";
+    case UserExit: return "UserExit";
+    case NotFound: return "NotFound";
+    case ChecksumMismatch: return "ChecksumMismatch";
+    }
+    return "Unknown";
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef XXHASH64_H
+#define XXHASH64_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Streaming implementation of the XXH64 hash.
+ *
+ * Produces the same digests as the reference xxHash library, so values can
+ * be checked with the xxhsum tool. Used for content hashes of archived
+ * files and for path hashes in the manifest.
+ */
+class Xxh64 {
+public:
+    explicit Xxh64(uint64_t seed = 0);
+
+    void Reset(uint64_t seed = 0);
+    void Update(const void* data, size_t length);
+    uint64_t Digest() const;
+
+    static uint64_t Hash(const void* data, size_t length, uint64_t seed = 0);
+
+private:
+    uint64_t Acc[4];
+    uint64_t Seed;
+    uint64_t TotalLength;
+    unsigned char Buffer[32];
+    size_t Buffered;
+};
+
+#endif // XXHASH64_H
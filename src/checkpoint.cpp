@@ -0,0 +1,284 @@
+#include "checkpoint.h"
+#include "logs.h"
+#include "xxhash64.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define JOURNAL_MAGIC "BTTFJRNL"
+#define JOURNAL_VERSION 1
+
+namespace {
+
+struct JournalHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t codecLength;
+};
+
+/* Precedes the payload of every checkpoint. */
+struct RecordHeader {
+    uint64_t length;
+    uint64_t digest;
+};
+
+/* Fixed part of a manifest entry in Checkpoint::records, followed by the path. */
+struct EntryRecord {
+    uint64_t size;
+    int64_t mtime;
+    uint64_t inode;
+    uint64_t contentHash;
+    uint32_t pathLength;
+} __attribute__((packed));
+
+static_assert(sizeof(JournalHeader) == 16, "unexpected journal header layout");
+static_assert(sizeof(EntryRecord) == 36, "unexpected entry record layout");
+
+bool WriteAll(int fd, const char* data, size_t length){
+    for(size_t done = 0; done < length;){
+        ssize_t written = write(fd, data + done, length - done);
+        if(written < 0 && errno == EINTR){
+            continue;
+        }
+        if(written <= 0){
+            return false;
+        }
+        done += written;
+    }
+    return true;
+}
+
+bool ReadFile(int fd, std::string& content){
+    char buffer[0x10000];
+    while(true){
+        ssize_t bytes = read(fd, buffer, sizeof(buffer));
+        if(bytes < 0 && errno == EINTR){
+            continue;
+        }
+        if(bytes < 0){
+            return false;
+        }
+        if(bytes == 0){
+            return true;
+        }
+        content.append(buffer, bytes);
+    }
+}
+
+/**
+ * @brief Syncs the directory holding filename, so a newly created file survives a crash.
+ */
+void SyncDirectory(const std::string& filename){
+    size_t slash = filename.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : filename.substr(0, slash);
+    int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd >= 0){
+        fsync(fd);
+        close(fd);
+    }
+}
+
+void AppendString(std::string& payload, const std::string& value){
+    uint64_t length = value.size();
+    payload.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    payload.append(value);
+}
+
+bool ReadString(const std::string& payload, size_t& position, std::string& value){
+    uint64_t length;
+    if(position + sizeof(length) > payload.size()){
+        return false;
+    }
+    memcpy(&length, payload.data() + position, sizeof(length));
+    position += sizeof(length);
+    if(length > payload.size() - position){
+        return false;
+    }
+    value.assign(payload, position, length);
+    position += length;
+    return true;
+}
+
+} // namespace
+
+void AppendRecord(std::string& records, const ManifestEntry& entry){
+    EntryRecord record;
+    record.size = entry.size;
+    record.mtime = entry.mtime;
+    record.inode = entry.inode;
+    record.contentHash = entry.contentHash;
+    record.pathLength = static_cast<uint32_t>(entry.path.size());
+    records.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    records.append(entry.path);
+}
+
+bool NextRecord(const std::string& records, size_t& position, ManifestEntry& entry){
+    EntryRecord record;
+    if(position + sizeof(record) > records.size()){
+        return false;
+    }
+    memcpy(&record, records.data() + position, sizeof(record));
+    if(position + sizeof(record) + record.pathLength > records.size()){
+        return false;
+    }
+    entry.path = std::string_view(records.data() + position + sizeof(record), record.pathLength);
+    position += sizeof(record) + record.pathLength;
+    entry.size = record.size;
+    entry.mtime = record.mtime;
+    entry.inode = record.inode;
+    entry.contentHash = record.contentHash;
+    return true;
+}
+
+class CheckpointJournal::Impl {
+public:
+    ~Impl(){
+        if(Fd >= 0){
+            close(Fd);
+        }
+    }
+
+    std::string Filename;
+    int Fd = -1;
+};
+
+CheckpointJournal::CheckpointJournal() : pImpl(std::make_unique<Impl>()) {}
+
+CheckpointJournal::~CheckpointJournal() = default;
+
+std::unique_ptr<CheckpointJournal> CheckpointJournal::Create(const std::string& filename, Codec codec){
+    std::unique_ptr<CheckpointJournal> journal(new CheckpointJournal());
+    journal->pImpl->Filename = filename;
+    journal->pImpl->Fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if(journal->pImpl->Fd < 0){
+        error_print("Cannot create checkpoint journal", filename);
+        return nullptr;
+    }
+
+    std::string codecName = CodecName(codec);
+    JournalHeader header;
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    header.codecLength = static_cast<uint32_t>(codecName.size());
+    std::string content(reinterpret_cast<const char*>(&header), sizeof(header));
+    content += codecName;
+    if(!WriteAll(journal->pImpl->Fd, content.data(), content.size()) || fdatasync(journal->pImpl->Fd) != 0){
+        error_print("Cannot write checkpoint journal", filename);
+        return nullptr;
+    }
+    SyncDirectory(filename);
+    return journal;
+}
+
+std::unique_ptr<CheckpointJournal> CheckpointJournal::Resume(const std::string& filename, Codec codec,
+    Checkpoint& progress, std::vector<std::string>& doneItems){
+    int fd = open(filename.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+    if(fd < 0){
+        return nullptr;
+    }
+    std::unique_ptr<CheckpointJournal> journal(new CheckpointJournal());
+    journal->pImpl->Filename = filename;
+    journal->pImpl->Fd = fd;
+
+    std::string content;
+    JournalHeader header;
+    std::string codecName = CodecName(codec);
+    if(!ReadFile(fd, content) || content.size() < sizeof(header)){
+        warning_print("Checkpoint journal too short", filename);
+        return nullptr;
+    }
+    memcpy(&header, content.data(), sizeof(header));
+    if(memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0 || header.version != JOURNAL_VERSION
+        || header.codecLength != codecName.size() || content.compare(sizeof(header), header.codecLength, codecName) != 0){
+        warning_print("Checkpoint journal does not belong to a", codecName, "archive", filename);
+        return nullptr;
+    }
+
+    progress = Checkpoint();
+    doneItems.clear();
+    size_t position = sizeof(header) + header.codecLength;
+    size_t intact = position;
+    while(position + sizeof(RecordHeader) <= content.size()){
+        RecordHeader record;
+        memcpy(&record, content.data() + position, sizeof(record));
+        if(record.length > content.size() - position - sizeof(record)){
+            break;
+        }
+        std::string payload = content.substr(position + sizeof(record), record.length);
+        Checkpoint checkpoint;
+        size_t field = sizeof(checkpoint.offset);
+        if(Xxh64::Hash(payload.data(), payload.size()) != record.digest || payload.size() < field){
+            break;
+        }
+        memcpy(&checkpoint.offset, payload.data(), field);
+        if(!ReadString(payload, field, checkpoint.item) || !ReadString(payload, field, checkpoint.last)
+            || !ReadString(payload, field, checkpoint.toc) || !ReadString(payload, field, checkpoint.checksums)
+            || !ReadString(payload, field, checkpoint.records)){
+            break;
+        }
+
+        /* items are archived one after the other, so a new item completes the previous one */
+        if(!progress.item.empty() && checkpoint.item != progress.item
+            && std::find(doneItems.begin(), doneItems.end(), progress.item) == doneItems.end()){
+            doneItems.push_back(progress.item);
+        }
+        progress.offset = checkpoint.offset;
+        progress.item = checkpoint.item;
+        progress.last = checkpoint.last;
+        progress.toc += checkpoint.toc;
+        progress.checksums += checkpoint.checksums;
+        progress.records += checkpoint.records;
+        position += sizeof(record) + record.length;
+        intact = position;
+    }
+
+    if(intact == sizeof(header) + header.codecLength){
+        warning_print("Checkpoint journal holds no checkpoint", filename);
+        return nullptr;
+    }
+    if(intact < content.size()){
+        warning_print("Dropping torn checkpoint at the end of", filename);
+        if(ftruncate(fd, intact) != 0 || fdatasync(fd) != 0){
+            error_print("Cannot truncate checkpoint journal", filename);
+            return nullptr;
+        }
+    }
+    return journal;
+}
+
+Status CheckpointJournal::Append(const Checkpoint& checkpoint){
+    std::string payload(reinterpret_cast<const char*>(&checkpoint.offset), sizeof(checkpoint.offset));
+    AppendString(payload, checkpoint.item);
+    AppendString(payload, checkpoint.last);
+    AppendString(payload, checkpoint.toc);
+    AppendString(payload, checkpoint.checksums);
+    AppendString(payload, checkpoint.records);
+
+    RecordHeader record;
+    record.length = payload.size();
+    record.digest = Xxh64::Hash(payload.data(), payload.size());
+    payload.insert(0, reinterpret_cast<const char*>(&record), sizeof(record));
+    off_t end = lseek(pImpl->Fd, 0, SEEK_END);
+    if(end < 0 || !WriteAll(pImpl->Fd, payload.data(), payload.size()) || fdatasync(pImpl->Fd) != 0){
+        error_print("Cannot write checkpoint to", pImpl->Filename);
+        /* a partial record would hide the checkpoints appended after it */
+        if(end >= 0 && ftruncate(pImpl->Fd, end) != 0){
+            error_print("Cannot truncate checkpoint journal", pImpl->Filename);
+        }
+        return WriteFailed;
+    }
+    return Success;
+}
+
+void CheckpointJournal::Remove(){
+    if(pImpl->Fd >= 0){
+        close(pImpl->Fd);
+        pImpl->Fd = -1;
+    }
+    if(unlink(pImpl->Filename.c_str()) != 0){
+        warning_print("Cannot remove checkpoint journal", pImpl->Filename);
+    }
+}
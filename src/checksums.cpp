@@ -0,0 +1,246 @@
+#include "checksums.h"
+#include "xxhash64.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/* zeros hashed at a time for the holes of sparse entries */
+#define HASH_ZEROS_SIZE 0x10000
+
+namespace {
+
+const char ZeroBlock[HASH_ZEROS_SIZE] = {};
+
+/**
+ * @brief Data of one entry for a hashing thread, followed by zeros; the
+ *        last task of an entry completes its digest.
+ */
+struct HashTask {
+    size_t entry = 0;
+    std::vector<char> data;
+    uint64_t zeros = 0;
+    bool last = false;
+};
+
+} // namespace
+
+void AppendChecksum(std::string& list, const std::string& path, uint64_t digest){
+    char hex[20];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(digest));
+    bool escaped = path.find_first_of("\\\n") != std::string::npos;
+    if(escaped){
+        list += '\\';
+    }
+    list += hex;
+    list += "  ";
+    for(char c : path){
+        if(escaped && c == '\\'){
+            list += "\\\\";
+        } else if(escaped && c == '\n'){
+            list += "\\n";
+        } else {
+            list += c;
+        }
+    }
+    list += '\n';
+}
+
+bool ParseChecksums(const std::string& list, std::map<std::string, uint64_t>& digests){
+    size_t position = 0;
+    while(position < list.size()){
+        size_t end = list.find('\n', position);
+        if(end == std::string::npos){
+            end = list.size();
+        }
+        std::string line = list.substr(position, end - position);
+        position = end + 1;
+        if(line.empty()){
+            continue;
+        }
+        bool escaped = line[0] == '\\';
+        if(escaped){
+            line.erase(0, 1);
+        }
+        if(line.size() < 19 || line.compare(16, 2, "  ") != 0){
+            return false;
+        }
+        char* parsed = nullptr;
+        std::string hex = line.substr(0, 16);
+        uint64_t digest = std::strtoull(hex.c_str(), &parsed, 16);
+        if(parsed != hex.c_str() + 16){
+            return false;
+        }
+        std::string path;
+        for(size_t i = 18; i < line.size(); i++){
+            if(escaped && line[i] == '\\' && i + 1 < line.size()){
+                path += line[++i] == 'n' ? '\n' : line[i];
+            } else {
+                path += line[i];
+            }
+        }
+        digests[path] = digest;
+    }
+    return true;
+}
+
+class HashPool::Impl {
+public:
+    explicit Impl(unsigned int threads) {
+        Threads = threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads;
+        Queues.resize(Threads);
+        Wake = std::make_unique<std::condition_variable[]>(Threads);
+        for(unsigned int i = 0; i < Threads; i++){
+            Workers.emplace_back(&Impl::WorkerLoop, this, i);
+        }
+    }
+
+    ~Impl(){
+        {
+            std::lock_guard<std::mutex> lock(Lock);
+            Stopping = true;
+        }
+        for(unsigned int i = 0; i < Threads; i++){
+            Wake[i].notify_all();
+        }
+        for(auto& worker : Workers){
+            worker.join();
+        }
+    }
+
+    void Begin(const std::string& path){
+        std::lock_guard<std::mutex> lock(Lock);
+        Entries.emplace_back(path, 0);
+        Pending.clear();
+    }
+
+    void Update(const void* data, size_t length){
+        const char* bytes = static_cast<const char*>(data);
+        while(length > 0){
+            size_t step = std::min<size_t>(length, HASH_POOL_BLOCK_SIZE - Pending.size());
+            Pending.insert(Pending.end(), bytes, bytes + step);
+            bytes += step;
+            length -= step;
+            if(Pending.size() == HASH_POOL_BLOCK_SIZE){
+                Push(0, false);
+            }
+        }
+    }
+
+    void Zeros(uint64_t length){
+        if(length > 0){
+            Push(length, false);
+        }
+    }
+
+    void End(){
+        Push(0, true);
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> Finish(){
+        std::unique_lock<std::mutex> lock(Lock);
+        Idle.wait(lock, [this]() { return Queued == 0; });
+        return Entries;
+    }
+
+private:
+    unsigned int Threads;
+    std::vector<std::thread> Workers;
+    std::mutex Lock;
+    /* one queue and wake-up per thread, entry i goes to thread i % Threads */
+    std::vector<std::deque<HashTask>> Queues;
+    std::unique_ptr<std::condition_variable[]> Wake;
+    std::condition_variable Space;
+    std::condition_variable Idle;
+    /* tasks queued or being hashed, and the bytes they hold */
+    size_t Queued = 0;
+    uint64_t QueuedBytes = 0;
+    bool Stopping = false;
+    std::vector<std::pair<std::string, uint64_t>> Entries;
+    /* data of the current entry not handed out yet, producer only */
+    std::vector<char> Pending;
+
+    void Push(uint64_t zeros, bool last){
+        HashTask task;
+        task.data = std::move(Pending);
+        task.zeros = zeros;
+        task.last = last;
+        Pending = std::vector<char>();
+        uint64_t bytes = task.data.size();
+
+        std::unique_lock<std::mutex> lock(Lock);
+        Space.wait(lock, [this, bytes]() { return QueuedBytes == 0 || QueuedBytes + bytes <= HASH_POOL_QUEUE_BYTES; });
+        task.entry = Entries.size() - 1;
+        size_t worker = task.entry % Threads;
+        QueuedBytes += bytes;
+        Queued++;
+        Queues[worker].push_back(std::move(task));
+        Wake[worker].notify_one();
+    }
+
+    void WorkerLoop(unsigned int id){
+        Xxh64 hash;
+        while(true){
+            HashTask task;
+            {
+                std::unique_lock<std::mutex> lock(Lock);
+                Wake[id].wait(lock, [this, id]() { return Stopping || !Queues[id].empty(); });
+                if(Queues[id].empty()){
+                    return;
+                }
+                task = std::move(Queues[id].front());
+                Queues[id].pop_front();
+            }
+
+            hash.Update(task.data.data(), task.data.size());
+            for(uint64_t hashed = 0; hashed < task.zeros;){
+                size_t step = static_cast<size_t>(std::min<uint64_t>(task.zeros - hashed, HASH_ZEROS_SIZE));
+                hash.Update(ZeroBlock, step);
+                hashed += step;
+            }
+            uint64_t digest = 0;
+            if(task.last){
+                digest = hash.Digest();
+                hash.Reset();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(Lock);
+                if(task.last){
+                    Entries[task.entry].second = digest;
+                }
+                QueuedBytes -= task.data.size();
+                Queued--;
+            }
+            Space.notify_one();
+            Idle.notify_all();
+        }
+    }
+};
+
+HashPool::HashPool(unsigned int threads) : pImpl(std::make_unique<Impl>(threads)) {}
+
+HashPool::~HashPool() = default;
+
+void HashPool::Begin(const std::string& path){
+    pImpl->Begin(path);
+}
+
+void HashPool::Update(const void* data, size_t length){
+    pImpl->Update(data, length);
+}
+
+void HashPool::Zeros(uint64_t length){
+    pImpl->Zeros(length);
+}
+
+void HashPool::End(){
+    pImpl->End();
+}
+
+std::vector<std::pair<std::string, uint64_t>> HashPool::Finish(){
+    return pImpl->Finish();
+}
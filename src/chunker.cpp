@@ -0,0 +1,55 @@
+#include "chunker.h"
+#include <array>
+
+namespace {
+
+/* 18 and 14 one bits: 4x harder and 4x easier than the 16 bits of CHUNK_AVG_SIZE. */
+constexpr uint64_t MASK_SMALL = 0xffffc00000000000ULL;
+constexpr uint64_t MASK_LARGE = 0xfffc000000000000ULL;
+
+/**
+ * @brief Builds the gear table from a fixed splitmix64 sequence.
+ */
+constexpr std::array<uint64_t, 256> MakeGearTable(){
+    std::array<uint64_t, 256> table{};
+    uint64_t state = 0x42545446u; // "BTTF"
+    for(size_t i = 0; i < table.size(); i++){
+        state += 0x9e3779b97f4a7c15ULL;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        table[i] = z ^ (z >> 31);
+    }
+    return table;
+}
+
+constexpr std::array<uint64_t, 256> GEAR = MakeGearTable();
+
+} // namespace
+
+size_t Chunker::FindCut(const unsigned char* data, size_t length){
+    if(length <= CHUNK_MIN_SIZE){
+        return length;
+    }
+    if(length > CHUNK_MAX_SIZE){
+        length = CHUNK_MAX_SIZE;
+    }
+    size_t normal = length < CHUNK_AVG_SIZE ? length : CHUNK_AVG_SIZE;
+
+    /* The mask tests the high bits, which depend on the last 64 bytes. */
+    uint64_t hash = 0;
+    size_t i = CHUNK_MIN_SIZE;
+    for(; i < normal; i++){
+        hash = (hash << 1) + GEAR[data[i]];
+        if((hash & MASK_SMALL) == 0){
+            return i + 1;
+        }
+    }
+    for(; i < length; i++){
+        hash = (hash << 1) + GEAR[data[i]];
+        if((hash & MASK_LARGE) == 0){
+            return i + 1;
+        }
+    }
+    return length;
+}
@@ -0,0 +1,69 @@
+#include "codec.h"
+
+/**
+ * @brief Name of the codec as used by the CLI and by libarchive filter options.
+ */
+std::string CodecName(Codec codec){
+    switch(codec){
+    case Codec::Xz: return "xz";
+    case Codec::Zstd: return "zstd";
+    case Codec::Lz4: return "lz4";
+    case Codec::Gzip: return "gzip";
+    case Codec::None: return "none";
+    }
+    return "none";
+}
+
+/**
+ * @brief File name extension of a tar archive compressed with the codec.
+ */
+std::string CodecExtension(Codec codec){
+    switch(codec){
+    case Codec::Xz: return ".tar.xz";
+    case Codec::Zstd: return ".tar.zst";
+    case Codec::Lz4: return ".tar.lz4";
+    case Codec::Gzip: return ".tar.gz";
+    case Codec::None: return ".tar";
+    }
+    return ".tar";
+}
+
+/**
+ * @brief Looks up a codec by its CLI name.
+ * @return false if the name is unknown, codec is left untouched then.
+ */
+bool ParseCodec(const std::string& name, Codec& codec){
+    for(Codec candidate : {Codec::Xz, Codec::Zstd, Codec::Lz4, Codec::Gzip, Codec::None}){
+        if(name == CodecName(candidate)){
+            codec = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Checks a compression level against the range supported by the codec.
+ *
+ * CODEC_DEFAULT_LEVEL is always valid. The none codec takes no level.
+ */
+bool IsValidLevel(Codec codec, int level){
+    if(level == CODEC_DEFAULT_LEVEL){
+        return true;
+    }
+    switch(codec){
+    case Codec::Xz: return level >= 0 && level <= 9;
+    case Codec::Zstd: return level >= 1 && level <= 19;
+    case Codec::Lz4: return level >= 1 && level <= 9;
+    case Codec::Gzip: return level >= 1 && level <= 9;
+    case Codec::None: return false;
+    }
+    return false;
+}
+
+/**
+ * @brief Tells whether libarchive can compress with the codec on several threads.
+ */
+bool IsThreadedCodec(Codec codec){
+    return codec == Codec::Xz || codec == Codec::Zstd;
+}
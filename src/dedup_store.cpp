@@ -0,0 +1,773 @@
+#include "dedup_store.h"
+#include "chunker.h"
+#include "codec.h"
+#include "xxhash64.h"
+#include "logs.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+#include <fcntl.h>
+#include <lzma.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define INDEX_MAGIC "BTTFIDX1"
+#define INDEX_FILE "index"
+/* xz preset used when no level is given; the fast presets keep chunk compression cheap. */
+#define DEDUP_DEFAULT_PRESET 3
+/* Seed of the second half of a chunk id. */
+#define CHUNK_ID_SEED 0x9e3779b97f4a7c15ULL
+
+namespace {
+
+enum ChunkFlags : uint32_t {
+    Stored = 0,
+    Lzma2 = 1
+};
+
+/* On-disk index record, all fields little endian. */
+struct IndexRecord {
+    uint64_t high;
+    uint64_t low;
+    uint32_t pack;
+    uint32_t flags;
+    uint64_t offset;
+    uint32_t storedSize;
+    uint32_t rawSize;
+};
+
+static_assert(sizeof(IndexRecord) == 40, "unexpected index record layout");
+
+struct ChunkIdHash {
+    size_t operator()(const ChunkId& id) const {
+        return static_cast<size_t>(id.low);
+    }
+};
+
+std::string PackName(const std::string& directory, uint32_t pack){
+    char name[32];
+    snprintf(name, sizeof(name), "pack-%08u", pack);
+    return directory + "/" + name;
+}
+
+bool WriteAll(int fd, const void* data, size_t length){
+    const char* bytes = static_cast<const char*>(data);
+    while(length > 0){
+        ssize_t written = write(fd, bytes, length);
+        if(written < 0 && errno == EINTR){
+            continue;
+        }
+        if(written <= 0){
+            return false;
+        }
+        bytes += written;
+        length -= written;
+    }
+    return true;
+}
+
+bool ReadAll(int fd, void* data, size_t length, uint64_t offset){
+    char* bytes = static_cast<char*>(data);
+    while(length > 0){
+        ssize_t got = pread(fd, bytes, length, offset);
+        if(got < 0 && errno == EINTR){
+            continue;
+        }
+        if(got <= 0){
+            return false;
+        }
+        bytes += got;
+        length -= got;
+        offset += got;
+    }
+    return true;
+}
+
+/**
+ * @brief Exclusive flock on the index, held while it is read or appended so
+ *        sessions sharing the store never see each other's partial records.
+ */
+class IndexLock {
+public:
+    explicit IndexLock(int fd) : Fd(fd) {
+        while(flock(Fd, LOCK_EX) != 0 && errno == EINTR){
+        }
+    }
+    ~IndexLock() {
+        flock(Fd, LOCK_UN);
+    }
+
+private:
+    int Fd;
+};
+
+} // namespace
+
+ChunkId ChunkId::Of(const void* data, size_t length){
+    ChunkId id;
+    id.high = Xxh64::Hash(data, length);
+    id.low = Xxh64::Hash(data, length, CHUNK_ID_SEED);
+    return id;
+}
+
+/**
+ * @class DedupStore::Impl
+ * @brief In-memory chunk index, the pack being written and cached pack descriptors.
+ */
+class DedupStore::Impl {
+public:
+    ~Impl() {
+        Flush();
+        if(IndexFd >= 0){
+            close(IndexFd);
+        }
+        if(PackFd >= 0){
+            close(PackFd);
+        }
+        for(auto& pack : ReadFds){
+            close(pack.second);
+        }
+    }
+
+    std::string Directory;
+    int IndexFd = -1;
+    /* index bytes read into Index so far */
+    uint64_t IndexEnd = 0;
+    int PackFd = -1;
+    uint32_t Pack = 0;
+    uint64_t PackSize = 0;
+    uint32_t Preset = DEDUP_DEFAULT_PRESET;
+    std::unordered_map<ChunkId, IndexRecord, ChunkIdHash> Index;
+    std::vector<IndexRecord> Unflushed;
+    std::unordered_map<uint32_t, int> ReadFds;
+    std::vector<uint8_t> Compressed;
+    uint64_t New = 0;
+    uint64_t Duplicates = 0;
+
+    /**
+     * @brief Loads the index, dropping a torn record left by an interrupted run.
+     *
+     * The index is opened with O_APPEND, so records of sessions sharing the
+     * store are appended one after the other.
+     */
+    bool LoadIndex(){
+        std::string path = Directory + "/" + INDEX_FILE;
+        IndexFd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if(IndexFd < 0){
+            error_print("Cannot open chunk index", path);
+            return false;
+        }
+        IndexLock lock(IndexFd);
+        struct stat st;
+        if(fstat(IndexFd, &st) != 0){
+            error_print("Cannot open chunk index", path);
+            return false;
+        }
+        if(st.st_size == 0 && !WriteAll(IndexFd, INDEX_MAGIC, strlen(INDEX_MAGIC))){
+            error_print("Cannot create chunk index", path);
+            return false;
+        }
+
+        char magic[8];
+        if(!ReadAll(IndexFd, magic, sizeof(magic), 0) || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0){
+            error_print("Not a chunk index", path);
+            return false;
+        }
+        IndexEnd = sizeof(magic);
+        return ReadRecords();
+    }
+
+    /**
+     * @brief Adds the records appended to the index since it was last read,
+     *        e.g. by another session sharing the store.
+     *
+     * Called with the index locked, so a partial record at the end can only
+     * be left by a crashed run; it is cut off.
+     */
+    bool ReadRecords(){
+        struct stat st;
+        if(fstat(IndexFd, &st) != 0){
+            return false;
+        }
+        uint64_t count = (st.st_size - IndexEnd) / sizeof(IndexRecord);
+        std::vector<IndexRecord> records(count);
+        if(count > 0 && !ReadAll(IndexFd, records.data(), count * sizeof(IndexRecord), IndexEnd)){
+            error_print("Cannot read chunk index", Directory);
+            return false;
+        }
+        IndexEnd += count * sizeof(IndexRecord);
+        if(static_cast<uint64_t>(st.st_size) != IndexEnd && ftruncate(IndexFd, IndexEnd) != 0){
+            error_print("Cannot truncate chunk index", Directory);
+            return false;
+        }
+
+        Index.reserve(Index.size() + count);
+        for(const auto& record : records){
+            ChunkId id;
+            id.high = record.high;
+            id.low = record.low;
+            Index.emplace(id, record);
+            /* the pack of this session keeps its number once created */
+            if(PackFd < 0){
+                Pack = std::max(Pack, record.pack + 1);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Creates the pack of this session, skipping names left by a crashed run.
+     */
+    bool OpenPack(){
+        while(true){
+            std::string path = PackName(Directory, Pack);
+            PackFd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+            if(PackFd >= 0){
+                return true;
+            }
+            if(errno != EEXIST){
+                error_print("Cannot create pack", path);
+                return false;
+            }
+            Pack++;
+        }
+    }
+
+    Status Put(const char* data, size_t length, ChunkId& id){
+        id = ChunkId::Of(data, length);
+        if(Index.count(id) != 0){
+            Duplicates++;
+            return Success;
+        }
+        if(PackFd < 0 && !OpenPack()){
+            return WriteFailed;
+        }
+
+        IndexRecord record = {};
+        record.high = id.high;
+        record.low = id.low;
+        record.pack = Pack;
+        record.offset = PackSize;
+        record.rawSize = static_cast<uint32_t>(length);
+
+        const void* stored = data;
+        size_t storedSize = length;
+        size_t compressedSize = 0;
+        if(Compress(data, length, compressedSize) && compressedSize < length){
+            stored = Compressed.data();
+            storedSize = compressedSize;
+            record.flags = Lzma2;
+        } else {
+            record.flags = Stored;
+        }
+        record.storedSize = static_cast<uint32_t>(storedSize);
+
+        if(!WriteAll(PackFd, stored, storedSize)){
+            error_print("Failed to write chunk to pack", Pack, ":", strerror(errno));
+            return WriteFailed;
+        }
+        PackSize += storedSize;
+        Index.emplace(id, record);
+        Unflushed.push_back(record);
+        New++;
+        return Success;
+    }
+
+    Status Get(const ChunkId& id, std::vector<char>& data){
+        auto it = Index.find(id);
+        if(it == Index.end()){
+            /* stored by a session that shares the store */
+            IndexLock lock(IndexFd);
+            ReadRecords();
+            it = Index.find(id);
+        }
+        if(it == Index.end()){
+            error_print("Chunk missing from store");
+            return AccessFileFailed;
+        }
+        const IndexRecord& record = it->second;
+        int fd = ReadFd(record.pack);
+        if(fd < 0){
+            return CannotOpenFile;
+        }
+
+        data.resize(record.rawSize);
+        bool ok;
+        if(record.flags == Lzma2){
+            Compressed.resize(record.storedSize);
+            ok = ReadAll(fd, Compressed.data(), record.storedSize, record.offset) && Decompress(record, data);
+        } else {
+            ok = ReadAll(fd, data.data(), record.rawSize, record.offset);
+        }
+        if(!ok || !(ChunkId::Of(data.data(), data.size()) == id)){
+            error_print("Corrupted chunk in pack", record.pack, "at offset", record.offset);
+            return AccessFileFailed;
+        }
+        return Success;
+    }
+
+    /**
+     * @brief Appends the records of chunks written since the last flush to the index.
+     *
+     * Records are only written after the chunk data, so the index never
+     * points at data that is not in a pack. The index is locked for the
+     * append, and a record torn by a crashed session is cut off first so
+     * the new ones stay aligned.
+     */
+    Status Flush(){
+        if(Unflushed.empty()){
+            return Success;
+        }
+        IndexLock lock(IndexFd);
+        struct stat st;
+        if(fstat(IndexFd, &st) != 0){
+            error_print("Failed to update chunk index", Directory);
+            return WriteFailed;
+        }
+        uint64_t torn = (st.st_size - strlen(INDEX_MAGIC)) % sizeof(IndexRecord);
+        if(torn != 0 && ftruncate(IndexFd, st.st_size - torn) != 0){
+            error_print("Cannot truncate chunk index", Directory);
+            return WriteFailed;
+        }
+        if(!WriteAll(IndexFd, Unflushed.data(), Unflushed.size() * sizeof(IndexRecord))){
+            error_print("Failed to update chunk index", Directory);
+            return WriteFailed;
+        }
+        Unflushed.clear();
+        return Success;
+    }
+
+private:
+    int ReadFd(uint32_t pack){
+        if(pack == Pack && PackFd >= 0){
+            return PackFd;
+        }
+        auto it = ReadFds.find(pack);
+        if(it != ReadFds.end()){
+            return it->second;
+        }
+        std::string path = PackName(Directory, pack);
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0){
+            error_print("Cannot open pack", path);
+            return -1;
+        }
+        ReadFds.emplace(pack, fd);
+        return fd;
+    }
+
+    void Filters(lzma_options_lzma& options, lzma_filter* filters){
+        lzma_lzma_preset(&options, Preset);
+        options.dict_size = CHUNK_MAX_SIZE;
+        filters[0].id = LZMA_FILTER_LZMA2;
+        filters[0].options = &options;
+        filters[1].id = LZMA_VLI_UNKNOWN;
+        filters[1].options = nullptr;
+    }
+
+    bool Compress(const char* data, size_t length, size_t& compressedSize){
+        lzma_options_lzma options;
+        lzma_filter filters[2];
+        Filters(options, filters);
+        Compressed.resize(length);
+        compressedSize = 0;
+        return lzma_raw_buffer_encode(filters, nullptr, reinterpret_cast<const uint8_t*>(data), length,
+                                      Compressed.data(), &compressedSize, Compressed.size()) == LZMA_OK;
+    }
+
+    bool Decompress(const IndexRecord& record, std::vector<char>& data){
+        lzma_options_lzma options;
+        lzma_filter filters[2];
+        Filters(options, filters);
+        size_t inPosition = 0;
+        size_t outPosition = 0;
+        lzma_ret ret = lzma_raw_buffer_decode(filters, nullptr, Compressed.data(), &inPosition, record.storedSize,
+                                              reinterpret_cast<uint8_t*>(data.data()), &outPosition, data.size());
+        return ret == LZMA_OK && outPosition == record.rawSize;
+    }
+};
+
+DedupStore::DedupStore() : pImpl(std::make_unique<Impl>()) {}
+
+DedupStore::~DedupStore() = default;
+
+std::unique_ptr<DedupStore> DedupStore::Open(const std::string& directory, int level){
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if(ec){
+        error_print("Cannot create chunk store", directory, ":", ec.message());
+        return nullptr;
+    }
+
+    std::unique_ptr<DedupStore> store(new DedupStore());
+    store->pImpl->Directory = directory;
+    if(level != CODEC_DEFAULT_LEVEL){
+        store->pImpl->Preset = static_cast<uint32_t>(level);
+    }
+    if(!store->pImpl->LoadIndex()){
+        return nullptr;
+    }
+    return store;
+}
+
+/**
+ * @brief Stores a chunk unless an identical one is already stored.
+ * @param id Receives the id referencing the chunk.
+ * @return Success, or WriteFailed if the pack could not be written.
+ */
+Status DedupStore::Put(const char* data, size_t length, ChunkId& id) {
+    return pImpl->Put(data, length, id);
+}
+
+/**
+ * @brief Reads and decompresses a chunk, verifying its content against the id.
+ * @return Success, CannotOpenFile if its pack is missing, or AccessFileFailed
+ *         if the chunk is unknown or corrupted.
+ */
+Status DedupStore::Get(const ChunkId& id, std::vector<char>& data) {
+    return pImpl->Get(id, data);
+}
+
+Status DedupStore::Flush() {
+    return pImpl->Flush();
+}
+
+uint64_t DedupStore::NewChunks() const {
+    return pImpl->New;
+}
+
+uint64_t DedupStore::DuplicateChunks() const {
+    return pImpl->Duplicates;
+}
+
+#define ARCHIVE_MAGIC "BTTFDDP1"
+/* Output buffer of the chunk list file. */
+#define ARCHIVE_BUFFER_SIZE 0x100000
+
+namespace {
+
+/* Per-file record of a dedup archive, followed by the path and the chunk ids. */
+struct FileRecord {
+    uint32_t pathLength;
+    uint32_t reserved;
+    uint64_t size;
+    int64_t mtime;
+    uint64_t chunkCount;
+};
+
+static_assert(sizeof(FileRecord) == 32, "unexpected file record layout");
+
+/**
+ * @brief Rejects paths that would escape the extraction directory.
+ */
+bool IsSafePath(const std::string& path){
+    if(path.empty() || path[0] == '/'){
+        return false;
+    }
+    for(const auto& part : std::filesystem::path(path)){
+        if(part == ".."){
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+/**
+ * @class DedupArchive::Impl
+ * @brief Chunk list file, the store and the chunking state of the current file.
+ */
+class DedupArchive::Impl {
+public:
+    ~Impl() {
+        Close();
+    }
+
+    FILE* File = nullptr;
+    std::vector<char> FileBuffer;
+    std::unique_ptr<DedupStore> Store;
+    std::string Path;
+    std::vector<unsigned char> Pending;
+    std::vector<ChunkId> Chunks;
+    uint64_t Size = 0;
+    Status Result = Success;
+
+    Status Write(const char* data, size_t length){
+        Pending.insert(Pending.end(), data, data + length);
+        size_t start = 0;
+        Status status = Success;
+        while(status == Success && Pending.size() - start >= CHUNK_MAX_SIZE){
+            size_t cut = Chunker::FindCut(Pending.data() + start, Pending.size() - start);
+            status = PutChunk(start, cut);
+            start += cut;
+        }
+        Pending.erase(Pending.begin(), Pending.begin() + start);
+        return status;
+    }
+
+    Status EndFile(int64_t mtime, bool keep){
+        Status status = Success;
+        size_t start = 0;
+        while(status == Success && start < Pending.size()){
+            size_t cut = Chunker::FindCut(Pending.data() + start, Pending.size() - start);
+            status = PutChunk(start, cut);
+            start += cut;
+        }
+        Pending.clear();
+
+        if(keep && status == Success){
+            FileRecord record = {};
+            record.pathLength = static_cast<uint32_t>(Path.size());
+            record.size = Size;
+            record.mtime = mtime;
+            record.chunkCount = Chunks.size();
+            bool ok = fwrite(&record, sizeof(record), 1, File) == 1
+                && fwrite(Path.data(), 1, Path.size(), File) == Path.size()
+                && (Chunks.empty() || fwrite(Chunks.data(), sizeof(ChunkId), Chunks.size(), File) == Chunks.size());
+            if(!ok){
+                error_print("Failed to write chunk list for", Path);
+                status = WriteFailed;
+            }
+        }
+        Chunks.clear();
+        Size = 0;
+        if(status != Success && Result == Success){
+            Result = status;
+        }
+        return status;
+    }
+
+    Status Flush(){
+        Status status = Store->Flush();
+        if(fflush(File) != 0){
+            status = WriteFailed;
+        }
+        if(status != Success && Result == Success){
+            Result = status;
+        }
+        return Result;
+    }
+
+    Status Close(){
+        if(File == nullptr){
+            return Result;
+        }
+        Status status = Store->Flush();
+        if(fclose(File) != 0){
+            status = WriteFailed;
+        }
+        File = nullptr;
+        if(status != Success && Result == Success){
+            Result = status;
+        }
+        info_print("Chunks stored:", Store->NewChunks(), "deduplicated:", Store->DuplicateChunks());
+        return Result;
+    }
+
+private:
+    Status PutChunk(size_t start, size_t length){
+        ChunkId id;
+        Status status = Store->Put(reinterpret_cast<const char*>(Pending.data() + start), length, id);
+        if(status == Success){
+            Chunks.push_back(id);
+            Size += length;
+        }
+        return status;
+    }
+};
+
+DedupArchive::DedupArchive() : pImpl(std::make_unique<Impl>()) {}
+
+DedupArchive::~DedupArchive() = default;
+
+std::unique_ptr<DedupArchive> DedupArchive::Create(const std::string& filename, const std::string& store, int level){
+    std::unique_ptr<DedupArchive> archive(new DedupArchive());
+    Impl& impl = *archive->pImpl;
+    std::error_code ec;
+    std::string storePath = std::filesystem::absolute(store, ec).string();
+    impl.Store = DedupStore::Open(storePath, level);
+    if(impl.Store == nullptr){
+        return nullptr;
+    }
+    impl.File = fopen(filename.c_str(), "wb");
+    if(impl.File == nullptr){
+        error_print("Cannot create archive", filename);
+        return nullptr;
+    }
+    impl.FileBuffer.resize(ARCHIVE_BUFFER_SIZE);
+    setvbuf(impl.File, impl.FileBuffer.data(), _IOFBF, impl.FileBuffer.size());
+
+    uint32_t length = static_cast<uint32_t>(storePath.size());
+    if(fwrite(ARCHIVE_MAGIC, 1, strlen(ARCHIVE_MAGIC), impl.File) != strlen(ARCHIVE_MAGIC)
+        || fwrite(&length, sizeof(length), 1, impl.File) != 1
+        || fwrite(storePath.data(), 1, length, impl.File) != length){
+        error_print("Cannot write archive header", filename);
+        return nullptr;
+    }
+    return archive;
+}
+
+/**
+ * @brief Starts a file; its data follows with Write().
+ * @param path Path of the file inside the archive.
+ */
+void DedupArchive::BeginFile(const std::string& path) {
+    pImpl->Path = path;
+}
+
+/**
+ * @brief Chunks and stores the next piece of the current file.
+ * @return Success, or WriteFailed if a chunk could not be stored.
+ */
+Status DedupArchive::Write(const char* data, size_t length) {
+    return pImpl->Write(data, length);
+}
+
+/**
+ * @brief Stores the tail of the current file and records its chunk list.
+ * @param mtime Modification time in nanoseconds since the epoch.
+ * @param keep false drops the file from the archive, e.g. after a read error.
+ */
+Status DedupArchive::EndFile(int64_t mtime, bool keep) {
+    return pImpl->EndFile(mtime, keep);
+}
+
+/**
+ * @brief Makes everything archived so far durable in the store and the archive file.
+ * @return Success, or the first error seen while writing the archive.
+ */
+Status DedupArchive::Flush() {
+    return pImpl->Flush();
+}
+
+/**
+ * @brief Flushes and closes the archive file.
+ * @return Success, or the first error seen while writing the archive.
+ */
+Status DedupArchive::Close() {
+    return pImpl->Close();
+}
+
+bool DedupArchive::IsDedupArchive(const std::string& filename){
+    char magic[8];
+    FILE* file = fopen(filename.c_str(), "rb");
+    if(file == nullptr){
+        return false;
+    }
+    bool match = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, ARCHIVE_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return match;
+}
+
+/**
+ * @brief Restores the files of a dedup archive below destination.
+ *
+ * Files are reassembled one chunk at a time, so memory use does not depend
+ * on file sizes. Paths that are absolute or contain ".." are skipped.
+ *
+ * @param filename The archive file.
+ * @param store Store directory, empty to use the one recorded in the archive.
+ * @param destination Directory the files are restored into, empty for the
+ *        current directory.
+ * @return Success, CannotOpenFile if the archive or its store cannot be
+ *         opened, AccessFileFailed if it is truncated or a chunk is missing,
+ *         or WriteFailed if a file could not be written.
+ */
+Status DedupArchive::Extract(const std::string& filename, const std::string& store, const std::string& destination){
+    FILE* file = fopen(filename.c_str(), "rb");
+    if(file == nullptr){
+        error_print("Failed to open archive file", filename);
+        return CannotOpenFile;
+    }
+    std::vector<char> fileBuffer(ARCHIVE_BUFFER_SIZE);
+    setvbuf(file, fileBuffer.data(), _IOFBF, fileBuffer.size());
+
+    char magic[8];
+    uint32_t length = 0;
+    std::string storePath;
+    if(fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, ARCHIVE_MAGIC, sizeof(magic)) != 0
+        || fread(&length, sizeof(length), 1, file) != 1){
+        fclose(file);
+        return AccessFileFailed;
+    }
+    storePath.resize(length);
+    if(fread(&storePath[0], 1, length, file) != length){
+        fclose(file);
+        return AccessFileFailed;
+    }
+    if(!store.empty()){
+        storePath = store;
+    }
+
+    std::unique_ptr<DedupStore> chunks;
+    if(std::filesystem::is_directory(storePath)){
+        chunks = DedupStore::Open(storePath, CODEC_DEFAULT_LEVEL);
+    }
+    if(chunks == nullptr){
+        error_print("Cannot open chunk store", storePath);
+        fclose(file);
+        return CannotOpenFile;
+    }
+
+    Status status = Success;
+    std::vector<ChunkId> ids;
+    std::vector<char> data;
+    FileRecord record;
+    while(fread(&record, sizeof(record), 1, file) == 1){
+        std::string path(record.pathLength, '\0');
+        ids.resize(record.chunkCount);
+        if(fread(&path[0], 1, path.size(), file) != path.size()
+            || (!ids.empty() && fread(ids.data(), sizeof(ChunkId), ids.size(), file) != ids.size())){
+            status = AccessFileFailed;
+            break;
+        }
+        if(!IsSafePath(path)){
+            warning_print("Skipping unsafe path", path);
+            continue;
+        }
+        if(!destination.empty()){
+            path = (std::filesystem::path(destination) / path).string();
+        }
+
+        std::error_code ec;
+        std::filesystem::path parent = std::filesystem::path(path).parent_path();
+        if(!parent.empty()){
+            std::filesystem::create_directories(parent, ec);
+        }
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(fd < 0){
+            error_print("Failed to create", path);
+            status = WriteFailed;
+            continue;
+        }
+        Status fileStatus = Success;
+        for(const auto& id : ids){
+            fileStatus = chunks->Get(id, data);
+            if(fileStatus != Success){
+                break;
+            }
+            if(!WriteAll(fd, data.data(), data.size())){
+                fileStatus = WriteFailed;
+                break;
+            }
+        }
+        struct timespec times[2];
+        times[0].tv_sec = times[1].tv_sec = record.mtime / 1000000000LL;
+        times[0].tv_nsec = times[1].tv_nsec = record.mtime % 1000000000LL;
+        futimens(fd, times);
+        close(fd);
+        if(fileStatus != Success){
+            error_print("Failed to restore", path);
+            if(status == Success){
+                status = fileStatus;
+            }
+        }
+    }
+    fclose(file);
+    return status;
+}
@@ -0,0 +1,417 @@
+#include "dir_listing.h"
+#include "logs.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <queue>
+#include <random>
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Names sampled per pass when locating a page far from any known boundary. */
+#define LISTING_SAMPLE_SIZE 8192
+/*
+ * Sample positions kept on either side of the estimated one, about three
+ * standard deviations of the sampled position at LISTING_SAMPLE_SIZE.
+ */
+#define LISTING_SAMPLE_MARGIN 128
+
+/* Changes to the entries of a directory, or to the directory itself. */
+#define LISTING_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+class DirListing::Impl {
+public:
+    std::string Path;
+    size_t PageSize = LISTING_PAGE_SIZE;
+
+    ~Impl(){
+        if(Inotify >= 0){
+            close(Inotify);
+        }
+    }
+
+    bool Open(const std::string& path, size_t pageSize){
+        Path = path;
+        PageSize = std::max<size_t>(1, pageSize);
+        DIR* dir = opendir(Path.c_str());
+        if(dir == nullptr){
+            error_print("Cannot open directory", Path);
+            return false;
+        }
+        closedir(dir);
+        Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(Inotify >= 0 && inotify_add_watch(Inotify, Path.c_str(), LISTING_WATCH_MASK) < 0){
+            close(Inotify);
+            Inotify = -1;
+        }
+        if(Inotify < 0){
+            debug_print("No inotify watch on", Path, ", checking its mtime instead");
+            Changed();
+        }
+        return true;
+    }
+
+    size_t Size(){
+        Refresh();
+        if(!CountKnown){
+            std::vector<Candidate> none;
+            Scan(nullptr, 0, none);
+        }
+        return Count;
+    }
+
+    const std::vector<ListingEntry>& Page(size_t page){
+        Refresh();
+        if(CurrentValid && CurrentIndex == page){
+            return Current;
+        }
+        Current.clear();
+        CurrentIndex = page;
+        CurrentValid = true;
+        if(CountKnown && page * PageSize >= Count){
+            return Current;
+        }
+
+        /* start from the nearest known page boundary at or before the page */
+        size_t start = 0;
+        std::string bound;
+        bool bounded = false;
+        auto known = Bounds.upper_bound(page);
+        if(known != Bounds.begin()){
+            --known;
+            start = known->first;
+            bound = known->second;
+            bounded = true;
+        }
+
+        /* far ahead: locate the page boundary itself instead of paging to it */
+        if(page - start >= LISTING_SCAN_PAGES){
+            std::string name;
+            if(FindName(page * PageSize - 1, name)){
+                start = page;
+                bound = name;
+                bounded = true;
+                Remember(page, bound);
+            } else if(CountKnown && page * PageSize >= Count){
+                return Current;
+            }
+        }
+
+        while(true){
+            size_t pages = std::min<size_t>(page - start + 1, LISTING_SCAN_PAGES);
+            std::vector<Candidate> collected;
+            if(!Scan(bounded ? &bound : nullptr, pages * PageSize, collected)){
+                CurrentValid = false;
+                break;
+            }
+            for(size_t i = 1; i < pages && i * PageSize < collected.size(); i++){
+                Remember(start + i, collected[i * PageSize - 1].first);
+            }
+            if(page < start + pages){
+                size_t first = (page - start) * PageSize;
+                for(size_t i = first; i < std::min(first + PageSize, collected.size()); i++){
+                    Current.push_back(Resolve(collected[i]));
+                }
+                break;
+            }
+            if(collected.size() < pages * PageSize){
+                break;
+            }
+            start += pages;
+            bound = collected.back().first;
+            bounded = true;
+            Remember(start, bound);
+        }
+        return Current;
+    }
+
+    size_t Scans() const {
+        return ScanCount;
+    }
+
+private:
+    /* name and d_type of a directory entry */
+    using Candidate = std::pair<std::string, unsigned char>;
+
+    int Inotify = -1;
+    struct timespec Mtime = {};
+    ino_t Inode = 0;
+
+    size_t Count = 0;
+    bool CountKnown = false;
+    /* page number -> last name of the page before it */
+    std::map<size_t, std::string> Bounds;
+    std::vector<ListingEntry> Current;
+    size_t CurrentIndex = 0;
+    bool CurrentValid = false;
+    size_t ScanCount = 0;
+
+    /**
+     * @brief Drops everything read from the directory if it changed since
+     *        the last call.
+     */
+    void Refresh(){
+        if(Changed()){
+            debug_print("Directory changed, listing dropped:", Path);
+            CountKnown = false;
+            Bounds.clear();
+            Current.clear();
+            CurrentValid = false;
+        }
+    }
+
+    /**
+     * @brief Consumes pending inotify events, or compares the directory's
+     *        modification time and inode with the last ones seen.
+     */
+    bool Changed(){
+        if(Inotify >= 0){
+            bool changed = false;
+            char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+            while(read(Inotify, events, sizeof(events)) > 0){
+                changed = true;
+            }
+            return changed;
+        }
+        struct stat st;
+        if(stat(Path.c_str(), &st) != 0){
+            return true;
+        }
+        bool changed = st.st_ino != Inode || st.st_mtim.tv_sec != Mtime.tv_sec || st.st_mtim.tv_nsec != Mtime.tv_nsec;
+        Inode = st.st_ino;
+        Mtime = st.st_mtim;
+        return changed;
+    }
+
+    /**
+     * @brief Reads the directory once, counting its entries and keeping the
+     *        limit smallest names after bound, or from the start without one.
+     *
+     * @param collected Receives the kept entries in sorted order.
+     * @return false if the directory cannot be read.
+     */
+    bool Scan(const std::string* bound, size_t limit, std::vector<Candidate>& collected){
+        /* largest kept name on top, so it is the one replaced */
+        std::priority_queue<Candidate> heap;
+        bool read = Pass([&](const char* name, unsigned char type) {
+            if(limit == 0 || (bound != nullptr && strcmp(name, bound->c_str()) <= 0)){
+                return;
+            }
+            if(heap.size() < limit){
+                heap.emplace(name, type);
+            } else if(strcmp(name, heap.top().first.c_str()) < 0){
+                heap.pop();
+                heap.emplace(name, type);
+            }
+        });
+        if(!read){
+            return false;
+        }
+
+        collected.resize(heap.size());
+        for(size_t i = collected.size(); i > 0; i--){
+            collected[i - 1] = heap.top();
+            heap.pop();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads the directory once, calling visit with the name and
+     *        d_type of every entry but "." and "..", and updates the count.
+     * @return false if the directory cannot be read.
+     */
+    bool Pass(const std::function<void(const char*, unsigned char)>& visit){
+        DIR* dir = opendir(Path.c_str());
+        if(dir == nullptr){
+            error_print("Cannot read directory", Path);
+            return false;
+        }
+        ScanCount++;
+        size_t count = 0;
+        struct dirent* entry;
+        while((entry = readdir(dir)) != nullptr){
+            if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0){
+                continue;
+            }
+            count++;
+            visit(entry->d_name, entry->d_type);
+        }
+        closedir(dir);
+        Count = count;
+        CountKnown = true;
+        return true;
+    }
+
+    /**
+     * @brief Finds the name at a position of the sorted listing.
+     *
+     * A random sample of the names in the range that holds the position
+     * gives two names that very likely enclose it; a counting pass confirms
+     * that and narrows the range, by about LISTING_SAMPLE_SIZE /
+     * (2 * LISTING_SAMPLE_MARGIN) each round. Once the position is within
+     * LISTING_SCAN_PAGES pages of the lower end it is read directly. Memory
+     * stays bounded by the sample, and a directory of millions of entries
+     * takes a handful of passes.
+     *
+     * @return false if rank is past the end or the directory cannot be read.
+     */
+    bool FindName(size_t rank, std::string& result){
+        std::string low;
+        std::string high;
+        bool hasLow = false;
+        bool hasHigh = false;
+        /* names up to and including low */
+        size_t base = 0;
+        std::minstd_rand random(static_cast<unsigned int>(rank));
+        while(true){
+            size_t offset = rank - base;
+            if(offset < LISTING_SCAN_PAGES * PageSize){
+                std::vector<Candidate> collected;
+                if(!Scan(hasLow ? &low : nullptr, offset + 1, collected) || collected.size() <= offset){
+                    return false;
+                }
+                result = collected[offset].first;
+                return true;
+            }
+
+            std::vector<std::string> sample;
+            size_t inside = 0;
+            bool read = Pass([&](const char* name, unsigned char) {
+                if((hasLow && strcmp(name, low.c_str()) <= 0) || (hasHigh && strcmp(name, high.c_str()) >= 0)){
+                    return;
+                }
+                inside++;
+                if(sample.size() < LISTING_SAMPLE_SIZE){
+                    sample.emplace_back(name);
+                } else {
+                    size_t slot = random() % inside;
+                    if(slot < LISTING_SAMPLE_SIZE){
+                        sample[slot] = name;
+                    }
+                }
+            });
+            if(!read || offset >= inside){
+                return false;
+            }
+            std::sort(sample.begin(), sample.end());
+            size_t estimate = offset * sample.size() / inside;
+            bool lower = estimate >= LISTING_SAMPLE_MARGIN;
+            bool upper = estimate + LISTING_SAMPLE_MARGIN < sample.size();
+            std::string newLow = lower ? sample[estimate - LISTING_SAMPLE_MARGIN] : low;
+            std::string newHigh = upper ? sample[estimate + LISTING_SAMPLE_MARGIN] : high;
+
+            /* names in (low, newLow] and in (low, newHigh) */
+            size_t belowLow = 0;
+            size_t belowHigh = 0;
+            read = Pass([&](const char* name, unsigned char) {
+                if((hasLow && strcmp(name, low.c_str()) <= 0) || (hasHigh && strcmp(name, high.c_str()) >= 0)){
+                    return;
+                }
+                if(lower && strcmp(name, newLow.c_str()) <= 0){
+                    belowLow++;
+                }
+                if(!upper || strcmp(name, newHigh.c_str()) < 0){
+                    belowHigh++;
+                }
+            });
+            if(!read){
+                return false;
+            }
+            /* an unlucky sample that misses the position is simply drawn again */
+            if(offset < belowLow || offset >= belowHigh){
+                continue;
+            }
+            if(lower){
+                low = newLow;
+                hasLow = true;
+                base += belowLow;
+            }
+            if(upper){
+                high = newHigh;
+                hasHigh = true;
+            }
+        }
+    }
+
+    /**
+     * @brief Records where a page starts, thinning out the boundaries when
+     *        there are more than LISTING_INDEX_LIMIT.
+     */
+    void Remember(size_t page, const std::string& bound){
+        Bounds[page] = bound;
+        if(Bounds.size() <= LISTING_INDEX_LIMIT){
+            return;
+        }
+        bool keep = true;
+        for(auto it = Bounds.begin(); it != Bounds.end();){
+            if(!keep && it->first != page){
+                it = Bounds.erase(it);
+            } else {
+                ++it;
+            }
+            keep = !keep;
+        }
+    }
+
+    /**
+     * @brief Completes an entry of the current page; its type is looked up
+     *        when readdir does not report it or it is a symbolic link.
+     */
+    ListingEntry Resolve(const Candidate& candidate){
+        ListingEntry entry;
+        entry.name = candidate.first;
+        entry.directory = candidate.second == DT_DIR;
+        if(candidate.second == DT_UNKNOWN || candidate.second == DT_LNK){
+            struct stat st;
+            std::string path = Path + "/" + entry.name;
+            entry.directory = stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+        }
+        return entry;
+    }
+};
+
+DirListing::DirListing() : pImpl(std::make_unique<Impl>()) {}
+
+DirListing::~DirListing() = default;
+
+std::unique_ptr<DirListing> DirListing::Open(const std::string& path, size_t pageSize){
+    std::unique_ptr<DirListing> listing(new DirListing());
+    if(!listing->pImpl->Open(path, pageSize)){
+        return nullptr;
+    }
+    return listing;
+}
+
+size_t DirListing::Size(){
+    return pImpl->Size();
+}
+
+size_t DirListing::PageSize() const {
+    return pImpl->PageSize;
+}
+
+size_t DirListing::PageCount(){
+    return (pImpl->Size() + pImpl->PageSize - 1) / pImpl->PageSize;
+}
+
+const std::vector<ListingEntry>& DirListing::Page(size_t page){
+    return pImpl->Page(page);
+}
+
+bool DirListing::At(size_t index, ListingEntry& entry){
+    const auto& page = pImpl->Page(index / pImpl->PageSize);
+    size_t offset = index % pImpl->PageSize;
+    if(offset >= page.size()){
+        return false;
+    }
+    entry = page[offset];
+    return true;
+}
+
+size_t DirListing::Scans() const {
+    return pImpl->Scans();
+}
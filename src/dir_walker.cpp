@@ -0,0 +1,454 @@
+#include "dir_walker.h"
+#include "logs.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define GETDENTS_BUFFER_SIZE 0x20000
+/* Directories queued with an already opened descriptor; beyond this they are re-opened by path. */
+#define MAX_OPEN_QUEUED_DIRS 256
+/* Entries buffered between the walk and a Next() consumer. */
+#define STREAM_CAPACITY 0x4000
+
+namespace {
+
+struct linux_dirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/**
+ * @brief A directory waiting to be read.
+ */
+struct WorkItem {
+    std::string path;
+    /** Descriptor opened relative to the parent, or -1 to open by path. */
+    int fd = -1;
+};
+
+unsigned char ModeToType(mode_t mode){
+    switch(mode & S_IFMT){
+    case S_IFREG: return DT_REG;
+    case S_IFDIR: return DT_DIR;
+    case S_IFLNK: return DT_LNK;
+    case S_IFCHR: return DT_CHR;
+    case S_IFBLK: return DT_BLK;
+    case S_IFIFO: return DT_FIFO;
+    case S_IFSOCK: return DT_SOCK;
+    default: return DT_UNKNOWN;
+    }
+}
+
+} // namespace
+
+/**
+ * @class DirWalker::Impl
+ * @brief Worker deques, the pending-directory counter and the optional
+ *        background stream used by Start()/Next().
+ */
+class DirWalker::Impl {
+public:
+    Impl(unsigned int threads, bool statSizes, bool ordered) : StatSizes(statSizes), Ordered(ordered) {
+        Threads = threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads;
+    }
+
+    ~Impl() {
+        Stop();
+        if(Background.joinable()){
+            Background.join();
+        }
+    }
+
+    /**
+     * @brief Walks the tree below root and calls visit for every entry.
+     *
+     * Blocks until the whole tree has been visited. The root itself is not
+     * reported.
+     *
+     * @return Success, or AccessFileFailed if root cannot be opened as a directory.
+     */
+    Status Walk(const std::string& root, const Visitor& visit){
+        int fd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if(fd < 0){
+            error_print("Failed to open directory", root);
+            return AccessFileFailed;
+        }
+
+        std::string rootPath = root;
+        while(rootPath.size() > 1 && rootPath.back() == '/'){
+            rootPath.pop_back();
+        }
+        if(Ordered){
+            std::vector<char> buffer(GETDENTS_BUFFER_SIZE);
+            WalkSorted(rootPath, fd, ResumeComponents(rootPath), visit, buffer);
+            return Success;
+        }
+
+        Workers.clear();
+        for(unsigned int i = 0; i < Threads; i++){
+            Workers.push_back(std::make_unique<Worker>());
+        }
+        Workers[0]->Work.push_back(WorkItem{rootPath, fd});
+        Pending = 1;
+
+        std::vector<std::thread> threads;
+        for(unsigned int i = 0; i < Threads; i++){
+            threads.emplace_back(&Impl::WorkerLoop, this, i, std::cref(visit));
+        }
+        for(auto& thread : threads){
+            thread.join();
+        }
+
+        /* Only left over when the walk was cancelled. */
+        for(auto& worker : Workers){
+            for(auto& item : worker->Work){
+                if(item.fd >= 0){
+                    close(item.fd);
+                }
+            }
+            worker->Work.clear();
+        }
+        return Success;
+    }
+
+    /**
+     * @brief Starts walking root in the background.
+     *
+     * Entries are buffered in a bounded queue and handed out by Next(), so a
+     * consumer can start processing while the walk is still in progress.
+     */
+    void Start(const std::string& root){
+        Background = std::thread([this, root]() {
+            Walk(root, [this](const WalkEntry& entry) {
+                std::unique_lock<std::mutex> lock(StreamLock);
+                StreamSpace.wait(lock, [this]() { return Stream.size() < STREAM_CAPACITY || Cancel; });
+                if(Cancel){
+                    return;
+                }
+                Stream.push_back(entry);
+                StreamReady.notify_one();
+            });
+            std::lock_guard<std::mutex> lock(StreamLock);
+            StreamDone = true;
+            StreamReady.notify_all();
+        });
+    }
+
+    void ResumeAfter(const std::string& path){
+        Resume = path;
+    }
+
+    void Stop(){
+        {
+            /* under the lock, so a producer about to wait on StreamSpace sees it */
+            std::lock_guard<std::mutex> lock(StreamLock);
+            Cancel = true;
+        }
+        StreamSpace.notify_all();
+    }
+
+    /**
+     * @brief Takes the next entry of a walk started with Start().
+     * @return false once the walk has finished and all entries were taken.
+     */
+    bool Next(WalkEntry& entry){
+        std::unique_lock<std::mutex> lock(StreamLock);
+        StreamReady.wait(lock, [this]() { return !Stream.empty() || StreamDone; });
+        if(Stream.empty()){
+            return false;
+        }
+        entry = std::move(Stream.front());
+        Stream.pop_front();
+        StreamSpace.notify_one();
+        return true;
+    }
+
+private:
+    struct Worker {
+        std::mutex Lock;
+        std::deque<WorkItem> Work;
+    };
+
+    unsigned int Threads;
+    bool StatSizes;
+    bool Ordered;
+    std::string Resume;
+    std::vector<std::unique_ptr<Worker>> Workers;
+    /* Directories queued or being read; the walk is over when it drops to zero. */
+    std::atomic<size_t> Pending{0};
+    std::atomic<int> QueuedFds{0};
+    std::atomic<bool> Cancel{false};
+
+    std::thread Background;
+    std::mutex StreamLock;
+    std::condition_variable StreamReady;
+    std::condition_variable StreamSpace;
+    std::deque<WalkEntry> Stream;
+    bool StreamDone = false;
+
+    void WorkerLoop(unsigned int id, const Visitor& visit){
+        std::vector<char> buffer(GETDENTS_BUFFER_SIZE);
+        unsigned int idle = 0;
+        while(Pending > 0 && !Cancel){
+            WorkItem item;
+            if(PopLocal(id, item) || Steal(id, item)){
+                idle = 0;
+                ReadDirectory(id, item, visit, buffer);
+                Pending--;
+            } else if(idle++ < 64){
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    }
+
+    bool PopLocal(unsigned int id, WorkItem& item){
+        std::lock_guard<std::mutex> lock(Workers[id]->Lock);
+        if(Workers[id]->Work.empty()){
+            return false;
+        }
+        item = std::move(Workers[id]->Work.back());
+        Workers[id]->Work.pop_back();
+        return true;
+    }
+
+    /**
+     * @brief Takes the oldest directory of another worker.
+     *
+     * The oldest entries sit closest to the root and usually carry the largest
+     * subtrees, which keeps steals rare.
+     */
+    bool Steal(unsigned int id, WorkItem& item){
+        for(unsigned int i = 1; i < Threads; i++){
+            Worker& victim = *Workers[(id + i) % Threads];
+            std::unique_lock<std::mutex> lock(victim.Lock, std::try_to_lock);
+            if(!lock.owns_lock() || victim.Work.empty()){
+                continue;
+            }
+            item = std::move(victim.Work.front());
+            victim.Work.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Lists one directory, visits its entries and queues its subdirectories.
+     */
+    void ReadDirectory(unsigned int id, WorkItem& item, const Visitor& visit, std::vector<char>& buffer){
+        int fd = item.fd;
+        if(fd >= 0){
+            QueuedFds--;
+        } else {
+            fd = open(item.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+            if(fd < 0){
+                warning_print("Skipping unreadable directory", item.path);
+                return;
+            }
+        }
+
+        WalkEntry entry;
+        while(!Cancel){
+            long bytes = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+            if(bytes <= 0){
+                if(bytes < 0){
+                    error_print("Failed to read directory", item.path, ":", strerror(errno));
+                }
+                break;
+            }
+            for(long offset = 0; offset < bytes;){
+                auto* record = reinterpret_cast<linux_dirent64*>(buffer.data() + offset);
+                offset += record->d_reclen;
+                const char* name = record->d_name;
+                if(name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))){
+                    continue;
+                }
+
+                FillEntry(fd, item.path, record, entry);
+                /* reported before it is queued, so it precedes its own entries */
+                visit(entry);
+                if(entry.type == DT_DIR){
+                    QueueDirectory(id, fd, name, entry.path);
+                }
+            }
+        }
+        close(fd);
+    }
+
+    /**
+     * @brief Fills entry from a directory record of the directory open as fd.
+     */
+    void FillEntry(int fd, const std::string& directory, const linux_dirent64* record, WalkEntry& entry){
+        const char* name = record->d_name;
+        entry.path.assign(directory);
+        if(entry.path.empty() || entry.path.back() != '/'){
+            entry.path.push_back('/');
+        }
+        entry.path.append(name);
+        entry.type = record->d_type;
+        entry.inode = record->d_ino;
+        entry.size = 0;
+        entry.mtime = 0;
+
+        if(entry.type == DT_UNKNOWN || (StatSizes && entry.type == DT_REG)){
+            struct statx stx;
+            if(statx(fd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_TYPE | STATX_SIZE | STATX_MTIME | STATX_INO, &stx) == 0){
+                entry.type = ModeToType(stx.stx_mode);
+                if(entry.type == DT_REG){
+                    /* d_ino may differ from st_ino on overlay filesystems */
+                    entry.inode = stx.stx_ino;
+                    entry.size = stx.stx_size;
+                    entry.mtime = stx.stx_mtime.tv_sec * 1000000000LL + stx.stx_mtime.tv_nsec;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Splits the resume path into its components below root.
+     * @return The components, empty to walk everything.
+     */
+    std::vector<std::string> ResumeComponents(const std::string& root){
+        std::vector<std::string> components;
+        std::string prefix = root.back() == '/' ? root : root + "/";
+        if(Resume.empty()){
+            return components;
+        }
+        if(Resume.compare(0, prefix.size(), prefix) != 0){
+            warning_print("Resume path", Resume, "is not below", root, ", walking everything");
+            return components;
+        }
+        for(size_t position = prefix.size(); position < Resume.size();){
+            size_t slash = Resume.find('/', position);
+            if(slash == std::string::npos){
+                slash = Resume.size();
+            }
+            if(slash > position){
+                components.push_back(Resume.substr(position, slash - position));
+            }
+            position = slash + 1;
+        }
+        return components;
+    }
+
+    /**
+     * @brief Visits the tree below the directory open as fd in sorted
+     *        depth-first order; closes fd.
+     *
+     * The whole directory is listed and closed before its subdirectories
+     * are entered, so only one descriptor is open at a time.
+     *
+     * @param resume Components of the resume path below this directory:
+     *        entries before the first one are skipped with their subtrees,
+     *        the entry matching it is not reported again and the walk
+     *        continues inside it with the remaining components.
+     */
+    void WalkSorted(const std::string& path, int fd, std::vector<std::string> resume, const Visitor& visit, std::vector<char>& buffer){
+        std::vector<WalkEntry> entries;
+        while(!Cancel){
+            long bytes = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+            if(bytes <= 0){
+                if(bytes < 0){
+                    error_print("Failed to read directory", path, ":", strerror(errno));
+                }
+                break;
+            }
+            for(long offset = 0; offset < bytes;){
+                auto* record = reinterpret_cast<linux_dirent64*>(buffer.data() + offset);
+                offset += record->d_reclen;
+                const char* name = record->d_name;
+                if(name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))){
+                    continue;
+                }
+                if(!resume.empty() && resume.front().compare(name) > 0){
+                    continue;
+                }
+                entries.emplace_back();
+                FillEntry(fd, path, record, entries.back());
+            }
+        }
+        close(fd);
+
+        /* all paths share the directory prefix, so this sorts by name, byte by byte */
+        std::sort(entries.begin(), entries.end(), [](const WalkEntry& a, const WalkEntry& b) { return a.path < b.path; });
+        size_t nameOffset = path.back() == '/' ? path.size() : path.size() + 1;
+        for(auto& entry : entries){
+            if(Cancel){
+                return;
+            }
+            /* the first entry is the resume point or the first one after it */
+            std::vector<std::string> below;
+            bool reported = false;
+            if(!resume.empty()){
+                reported = entry.path.compare(nameOffset, std::string::npos, resume.front()) == 0;
+                if(reported){
+                    below.assign(resume.begin() + 1, resume.end());
+                }
+                resume.clear();
+            }
+            if(!reported){
+                visit(entry);
+            }
+            if(entry.type == DT_DIR){
+                int child = open(entry.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+                if(child < 0){
+                    warning_print("Skipping unreadable directory", entry.path);
+                    continue;
+                }
+                WalkSorted(entry.path, child, std::move(below), visit, buffer);
+            }
+        }
+    }
+
+    void QueueDirectory(unsigned int id, int parentFd, const char* name, const std::string& path){
+        WorkItem child{path, -1};
+        if(QueuedFds < MAX_OPEN_QUEUED_DIRS){
+            child.fd = openat(parentFd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+            if(child.fd >= 0){
+                QueuedFds++;
+            }
+        }
+        Pending++;
+        std::lock_guard<std::mutex> lock(Workers[id]->Lock);
+        Workers[id]->Work.push_back(std::move(child));
+    }
+};
+
+DirWalker::DirWalker(unsigned int threads, bool statSizes, bool ordered) : pImpl(std::make_unique<Impl>(threads, statSizes, ordered)) {}
+
+DirWalker::~DirWalker() = default;
+
+Status DirWalker::Walk(const std::string& root, const Visitor& visit) {
+    return pImpl->Walk(root, visit);
+}
+
+void DirWalker::ResumeAfter(const std::string& path) {
+    pImpl->ResumeAfter(path);
+}
+
+void DirWalker::Start(const std::string& root) {
+    pImpl->Start(root);
+}
+
+bool DirWalker::Next(WalkEntry& entry) {
+    return pImpl->Next(entry);
+}
+
+void DirWalker::Stop() {
+    pImpl->Stop();
+}
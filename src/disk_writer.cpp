@@ -0,0 +1,318 @@
+#include "disk_writer.h"
+#include "logs.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/* Splits path into checked components, false if it escapes the destination. */
+bool SplitPath(const std::string& path, std::vector<std::string>& parts){
+    size_t start = 0;
+    while(start <= path.size()){
+        size_t end = path.find('/', start);
+        if(end == std::string::npos){
+            end = path.size();
+        }
+        std::string part = path.substr(start, end - start);
+        if(part == ".."){
+            return false;
+        }
+        if(!part.empty() && part != "."){
+            parts.push_back(part);
+        }
+        start = end + 1;
+    }
+    return !parts.empty();
+}
+
+struct timespec ToTimespec(int64_t nanoseconds){
+    struct timespec time;
+    time.tv_sec = nanoseconds / 1000000000LL;
+    time.tv_nsec = nanoseconds % 1000000000LL;
+    return time;
+}
+
+} // namespace
+
+/**
+ * @class DiskWriter::Impl
+ * @brief Destination descriptor, parent directory cache and deferred directory metadata.
+ */
+class DiskWriter::Impl {
+public:
+    ~Impl() {
+        for(auto& dir : Dirs){
+            close(dir.second);
+        }
+        if(RootFd >= 0){
+            close(RootFd);
+        }
+    }
+
+    int RootFd = -1;
+    Durability Policy = Durability::None;
+    std::mutex Lock;
+    std::unordered_map<std::string, int> Dirs;
+    std::vector<DiskEntry> Deferred;
+
+    /**
+     * @brief Descriptor of the directory made of the first count parts, created if missing.
+     * @param owned Set if the caller must close the descriptor because the cache is full.
+     */
+    int ParentFd(const std::vector<std::string>& parts, size_t count, bool& owned){
+        owned = false;
+        if(count == 0){
+            return RootFd;
+        }
+        std::string key;
+        for(size_t i = 0; i < count; i++){
+            key += parts[i];
+            key += '/';
+        }
+        {
+            std::lock_guard<std::mutex> lock(Lock);
+            auto cached = Dirs.find(key);
+            if(cached != Dirs.end()){
+                return cached->second;
+            }
+        }
+
+        bool parentOwned;
+        int parent = ParentFd(parts, count - 1, parentOwned);
+        if(parent < 0){
+            return -1;
+        }
+        const char* name = parts[count - 1].c_str();
+        if(mkdirat(parent, name, 0755) != 0 && errno != EEXIST){
+            error_print("Cannot create directory", key, ":", strerror(errno));
+        }
+        int fd = openat(parent, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if(parentOwned){
+            close(parent);
+        }
+        if(fd < 0){
+            error_print("Cannot open directory", key, ":", strerror(errno));
+            return -1;
+        }
+
+        std::lock_guard<std::mutex> lock(Lock);
+        auto inserted = Dirs.emplace(key, fd);
+        if(!inserted.second){
+            /* another thread opened it first */
+            close(fd);
+            return inserted.first->second;
+        }
+        if(Dirs.size() > DISK_WRITER_MAX_DIR_FDS){
+            Dirs.erase(inserted.first);
+            owned = true;
+        }
+        return fd;
+    }
+
+    /**
+     * @brief Resolves the parent directory of path.
+     * @return The parent descriptor, or -1 if the path is unsafe or the directory cannot be created.
+     */
+    int Resolve(const std::string& path, std::string& name, bool& owned){
+        std::vector<std::string> parts;
+        if(!SplitPath(path, parts)){
+            warning_print("Refusing to extract", path);
+            owned = false;
+            return -1;
+        }
+        name = parts.back();
+        return ParentFd(parts, parts.size() - 1, owned);
+    }
+
+    Status BeginFile(const DiskEntry& entry, DiskFile& file){
+        std::string name;
+        bool owned;
+        int parent = Resolve(entry.path, name, owned);
+        if(parent < 0){
+            return AccessFileFailed;
+        }
+        int flags = O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC;
+        file.fd = openat(parent, name.c_str(), flags, 0600);
+        if(file.fd < 0 && (errno == ELOOP || errno == ETXTBSY)){
+            /* replace a symlink or busy file instead of writing through it */
+            unlinkat(parent, name.c_str(), 0);
+            file.fd = openat(parent, name.c_str(), flags, 0600);
+        }
+        if(owned){
+            close(parent);
+        }
+        if(file.fd < 0){
+            error_print("Cannot create", entry.path, ":", strerror(errno));
+            return AccessFileFailed;
+        }
+        file.entry = entry;
+        if(entry.size > 0 && !entry.sparse && fallocate(file.fd, 0, 0, entry.size) != 0 && errno != EOPNOTSUPP){
+            warning_print("Cannot preallocate", entry.path, ":", strerror(errno));
+        }
+        return Success;
+    }
+
+    Status WriteBlock(DiskFile& file, const void* data, size_t length, int64_t offset){
+        const char* bytes = static_cast<const char*>(data);
+        while(length > 0){
+            ssize_t written = pwrite(file.fd, bytes, length, offset);
+            if(written < 0 && errno == EINTR){
+                continue;
+            }
+            if(written <= 0){
+                error_print("Cannot write", file.entry.path, ":", strerror(errno));
+                return AccessFileFailed;
+            }
+            bytes += written;
+            length -= written;
+            offset += written;
+        }
+        return Success;
+    }
+
+    Status EndFile(DiskFile& file){
+        if(file.fd < 0){
+            return AccessFileFailed;
+        }
+        Status status = Success;
+        struct timespec times[2] = {{0, UTIME_OMIT}, ToTimespec(file.entry.mtime)};
+        /* the size also covers a trailing hole and trims an overlong preallocation */
+        if(ftruncate(file.fd, file.entry.size) != 0
+            || fchmod(file.fd, file.entry.mode & 07777) != 0
+            || futimens(file.fd, times) != 0
+            || (Policy == Durability::PerFile && fsync(file.fd) != 0)){
+            error_print("Cannot finish", file.entry.path, ":", strerror(errno));
+            status = AccessFileFailed;
+        }
+        if(close(file.fd) != 0){
+            status = AccessFileFailed;
+        }
+        file.fd = -1;
+        return status;
+    }
+
+    Status MakeDirectory(const DiskEntry& entry){
+        std::vector<std::string> parts;
+        if(!SplitPath(entry.path, parts)){
+            /* "." or "./" name the destination itself */
+            return entry.path.find("..") == std::string::npos ? Success : AccessFileFailed;
+        }
+        bool owned;
+        int fd = ParentFd(parts, parts.size(), owned);
+        if(fd < 0){
+            return AccessFileFailed;
+        }
+        if(owned){
+            close(fd);
+        }
+        std::lock_guard<std::mutex> lock(Lock);
+        Deferred.push_back(entry);
+        return Success;
+    }
+
+    Status Link(const DiskEntry& entry, const std::string& target){
+        std::vector<std::string> targetParts;
+        if(!SplitPath(target, targetParts)){
+            warning_print("Refusing to link to", target);
+            return AccessFileFailed;
+        }
+        std::string name;
+        bool owned;
+        int parent = Resolve(entry.path, name, owned);
+        if(parent < 0){
+            return AccessFileFailed;
+        }
+        std::string source;
+        for(const auto& part : targetParts){
+            source += source.empty() ? part : "/" + part;
+        }
+        int result = linkat(RootFd, source.c_str(), parent, name.c_str(), 0);
+        if(result != 0 && errno == EEXIST){
+            unlinkat(parent, name.c_str(), 0);
+            result = linkat(RootFd, source.c_str(), parent, name.c_str(), 0);
+        }
+        if(result != 0){
+            error_print("Cannot link", entry.path, "to", target, ":", strerror(errno));
+        }
+        if(owned){
+            close(parent);
+        }
+        return result == 0 ? Success : AccessFileFailed;
+    }
+
+    Status Finish(){
+        Status status = Success;
+        std::lock_guard<std::mutex> lock(Lock);
+        /* children first, so setting a child does not touch a parent already fixed up */
+        std::sort(Deferred.begin(), Deferred.end(), [](const DiskEntry& a, const DiskEntry& b){
+            return std::count(a.path.begin(), a.path.end(), '/') > std::count(b.path.begin(), b.path.end(), '/');
+        });
+        for(const auto& entry : Deferred){
+            std::vector<std::string> parts;
+            SplitPath(entry.path, parts);
+            std::string path;
+            for(const auto& part : parts){
+                path += path.empty() ? part : "/" + part;
+            }
+            struct timespec times[2] = {{0, UTIME_OMIT}, ToTimespec(entry.mtime)};
+            if(fchmodat(RootFd, path.c_str(), entry.mode & 07777, 0) != 0
+                || utimensat(RootFd, path.c_str(), times, AT_SYMLINK_NOFOLLOW) != 0){
+                warning_print("Cannot set metadata of", entry.path, ":", strerror(errno));
+                status = AccessFileFailed;
+            }
+        }
+        Deferred.clear();
+
+        if(Policy == Durability::SyncAtEnd && syncfs(RootFd) != 0){
+            warning_print("syncfs failed:", strerror(errno));
+            status = AccessFileFailed;
+        }
+        return status;
+    }
+};
+
+DiskWriter::DiskWriter() : pImpl(std::make_unique<Impl>()) {}
+
+DiskWriter::~DiskWriter() = default;
+
+std::unique_ptr<DiskWriter> DiskWriter::Open(const std::string& root, Durability durability){
+    std::unique_ptr<DiskWriter> writer(new DiskWriter());
+    writer->pImpl->RootFd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(writer->pImpl->RootFd < 0){
+        error_print("Cannot open destination", root, ":", strerror(errno));
+        return nullptr;
+    }
+    writer->pImpl->Policy = durability;
+    return writer;
+}
+
+Status DiskWriter::BeginFile(const DiskEntry& entry, DiskFile& file) {
+    return pImpl->BeginFile(entry, file);
+}
+
+Status DiskWriter::WriteBlock(DiskFile& file, const void* data, size_t length, int64_t offset) {
+    return pImpl->WriteBlock(file, data, length, offset);
+}
+
+Status DiskWriter::EndFile(DiskFile& file) {
+    return pImpl->EndFile(file);
+}
+
+Status DiskWriter::MakeDirectory(const DiskEntry& entry) {
+    return pImpl->MakeDirectory(entry);
+}
+
+Status DiskWriter::Link(const DiskEntry& entry, const std::string& target) {
+    return pImpl->Link(entry, target);
+}
+
+Status DiskWriter::Finish() {
+    return pImpl->Finish();
+}
@@ -1,11 +1,19 @@
 #include "explorer.h"
+#include "dir_listing.h"
 #include "logs.h"
+#include "size_estimator.h"
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
 #include <limits>
+#include <list>
 #include <vector>
 
 namespace fs = std::filesystem;
 
+/* Directories whose listing is kept while navigating, most recent first. */
+#define EXPLORER_CACHE_SIZE 8
+
 /**
  * @class Explorer::Impl
  * @brief Implementation class for the Explorer functionality, providing methods to navigate and interact with the filesystem.
@@ -21,9 +29,26 @@ public:
     fs::directory_entry CurrentLocation;
 
     /**
-     * @brief The contents of the current location in the filesystem.
+     * @brief Listings of the recently visited directories, most recent first.
+     *
+     * Each listing keeps one page, so returning to a directory does not read
+     * it again unless it changed, and the cache stays small however large
+     * the directories are.
+     */
+    std::list<std::pair<std::string, std::unique_ptr<DirListing>>> Listings;
+
+    /**
+     * @brief Page of the current location shown to the user.
      */
-    std::vector<fs::directory_entry> LocationContent;
+    size_t CurrentPage = 0;
+
+    /**
+     * @brief Background estimator of the listed directories, none if not set.
+     *
+     * Scans are started for the directories on the shown page and for the
+     * current location; their results so far are printed with the listing.
+     */
+    std::unique_ptr<SizeEstimator> Estimator;
 
     /**
      * @brief Default constructor. Initializes the current location to the current working directory.
@@ -52,14 +77,14 @@ public:
     
         do{
             PrintHelp();
-            this->GetCurrentLocationContent();
+            DirListing* listing = this->GetCurrentLocationContent();
             std::cout << this->GetCurrentLocationPath() << ":" << std::endl;
-            this->PrintCurrentLocationContent();
+            this->PrintCurrentLocationContent(listing);
     
             if (!(std::cin >> x)) {
                 std::cin.clear(); // Clear the error flag
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Discard invalid input
-                debug_print("Invalid input. Please try again.");
+                warning_print("Invalid input. Please try again.");
                 continue;
             }
     
@@ -71,27 +96,47 @@ public:
                 status = UserExit;
                 break;
             }
+            else if(x == "N") {
+                if(listing != nullptr && CurrentPage + 1 < listing->PageCount()){
+                    CurrentPage++;
+                }
+                continue;
+            }
+            else if(x == "P") {
+                if(CurrentPage > 0){
+                    CurrentPage--;
+                }
+                continue;
+            }
+            else if(x == "R") {
+                continue;
+            }
             else {
                 try{
                     int id_temp = std::stoi(x);
-                    if(id_temp < 0 || static_cast<size_t>(id_temp) >= this->LocationContent.size()) {
-                        debug_print("Invalid selection");
+                    if(id_temp < 0 || listing == nullptr || static_cast<size_t>(id_temp) >= listing->Size()) {
+                        warning_print("Invalid selection");
                         continue;
                     }
                     id = static_cast<uint32_t>(id_temp);
                 } catch (const std::out_of_range& e) {
-                    debug_print("Invalid input: number out of range");
+                    warning_print("Invalid input: number out of range");
                     continue;
                 } catch (const std::invalid_argument& e) {
-                    debug_print("Invalid input: not a number");
+                    warning_print("Invalid input: not a number");
                     continue;
                 } catch (const std::exception& e) {
-                    debug_print("Invalid input: ", e.what());
+                    warning_print("Invalid input: ", e.what());
                     continue;
                 }
     
-                selectedLocation = GetLocationItembyId(id);
-                if(selectedLocation.is_directory()){
+                ListingEntry item;
+                if(!GetLocationItembyId(listing, id, item)){
+                    warning_print("Invalid selection");
+                    continue;
+                }
+                selectedLocation = fs::directory_entry(this->CurrentLocation.path() / item.name);
+                if(item.directory){
                     MoveToLocation(selectedLocation);
                 }
                 else{
@@ -102,6 +147,10 @@ public:
         } while(true);
     
         SetCurrentLocation(selectedLocation);
+        /* the disk is the archiver's now */
+        if(Estimator != nullptr){
+            Estimator->Cancel();
+        }
     
         if(location != nullptr) *location = this->CurrentLocation;
     
@@ -112,6 +161,10 @@ public:
         return this->CurrentLocation;
     } 
 
+    void SetEstimator(std::unique_ptr<SizeEstimator> estimator){
+        Estimator = std::move(estimator);
+    }
+
     private:
     /**
      * @brief Sets the current location in the filesystem.
@@ -130,23 +183,93 @@ public:
     }
 
     /**
-     * @brief Populates the LocationContent vector with the contents of the current location.
+     * @brief Returns the listing of the current location from the cache,
+     *        opening it if the location was not visited recently.
+     * @return The listing, or nullptr if the location cannot be read.
+     */
+    DirListing* GetCurrentLocationContent(){
+        std::string path = this->CurrentLocation.path().string();
+        auto cached = std::find_if(Listings.begin(), Listings.end(), [&path](const auto& listing) {
+            return listing.first == path;
+        });
+        if(cached != Listings.end()){
+            Listings.splice(Listings.begin(), Listings, cached);
+            return Listings.front().second.get();
+        }
+        auto listing = DirListing::Open(path);
+        if(listing == nullptr){
+            return nullptr;
+        }
+        Listings.emplace_front(path, std::move(listing));
+        if(Listings.size() > EXPLORER_CACHE_SIZE){
+            Listings.pop_back();
+        }
+        return Listings.front().second.get();
+    }
+
+    /**
+     * @brief Prints the current page of the current location to the console,
+     *        each entry with its index in the whole sorted listing.
      */
-    void GetCurrentLocationContent(){
-        this->LocationContent.clear();
-        for(const auto item : fs::directory_iterator(this->CurrentLocation)){
-                this->LocationContent.push_back(item);
+    void PrintCurrentLocationContent(DirListing* listing){
+        if(listing == nullptr){
+            std::cout << "(cannot read directory)" << std::endl;
+            return;
         }
+        size_t pages = std::max<size_t>(1, listing->PageCount());
+        CurrentPage = std::min(CurrentPage, pages - 1);
+        size_t first = CurrentPage * listing->PageSize();
+        const auto& page = listing->Page(CurrentPage);
+        for(size_t i = 0; i < page.size(); i++){
+            fs::path path = this->CurrentLocation.path() / page[i].name;
+            std::cout << first + i << " " << path;
+            if(page[i].directory){
+                std::cout << EstimateLabel(path.string());
+            }
+            std::cout << std::endl;
+        }
+        std::cout << "page " << CurrentPage + 1 << " of " << pages << " (" << listing->Size() << " items)"
+                  << EstimateLabel(GetCurrentLocationPath()) << std::endl;
     }
 
     /**
-     * @brief Prints the contents of the current location to the console.
+     * @brief Starts the estimate of a path if needed and describes its
+     *        result so far, e.g. " [1.2 GiB, 3400 files -> ~310.5 MiB, ~42 s]".
+     * @return The description, empty without an estimator.
      */
-    void PrintCurrentLocationContent(){
-        uint32_t i = 0;
-        for(const auto item : this->LocationContent){
-            std::cout << i++ << " " << item << std::endl;
+    std::string EstimateLabel(const std::string& path){
+        if(Estimator == nullptr){
+            return "";
+        }
+        Estimator->Start(path);
+        SizeEstimate estimate;
+        if(!Estimator->Get(path, estimate)){
+            return "";
+        }
+        std::string label = " [" + FormatBytes(estimate.bytes) + ", " + std::to_string(estimate.files) + " files";
+        if(estimate.sampleBytes > 0){
+            label += " -> ~" + FormatBytes(estimate.ArchiveBytes()) + ", ~" + std::to_string(static_cast<uint64_t>(estimate.Seconds() + 0.5)) + " s";
+        }
+        if(!estimate.complete){
+            label += ", scanning";
         }
+        return label + "]";
+    }
+
+    /**
+     * @brief Formats a byte count with a binary unit and one decimal.
+     */
+    static std::string FormatBytes(uint64_t bytes){
+        static const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB", "PiB"};
+        double value = static_cast<double>(bytes);
+        size_t unit = 0;
+        while(value >= 1024 && unit + 1 < sizeof(units) / sizeof(units[0])){
+            value /= 1024;
+            unit++;
+        }
+        char text[32];
+        snprintf(text, sizeof(text), unit == 0 ? "%.0f %s" : "%.1f %s", value, units[unit]);
+        return text;
     }
 
     /**
@@ -156,19 +279,26 @@ public:
     void MoveToLocation(std::filesystem::directory_entry location){
         debug_print("Moving to location", location.path());
         this->SetCurrentLocation(location);
-        this->GetCurrentLocationContent();
-        debug_print("Found items: ", this->LocationContent.size());
+        this->CurrentPage = 0;
+        /* the previous directory's scans would delay the new one's */
+        if(Estimator != nullptr){
+            Estimator->Cancel();
+        }
     }
 
     /**
-     * @brief Retrieves an item from the current location's contents by its ID.
+     * @brief Retrieves an item from the current location's contents by its ID,
+     *        reading only the page that holds it.
      * @param id The ID of the item to retrieve.
-     * @return The directory entry corresponding to the specified ID.
+     * @param item Receives the entry corresponding to the specified ID.
+     * @return false if there is no such item.
      */
-    std::filesystem::directory_entry GetLocationItembyId(uint32_t id){
-        auto location = this->LocationContent.at(id);
-        debug_print("Selected item: ", location.path());
-        return location;
+    bool GetLocationItembyId(DirListing* listing, uint32_t id, ListingEntry& item){
+        if(!listing->At(id, item)){
+            return false;
+        }
+        debug_print("Selected item: ", item.name);
+        return true;
     }
 
     /**
@@ -186,6 +316,10 @@ public:
         std::cout << "Select item to archive: " << std::endl;
         std::cout << "\t[number] -(file) archive file  " << std::endl;
         std::cout << "\t[number] -(directory) go to the directory " << std::endl;
+        std::cout << "\tN - next page, P - previous page " << std::endl;
+        if(Estimator != nullptr){
+            std::cout << "\tR - refresh size estimates " << std::endl;
+        }
         std::cout << "\tA - Archive current directory " << std::endl;
         std::cout << "\tX - Exit " << std::endl;
     }
@@ -204,3 +338,7 @@ Status Explorer::SelectItemToArchive(std::filesystem::directory_entry* location)
 std::filesystem::directory_entry Explorer::GetLocation(){
     return pImpl->GetLocation();
 }
+
+void Explorer::SetEstimator(std::unique_ptr<SizeEstimator> estimator){
+    pImpl->SetEstimator(std::move(estimator));
+}
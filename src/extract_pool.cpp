@@ -0,0 +1,212 @@
+#include "extract_pool.h"
+#include "logs.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/**
+ * @class ExtractPool::Impl
+ * @brief Job queue shared by the decoder thread and the writer threads.
+ */
+class ExtractPool::Impl {
+public:
+    Impl(ILibArchiveWrapper& libarchive, unsigned int threads, int flags, DiskWriter* native)
+        : libarchive(libarchive), Native(native) {
+        for(unsigned int i = 0; i < threads; i++){
+            if(Native != nullptr){
+                Workers.emplace_back(&Impl::WorkerLoop, this, nullptr);
+                continue;
+            }
+            struct archive* disk = libarchive.archive_write_disk_new();
+            if(disk == nullptr){
+                error_print("Failed to create archive writer for worker", i);
+                continue;
+            }
+            libarchive.archive_write_disk_set_options(disk, flags);
+            libarchive.archive_write_disk_set_standard_lookup(disk);
+            Workers.emplace_back(&Impl::WorkerLoop, this, disk);
+        }
+    }
+
+    ~Impl() {
+        Finish();
+    }
+
+    /**
+     * @brief Queues a job, waiting while the queue holds too much data.
+     *
+     * If no worker could be started the job is dropped and the pool reports
+     * CriticalError.
+     */
+    void Submit(ExtractJob job){
+        if(Workers.empty()){
+            Fail(CriticalError);
+            libarchive.archive_entry_free(job.entry);
+            return;
+        }
+        std::unique_lock<std::mutex> lock(Lock);
+        Space.wait(lock, [this]() { return QueuedBytes < POOL_QUEUE_BYTES || Jobs.empty(); });
+        QueuedBytes += job.data.size();
+        Jobs.push_back(std::move(job));
+        Ready.notify_one();
+    }
+
+    /**
+     * @brief Waits until every submitted job has been written.
+     */
+    void Drain(){
+        std::unique_lock<std::mutex> lock(Lock);
+        Idle.wait(lock, [this]() { return Jobs.empty() && Active == 0; });
+    }
+
+    /**
+     * @brief Writes the remaining jobs and stops the workers.
+     *
+     * Every worker closes its disk handle, which applies the metadata it
+     * deferred.
+     *
+     * @return Success, or the first error reported by a worker.
+     */
+    Status Finish(){
+        {
+            std::lock_guard<std::mutex> lock(Lock);
+            Stopping = true;
+        }
+        Ready.notify_all();
+        for(auto& worker : Workers){
+            worker.join();
+        }
+        Workers.clear();
+        return Result;
+    }
+
+private:
+    ILibArchiveWrapper& libarchive;
+    DiskWriter* Native;
+    std::vector<std::thread> Workers;
+    std::mutex Lock;
+    std::condition_variable Ready;
+    std::condition_variable Space;
+    std::condition_variable Idle;
+    std::deque<ExtractJob> Jobs;
+    size_t QueuedBytes = 0;
+    unsigned int Active = 0;
+    bool Stopping = false;
+    Status Result = Success;
+
+    void WorkerLoop(struct archive* disk){
+        while(true){
+            ExtractJob job;
+            {
+                std::unique_lock<std::mutex> lock(Lock);
+                Ready.wait(lock, [this]() { return !Jobs.empty() || Stopping; });
+                if(Jobs.empty()){
+                    break;
+                }
+                job = std::move(Jobs.front());
+                Jobs.pop_front();
+                QueuedBytes -= job.data.size();
+                Active++;
+            }
+            Space.notify_one();
+
+            Status status = Write(disk, job);
+            libarchive.archive_entry_free(job.entry);
+
+            std::lock_guard<std::mutex> lock(Lock);
+            if(status != Success && Result == Success){
+                Result = status;
+            }
+            Active--;
+            if(Jobs.empty() && Active == 0){
+                Idle.notify_all();
+            }
+        }
+
+        if(disk != nullptr){
+            libarchive.archive_write_close(disk);
+            libarchive.archive_write_free(disk);
+        }
+    }
+
+    Status Write(struct archive* disk, const ExtractJob& job){
+        if(Native != nullptr){
+            return WriteNative(job);
+        }
+        if(libarchive.archive_write_header(disk, job.entry) < ARCHIVE_OK){
+            error_print("Failed to write archive header", libarchive.archive_error_string(disk));
+            return AccessFileFailed;
+        }
+        Status status = Success;
+        size_t position = 0;
+        for(const auto& block : job.blocks){
+            if(libarchive.archive_write_data_block(disk, job.data.data() + position, block.second, block.first) < ARCHIVE_OK){
+                error_print("Failed to write archive data", libarchive.archive_error_string(disk));
+                status = AccessFileFailed;
+                break;
+            }
+            position += block.second;
+        }
+        /* finish the entry even after a failed block, so the handle can take the next one */
+        if(libarchive.archive_write_finish_entry(disk) < ARCHIVE_OK){
+            error_print(libarchive.archive_error_string(disk));
+            return AccessFileFailed;
+        }
+        return status;
+    }
+
+    Status WriteNative(const ExtractJob& job){
+        const char* pathname = libarchive.archive_entry_pathname(job.entry);
+        if(pathname == nullptr){
+            return AccessFileFailed;
+        }
+        DiskEntry entry;
+        entry.path = pathname;
+        entry.mode = libarchive.archive_entry_mode(job.entry);
+        entry.mtime = static_cast<int64_t>(libarchive.archive_entry_mtime(job.entry)) * 1000000000LL
+            + libarchive.archive_entry_mtime_nsec(job.entry);
+        entry.size = libarchive.archive_entry_size(job.entry);
+        entry.sparse = libarchive.archive_entry_sparse_count(job.entry) > 0;
+
+        DiskFile file;
+        Status status = Native->BeginFile(entry, file);
+        if(status != Success){
+            return status;
+        }
+        size_t position = 0;
+        for(const auto& block : job.blocks){
+            status = Native->WriteBlock(file, job.data.data() + position, block.second, block.first);
+            if(status != Success){
+                break;
+            }
+            position += block.second;
+        }
+        Status endStatus = Native->EndFile(file);
+        return status != Success ? status : endStatus;
+    }
+
+    void Fail(Status status){
+        std::lock_guard<std::mutex> lock(Lock);
+        if(Result == Success){
+            Result = status;
+        }
+    }
+};
+
+ExtractPool::ExtractPool(ILibArchiveWrapper& libarchive, unsigned int threads, int flags, DiskWriter* native)
+    : pImpl(std::make_unique<Impl>(libarchive, threads, flags, native)) {}
+
+ExtractPool::~ExtractPool() = default;
+
+void ExtractPool::Submit(ExtractJob job) {
+    pImpl->Submit(std::move(job));
+}
+
+void ExtractPool::Drain() {
+    pImpl->Drain();
+}
+
+Status ExtractPool::Finish() {
+    return pImpl->Finish();
+}
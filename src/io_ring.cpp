@@ -0,0 +1,531 @@
+#include "io_ring.h"
+#include "logs.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <linux/io_uring.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+int SysSetup(unsigned entries, struct io_uring_params* params){
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int SysEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags){
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int SysRegister(int fd, unsigned opcode, const void* arg, unsigned count){
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+/* Buffers aligned for O_DIRECT, released with free(). */
+struct AlignedBuffer {
+    char* data = nullptr;
+
+    explicit AlignedBuffer(size_t size){
+        void* memory = nullptr;
+        if(posix_memalign(&memory, DIRECT_IO_ALIGNMENT, size) == 0){
+            data = static_cast<char*>(memory);
+        }
+    }
+    ~AlignedBuffer(){ free(data); }
+    AlignedBuffer(AlignedBuffer&& other) noexcept : data(std::exchange(other.data, nullptr)) {}
+    AlignedBuffer(const AlignedBuffer&) = delete;
+};
+
+/* Allocates count buffers and registers them with the ring, false if memory runs out. */
+bool MakeBuffers(IoRing& ring, std::vector<AlignedBuffer>& buffers, size_t count, bool& registered){
+    std::vector<struct iovec> iovecs;
+    for(size_t i = 0; i < count; i++){
+        buffers.emplace_back(RING_BUFFER_SIZE);
+        if(buffers.back().data == nullptr){
+            return false;
+        }
+        iovecs.push_back({buffers.back().data, RING_BUFFER_SIZE});
+    }
+    registered = ring.RegisterBuffers(iovecs);
+    return true;
+}
+
+} // namespace
+
+/**
+ * @class IoRing::Impl
+ * @brief Ring descriptor and the shared-memory views of the two queues.
+ */
+class IoRing::Impl {
+public:
+    ~Impl() {
+        if(SqRing != MAP_FAILED){
+            munmap(SqRing, SqRingSize);
+        }
+        if(CqRing != MAP_FAILED && CqRing != SqRing){
+            munmap(CqRing, CqRingSize);
+        }
+        if(Sqes != MAP_FAILED){
+            munmap(Sqes, SqesSize);
+        }
+        if(Fd >= 0){
+            close(Fd);
+        }
+    }
+
+    int Fd = -1;
+    void* SqRing = MAP_FAILED;
+    void* CqRing = MAP_FAILED;
+    void* Sqes = MAP_FAILED;
+    size_t SqRingSize = 0;
+    size_t CqRingSize = 0;
+    size_t SqesSize = 0;
+
+    unsigned* SqHead = nullptr;
+    unsigned* SqTail = nullptr;
+    unsigned SqMask = 0;
+    unsigned SqEntries = 0;
+    unsigned* SqArray = nullptr;
+    unsigned* CqHead = nullptr;
+    unsigned* CqTail = nullptr;
+    unsigned CqMask = 0;
+    struct io_uring_cqe* Cqes = nullptr;
+    unsigned Queued = 0;
+    bool Fixed = false;
+
+    bool Setup(unsigned entries){
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        Fd = SysSetup(entries, &params);
+        if(Fd < 0){
+            warning_print("io_uring unavailable:", strerror(errno));
+            return false;
+        }
+        /* IORING_OP_READ/WRITE need 5.6; FAST_POLL (5.7) is the closest feature bit */
+        if(!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_FAST_POLL)){
+            warning_print("io_uring too old, using blocking I/O");
+            return false;
+        }
+
+        SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        SqRingSize = std::max(SqRingSize, CqRingSize);
+        SqRing = mmap(nullptr, SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQ_RING);
+        CqRing = SqRing;
+        SqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        Sqes = mmap(nullptr, SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQES);
+        if(SqRing == MAP_FAILED || Sqes == MAP_FAILED){
+            error_print("Failed to map io_uring queues");
+            return false;
+        }
+
+        char* sq = static_cast<char*>(SqRing);
+        SqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        SqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        SqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        SqEntries = params.sq_entries;
+        SqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(CqRing);
+        CqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        CqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        CqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        Cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    bool Queue(uint8_t opcode, int fd, const void* data, unsigned length, uint64_t offset, int buffer, uint64_t tag){
+        unsigned tail = *SqTail;
+        if(tail - __atomic_load_n(SqHead, __ATOMIC_ACQUIRE) >= SqEntries){
+            return false;
+        }
+        unsigned index = tail & SqMask;
+        struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(Sqes) + index;
+        memset(sqe, 0, sizeof(*sqe));
+        bool fixed = Fixed && buffer >= 0;
+        if(fixed){
+            sqe->opcode = opcode == IORING_OP_READ ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+            sqe->buf_index = static_cast<uint16_t>(buffer);
+        } else {
+            sqe->opcode = opcode;
+        }
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(data);
+        sqe->len = length;
+        sqe->off = offset;
+        sqe->user_data = tag;
+        SqArray[index] = index;
+        __atomic_store_n(SqTail, tail + 1, __ATOMIC_RELEASE);
+        Queued++;
+        return true;
+    }
+};
+
+IoRing::IoRing() : pImpl(std::make_unique<Impl>()) {}
+
+IoRing::~IoRing() = default;
+
+std::unique_ptr<IoRing> IoRing::Create(unsigned entries){
+    std::unique_ptr<IoRing> ring(new IoRing());
+    if(!ring->pImpl->Setup(entries)){
+        return nullptr;
+    }
+    return ring;
+}
+
+bool IoRing::RegisterBuffers(const std::vector<struct iovec>& buffers){
+    if(SysRegister(pImpl->Fd, IORING_REGISTER_BUFFERS, buffers.data(), buffers.size()) < 0){
+        warning_print("io_uring buffer registration failed:", strerror(errno));
+        return false;
+    }
+    pImpl->Fixed = true;
+    return true;
+}
+
+bool IoRing::QueueRead(int fd, void* data, unsigned length, uint64_t offset, int buffer, uint64_t tag){
+    return pImpl->Queue(IORING_OP_READ, fd, data, length, offset, buffer, tag);
+}
+
+bool IoRing::QueueWrite(int fd, const void* data, unsigned length, uint64_t offset, int buffer, uint64_t tag){
+    return pImpl->Queue(IORING_OP_WRITE, fd, data, length, offset, buffer, tag);
+}
+
+bool IoRing::Submit(unsigned waitFor){
+    if(pImpl->Queued == 0 && waitFor == 0){
+        return true;
+    }
+    while(true){
+        int submitted = SysEnter(pImpl->Fd, pImpl->Queued, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0);
+        if(submitted >= 0){
+            pImpl->Queued -= std::min<unsigned>(pImpl->Queued, submitted);
+            return true;
+        }
+        if(errno != EINTR){
+            error_print("io_uring_enter failed:", strerror(errno));
+            return false;
+        }
+    }
+}
+
+bool IoRing::Complete(uint64_t& tag, int& result){
+    unsigned head = *pImpl->CqHead;
+    if(head == __atomic_load_n(pImpl->CqTail, __ATOMIC_ACQUIRE)){
+        return false;
+    }
+    const struct io_uring_cqe& cqe = pImpl->Cqes[head & pImpl->CqMask];
+    tag = cqe.user_data;
+    result = cqe.res;
+    __atomic_store_n(pImpl->CqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool IoRing::WaitCompletion(uint64_t& tag, int& result){
+    while(!Complete(tag, result)){
+        if(!Submit(1)){
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @class RingOutput::Impl
+ * @brief Buffer pool and the file region each in-flight write covers.
+ */
+class RingOutput::Impl {
+public:
+    ~Impl() {
+        if(Fd >= 0){
+            Close();
+        }
+    }
+
+    struct Pending {
+        uint64_t offset = 0;
+        unsigned length = 0;
+        unsigned done = 0;
+    };
+
+    std::unique_ptr<IoRing> Ring;
+    std::vector<AlignedBuffer> Buffers;
+    std::vector<Pending> Writes;
+    std::vector<unsigned> Free;
+    bool Registered = false;
+    int Fd = -1;
+    bool Direct = false;
+    bool Failed = false;
+    unsigned InFlight = 0;
+    unsigned Current = 0;
+    size_t Filled = 0;
+    uint64_t Offset = 0;
+
+    void Issue(unsigned slot){
+        Pending& write = Writes[slot];
+        const char* data = Buffers[slot].data + write.done;
+        if(!Ring->QueueWrite(Fd, data, write.length - write.done, write.offset + write.done, Registered ? slot : -1, slot)){
+            Failed = true;
+            InFlight--;
+            return;
+        }
+        if(!Ring->Submit(0)){
+            Failed = true;
+        }
+    }
+
+    /* Reaps one completion, resubmitting the rest of a short write. */
+    bool Reap(){
+        uint64_t tag;
+        int result;
+        if(!Ring->WaitCompletion(tag, result)){
+            Failed = true;
+            return false;
+        }
+        Pending& write = Writes[tag];
+        if(result <= 0){
+            error_print("Archive write failed:", strerror(-result));
+            Failed = true;
+        } else if(write.done + result < write.length){
+            write.done += result;
+            Issue(tag);
+            return true;
+        }
+        InFlight--;
+        Free.push_back(static_cast<unsigned>(tag));
+        return true;
+    }
+
+    bool Flush(size_t length){
+        Writes[Current] = Pending{Offset, static_cast<unsigned>(length), 0};
+        Offset += length;
+        InFlight++;
+        Issue(Current);
+        while(Free.empty() && !Failed){
+            Reap();
+        }
+        if(!Failed){
+            Current = Free.back();
+            Free.pop_back();
+        }
+        Filled = 0;
+        return !Failed;
+    }
+
+    bool Write(const char* data, size_t length){
+        while(length > 0 && !Failed){
+            size_t part = std::min(length, RING_BUFFER_SIZE - Filled);
+            memcpy(Buffers[Current].data + Filled, data, part);
+            Filled += part;
+            data += part;
+            length -= part;
+            if(Filled == RING_BUFFER_SIZE){
+                Flush(Filled);
+            }
+        }
+        return !Failed;
+    }
+
+    bool Close(){
+        uint64_t size = Offset + Filled;
+        if(Filled > 0 && !Failed){
+            size_t length = Filled;
+            if(Direct){
+                length = (Filled + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+                memset(Buffers[Current].data + Filled, 0, length - Filled);
+            }
+            Flush(length);
+        }
+        while(InFlight > 0 && Reap()){
+        }
+        if(!Failed && Direct && ftruncate(Fd, size) != 0){
+            Failed = true;
+        }
+        if(close(Fd) != 0){
+            Failed = true;
+        }
+        Fd = -1;
+        return !Failed;
+    }
+};
+
+RingOutput::RingOutput() : pImpl(std::make_unique<Impl>()) {}
+
+RingOutput::~RingOutput() = default;
+
+std::unique_ptr<RingOutput> RingOutput::Open(const std::string& filename, bool direct){
+    std::unique_ptr<RingOutput> output(new RingOutput());
+    Impl& impl = *output->pImpl;
+    impl.Ring = IoRing::Create(2 * RING_BUFFER_COUNT);
+    if(impl.Ring == nullptr || !MakeBuffers(*impl.Ring, impl.Buffers, RING_BUFFER_COUNT, impl.Registered)){
+        return nullptr;
+    }
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    impl.Fd = direct ? open(filename.c_str(), flags | O_DIRECT, 0644) : -1;
+    impl.Direct = impl.Fd >= 0;
+    if(direct && !impl.Direct){
+        warning_print("O_DIRECT not supported for", filename, ", using the page cache");
+    }
+    if(impl.Fd < 0){
+        impl.Fd = open(filename.c_str(), flags, 0644);
+    }
+    if(impl.Fd < 0){
+        error_print("Failed to open archive file", filename);
+        return nullptr;
+    }
+
+    impl.Writes.resize(RING_BUFFER_COUNT);
+    for(unsigned slot = RING_BUFFER_COUNT - 1; slot > 0; slot--){
+        impl.Free.push_back(slot);
+    }
+    impl.Current = 0;
+    return output;
+}
+
+bool RingOutput::Write(const char* data, size_t length){
+    return pImpl->Write(data, length);
+}
+
+bool RingOutput::Close(){
+    return pImpl->Fd < 0 ? !pImpl->Failed : pImpl->Close();
+}
+
+/**
+ * @class RingInput::Impl
+ * @brief Read-ahead window of RING_BUFFER_COUNT blocks, consumed in file order.
+ *
+ * Block n of the file always lands in buffer n % RING_BUFFER_COUNT, so the
+ * window is a plain ring of sequence numbers.
+ */
+class RingInput::Impl {
+public:
+    ~Impl() {
+        /* the kernel may still write into the buffers */
+        while(InFlight > 0){
+            uint64_t tag;
+            int result;
+            if(!Ring->WaitCompletion(tag, result)){
+                break;
+            }
+            InFlight--;
+        }
+        if(Fd >= 0){
+            close(Fd);
+        }
+    }
+
+    struct Block {
+        uint64_t offset = 0;
+        unsigned length = 0;
+        unsigned done = 0;
+        bool complete = false;
+        bool failed = false;
+    };
+
+    std::unique_ptr<IoRing> Ring;
+    std::vector<AlignedBuffer> Buffers;
+    std::vector<Block> Blocks;
+    bool Registered = false;
+    int Fd = -1;
+    uint64_t Size = 0;
+    uint64_t NextOffset = 0;
+    uint64_t Sequence = 0;
+    unsigned InFlight = 0;
+    bool Returned = false;
+
+    void Issue(unsigned slot){
+        Block& block = Blocks[slot];
+        if(!Ring->QueueRead(Fd, Buffers[slot].data + block.done, block.length - block.done, block.offset + block.done,
+            Registered ? slot : -1, slot)){
+            block.failed = block.complete = true;
+            return;
+        }
+        InFlight++;
+    }
+
+    void Start(unsigned slot){
+        if(NextOffset >= Size){
+            Blocks[slot] = Block{NextOffset, 0, 0, true, false};
+            return;
+        }
+        unsigned length = static_cast<unsigned>(std::min<uint64_t>(RING_BUFFER_SIZE, Size - NextOffset));
+        Blocks[slot] = Block{NextOffset, length, 0, false, false};
+        NextOffset += length;
+        Issue(slot);
+    }
+
+    ssize_t Read(const char** data){
+        unsigned slot = Sequence % RING_BUFFER_COUNT;
+        if(Returned){
+            /* the caller is done with the previous block, refill its buffer */
+            Start(slot);
+            Ring->Submit(0);
+            Sequence++;
+            slot = Sequence % RING_BUFFER_COUNT;
+            Returned = false;
+        }
+        while(!Blocks[slot].complete){
+            uint64_t tag;
+            int result;
+            if(!Ring->WaitCompletion(tag, result)){
+                return -1;
+            }
+            InFlight--;
+            Block& block = Blocks[tag];
+            if(result < 0){
+                block.failed = block.complete = true;
+            } else if(result == 0){
+                /* the file shrank, deliver what was read */
+                block.length = block.done;
+                block.complete = true;
+            } else {
+                block.done += result;
+                block.complete = block.done == block.length;
+                if(!block.complete){
+                    Issue(tag);
+                    Ring->Submit(0);
+                }
+            }
+        }
+        if(Blocks[slot].failed){
+            return -1;
+        }
+        *data = Buffers[slot].data;
+        Returned = Blocks[slot].length > 0;
+        return Blocks[slot].length;
+    }
+};
+
+RingInput::RingInput() : pImpl(std::make_unique<Impl>()) {}
+
+RingInput::~RingInput() = default;
+
+std::unique_ptr<RingInput> RingInput::Open(const std::string& filename){
+    std::unique_ptr<RingInput> input(new RingInput());
+    Impl& impl = *input->pImpl;
+    impl.Fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if(impl.Fd < 0 || fstat(impl.Fd, &st) != 0 || !S_ISREG(st.st_mode)){
+        return nullptr;
+    }
+    impl.Size = st.st_size;
+    impl.Ring = IoRing::Create(2 * RING_BUFFER_COUNT);
+    if(impl.Ring == nullptr || !MakeBuffers(*impl.Ring, impl.Buffers, RING_BUFFER_COUNT, impl.Registered)){
+        return nullptr;
+    }
+    posix_fadvise(impl.Fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    impl.Blocks.resize(RING_BUFFER_COUNT);
+    for(unsigned slot = 0; slot < RING_BUFFER_COUNT; slot++){
+        impl.Start(slot);
+    }
+    impl.Ring->Submit(0);
+    return input;
+}
+
+ssize_t RingInput::Read(const char** data){
+    return pImpl->Read(data);
+}
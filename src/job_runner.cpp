@@ -0,0 +1,251 @@
+#include "job_runner.h"
+#include "codec.h"
+#include "logs.h"
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+/**
+ * @brief Splits a manifest line into blank separated fields; a field in
+ *        double quotes may contain blanks.
+ *
+ * @return false if a quote is not closed.
+ */
+bool SplitFields(const std::string& line, std::vector<std::string>& fields){
+    size_t position = 0;
+    while(true){
+        position = line.find_first_not_of(" \t\r", position);
+        if(position == std::string::npos){
+            return true;
+        }
+        if(line[position] == '"'){
+            size_t end = line.find('"', position + 1);
+            if(end == std::string::npos){
+                return false;
+            }
+            fields.push_back(line.substr(position + 1, end - position - 1));
+            position = end + 1;
+        } else {
+            size_t end = line.find_first_of(" \t\r", position);
+            fields.push_back(line.substr(position, end - position));
+            position = end;
+        }
+    }
+}
+
+/**
+ * @brief Applies one key or key=value setting of a manifest line.
+ *
+ * @return false if the setting is unknown, not valid for the job kind or
+ *         has an invalid value.
+ */
+bool ApplySetting(const std::string& field, Job& job){
+    size_t equals = field.find('=');
+    std::string key = field.substr(0, equals);
+    std::string value = equals == std::string::npos ? "" : field.substr(equals + 1);
+    bool pack = job.kind == JobKind::Pack;
+    if(key == "codec" && pack){
+        return ParseCodec(value, job.options.codec);
+    }
+    if(key == "level" && pack){
+        try{
+            job.options.level = std::stoi(value);
+        } catch (const std::exception& e) {
+            return false;
+        }
+        return true;
+    }
+    if(key == "long" && pack && value.empty()){
+        job.options.longMode = true;
+        return true;
+    }
+    if(key == "reproducible" && pack && value.empty()){
+        job.options.reproducible = true;
+        return true;
+    }
+    if(key == "seekable" && pack && value.empty()){
+        job.options.seekable = true;
+        return true;
+    }
+    if(key == "checkpoint" && pack && value.empty()){
+        job.options.seekable = true;
+        job.options.checkpoint = true;
+        return true;
+    }
+    if(key == "incremental" && pack && !value.empty()){
+        job.options.baseManifest = value;
+        return true;
+    }
+    if(key == "dedup" && !value.empty()){
+        job.options.dedupStore = value;
+        return true;
+    }
+    if(key == "native-writer" && !pack && value.empty()){
+        job.options.nativeWriter = true;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+Status ParseJobManifest(const std::string& filename, const ArchiverOptions& defaults, std::vector<Job>& jobs){
+    jobs.clear();
+    std::ifstream file(filename);
+    if(!file){
+        error_print("Cannot open job manifest", filename);
+        return CannotOpenFile;
+    }
+    std::string line;
+    for(size_t number = 1; std::getline(file, line); number++){
+        std::vector<std::string> fields;
+        if(!SplitFields(line, fields)){
+            error_print("Unterminated quote in job manifest line", number);
+            jobs.clear();
+            return TooManyArgs;
+        }
+        if(fields.empty() || fields[0][0] == '#'){
+            continue;
+        }
+        Job job;
+        job.options = defaults;
+        job.options.outputFd = -1;
+        job.options.inputFd = -1;
+        job.options.outputCallback = nullptr;
+        bool valid = fields.size() >= 3 && (fields[0] == "pack" || fields[0] == "unpack");
+        if(valid){
+            job.kind = fields[0] == "pack" ? JobKind::Pack : JobKind::Unpack;
+            job.source = fields[1];
+            job.target = fields[2];
+            if(job.kind == JobKind::Unpack){
+                job.options.extractDirectory = job.target;
+            }
+        }
+        for(size_t i = 3; valid && i < fields.size(); i++){
+            valid = ApplySetting(fields[i], job);
+        }
+        if(valid && !IsValidLevel(job.options.codec, job.options.level)){
+            valid = false;
+        }
+        if(!valid){
+            error_print("Invalid job manifest line", number, ":", line);
+            jobs.clear();
+            return TooManyArgs;
+        }
+        jobs.push_back(std::move(job));
+    }
+    return Success;
+}
+
+namespace {
+
+/**
+ * @brief Gives a job its share of the thread budget, split between the
+ *        stages that run at the same time.
+ *
+ * A pack job walks the tree while it compresses, so a quarter of the share
+ * goes to the walker; an unpack job keeps one thread for decoding and gives
+ * the rest to its writer pool. Each stage keeps at least one thread. The
+ * pipeline reader thread, which mostly waits for the disk, is not counted.
+ */
+void AssignShare(Job& job, unsigned int share){
+    if(job.kind == JobKind::Pack){
+        job.options.walkerThreads = std::max(1u, share / 4);
+        job.options.threads = std::max(1u, share - job.options.walkerThreads);
+    } else {
+        job.options.extractThreads = std::max(1u, share - 1);
+    }
+}
+
+} // namespace
+
+class JobRunner::Impl {
+public:
+    Impl(unsigned int threads, unsigned int parallel)
+        : Threads(threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads), Parallel(parallel) {}
+
+    std::vector<Status> Run(const std::vector<Job>& jobs, const std::function<Status(const Job&)>& execute,
+                            const std::function<void(size_t, Status)>& report){
+        std::vector<Status> statuses(jobs.size(), Success);
+        if(jobs.empty()){
+            return statuses;
+        }
+        /* every running job needs at least one thread of the budget */
+        unsigned int slots = std::min(Parallel == 0 ? Threads : Parallel, Threads);
+        slots = static_cast<unsigned int>(std::min<size_t>(slots, jobs.size()));
+
+        size_t next = 0;
+        unsigned int running = 0;
+        unsigned int idle = Threads;
+        std::mutex budgetMutex;
+        std::mutex reportMutex;
+        std::vector<std::thread> workers;
+        for(unsigned int slot = 0; slot < slots; slot++){
+            workers.emplace_back([&]() {
+                while(true){
+                    size_t index;
+                    unsigned int share;
+                    unsigned int taken;
+                    {
+                        std::lock_guard<std::mutex> lock(budgetMutex);
+                        if(next == jobs.size()){
+                            break;
+                        }
+                        index = next++;
+                        /* the free threads, those of finished jobs included, are
+                           split between this job and the slots still to start one */
+                        size_t starting = std::min<size_t>(slots - running, jobs.size() - index);
+                        share = std::max(1u, static_cast<unsigned int>(idle / starting));
+                        taken = std::min(share, idle);
+                        idle -= taken;
+                        running++;
+                    }
+
+                    Job job = jobs[index];
+                    AssignShare(job, share);
+                    job.options.prefetchBytes = job.options.prefetchBytes / Threads * share;
+                    Status status = execute(job);
+                    statuses[index] = status;
+                    {
+                        std::lock_guard<std::mutex> lock(budgetMutex);
+                        idle += taken;
+                        running--;
+                    }
+                    if(report){
+                        std::lock_guard<std::mutex> lock(reportMutex);
+                        report(index, status);
+                    }
+                }
+            });
+        }
+        for(auto& worker : workers){
+            worker.join();
+        }
+        return statuses;
+    }
+
+private:
+    unsigned int Threads;
+    unsigned int Parallel;
+};
+
+JobRunner::JobRunner(unsigned int threads, unsigned int parallel) : pImpl(std::make_unique<Impl>(threads, parallel)) {}
+
+JobRunner::~JobRunner() = default;
+
+std::vector<Status> JobRunner::Run(const std::vector<Job>& jobs, const std::function<Status(const Job&)>& execute,
+                                   const std::function<void(size_t index, Status status)>& report){
+    return pImpl->Run(jobs, execute, report);
+}
+
+Status JobRunner::Aggregate(const std::vector<Status>& statuses){
+    for(Status status : statuses){
+        if(status != Success){
+            return status;
+        }
+    }
+    return Success;
+}
@@ -0,0 +1,100 @@
+#include "link_table.h"
+#include <vector>
+
+namespace {
+
+/* Slots of a new table, a power of two. */
+constexpr size_t INITIAL_SLOTS = 1024;
+
+/* splitmix64 finalizer over both halves of the key. */
+uint64_t HashKey(uint64_t device, uint64_t inode){
+    uint64_t x = inode ^ (device * 0x9E3779B97F4A7C15ULL);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+} // namespace
+
+/**
+ * @class LinkTable::Impl
+ * @brief Linear probing table; a slot is empty while its path offset is 0.
+ */
+class LinkTable::Impl {
+public:
+    struct Slot {
+        uint64_t device;
+        uint64_t inode;
+        /** Offset of the NUL-terminated path in Paths plus one. */
+        uint64_t path;
+        uint64_t contentHash;
+    };
+
+    std::vector<Slot> Slots = std::vector<Slot>(INITIAL_SLOTS, Slot{0, 0, 0, 0});
+    std::vector<char> Paths;
+    size_t Count = 0;
+
+    /* Slot holding the key, or the empty slot where it belongs. */
+    size_t Probe(uint64_t device, uint64_t inode) const {
+        size_t mask = Slots.size() - 1;
+        size_t index = HashKey(device, inode) & mask;
+        while(Slots[index].path != 0 && (Slots[index].device != device || Slots[index].inode != inode)){
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
+
+    /* Doubles the table once it is three quarters full. */
+    void Grow(){
+        std::vector<Slot> old(Slots.size() * 2, Slot{0, 0, 0, 0});
+        old.swap(Slots);
+        for(const auto& slot : old){
+            if(slot.path != 0){
+                Slots[Probe(slot.device, slot.inode)] = slot;
+            }
+        }
+    }
+};
+
+LinkTable::LinkTable() : pImpl(std::make_unique<Impl>()) {}
+
+LinkTable::~LinkTable() = default;
+
+bool LinkTable::Find(uint64_t device, uint64_t inode, std::string& path, uint64_t& contentHash) const {
+    const Impl::Slot& slot = pImpl->Slots[pImpl->Probe(device, inode)];
+    if(slot.path == 0){
+        return false;
+    }
+    path = &pImpl->Paths[slot.path - 1];
+    contentHash = slot.contentHash;
+    return true;
+}
+
+void LinkTable::Add(uint64_t device, uint64_t inode, const std::string& path) {
+    if((pImpl->Count + 1) * 4 > pImpl->Slots.size() * 3){
+        pImpl->Grow();
+    }
+    Impl::Slot& slot = pImpl->Slots[pImpl->Probe(device, inode)];
+    if(slot.path != 0){
+        return;
+    }
+    slot = Impl::Slot{device, inode, pImpl->Paths.size() + 1, 0};
+    pImpl->Paths.insert(pImpl->Paths.end(), path.begin(), path.end());
+    pImpl->Paths.push_back('\0');
+    pImpl->Count++;
+}
+
+void LinkTable::SetContentHash(uint64_t device, uint64_t inode, uint64_t contentHash) {
+    Impl::Slot& slot = pImpl->Slots[pImpl->Probe(device, inode)];
+    if(slot.path != 0){
+        slot.contentHash = contentHash;
+    }
+}
+
+size_t LinkTable::Size() const {
+    return pImpl->Count;
+}
+
+void LinkTable::Clear() {
+    pImpl = std::make_unique<Impl>();
+}
@@ -1,20 +1,141 @@
+#include "logs.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <sstream>
-#include <string>
-#include <stdbool.h>
+#include <thread>
 
-#include <cstdlib>
+namespace {
 
-static bool is_debug_print_enable(){
-    return std::getenv("NAVTOR_DEBUG_LOG") == nullptr ? false : true;
-}
+/* How long the writer thread sleeps when the ring is empty. */
+constexpr std::chrono::milliseconds IDLE_INTERVAL(2);
+
+/**
+ * @brief Bounded multi-producer ring of log messages with a background writer.
+ *
+ * Producers claim a slot by advancing Head with a compare-and-swap and
+ * publish it through the slot's sequence number (Vyukov's bounded queue), so
+ * logging threads never take a lock or wait for the output. The single
+ * writer thread drains the ring in order and writes batches to stdout.
+ */
+class Logger {
+public:
+    static Logger& Instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    void Submit(const std::string& message) {
+        size_t position = Head.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &Slots[position % LOG_RING_SIZE];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            if (sequence == position) {
+                if (Head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (sequence < position) {
+                /* full: the writer has not freed this slot yet */
+                Dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                position = Head.load(std::memory_order_relaxed);
+            }
+        }
+        slot->length = std::min<size_t>(message.size(), LOG_MESSAGE_SIZE);
+        memcpy(slot->text, message.data(), slot->length);
+        slot->sequence.store(position + 1, std::memory_order_release);
+    }
+
+    void Flush() {
+        size_t target = Head.load(std::memory_order_acquire);
+        while (Written.load(std::memory_order_acquire) < target) {
+            std::this_thread::sleep_for(IDLE_INTERVAL / 2);
+        }
+    }
 
-template<typename... Args>
-void debug_print(const std::string& format, Args... args) {
-    if (!is_debug_print_enable()) {
-        return;
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        size_t length = 0;
+        char text[LOG_MESSAGE_SIZE];
+    };
+
+    Slot Slots[LOG_RING_SIZE];
+    std::atomic<size_t> Head{0};
+    /* messages taken from the ring and written, only advanced by the writer */
+    std::atomic<size_t> Written{0};
+    std::atomic<size_t> Dropped{0};
+    std::atomic<bool> Stop{false};
+    std::thread Writer;
+
+    Logger() {
+        for (size_t i = 0; i < LOG_RING_SIZE; i++) {
+            Slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        Writer = std::thread(&Logger::WriterLoop, this);
     }
-    std::ostringstream stream;
-    ((stream << args << " "), ...);
-    std::cout << format << ": " << stream.str() << std::endl;
+
+    /* Writes what is left at exit; messages logged later are lost. */
+    ~Logger() {
+        Stop = true;
+        Writer.join();
+    }
+
+    void WriterLoop() {
+        std::string batch;
+        size_t position = 0;
+        while (true) {
+            Slot& slot = Slots[position % LOG_RING_SIZE];
+            if (slot.sequence.load(std::memory_order_acquire) == position + 1) {
+                batch.append(slot.text, slot.length);
+                batch += '\n';
+                slot.sequence.store(position + LOG_RING_SIZE, std::memory_order_release);
+                position++;
+                continue;
+            }
+            size_t dropped = Dropped.exchange(0, std::memory_order_relaxed);
+            if (dropped > 0) {
+                batch += "[log] " + std::to_string(dropped) + " messages dropped\n";
+            }
+            if (!batch.empty()) {
+                std::cout.write(batch.data(), batch.size());
+                std::cout.flush();
+                batch.clear();
+                Written.store(position, std::memory_order_release);
+                continue;
+            }
+            if (Stop && Head.load(std::memory_order_acquire) == position) {
+                break;
+            }
+            std::this_thread::sleep_for(IDLE_INTERVAL);
+        }
+    }
+};
+
+} // namespace
+
+int log_read_level() {
+    const char* value = std::getenv("NAVTOR_DEBUG_LOG");
+    if (value == nullptr) {
+        return LOG_LEVEL_OFF;
+    }
+    const char* names[] = {"debug", "info", "warning", "error"};
+    for (int level = LOG_LEVEL_DEBUG; level <= LOG_LEVEL_ERROR; level++) {
+        if (strcmp(value, names[level]) == 0) {
+            return level;
+        }
+    }
+    return LOG_LEVEL_DEBUG;
+}
+
+void log_submit(const std::string& message) {
+    Logger::Instance().Submit(message);
+}
+
+void log_flush() {
+    Logger::Instance().Flush();
 }
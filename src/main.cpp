@@ -1,18 +1,57 @@
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include "logs.h"
 #include "explorer.h"
 #include "archiver.h"
+#include "job_runner.h"
 #include "status.h"
 #include "libarchive_wrapper.h"
+#include <sys/stat.h>
+#include <unistd.h>
 
-const std::string DEFAULT_ARCHIVE_NAME = "archive.tar.gz";
+/* the extension is derived from the selected codec */
+const std::string DEFAULT_ARCHIVE_NAME = "archive";
 
-#define MAX_PARAM_NUMBERS 2
+#define MAX_POSITIONAL_PARAMS 1
 
 enum Modes {
     UNDEFINED,
     PACK,
-    UNPACK
+    UNPACK,
+    LIST,
+    BATCH,
+    VERIFY
+};
+
+/**
+ * @brief Settings collected from the command line.
+ */
+struct CliOptions {
+    ArchiverOptions archiver;
+    std::vector<std::string> positional;
+    /** entry restored alone from a seekable archive, empty to extract everything */
+    std::string path;
+    std::string directory = ".";
+    /** archive file written in pack mode, "-" for stdout, empty for the default name */
+    std::string output;
+    /** print the entries of the archive instead of extracting it */
+    bool list = false;
+    /** list as JSON lines instead of text */
+    bool json = false;
+    /** check the archive against its checksums instead of extracting it */
+    bool verify = false;
+    /** format of the statistics printed after packing or unpacking, empty for none */
+    std::string stats;
+    /** job manifest run in batch mode, empty for an interactive pack or a single unpack */
+    std::string batch;
+    /** batch mode: jobs run at the same time, 0 for one per thread of the budget */
+    unsigned int parallel = 0;
 };
 
 /**
@@ -25,8 +64,251 @@ enum Modes {
 void 
 print_help(){
     std::cout << "Usage:" << std::endl;
-    std::cout << "BTTF for archivization mode" << std::endl;
-    std::cout << "BTTF <archive_name> for unpack " << std::endl;
+    std::cout << "BTTF [options] for archivization mode" << std::endl;
+    std::cout << "BTTF [options] <archive_name> for unpack, - reads the archive from stdin" << std::endl;
+    std::cout << "BTTF --list [--json] <archive_name> to list the archive content" << std::endl;
+    std::cout << "BTTF --verify [-j <N>] <archive_name> to check the archive content against its checksums" << std::endl;
+    std::cout << "BTTF --batch <job_manifest> [-j <N>] [--parallel <N>] to run pack and unpack jobs without interaction" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "\t-c, --codec <name>  compression codec: xz (default), zstd, lz4, gzip, none" << std::endl;
+    std::cout << "\t-l, --level <N>     compression level (xz 0-9, zstd 1-19, lz4 1-9, gzip 1-9)" << std::endl;
+    std::cout << "\t--long              zstd long-distance matching for large, repetitive inputs" << std::endl;
+    std::cout << "\t-j, --threads <N>   number of compression threads, or writer threads when unpacking (default: all cores)" << std::endl;
+    std::cout << "\t-i, --incremental <manifest>  archive only files changed since the archive the manifest belongs to" << std::endl;
+    std::cout << "\t-d, --dedup <store>  deduplicate file data into the chunk store directory" << std::endl;
+    std::cout << "\t--reproducible      walk directories in sorted order on one thread, so the same tree gives the same archive" << std::endl;
+    std::cout << "\t--seekable          write independently compressed frames and a table of contents (xz, zstd, lz4)" << std::endl;
+    std::cout << "\t--checkpoint        seekable archive with a journal, so an interrupted run continues where it stopped" << std::endl;
+    std::cout << "\t-p, --path <entry>  restore only this entry of a seekable archive" << std::endl;
+    std::cout << "\t-C, --directory <dir>  directory the entry given with --path is restored into (default: .)" << std::endl;
+    std::cout << "\t-o, --output <file>  archive file to write, - streams the archive to stdout" << std::endl;
+    std::cout << "\t--io-uring          use io_uring for archive file and source file I/O where the kernel supports it" << std::endl;
+    std::cout << "\t--direct-io         with --io-uring, write the archive with O_DIRECT to bypass the page cache" << std::endl;
+    std::cout << "\t--prefetch <MiB>    size of the window of upcoming files read ahead while packing, 0 disables (default: 32)" << std::endl;
+    std::cout << "\t--native-writer     create extracted files with openat/fallocate and batched directory metadata" << std::endl;
+    std::cout << "\t--sync <policy>     with --native-writer: none (default), end (one syncfs) or file (fsync per file)" << std::endl;
+    std::cout << "\t--list              print path, size, mode and mtime of every entry without extracting" << std::endl;
+    std::cout << "\t--json              with --list, print one JSON object per entry" << std::endl;
+    std::cout << "\t--verify            decode the archive and compare every file with its recorded XXH64, writing nothing" << std::endl;
+    std::cout << "\t--no-checksums      do not record the XXH64 of every file at the end of the archive" << std::endl;
+    std::cout << "\t--stats=json        print file and byte counts and the time per phase to stderr as JSON when done" << std::endl;
+    std::cout << "\t--batch <file>      run the jobs of a manifest, one per line:" << std::endl;
+    std::cout << "\t                      pack <directory> <archive> [codec=<name>] [level=<N>] [long] [reproducible] [seekable] [checkpoint] [incremental=<manifest>] [dedup=<store>]" << std::endl;
+    std::cout << "\t                      unpack <archive> <directory> [dedup=<store>] [native-writer]" << std::endl;
+    std::cout << "\t                    -j is the thread budget shared by all jobs; a starting job takes its share" << std::endl;
+    std::cout << "\t                    of the threads not in use, split between walking and compression or" << std::endl;
+    std::cout << "\t                    between decoding and writing, with at least one thread per stage" << std::endl;
+    std::cout << "\t--parallel <N>      with --batch, number of jobs run at the same time (default and maximum: one per thread)" << std::endl;
+}
+
+/**
+ * @brief Parses the command line into CliOptions.
+ *
+ * Arguments starting with '-' are treated as options, everything else is
+ * collected as a positional parameter.
+ *
+ * @param argc Number of arguments.
+ * @param argv Argument values.
+ * @param options Output structure filled with the parsed settings.
+ * @return Status - Success, or TooManyArgs if an option is malformed or
+ *         too many positional parameters were given.
+ */
+Status parse_args(int argc, char** argv, CliOptions& options){
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg == "-c" || arg == "--codec"){
+            if(i + 1 >= argc || !ParseCodec(argv[i + 1], options.archiver.codec)){
+                error_print("Invalid codec for", arg);
+                return TooManyArgs;
+            }
+            i++;
+        }
+        else if(arg == "-l" || arg == "--level"){
+            if(i + 1 >= argc){
+                error_print("Missing value for", arg);
+                return TooManyArgs;
+            }
+            try{
+                options.archiver.level = std::stoi(argv[++i]);
+            } catch (const std::exception& e) {
+                error_print("Invalid compression level", argv[i]);
+                return TooManyArgs;
+            }
+        }
+        else if(arg == "--long"){
+            options.archiver.longMode = true;
+        }
+        else if(arg == "-j" || arg == "--threads"){
+            if(i + 1 >= argc){
+                error_print("Missing value for", arg);
+                return TooManyArgs;
+            }
+            try{
+                options.archiver.threads = static_cast<unsigned int>(std::stoul(argv[++i]));
+                options.archiver.extractThreads = options.archiver.threads;
+            } catch (const std::exception& e) {
+                error_print("Invalid thread count", argv[i]);
+                return TooManyArgs;
+            }
+        }
+        else if(arg == "-i" || arg == "--incremental"){
+            if(i + 1 >= argc){
+                error_print("Missing value for", arg);
+                return TooManyArgs;
+            }
+            options.archiver.baseManifest = argv[++i];
+        }
+        else if(arg == "-d" || arg == "--dedup"){
+            if(i + 1 >= argc){
+                error_print("Missing value for", arg);
+                return TooManyArgs;
+            }
+            options.archiver.dedupStore = argv[++i];
+        }
+        else if(arg == "--reproducible"){
+            options.archiver.reproducible = true;
+        }
+        else if(arg == "--seekable"){
+            options.archiver.seekable = true;
+        }
+        else if(arg == "--checkpoint"){
+            options.archiver.seekable = true;
+            options.archiver.checkpoint = true;
+        }
+        else if(arg == "-o" || arg == "--output"){
+            if(i + 1 >= argc){
+                error_print("Missing value for", arg);
+                return TooManyArgs;
+            }
+            options.output = argv[++i];
+        }
+        else if(arg == "--io-uring"){
+            options.archiver.ioUring = true;
+        }
+        else if(arg == "--direct-io"){
+            options.archiver.directIo = true;
+        }
+        else if(arg == "--prefetch"){
+            if(i + 1 >= argc){
+                error_print("Missing value for", arg);
+                return TooManyArgs;
+            }
+            try{
+                options.archiver.prefetchBytes = std::stoull(argv[++i]) << 20;
+            } catch (const std::exception& e) {
+                error_print("Invalid prefetch window", argv[i]);
+                return TooManyArgs;
+            }
+        }
+        else if(arg == "--native-writer"){
+            options.archiver.nativeWriter = true;
+        }
+        else if(arg == "--sync"){
+            if(i + 1 >= argc){
+                error_print("Missing value for", arg);
+                return TooManyArgs;
+            }
+            std::string policy = argv[++i];
+            if(policy == "none"){
+                options.archiver.durability = Durability::None;
+            }
+            else if(policy == "end"){
+                options.archiver.durability = Durability::SyncAtEnd;
+            }
+            else if(policy == "file"){
+                options.archiver.durability = Durability::PerFile;
+            }
+            else{
+                error_print("Unknown sync policy", policy);
+                return TooManyArgs;
+            }
+            options.archiver.nativeWriter = true;
+        }
+        else if(arg == "--list"){
+            options.list = true;
+        }
+        else if(arg == "--json"){
+            options.json = true;
+        }
+        else if(arg == "--verify"){
+            options.verify = true;
+        }
+        else if(arg == "--no-checksums"){
+            options.archiver.checksums = false;
+        }
+        else if(arg.rfind("--stats=", 0) == 0){
+            options.stats = arg.substr(8);
+            if(options.stats != "json"){
+                error_print("Unknown stats format", options.stats);
+                return TooManyArgs;
+            }
+        }
+        else if(arg == "--batch"){
+            if(i + 1 >= argc){
+                error_print("Missing value for", arg);
+                return TooManyArgs;
+            }
+            options.batch = argv[++i];
+        }
+        else if(arg == "--parallel"){
+            if(i + 1 >= argc){
+                error_print("Missing value for", arg);
+                return TooManyArgs;
+            }
+            try{
+                options.parallel = static_cast<unsigned int>(std::stoul(argv[++i]));
+            } catch (const std::exception& e) {
+                error_print("Invalid job count", argv[i]);
+                return TooManyArgs;
+            }
+        }
+        else if(arg == "-p" || arg == "--path"){
+            if(i + 1 >= argc){
+                error_print("Missing value for", arg);
+                return TooManyArgs;
+            }
+            options.path = argv[++i];
+        }
+        else if(arg == "-C" || arg == "--directory"){
+            if(i + 1 >= argc){
+                error_print("Missing value for", arg);
+                return TooManyArgs;
+            }
+            options.directory = argv[++i];
+        }
+        else if(arg.size() > 1 && arg[0] == '-'){
+            error_print("Unknown option", arg);
+            return TooManyArgs;
+        }
+        else{
+            options.positional.push_back(arg);
+        }
+    }
+
+    if(!IsValidLevel(options.archiver.codec, options.archiver.level)){
+        std::cout << "Level " << options.archiver.level << " is not supported by " << CodecName(options.archiver.codec) << std::endl;
+        return TooManyArgs;
+    }
+    if(options.positional.size() > MAX_POSITIONAL_PARAMS){
+        error_print("Too many arguments");
+        return TooManyArgs;
+    }
+    return Success;
+}
+
+/**
+ * @brief Prints the counters of an archiver as one JSON object on stderr,
+ *        which stays free while the archive is streamed to stdout.
+ *
+ * @param operation "pack" or "unpack".
+ */
+void print_stats(const char* operation, const ArchiverStats& stats){
+    std::cerr << "{\"operation\":\"" << operation << "\",\"files\":" << stats.files
+              << ",\"bytes_read\":" << stats.bytesRead << ",\"bytes_written\":" << stats.bytesWritten
+              << ",\"compression_ratio\":" << stats.compressionRatio
+              << ",\"phases_ns\":{\"walk\":" << stats.walkNs << ",\"read\":" << stats.readNs
+              << ",\"compress\":" << stats.compressNs << ",\"write\":" << stats.writeNs
+              << ",\"finish_entry\":" << stats.finishEntryNs << ",\"total\":" << stats.totalNs << "}}" << std::endl;
 }
 
 /**
@@ -39,11 +321,30 @@ print_help(){
  * Note: The dual implementation is provided solely for the purpose of showcasing 
  * the usage of interfaces in C++.
  * 
+ * With -o the archive goes to the given file, or with "-" to stdout. In the
+ * latter case stdout is moved to a private descriptor and fd 1 is pointed at
+ * stderr, so the explorer and progress messages cannot corrupt the stream.
+ *
+ * The archive is completed with Archiver::Finish before the statistics are
+ * taken, so they include the final flush of the compressor.
+ *
  * @return Status - Returns the status of the operation, either Success or UserExit.
  */
-Status pack_mode(){
+Status pack_mode(const CliOptions& cli){
+    ArchiverOptions options = cli.archiver;
+    if(cli.output == "-"){
+        std::cout.flush();
+        options.outputFd = dup(STDOUT_FILENO);
+        if(options.outputFd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0){
+            error_print("Failed to redirect stdout");
+            return CannotOpenFile;
+        }
+    }
     auto libarchive = std::make_unique<LibArchiveWrapper>();
+    /* compresses the estimator's samples with the selected codec; outlives the explorer */
+    Archiver sampler(std::make_unique<LibArchiveWrapper>(), cli.archiver);
     Explorer explorer;
+    explorer.SetEstimator(std::make_unique<SizeEstimator>(sampler.SampleCompressor(), cli.archiver.walkerThreads));
 
     std::filesystem::directory_entry entry; 
     auto stat = explorer.SelectItemToArchive(&entry);
@@ -55,58 +356,279 @@ Status pack_mode(){
 
     /// Possible use of Archiver with Explorer
     Status status = Success;
-    auto archive = Archiver(explorer, std::move(libarchive));
+    try{
+        std::unique_ptr<Archiver> archive;
+        if(!cli.output.empty() && cli.output != "-"){
+            archive = std::make_unique<Archiver>(cli.output, std::move(libarchive), options);
+            status = archive->ArchiveItem(entry);
+        } else {
+            archive = std::make_unique<Archiver>(explorer, std::move(libarchive), options);
+        }
+        Status finishStatus = archive->Finish();
+        status = status == Success ? finishStatus : status;
+        if(!cli.stats.empty()){
+            print_stats("pack", archive->GetStats());
+        }
+    } catch (const std::runtime_error& e) {
+        std::cout << e.what() << std::endl;
+        status = CannotOpenFile;
+    }
+    if(options.outputFd >= 0){
+        close(options.outputFd);
+    }
 
     /// Possible use of Archiver without Explorer
-    // auto archive = new Archiver(DEFAULT_ARCHIVE_NAME, std::move(libarchive));
+    // auto archive = new Archiver(DEFAULT_ARCHIVE_NAME + CodecExtension(options.codec), std::move(libarchive), options);
     // Status status = archive->ArchiveItem(entry);
     // delete archive;
 
     return status;
 }
 
+/**
+ * @brief Archiver settings for reading file_name, "-" reads the archive from stdin.
+ */
+ArchiverOptions input_options(const std::string& file_name, const CliOptions& options){
+    ArchiverOptions archiver = options.archiver;
+    if(file_name == "-"){
+        archiver.inputFd = STDIN_FILENO;
+    }
+    return archiver;
+}
+
 /**
  * @brief Unpacks the contents of an archive file.
  * 
  * This function initializes an Archiver object and uses it to extract the 
  * contents of the specified archive file.
  * 
- * @param file_name The name of the archive file to be unpacked.
+ * @param file_name The name of the archive file to be unpacked, "-" for stdin.
+ * @param options Extraction settings, e.g. the number of writer threads, and
+ *        the single entry to restore from a seekable archive.
  * @return Status The result of the extraction operation.
  */
-Status unpack_mode(std::string file_name){
+Status unpack_mode(std::string file_name, const CliOptions& options){
     auto libarchive = std::make_unique<LibArchiveWrapper>();
-    auto archive = Archiver(std::move(libarchive));
-    return archive.Extract(file_name);
+    auto archive = Archiver(std::move(libarchive), input_options(file_name, options));
+    Status status = options.path.empty() ? archive.Extract(file_name)
+        : archive.ExtractPath(file_name, options.path, options.directory);
+    if(!options.stats.empty()){
+        print_stats("unpack", archive.GetStats());
+    }
+    return status;
+}
+
+/**
+ * @brief Runs one job of a batch: archives a directory or file into an
+ *        archive file, or extracts an archive into a directory.
+ *
+ * @param stats Format of the statistics printed when done, empty for none.
+ */
+Status run_job(const Job& job, const std::string& stats){
+    static std::mutex statsMutex;
+    Status status = Success;
+    try{
+        auto libarchive = std::make_unique<LibArchiveWrapper>();
+        if(job.kind == JobKind::Pack){
+            std::error_code ec;
+            std::filesystem::directory_entry entry(job.source, ec);
+            if(ec || !entry.exists()){
+                error_print("Nothing to archive at", job.source);
+                return NotFound;
+            }
+            Archiver archive(job.target, std::move(libarchive), job.options);
+            status = archive.ArchiveItem(entry);
+            Status finishStatus = archive.Finish();
+            status = status == Success ? finishStatus : status;
+            if(!stats.empty()){
+                std::lock_guard<std::mutex> lock(statsMutex);
+                print_stats("pack", archive.GetStats());
+            }
+        } else {
+            Archiver archive(std::move(libarchive), job.options);
+            status = archive.Extract(job.source);
+            if(!stats.empty()){
+                std::lock_guard<std::mutex> lock(statsMutex);
+                print_stats("unpack", archive.GetStats());
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        error_print(e.what());
+        status = CannotOpenFile;
+    }
+    return status;
+}
+
+/**
+ * @brief Runs the jobs of a manifest concurrently under the thread budget
+ *        given with -j and prints the status of each job as it completes.
+ *
+ * @return Success if every job succeeded, otherwise the status of the first
+ *         failed job in manifest order, or the error of reading the manifest.
+ */
+Status batch_mode(const CliOptions& cli){
+    std::vector<Job> jobs;
+    Status status = ParseJobManifest(cli.batch, cli.archiver, jobs);
+    if(status != Success){
+        std::cerr << "Cannot use job manifest " << cli.batch << std::endl;
+        return status;
+    }
+    JobRunner runner(cli.archiver.threads, cli.parallel);
+    std::vector<Status> statuses = runner.Run(jobs, [&cli](const Job& job) {
+        return run_job(job, cli.stats);
+    }, [&jobs](size_t index, Status status) {
+        const Job& job = jobs[index];
+        std::cout << "job " << index + 1 << " " << (job.kind == JobKind::Pack ? "pack " : "unpack ")
+                  << job.source << " -> " << job.target << ": " << StatusName(status) << std::endl;
+    });
+    status = JobRunner::Aggregate(statuses);
+    size_t failed = std::count_if(statuses.begin(), statuses.end(), [](Status s) { return s != Success; });
+    std::cout << jobs.size() - failed << " of " << jobs.size() << " jobs finished with success" << std::endl;
+    return status;
+}
+
+/**
+ * @brief Formats the file type and permission bits like ls -l.
+ */
+std::string mode_string(unsigned int mode){
+    std::string text = S_ISDIR(mode) ? "d" : S_ISLNK(mode) ? "l" : "-";
+    const char* bits = "rwxrwxrwx";
+    for(int i = 0; i < 9; i++){
+        text += (mode & (0400 >> i)) ? bits[i] : '-';
+    }
+    return text;
+}
+
+/**
+ * @brief Escapes a string for use inside a JSON string literal.
+ */
+std::string json_escape(const std::string& text){
+    std::string escaped;
+    for(unsigned char c : text){
+        if(c == '"' || c == '\\'){
+            escaped += '\\';
+            escaped += c;
+        } else if(c < 0x20){
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/**
+ * @brief Prints the entries of an archive as they are read.
+ *
+ * Text output has one entry per line in ls -l style; JSON output has one
+ * object per line, so listings of any size can be consumed as a stream.
+ *
+ * @param file_name The name of the archive file to be listed, "-" for stdin.
+ * @param options Output format.
+ * @return Status The result of the listing.
+ */
+Status list_mode(std::string file_name, const CliOptions& options){
+    auto libarchive = std::make_unique<LibArchiveWrapper>();
+    auto archive = Archiver(std::move(libarchive), input_options(file_name, options));
+    return archive.List(file_name, [&options](const ArchiveListEntry& entry){
+        time_t seconds = static_cast<time_t>(entry.mtime / 1000000000LL);
+        if(options.json){
+            std::cout << "{\"path\":\"" << json_escape(entry.path) << "\",\"size\":" << entry.size
+                      << ",\"mode\":" << entry.mode << ",\"mtime\":" << seconds << "}\n";
+            return;
+        }
+        char date[32];
+        struct tm local;
+        localtime_r(&seconds, &local);
+        strftime(date, sizeof(date), "%Y-%m-%d %H:%M", &local);
+        std::cout << mode_string(entry.mode) << " " << std::setw(12) << entry.size << " " << date << " " << entry.path << "\n";
+    });
+}
+
+/**
+ * @brief Checks an archive against the checksums recorded when it was
+ *        written and prints every file that fails.
+ *
+ * @param file_name The name of the archive file to be verified, "-" for stdin.
+ * @param options Hashing threads and the statistics format.
+ * @return Status The result of the verification.
+ */
+Status verify_mode(std::string file_name, const CliOptions& options){
+    auto libarchive = std::make_unique<LibArchiveWrapper>();
+    auto archive = Archiver(std::move(libarchive), input_options(file_name, options));
+    VerifyResult result;
+    Status status = archive.Verify(file_name, result);
+    for(const auto& path : result.mismatched){
+        std::cout << "MISMATCH " << path << "\n";
+    }
+    for(const auto& path : result.missing){
+        std::cout << "MISSING " << path << "\n";
+    }
+    for(const auto& path : result.unrecorded){
+        std::cout << "UNRECORDED " << path << "\n";
+    }
+    if(status == NotFound){
+        std::cout << file_name << " has no checksums, it was written without them or by another tool" << std::endl;
+    } else if(status == Success || status == ChecksumMismatch){
+        std::cout << result.verified << " of " << result.files << " files verified, " << result.mismatched.size()
+                  << " mismatched, " << result.missing.size() << " missing" << std::endl;
+    } else {
+        std::cout << "Failed to verify " << file_name << ": " << StatusName(status) << std::endl;
+    }
+    if(!options.stats.empty()){
+        print_stats("verify", archive.GetStats());
+    }
+    return status;
 }
 
 int
 main(int argc, char** argv){
     Modes mode = UNDEFINED;
-    Status stat = Success;
+    CliOptions options;
+    Status stat = parse_args(argc, argv, options);
 
-    if (argc > MAX_PARAM_NUMBERS) {
-        debug_print("Too many arguments");
-        stat = TooManyArgs;
-    } else if(argc == MAX_PARAM_NUMBERS) {
+    if (stat != Success) {
+        mode = UNDEFINED;
+    } else if(!options.batch.empty() && options.positional.empty()) {
+        mode = BATCH;
+        info_print("Batch mode");
+    } else if(options.list && options.positional.size() == MAX_POSITIONAL_PARAMS) {
+        mode = LIST;
+    } else if(options.verify && options.positional.size() == MAX_POSITIONAL_PARAMS) {
+        mode = VERIFY;
+    } else if(options.positional.size() == MAX_POSITIONAL_PARAMS) {
         mode = UNPACK;
-        debug_print("Unpack mode");
+        info_print("Unpack mode");
     } else {
         mode = PACK;
-        debug_print("Pack mode");
+        info_print("Pack mode");
     }
 
     
     switch (mode)
     {
     case PACK:
-        stat = pack_mode();
+        stat = pack_mode(options);
         stat == Success ? std::cout << "All files archive sucesfully" << std::endl : std::cout << "Something went wrong. Please verify result" <<  std::endl;
         break;
     case UNPACK:
-        unpack_mode(argv[1]);
+        stat = unpack_mode(options.positional[0], options);
         stat == Success ? std::cout << "Files restoring finished with success" << std::endl : std::cout << "Something went wrong. Please verify result" <<  std::endl;
         break;
+    case LIST:
+        stat = list_mode(options.positional[0], options);
+        if(stat != Success){
+            std::cerr << "Failed to list " << options.positional[0] << std::endl;
+        }
+        break;
+    case BATCH:
+        stat = batch_mode(options);
+        break;
+    case VERIFY:
+        stat = verify_mode(options.positional[0], options);
+        break;
     default:
         print_help();
         break;
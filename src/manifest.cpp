@@ -0,0 +1,233 @@
+#include "manifest.h"
+#include "xxhash64.h"
+#include "logs.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MANIFEST_MAGIC "BTTFMAN1"
+#define MANIFEST_VERSION 1
+
+namespace {
+
+/* On-disk layout, all fields little endian. */
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t count;
+    uint64_t pathsSize;
+};
+
+struct Record {
+    uint64_t pathHash;
+    uint64_t pathOffset;
+    uint32_t pathLength;
+    uint32_t reserved;
+    uint64_t size;
+    int64_t mtime;
+    uint64_t inode;
+    uint64_t contentHash;
+};
+
+static_assert(sizeof(Header) == 32, "unexpected manifest header layout");
+static_assert(sizeof(Record) == 56, "unexpected manifest record layout");
+
+uint64_t PathHash(std::string_view path){
+    return Xxh64::Hash(path.data(), path.size());
+}
+
+} // namespace
+
+/**
+ * @class Manifest::Impl
+ * @brief Holds the mapping of a manifest file.
+ */
+class Manifest::Impl {
+public:
+    ~Impl() {
+        if(Address != nullptr){
+            munmap(Address, Length);
+        }
+    }
+
+    void* Address = nullptr;
+    size_t Length = 0;
+    const Record* Records = nullptr;
+    size_t Count = 0;
+    const char* Paths = nullptr;
+
+    ManifestEntry ToEntry(const Record& record) const {
+        ManifestEntry entry;
+        entry.path = std::string_view(Paths + record.pathOffset, record.pathLength);
+        entry.size = record.size;
+        entry.mtime = record.mtime;
+        entry.inode = record.inode;
+        entry.contentHash = record.contentHash;
+        return entry;
+    }
+};
+
+Manifest::Manifest() : pImpl(std::make_unique<Impl>()) {}
+
+Manifest::~Manifest() = default;
+
+/**
+ * @brief Maps a manifest file written by ManifestWriter.
+ * @return The manifest, or nullptr if the file is missing or malformed.
+ */
+std::unique_ptr<Manifest> Manifest::Open(const std::string& filename){
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0){
+        error_print("Cannot open manifest", filename);
+        return nullptr;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)){
+        close(fd);
+        error_print("Manifest too short", filename);
+        return nullptr;
+    }
+
+    void* address = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(address == MAP_FAILED){
+        error_print("Cannot map manifest", filename);
+        return nullptr;
+    }
+
+    std::unique_ptr<Manifest> manifest(new Manifest());
+    manifest->pImpl->Address = address;
+    manifest->pImpl->Length = st.st_size;
+
+    const Header* header = static_cast<const Header*>(address);
+    size_t recordsSize = header->count * sizeof(Record);
+    if(memcmp(header->magic, MANIFEST_MAGIC, sizeof(header->magic)) != 0
+        || header->version != MANIFEST_VERSION
+        || header->recordSize != sizeof(Record)
+        || header->count > (st.st_size - sizeof(Header)) / sizeof(Record)
+        || header->pathsSize != st.st_size - sizeof(Header) - recordsSize){
+        error_print("Malformed manifest", filename);
+        return nullptr;
+    }
+    /* Find and At trust the path of every record to lie inside the blob */
+    const Record* records = reinterpret_cast<const Record*>(static_cast<const char*>(address) + sizeof(Header));
+    for(size_t i = 0; i < header->count; i++){
+        if(records[i].pathOffset > header->pathsSize || records[i].pathLength > header->pathsSize - records[i].pathOffset){
+            error_print("Malformed manifest", filename);
+            return nullptr;
+        }
+    }
+    madvise(address, st.st_size, MADV_RANDOM);
+
+    manifest->pImpl->Records = records;
+    manifest->pImpl->Count = header->count;
+    manifest->pImpl->Paths = static_cast<const char*>(address) + sizeof(Header) + recordsSize;
+    return manifest;
+}
+
+size_t Manifest::Size() const {
+    return pImpl->Count;
+}
+
+/**
+ * @brief Looks up a path.
+ * @param path Path inside the archive.
+ * @param entry Receives the recorded state if found.
+ * @param index Receives the position of the entry, usable with At().
+ * @return true if the path is recorded in the manifest.
+ */
+bool Manifest::Find(std::string_view path, ManifestEntry& entry, size_t& index) const {
+    uint64_t hash = PathHash(path);
+    const Record* begin = pImpl->Records;
+    const Record* end = begin + pImpl->Count;
+    const Record* it = std::lower_bound(begin, end, hash, [](const Record& record, uint64_t value) {
+        return record.pathHash < value;
+    });
+    for(; it != end && it->pathHash == hash; ++it){
+        if(std::string_view(pImpl->Paths + it->pathOffset, it->pathLength) == path){
+            entry = pImpl->ToEntry(*it);
+            index = static_cast<size_t>(it - begin);
+            return true;
+        }
+    }
+    return false;
+}
+
+ManifestEntry Manifest::At(size_t index) const {
+    return pImpl->ToEntry(pImpl->Records[index]);
+}
+
+/**
+ * @class ManifestWriter::Impl
+ * @brief Record buffer and path blob of a manifest being built.
+ */
+class ManifestWriter::Impl {
+public:
+    std::vector<Record> Records;
+    std::string Paths;
+};
+
+ManifestWriter::ManifestWriter() : pImpl(std::make_unique<Impl>()) {}
+
+ManifestWriter::~ManifestWriter() = default;
+
+void ManifestWriter::Add(const ManifestEntry& entry){
+    Record record = {};
+    record.pathHash = PathHash(entry.path);
+    record.pathOffset = pImpl->Paths.size();
+    record.pathLength = static_cast<uint32_t>(entry.path.size());
+    record.size = entry.size;
+    record.mtime = entry.mtime;
+    record.inode = entry.inode;
+    record.contentHash = entry.contentHash;
+    pImpl->Paths.append(entry.path);
+    pImpl->Records.push_back(record);
+}
+
+/**
+ * @brief Sorts the collected entries and writes the manifest.
+ *
+ * The file is written under a temporary name and renamed into place, so an
+ * interrupted run never leaves a truncated manifest behind.
+ *
+ * @return Success, or WriteFailed if the file could not be written.
+ */
+Status ManifestWriter::Write(const std::string& filename){
+    auto& records = pImpl->Records;
+    const std::string& paths = pImpl->Paths;
+    std::sort(records.begin(), records.end(), [&paths](const Record& a, const Record& b) {
+        if(a.pathHash != b.pathHash){
+            return a.pathHash < b.pathHash;
+        }
+        return paths.compare(a.pathOffset, a.pathLength, paths, b.pathOffset, b.pathLength) < 0;
+    });
+
+    Header header = {};
+    memcpy(header.magic, MANIFEST_MAGIC, sizeof(header.magic));
+    header.version = MANIFEST_VERSION;
+    header.recordSize = sizeof(Record);
+    header.count = records.size();
+    header.pathsSize = paths.size();
+
+    std::string temporary = filename + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if(file == nullptr){
+        error_print("Cannot create manifest", temporary);
+        return WriteFailed;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && (records.empty() || fwrite(records.data(), sizeof(Record), records.size(), file) == records.size());
+    ok = ok && (paths.empty() || fwrite(paths.data(), 1, paths.size(), file) == paths.size());
+    ok = (fclose(file) == 0) && ok;
+    if(!ok || rename(temporary.c_str(), filename.c_str()) != 0){
+        error_print("Failed to write manifest", filename);
+        unlink(temporary.c_str());
+        return WriteFailed;
+    }
+    return Success;
+}
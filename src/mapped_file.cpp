@@ -0,0 +1,48 @@
+#include "mapped_file.h"
+#include "logs.h"
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+std::shared_ptr<MappedFile> MappedFile::Map(int fd, uint64_t size){
+    struct stat st;
+    if(size == 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)){
+        return nullptr;
+    }
+
+    void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(address == MAP_FAILED){
+        warning_print("mmap failed, falling back to buffered read");
+        return nullptr;
+    }
+    madvise(address, size, MADV_SEQUENTIAL);
+
+    int ownFd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if(ownFd < 0){
+        munmap(address, size);
+        return nullptr;
+    }
+    return std::shared_ptr<MappedFile>(new MappedFile(ownFd, static_cast<const char*>(address), size));
+}
+
+MappedFile::MappedFile(int fd, const char* address, uint64_t length)
+    : Fd(fd), Address(address), Length(length) {}
+
+MappedFile::~MappedFile(){
+    munmap(const_cast<char*>(Address), Length);
+    close(Fd);
+}
+
+uint64_t MappedFile::Readable(uint64_t offset, uint64_t length) const {
+    struct stat st;
+    if(fstat(Fd, &st) != 0){
+        return 0;
+    }
+    uint64_t end = std::min<uint64_t>(Length, static_cast<uint64_t>(st.st_size));
+    if(offset >= end){
+        return 0;
+    }
+    return std::min(length, end - offset);
+}
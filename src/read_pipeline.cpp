@@ -0,0 +1,554 @@
+#include "read_pipeline.h"
+#include "spsc_queue.h"
+#include "xxhash64.h"
+#include "io_ring.h"
+#include "logs.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <cerrno>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @class ReadPipeline::Impl
+ * @brief Owns the buffer pool, the two SPSC queues and the reader thread.
+ *
+ * Chunks flow from the reader to the consumer through Chunks, emptied buffer
+ * slots flow back through FreeBuffers. Each queue therefore has exactly one
+ * producer and one consumer: slots the reader takes but does not publish,
+ * after a failed read, go to its own SpareBuffers list instead of back into
+ * FreeBuffers.
+ */
+class ReadPipeline::Impl {
+public:
+    Impl(FileSource source, bool ioRing, LinkTable* links, uint64_t prefetchBytes)
+        : Source(std::move(source)), Links(links), PrefetchBytes(prefetchBytes) {
+        Buffers.resize(PIPELINE_BUFFER_COUNT);
+        for(size_t i = 0; i < Buffers.size(); i++){
+            Buffers[i].resize(PIPELINE_BUFFER_SIZE);
+            FreeBuffers.TryPush(size_t(i));
+        }
+        if(ioRing){
+            SetUpRing();
+        }
+        Reader = std::thread(&Impl::ReaderLoop, this);
+    }
+
+    /**
+     * @brief Stops the reader thread.
+     *
+     * If the consumer bailed out early the reader may be waiting for a free
+     * buffer or for room in the queue, so pending chunks are drained until
+     * the thread has finished.
+     */
+    ~Impl() {
+        Stop = true;
+        FileChunk chunk;
+        while(!ReaderDone){
+            if(Chunks.TryPop(chunk)){
+                Release(chunk);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        Reader.join();
+    }
+
+    /**
+     * @brief Waits for the next chunk produced by the reader.
+     * @param chunk Receives the chunk.
+     * @return false once the stream is finished.
+     */
+    bool Next(FileChunk& chunk){
+        if(Finished){
+            return false;
+        }
+        Chunks.Pop(chunk);
+        if(chunk.kind == FileChunk::Finished){
+            Finished = true;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Returns the buffer of a Data chunk to the pool.
+     */
+    void Release(const FileChunk& chunk){
+        if(chunk.kind == FileChunk::Data && chunk.buffer != FileChunk::NoBuffer){
+            FreeBuffers.Push(chunk.buffer);
+        }
+    }
+
+private:
+    /* A file taken from the source and opened ahead of being read. */
+    struct PendingFile {
+        std::string path;
+        int fd = -1;
+        struct stat st;
+        /* bytes hinted to the kernel, counted in WindowBytes */
+        uint64_t hinted = 0;
+    };
+
+    FileSource Source;
+    LinkTable* Links;
+    uint64_t PrefetchBytes;
+    std::deque<PendingFile> Window;
+    uint64_t WindowBytes = 0;
+    bool SourceDone = false;
+    std::vector<std::vector<char>> Buffers;
+    SpscQueue<FileChunk, 4 * PIPELINE_BUFFER_COUNT> Chunks;
+    SpscQueue<size_t, PIPELINE_BUFFER_COUNT> FreeBuffers;
+    /* slots the reader took but did not publish; only touched by the reader thread */
+    std::vector<size_t> SpareBuffers;
+    std::thread Reader;
+    std::unique_ptr<IoRing> Ring;
+    bool RingFixed = false;
+    std::atomic<bool> Stop{false};
+    std::atomic<bool> ReaderDone{false};
+    bool Finished = false;
+
+    /**
+     * @brief Body of the reader thread.
+     */
+    void ReaderLoop(){
+        try {
+            while(!Stop){
+                FillWindow();
+                if(Window.empty()){
+                    break;
+                }
+                PendingFile file = std::move(Window.front());
+                Window.pop_front();
+                WindowBytes -= file.hinted;
+                if(!ReadFile(file)){
+                    break;
+                }
+            }
+        } catch (const std::exception& e) {
+            error_print("Reader stage failed:", e.what());
+        }
+        for(auto& file : Window){
+            CloseFd(file.fd);
+        }
+        Window.clear();
+
+        FileChunk finished;
+        finished.kind = FileChunk::Finished;
+        Publish(std::move(finished));
+        ReaderDone = true;
+    }
+
+    /**
+     * @brief Opens upcoming files until the window holds PrefetchBytes.
+     *
+     * At least one file is taken when the window is empty. Each file is
+     * hinted from its start, a large one only up to the room left.
+     */
+    void FillWindow(){
+        while(!SourceDone && Window.size() < PREFETCH_WINDOW_FILES && (Window.empty() || WindowBytes < PrefetchBytes)){
+            PendingFile file;
+            if(!Source(file.path)){
+                SourceDone = true;
+                break;
+            }
+            file.fd = open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+            if(file.fd >= 0 && fstat(file.fd, &file.st) != 0){
+                CloseFd(file.fd);
+                file.fd = -1;
+            }
+            if(file.fd >= 0 && S_ISREG(file.st.st_mode) && WindowBytes < PrefetchBytes){
+                file.hinted = std::min<uint64_t>(file.st.st_size, PrefetchBytes - WindowBytes);
+                if(file.hinted > 0){
+                    posix_fadvise(file.fd, 0, file.hinted, POSIX_FADV_WILLNEED);
+                }
+                WindowBytes += file.hinted;
+            }
+            Window.push_back(std::move(file));
+        }
+    }
+
+    /**
+     * @brief Reads one file and publishes its Begin, Data and End chunks.
+     * @return false if the pipeline is being torn down.
+     */
+    bool ReadFile(const PendingFile& file){
+        const std::string& path = file.path;
+        FileChunk begin;
+        begin.kind = FileChunk::Begin;
+        begin.path = path;
+        FileChunk end;
+        end.kind = FileChunk::End;
+
+        int fd = file.fd;
+        const struct stat& st = file.st;
+        bool linked = false;
+        if(fd < 0){
+            error_print("Error opening file:", path);
+            end.status = WriteFailed;
+        } else {
+            begin.size = S_ISREG(st.st_mode) ? static_cast<uint64_t>(st.st_size) : 0;
+            begin.mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+            begin.inode = st.st_ino;
+            if(Links != nullptr && S_ISREG(st.st_mode) && st.st_nlink > 1){
+                if(Links->Find(st.st_dev, st.st_ino, begin.linkTarget, end.contentHash)){
+                    CloseFd(fd);
+                    return Publish(std::move(begin)) && Publish(std::move(end));
+                }
+                linked = true;
+            }
+            begin.sparse = FindDataRegions(fd, st, begin.regions);
+        }
+        uint64_t size = begin.size;
+        std::vector<SparseRegion> regions;
+        bool sparse = begin.sparse;
+        if(sparse){
+            regions = begin.regions;
+        }
+        if(!Publish(std::move(begin))){
+            CloseFd(fd);
+            return false;
+        }
+
+        bool running = true;
+        if(end.status == Success){
+            std::shared_ptr<MappedFile> mapping;
+            if(!sparse && size >= MMAP_THRESHOLD){
+                mapping = MappedFile::Map(fd, size);
+            }
+            Xxh64 hash;
+            if(sparse){
+                running = ReadSparse(fd, size, regions, path, end.status, hash);
+            } else if(mapping){
+                running = ReadMapped(mapping, path, end.status, hash);
+            } else if(Ring && size > 0){
+                running = ReadRing(fd, size, path, end.status, hash);
+            } else {
+                running = ReadBuffered(fd, size, path, end.status, hash);
+            }
+            end.contentHash = hash.Digest();
+            /* later links only point here once the data is read; otherwise the next one carries it */
+            if(linked && running && end.status == Success){
+                Links->Add(st.st_dev, st.st_ino, path);
+                Links->SetContentHash(st.st_dev, st.st_ino, end.contentHash);
+            }
+        }
+        CloseFd(fd);
+
+        return running && Publish(std::move(end));
+    }
+
+    /**
+     * @brief Publishes a mapped file as MMAP_SLICE_SIZE slices of the mapping.
+     *
+     * A file that shrinks while being archived ends early with WriteFailed;
+     * libarchive pads the entry up to the size announced in its header.
+     *
+     * @return false if the pipeline is being torn down.
+     */
+    bool ReadMapped(const std::shared_ptr<MappedFile>& mapping, const std::string& path, Status& status, Xxh64& hash){
+        for(uint64_t offset = 0; offset < mapping->Size();){
+            uint64_t length = mapping->Readable(offset, MMAP_SLICE_SIZE);
+            if(length == 0){
+                error_print("File shrank while reading:", path);
+                status = WriteFailed;
+                break;
+            }
+            hash.Update(mapping->Data() + offset, length);
+            FileChunk data;
+            data.kind = FileChunk::Data;
+            data.data = mapping->Data() + offset;
+            data.size = length;
+            data.mapping = mapping;
+            if(!Publish(std::move(data))){
+                return false;
+            }
+            offset += length;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads a small or unmappable file into pooled buffers.
+     *
+     * Only the size announced in the header is read, so data appended
+     * meanwhile stays out of the entry and its hash; a file that shrank
+     * ends early with WriteFailed.
+     *
+     * @return false if the pipeline is being torn down.
+     */
+    bool ReadBuffered(int fd, uint64_t size, const std::string& path, Status& status, Xxh64& hash){
+        for(uint64_t offset = 0; offset < size;){
+            size_t slot;
+            if(!AcquireBuffer(slot)){
+                return false;
+            }
+            std::vector<char>& buffer = Buffers[slot];
+            ssize_t bytesRead = read(fd, buffer.data(), std::min<uint64_t>(buffer.size(), size - offset));
+            if(bytesRead < 0 && errno == EINTR){
+                SpareBuffers.push_back(slot);
+                continue;
+            }
+            if(bytesRead <= 0){
+                SpareBuffers.push_back(slot);
+                error_print(bytesRead < 0 ? "Error reading file:" : "File shrank while reading:", path);
+                status = WriteFailed;
+                return true;
+            }
+            offset += bytesRead;
+            hash.Update(buffer.data(), bytesRead);
+            FileChunk data;
+            data.kind = FileChunk::Data;
+            data.data = buffer.data();
+            data.size = static_cast<uint64_t>(bytesRead);
+            data.buffer = slot;
+            if(!Publish(std::move(data))){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads the data regions of a sparse file into pooled buffers.
+     *
+     * Holes are not read; they only enter the content hash, as zeros.
+     *
+     * @return false if the pipeline is being torn down.
+     */
+    bool ReadSparse(int fd, uint64_t size, const std::vector<SparseRegion>& regions, const std::string& path, Status& status, Xxh64& hash){
+        uint64_t hashed = 0;
+        for(const auto& region : regions){
+            HashZeros(hash, region.offset - hashed);
+            uint64_t offset = region.offset;
+            uint64_t end = region.offset + region.length;
+            while(offset < end){
+                size_t slot;
+                if(!AcquireBuffer(slot)){
+                    return false;
+                }
+                std::vector<char>& buffer = Buffers[slot];
+                ssize_t bytesRead = pread(fd, buffer.data(), std::min<uint64_t>(buffer.size(), end - offset), offset);
+                if(bytesRead < 0 && errno == EINTR){
+                    SpareBuffers.push_back(slot);
+                    continue;
+                }
+                if(bytesRead <= 0){
+                    SpareBuffers.push_back(slot);
+                    error_print(bytesRead < 0 ? "Error reading file:" : "File shrank while reading:", path);
+                    status = WriteFailed;
+                    return true;
+                }
+                hash.Update(buffer.data(), bytesRead);
+                FileChunk data;
+                data.kind = FileChunk::Data;
+                data.data = buffer.data();
+                data.size = static_cast<uint64_t>(bytesRead);
+                data.offset = offset;
+                data.buffer = slot;
+                if(!Publish(std::move(data))){
+                    return false;
+                }
+                offset += bytesRead;
+            }
+            hashed = end;
+        }
+        HashZeros(hash, size - hashed);
+        return true;
+    }
+
+    static void HashZeros(Xxh64& hash, uint64_t length){
+        while(length > 0){
+            size_t step = std::min<uint64_t>(length, SPARSE_ZEROS_SIZE);
+            hash.Update(SparseZeros(), step);
+            length -= step;
+        }
+    }
+
+    /**
+     * @brief Creates the ring and registers the buffer pool with it.
+     */
+    void SetUpRing(){
+        Ring = IoRing::Create(2 * RING_PIPELINE_DEPTH);
+        if(Ring == nullptr){
+            return;
+        }
+        std::vector<struct iovec> iovecs;
+        for(auto& buffer : Buffers){
+            iovecs.push_back({buffer.data(), buffer.size()});
+        }
+        RingFixed = Ring->RegisterBuffers(iovecs);
+    }
+
+    /* A pooled buffer being filled by the ring. */
+    struct RingRead {
+        size_t slot;
+        unsigned length;
+        int result;
+        bool complete;
+    };
+
+    /**
+     * @brief Reads a file of known size with several reads in flight.
+     *
+     * Reads are issued for consecutive blocks as long as free buffers and
+     * ring depth allow, and published strictly in file order. A file that
+     * shrinks ends early with WriteFailed, like a mapped file, and so does
+     * one whose reads cannot be queued RING_QUEUE_ATTEMPTS times in a row.
+     *
+     * @return false if the pipeline is being torn down.
+     */
+    bool ReadRing(int fd, uint64_t size, const std::string& path, Status& status, Xxh64& hash){
+        std::deque<RingRead> reads;
+        uint64_t offset = 0;
+        bool running = true;
+        unsigned queueFailures = 0;
+        while(running && status == Success && (offset < size || !reads.empty())){
+            size_t slot;
+            bool queueFailed = false;
+            while(offset < size && reads.size() < RING_PIPELINE_DEPTH && TryAcquireBuffer(slot)){
+                unsigned length = static_cast<unsigned>(std::min<uint64_t>(PIPELINE_BUFFER_SIZE, size - offset));
+                if(!Ring->QueueRead(fd, Buffers[slot].data(), length, offset, RingFixed ? static_cast<int>(slot) : -1, slot)){
+                    SpareBuffers.push_back(slot);
+                    queueFailed = true;
+                    break;
+                }
+                reads.push_back(RingRead{slot, length, 0, false});
+                offset += length;
+                queueFailures = 0;
+            }
+            if(reads.empty() && queueFailed){
+                /* nothing in flight to make room; flush the ring and retry a few times */
+                if(++queueFailures >= RING_QUEUE_ATTEMPTS || !Ring->Submit(0)){
+                    error_print("Cannot queue read of", path);
+                    status = WriteFailed;
+                    break;
+                }
+                continue;
+            }
+            if(reads.empty()){
+                /* all buffers are with the consumer; wait for one without handing it back */
+                running = AcquireBuffer(slot);
+                if(running){
+                    SpareBuffers.push_back(slot);
+                }
+                continue;
+            }
+            if(!Ring->Submit(0) || !WaitRingRead(reads, reads.front())){
+                status = WriteFailed;
+                break;
+            }
+
+            RingRead read = reads.front();
+            reads.pop_front();
+            if(read.result != static_cast<int>(read.length)){
+                error_print(read.result < 0 ? "Error reading file:" : "File shrank while reading:", path);
+                status = WriteFailed;
+                SpareBuffers.push_back(read.slot);
+                break;
+            }
+            hash.Update(Buffers[read.slot].data(), read.length);
+            FileChunk data;
+            data.kind = FileChunk::Data;
+            data.data = Buffers[read.slot].data();
+            data.size = read.length;
+            data.buffer = read.slot;
+            running = Publish(std::move(data));
+        }
+
+        /* buffers must not be reused while the kernel may still fill them */
+        for(auto& read : reads){
+            if(!read.complete){
+                WaitRingRead(reads, read);
+            }
+            SpareBuffers.push_back(read.slot);
+        }
+        return running;
+    }
+
+    /**
+     * @brief Reaps completions until target has completed.
+     */
+    bool WaitRingRead(std::deque<RingRead>& reads, const RingRead& target){
+        while(!target.complete){
+            uint64_t tag;
+            int result;
+            if(!Ring->WaitCompletion(tag, result)){
+                return false;
+            }
+            for(auto& read : reads){
+                if(read.slot == tag){
+                    read.result = result;
+                    read.complete = true;
+                }
+            }
+        }
+        return true;
+    }
+
+    static void CloseFd(int fd){
+        if(fd >= 0){
+            close(fd);
+        }
+    }
+
+    /**
+     * @brief Takes a free buffer slot without waiting, spare slots first.
+     * @return false if every buffer is with the consumer.
+     */
+    bool TryAcquireBuffer(size_t& slot){
+        if(!SpareBuffers.empty()){
+            slot = SpareBuffers.back();
+            SpareBuffers.pop_back();
+            return true;
+        }
+        return FreeBuffers.TryPop(slot);
+    }
+
+    /**
+     * @brief Takes a free buffer slot, waiting for the consumer if needed.
+     * @return false if the pipeline is being torn down.
+     */
+    bool AcquireBuffer(size_t& slot){
+        typename decltype(FreeBuffers)::Backoff backoff;
+        while(!TryAcquireBuffer(slot)){
+            if(Stop){
+                return false;
+            }
+            backoff.Wait();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Hands a chunk to the consumer, waiting for room if needed.
+     * @return false if the pipeline is being torn down.
+     */
+    bool Publish(FileChunk&& chunk){
+        typename decltype(Chunks)::Backoff backoff;
+        while(!Chunks.TryPush(std::move(chunk))){
+            if(Stop){
+                return false;
+            }
+            backoff.Wait();
+        }
+        return true;
+    }
+};
+
+ReadPipeline::ReadPipeline(FileSource source, bool ioRing, LinkTable* links, uint64_t prefetchBytes)
+    : pImpl(std::make_unique<Impl>(std::move(source), ioRing, links, prefetchBytes)) {}
+
+ReadPipeline::~ReadPipeline() = default;
+
+bool ReadPipeline::Next(FileChunk& chunk) {
+    return pImpl->Next(chunk);
+}
+
+void ReadPipeline::Release(const FileChunk& chunk) {
+    pImpl->Release(chunk);
+}
@@ -0,0 +1,182 @@
+#include "seekable.h"
+#include "logs.h"
+#include <cstring>
+#include <vector>
+#include <lzma.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Skippable frame magic accepted by both zstd and lz4. */
+#define SKIPPABLE_MAGIC 0x184D2A5Eu
+#define TRAILER_TAG "BTTF"
+#define TRAILER_VERSION 1
+#define XZ_FOOTER_SIZE LZMA_STREAM_HEADER_SIZE
+
+namespace {
+
+/* Trailing skippable frame of zstd and lz4 archives, all fields little endian. */
+struct Trailer {
+    uint32_t magic;
+    uint32_t size;
+    uint64_t tocOffset;
+    uint32_t version;
+    char tag[4];
+};
+
+/* Fixed part of a TOC record, followed by the path. */
+struct TocRecord {
+    uint64_t frameOffset;
+    uint64_t frameSize;
+    uint64_t size;
+    int64_t mtime;
+    uint32_t mode;
+    uint32_t pathLength;
+} __attribute__((packed));
+
+static_assert(sizeof(Trailer) == 24, "unexpected trailer layout");
+static_assert(sizeof(TocRecord) == 40, "unexpected TOC record layout");
+
+bool ReadAt(int fd, void* data, size_t length, uint64_t offset){
+    return pread(fd, data, length, offset) == static_cast<ssize_t>(length);
+}
+
+/**
+ * @brief Finds the last xz stream of the file from its footer and index.
+ */
+bool LocateLastXzStream(int fd, uint64_t fileSize, TocEntry& toc){
+    if(fileSize < 2 * XZ_FOOTER_SIZE){
+        return false;
+    }
+    uint8_t footer[XZ_FOOTER_SIZE];
+    lzma_stream_flags flags;
+    if(!ReadAt(fd, footer, sizeof(footer), fileSize - sizeof(footer))
+        || lzma_stream_footer_decode(&flags, footer) != LZMA_OK
+        || flags.backward_size > fileSize - sizeof(footer)){
+        return false;
+    }
+
+    std::vector<uint8_t> buffer(flags.backward_size);
+    if(!ReadAt(fd, buffer.data(), buffer.size(), fileSize - sizeof(footer) - buffer.size())){
+        return false;
+    }
+    lzma_index* index = nullptr;
+    uint64_t memlimit = UINT64_MAX;
+    size_t position = 0;
+    if(lzma_index_buffer_decode(&index, &memlimit, nullptr, buffer.data(), &position, buffer.size()) != LZMA_OK){
+        return false;
+    }
+    uint64_t streamSize = lzma_index_stream_size(index);
+    lzma_index_end(index, nullptr);
+    /* a single stream is a plain xz file, a seekable one has at least two frames */
+    if(streamSize >= fileSize){
+        return false;
+    }
+    toc.frameOffset = fileSize - streamSize;
+    toc.frameSize = streamSize;
+    return true;
+}
+
+} // namespace
+
+/**
+ * @brief Tells whether the codec can produce independently decodable frames
+ *        that standard tools read as a single stream.
+ */
+bool IsSeekableCodec(Codec codec){
+    return codec == Codec::Xz || codec == Codec::Zstd || codec == Codec::Lz4;
+}
+
+void AppendTocEntry(std::string& toc, const std::string& path, const TocEntry& entry){
+    TocRecord record;
+    record.frameOffset = entry.frameOffset;
+    record.frameSize = entry.frameSize;
+    record.size = entry.size;
+    record.mtime = entry.mtime;
+    record.mode = entry.mode;
+    record.pathLength = static_cast<uint32_t>(path.size());
+    toc.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    toc.append(path);
+}
+
+/**
+ * @brief Reads the record at position of a table of contents and moves past it.
+ * @return false at the end of the table or if it is truncated.
+ */
+bool NextTocEntry(const std::string& toc, size_t& position, std::string& path, TocEntry& entry){
+    TocRecord record;
+    if(position + sizeof(record) > toc.size()){
+        return false;
+    }
+    memcpy(&record, toc.data() + position, sizeof(record));
+    if(position + sizeof(record) + record.pathLength > toc.size()){
+        return false;
+    }
+    path.assign(toc, position + sizeof(record), record.pathLength);
+    position += sizeof(record) + record.pathLength;
+    entry.frameOffset = record.frameOffset;
+    entry.frameSize = record.frameSize;
+    entry.size = record.size;
+    entry.mtime = record.mtime;
+    entry.mode = record.mode;
+    return true;
+}
+
+/**
+ * @brief Looks up a path in a table of contents built with AppendTocEntry.
+ * @return false if the path is not listed or the table is truncated.
+ */
+bool FindTocEntry(const std::string& toc, const std::string& path, TocEntry& entry){
+    size_t position = 0;
+    std::string current;
+    while(NextTocEntry(toc, position, current, entry)){
+        if(current == path){
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Bytes appended after the last frame to locate the TOC frame.
+ *
+ * xz needs none, the last stream is found through its own footer.
+ */
+std::string SeekableTrailer(Codec codec, uint64_t tocOffset){
+    if(codec == Codec::Xz){
+        return std::string();
+    }
+    Trailer trailer;
+    trailer.magic = SKIPPABLE_MAGIC;
+    trailer.size = sizeof(Trailer) - 2 * sizeof(uint32_t);
+    trailer.tocOffset = tocOffset;
+    trailer.version = TRAILER_VERSION;
+    memcpy(trailer.tag, TRAILER_TAG, sizeof(trailer.tag));
+    return std::string(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+}
+
+/**
+ * @brief Finds the frame holding the table of contents of a seekable archive.
+ * @param fd The archive, opened for reading.
+ * @param toc Receives the compressed offset and size of the TOC frame.
+ * @return false if the file is not a seekable archive.
+ */
+bool LocateToc(int fd, TocEntry& toc){
+    struct stat st;
+    if(fstat(fd, &st) != 0){
+        return false;
+    }
+    uint64_t fileSize = st.st_size;
+
+    Trailer trailer;
+    if(fileSize >= sizeof(trailer) && ReadAt(fd, &trailer, sizeof(trailer), fileSize - sizeof(trailer))
+        && trailer.magic == SKIPPABLE_MAGIC && memcmp(trailer.tag, TRAILER_TAG, sizeof(trailer.tag)) == 0){
+        if(trailer.version != TRAILER_VERSION || trailer.tocOffset > fileSize - sizeof(trailer)){
+            error_print("Unsupported seekable trailer");
+            return false;
+        }
+        toc.frameOffset = trailer.tocOffset;
+        toc.frameSize = fileSize - sizeof(trailer) - trailer.tocOffset;
+        return true;
+    }
+    return LocateLastXzStream(fd, fileSize, toc);
+}
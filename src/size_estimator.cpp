@@ -0,0 +1,249 @@
+#include "size_estimator.h"
+#include "dir_walker.h"
+#include "logs.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * @brief Counters of one scan, updated by the scanning thread and read by
+ *        SizeEstimator::Get at any time.
+ */
+struct Progress {
+    std::atomic<uint64_t> files{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> sampleBytes{0};
+    std::atomic<uint64_t> sampleCompressed{0};
+    std::atomic<uint64_t> sampleNs{0};
+    std::atomic<bool> complete{false};
+    std::atomic<bool> cancelled{false};
+
+    SizeEstimate Snapshot() const {
+        SizeEstimate estimate;
+        estimate.files = files.load(std::memory_order_relaxed);
+        estimate.bytes = bytes.load(std::memory_order_relaxed);
+        estimate.sampleBytes = sampleBytes.load(std::memory_order_relaxed);
+        estimate.sampleCompressed = sampleCompressed.load(std::memory_order_relaxed);
+        estimate.sampleNs = sampleNs.load(std::memory_order_relaxed);
+        estimate.complete = complete.load(std::memory_order_acquire);
+        return estimate;
+    }
+};
+
+/**
+ * @brief Compresses the start of a file and adds the sizes and the time to progress.
+ */
+void Sample(const std::string& path, const SizeEstimator::Compressor& compress, std::vector<char>& buffer, Progress& progress){
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0){
+        return;
+    }
+    size_t length = 0;
+    ssize_t count;
+    while(length < buffer.size() && (count = read(fd, buffer.data() + length, buffer.size() - length)) > 0){
+        length += static_cast<size_t>(count);
+    }
+    close(fd);
+    if(length == 0){
+        return;
+    }
+    uint64_t compressed = 0;
+    auto start = std::chrono::steady_clock::now();
+    if(!compress(buffer.data(), length, compressed)){
+        warning_print("Failed to compress a sample of", path);
+        return;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    progress.sampleBytes.fetch_add(length, std::memory_order_relaxed);
+    progress.sampleCompressed.fetch_add(compressed, std::memory_order_relaxed);
+    progress.sampleNs.fetch_add(static_cast<uint64_t>(elapsed), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Adds a regular file, or every regular file below a directory, to
+ *        progress; returns when the walk ends or the walker is stopped.
+ */
+void Measure(const std::string& path, const SizeEstimator::Compressor& compress, DirWalker& walker, Progress& progress){
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0){
+        warning_print("Cannot estimate", path);
+        return;
+    }
+    std::vector<char> buffer(ESTIMATE_SAMPLE_BYTES);
+    if(!S_ISDIR(st.st_mode)){
+        if(S_ISREG(st.st_mode)){
+            progress.files.fetch_add(1, std::memory_order_relaxed);
+            progress.bytes.fetch_add(st.st_size, std::memory_order_relaxed);
+            Sample(path, compress, buffer, progress);
+        }
+        return;
+    }
+
+    walker.Start(path);
+    WalkEntry entry;
+    uint64_t nonEmpty = 0;
+    uint64_t nextSample = 1;
+    unsigned int samples = 0;
+    while(!progress.cancelled && walker.Next(entry)){
+        if(entry.type != DT_REG){
+            continue;
+        }
+        progress.files.fetch_add(1, std::memory_order_relaxed);
+        progress.bytes.fetch_add(entry.size, std::memory_order_relaxed);
+        if(entry.size > 0 && ++nonEmpty == nextSample && samples < ESTIMATE_SAMPLE_FILES){
+            Sample(entry.path, compress, buffer, progress);
+            samples++;
+            nextSample *= 2;
+        }
+    }
+}
+
+} // namespace
+
+uint64_t SizeEstimate::ArchiveBytes() const {
+    if(sampleBytes == 0){
+        return bytes;
+    }
+    return static_cast<uint64_t>(static_cast<double>(bytes) * sampleCompressed / sampleBytes);
+}
+
+double SizeEstimate::Seconds() const {
+    if(sampleBytes == 0){
+        return 0;
+    }
+    return static_cast<double>(bytes) * sampleNs / sampleBytes / 1e9;
+}
+
+class SizeEstimator::Impl {
+public:
+    Impl(Compressor compress, unsigned int threads) : Compress(std::move(compress)) {
+        Threads = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency() / ESTIMATE_PARALLEL_SCANS);
+        for(unsigned int i = 0; i < ESTIMATE_PARALLEL_SCANS; i++){
+            Scanners.emplace_back(&Impl::ScannerLoop, this);
+        }
+    }
+
+    ~Impl(){
+        Cancel();
+        {
+            std::lock_guard<std::mutex> lock(Lock);
+            Stop = true;
+        }
+        Wake.notify_all();
+        for(auto& scanner : Scanners){
+            scanner.join();
+        }
+    }
+
+    void Start(const std::string& path){
+        std::lock_guard<std::mutex> lock(Lock);
+        if(Scans.count(path) != 0){
+            return;
+        }
+        Scans[path] = std::make_shared<Progress>();
+        Queue.push_back(path);
+        Wake.notify_one();
+    }
+
+    bool Get(const std::string& path, SizeEstimate& estimate) const {
+        std::lock_guard<std::mutex> lock(Lock);
+        auto scan = Scans.find(path);
+        if(scan == Scans.end()){
+            return false;
+        }
+        estimate = scan->second->Snapshot();
+        return true;
+    }
+
+    void Cancel(){
+        std::lock_guard<std::mutex> lock(Lock);
+        Queue.clear();
+        for(auto scan = Scans.begin(); scan != Scans.end();){
+            if(!scan->second->complete){
+                scan->second->cancelled = true;
+                scan = Scans.erase(scan);
+            } else {
+                ++scan;
+            }
+        }
+        for(DirWalker* walker : Active){
+            walker->Stop();
+        }
+    }
+
+private:
+    Compressor Compress;
+    unsigned int Threads;
+    mutable std::mutex Lock;
+    std::condition_variable Wake;
+    std::deque<std::string> Queue;
+    /* shared with the scanner measuring it, which may outlive the entry */
+    std::map<std::string, std::shared_ptr<Progress>> Scans;
+    /* walkers of the running scans, stopped by Cancel */
+    std::vector<DirWalker*> Active;
+    bool Stop = false;
+    std::vector<std::thread> Scanners;
+
+    void ScannerLoop(){
+        while(true){
+            /* a stopped walker cannot be reused, so every scan gets its own */
+            DirWalker walker(Threads, true);
+            std::string path;
+            std::shared_ptr<Progress> progress;
+            {
+                std::unique_lock<std::mutex> lock(Lock);
+                Wake.wait(lock, [this]() { return Stop || !Queue.empty(); });
+                if(Stop){
+                    return;
+                }
+                path = Queue.front();
+                Queue.pop_front();
+                progress = Scans[path];
+                Active.push_back(&walker);
+            }
+            debug_print("Estimating", path);
+            Measure(path, Compress, walker, *progress);
+            std::lock_guard<std::mutex> lock(Lock);
+            Active.erase(std::find(Active.begin(), Active.end(), &walker));
+            if(!progress->cancelled){
+                progress->complete.store(true, std::memory_order_release);
+            }
+        }
+    }
+};
+
+SizeEstimator::SizeEstimator(Compressor compress, unsigned int threads) : pImpl(std::make_unique<Impl>(std::move(compress), threads)) {}
+
+SizeEstimator::~SizeEstimator() = default;
+
+void SizeEstimator::Start(const std::string& path){
+    pImpl->Start(path);
+}
+
+bool SizeEstimator::Get(const std::string& path, SizeEstimate& estimate) const {
+    return pImpl->Get(path, estimate);
+}
+
+void SizeEstimator::Cancel(){
+    pImpl->Cancel();
+}
+
+SizeEstimate SizeEstimator::Estimate(const std::string& path, const Compressor& compress, unsigned int threads){
+    Progress progress;
+    DirWalker walker(threads, true);
+    Measure(path, compress, walker, progress);
+    progress.complete = true;
+    return progress.Snapshot();
+}
@@ -0,0 +1,131 @@
+#include "sparse.h"
+#include "logs.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+/* Bytes read at a time by the zero-block scan. */
+constexpr size_t SCAN_READ_SIZE = 0x100000;
+
+void AddRegion(std::vector<SparseRegion>& regions, int64_t offset, int64_t length){
+    if(!regions.empty() && regions.back().offset + regions.back().length == offset){
+        regions.back().length += length;
+    } else {
+        regions.push_back(SparseRegion{offset, length});
+    }
+}
+
+/* Asks the filesystem for the data regions, false if it cannot tell. */
+bool SeekDataRegions(int fd, int64_t size, std::vector<SparseRegion>& regions){
+    int64_t offset = 0;
+    while(offset < size){
+        off_t data = lseek(fd, offset, SEEK_DATA);
+        if(data < 0){
+            /* ENXIO: only a hole is left */
+            return errno == ENXIO;
+        }
+        if(data >= size){
+            break;
+        }
+        off_t hole = lseek(fd, data, SEEK_HOLE);
+        if(hole < 0){
+            return false;
+        }
+        if(hole > size){
+            hole = size;
+        }
+        AddRegion(regions, data, hole - data);
+        offset = hole;
+    }
+    return true;
+}
+
+/* Reads the whole file and keeps the blocks that are not all zero. */
+bool ScanDataRegions(int fd, int64_t size, std::vector<SparseRegion>& regions){
+    std::vector<char> buffer(SCAN_READ_SIZE);
+    int64_t offset = 0;
+    while(offset < size){
+        ssize_t bytesRead = pread(fd, buffer.data(), std::min<int64_t>(buffer.size(), size - offset), offset);
+        if(bytesRead < 0 && errno == EINTR){
+            continue;
+        }
+        if(bytesRead <= 0){
+            return false;
+        }
+        for(ssize_t block = 0; block < bytesRead; block += SPARSE_SCAN_BLOCK){
+            size_t length = std::min<size_t>(SPARSE_SCAN_BLOCK, bytesRead - block);
+            if(!IsZeroBlock(buffer.data() + block, length)){
+                AddRegion(regions, offset + block, length);
+            }
+        }
+        offset += bytesRead;
+    }
+    return true;
+}
+
+} // namespace
+
+bool FindDataRegions(int fd, const struct stat& st, std::vector<SparseRegion>& regions){
+    regions.clear();
+    int64_t size = st.st_size;
+    /* st_blocks counts 512-byte units whatever the filesystem block size */
+    if(!S_ISREG(st.st_mode) || size == 0 || static_cast<int64_t>(st.st_blocks) * 512 >= size){
+        return false;
+    }
+
+    bool reported = SeekDataRegions(fd, size, regions);
+    lseek(fd, 0, SEEK_SET);
+    if(!reported || (regions.size() == 1 && regions[0].offset == 0 && regions[0].length == size)){
+        /* no hole reported although blocks are missing, e.g. no SEEK_HOLE support */
+        regions.clear();
+        if(!ScanDataRegions(fd, size, regions)){
+            warning_print("Cannot scan file for holes");
+            regions.clear();
+            return false;
+        }
+    }
+
+    int64_t dataBytes = 0;
+    for(const auto& region : regions){
+        dataBytes += region.length;
+    }
+    if(dataBytes == size){
+        regions.clear();
+        return false;
+    }
+    return true;
+}
+
+bool IsZeroBlock(const char* data, size_t length){
+    size_t position = 0;
+    /* eight words per step, which the compiler turns into vector loads and ORs */
+    for(; position + 64 <= length; position += 64){
+        uint64_t words[8];
+        memcpy(words, data + position, sizeof(words));
+        if((words[0] | words[1] | words[2] | words[3] | words[4] | words[5] | words[6] | words[7]) != 0){
+            return false;
+        }
+    }
+    for(; position < length; position++){
+        if(data[position] != 0){
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* SparseZeros(){
+    static const char* zeros = []() {
+        void* region = mmap(nullptr, SPARSE_ZEROS_SIZE, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(region == MAP_FAILED){
+            return static_cast<const char*>(calloc(SPARSE_ZEROS_SIZE, 1));
+        }
+        return static_cast<const char*>(region);
+    }();
+    return zeros;
+}
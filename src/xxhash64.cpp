@@ -0,0 +1,138 @@
+#include "xxhash64.h"
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t Prime1 = 11400714785074694791ULL;
+constexpr uint64_t Prime2 = 14029467366897019727ULL;
+constexpr uint64_t Prime3 = 1609587929392839161ULL;
+constexpr uint64_t Prime4 = 9650029242287828579ULL;
+constexpr uint64_t Prime5 = 2870177450012600261ULL;
+
+inline uint64_t Rotl(uint64_t value, int bits){
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t Read64(const unsigned char* p){
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t Read32(const unsigned char* p){
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t Round(uint64_t acc, uint64_t input){
+    acc += input * Prime2;
+    acc = Rotl(acc, 31);
+    return acc * Prime1;
+}
+
+inline uint64_t MergeRound(uint64_t acc, uint64_t value){
+    acc ^= Round(0, value);
+    return acc * Prime1 + Prime4;
+}
+
+} // namespace
+
+Xxh64::Xxh64(uint64_t seed){
+    Reset(seed);
+}
+
+void Xxh64::Reset(uint64_t seed){
+    Seed = seed;
+    Acc[0] = seed + Prime1 + Prime2;
+    Acc[1] = seed + Prime2;
+    Acc[2] = seed;
+    Acc[3] = seed - Prime1;
+    TotalLength = 0;
+    Buffered = 0;
+}
+
+/**
+ * @brief Feeds more data into the hash.
+ *
+ * Full 32 byte stripes are consumed directly from the input; only the tail
+ * is copied into the internal buffer.
+ */
+void Xxh64::Update(const void* data, size_t length){
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + length;
+    TotalLength += length;
+
+    if(Buffered + length < sizeof(Buffer)){
+        memcpy(Buffer + Buffered, p, length);
+        Buffered += length;
+        return;
+    }
+
+    if(Buffered > 0){
+        size_t fill = sizeof(Buffer) - Buffered;
+        memcpy(Buffer + Buffered, p, fill);
+        p += fill;
+        for(int i = 0; i < 4; i++){
+            Acc[i] = Round(Acc[i], Read64(Buffer + 8 * i));
+        }
+        Buffered = 0;
+    }
+
+    uint64_t v1 = Acc[0], v2 = Acc[1], v3 = Acc[2], v4 = Acc[3];
+    while(end - p >= 32){
+        v1 = Round(v1, Read64(p));
+        v2 = Round(v2, Read64(p + 8));
+        v3 = Round(v3, Read64(p + 16));
+        v4 = Round(v4, Read64(p + 24));
+        p += 32;
+    }
+    Acc[0] = v1; Acc[1] = v2; Acc[2] = v3; Acc[3] = v4;
+
+    Buffered = static_cast<size_t>(end - p);
+    memcpy(Buffer, p, Buffered);
+}
+
+uint64_t Xxh64::Digest() const {
+    uint64_t h;
+    if(TotalLength >= 32){
+        h = Rotl(Acc[0], 1) + Rotl(Acc[1], 7) + Rotl(Acc[2], 12) + Rotl(Acc[3], 18);
+        for(int i = 0; i < 4; i++){
+            h = MergeRound(h, Acc[i]);
+        }
+    } else {
+        h = Seed + Prime5;
+    }
+    h += TotalLength;
+
+    const unsigned char* p = Buffer;
+    const unsigned char* end = Buffer + Buffered;
+    while(end - p >= 8){
+        h ^= Round(0, Read64(p));
+        h = Rotl(h, 27) * Prime1 + Prime4;
+        p += 8;
+    }
+    if(end - p >= 4){
+        h ^= static_cast<uint64_t>(Read32(p)) * Prime1;
+        h = Rotl(h, 23) * Prime2 + Prime3;
+        p += 4;
+    }
+    while(p < end){
+        h ^= (*p) * Prime5;
+        h = Rotl(h, 11) * Prime1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t Xxh64::Hash(const void* data, size_t length, uint64_t seed){
+    Xxh64 state(seed);
+    state.Update(data, length);
+    return state.Digest();
+}
@@ -0,0 +1,74 @@
+#ifndef MOCK_LIBARCHIVE_WRAPPER_H
+#define MOCK_LIBARCHIVE_WRAPPER_H
+
+#include <gmock/gmock.h>
+#include "ILibarchive_wrapper.h"
+
+extern "C"{
+#include <archive.h>
+#include <archive_entry.h>
+}
+
+// Mock class for ILibArchiveWrapper
+class MockLibArchiveWrapper : public ILibArchiveWrapper {
+    public:
+        MOCK_METHOD(struct archive*, archive_read_new, (), (override));
+        MOCK_METHOD(int, archive_read_support_filter_all, (struct archive*), (override));
+        MOCK_METHOD(int, archive_read_support_format_all, (struct archive*), (override));
+        MOCK_METHOD(int, archive_read_open_filename, (struct archive*, const char*, size_t), (override));
+        MOCK_METHOD(int, archive_read_next_header, (struct archive*, struct archive_entry**), (override));
+        MOCK_METHOD(int, archive_read_data_block, (struct archive*, const void**, size_t*, int64_t*), (override));
+        MOCK_METHOD(int, archive_read_close, (struct archive*), (override));
+        MOCK_METHOD(int, archive_read_free, (struct archive*), (override));
+        MOCK_METHOD(struct archive*, archive_write_new, (), (override));
+        MOCK_METHOD(int, archive_write_add_filter_xz, (struct archive*), (override));
+        MOCK_METHOD(int, archive_write_add_filter_zstd, (struct archive*), (override));
+        MOCK_METHOD(int, archive_write_add_filter_lz4, (struct archive*), (override));
+        MOCK_METHOD(int, archive_write_add_filter_gzip, (struct archive*), (override));
+        MOCK_METHOD(int, archive_write_add_filter_none, (struct archive*), (override));
+        MOCK_METHOD(int, archive_write_set_filter_option, (struct archive*, const char*, const char*, const char*), (override));
+        MOCK_METHOD(int, archive_write_set_format_pax_restricted, (struct archive*), (override));
+        MOCK_METHOD(int, archive_write_open_filename, (struct archive*, const char*), (override));
+        MOCK_METHOD(int, archive_write_header, (struct archive*, struct archive_entry*), (override));
+        MOCK_METHOD(int, archive_write_data, (struct archive*, const void*, size_t), (override));
+        MOCK_METHOD(int, archive_write_close, (struct archive*), (override));
+        MOCK_METHOD(int, archive_write_free, (struct archive*), (override));
+        MOCK_METHOD(struct archive_entry*, archive_entry_new, (), (override));
+        MOCK_METHOD(void, archive_entry_free, (struct archive_entry*), (override));
+        MOCK_METHOD(void, archive_entry_set_pathname, (struct archive_entry*, const char*), (override));
+        MOCK_METHOD(void, archive_entry_set_size, (struct archive_entry*, int64_t), (override));
+        MOCK_METHOD(void, archive_entry_set_filetype, (struct archive_entry*, unsigned int), (override));
+        MOCK_METHOD(void, archive_entry_set_perm, (struct archive_entry*, unsigned int), (override));
+        MOCK_METHOD(int, archive_write_disk_set_options, (struct archive*, int), (override));
+        MOCK_METHOD(const char*, archive_error_string, (struct archive*), (override));
+        MOCK_METHOD(int, archive_write_disk_set_standard_lookup, (struct archive*), (override));
+        MOCK_METHOD(struct archive*, archive_write_disk_new, (), (override));
+        MOCK_METHOD(int, archive_write_finish_entry, (struct archive*), (override));
+        MOCK_METHOD(int64_t, archive_entry_size, (struct archive_entry*), (override));
+        MOCK_METHOD(const char*, archive_entry_pathname, (struct archive_entry*), (override));
+        MOCK_METHOD(int, archive_write_data_block, (struct archive*, const void*, size_t, int64_t), (override));
+        MOCK_METHOD(struct archive_entry*, archive_entry_clone, (struct archive_entry*), (override));
+        MOCK_METHOD(unsigned int, archive_entry_filetype, (struct archive_entry*), (override));
+        MOCK_METHOD(const char*, archive_entry_hardlink, (struct archive_entry*), (override));
+        MOCK_METHOD(int, archive_read_open, (struct archive*, void*, archive_open_callback*, archive_read_callback*, archive_close_callback*), (override));
+        MOCK_METHOD(int, archive_write_open, (struct archive*, void*, archive_open_callback*, archive_write_callback*, archive_close_callback*), (override));
+        MOCK_METHOD(int, archive_write_set_bytes_per_block, (struct archive*, int), (override));
+        MOCK_METHOD(int, archive_write_set_format_raw, (struct archive*), (override));
+        MOCK_METHOD(int, archive_read_data_skip, (struct archive*), (override));
+        MOCK_METHOD(unsigned int, archive_entry_mode, (struct archive_entry*), (override));
+        MOCK_METHOD(time_t, archive_entry_mtime, (struct archive_entry*), (override));
+        MOCK_METHOD(long, archive_entry_mtime_nsec, (struct archive_entry*), (override));
+        MOCK_METHOD(void, archive_entry_set_mtime, (struct archive_entry*, time_t, long), (override));
+        MOCK_METHOD(int, archive_write_open_fd, (struct archive*, int), (override));
+        MOCK_METHOD(int, archive_read_open_fd, (struct archive*, int, size_t), (override));
+        MOCK_METHOD(int, archive_write_set_bytes_in_last_block, (struct archive*, int), (override));
+        MOCK_METHOD(void, archive_entry_sparse_add_entry, (struct archive_entry*, la_int64_t, la_int64_t), (override));
+        MOCK_METHOD(int, archive_entry_sparse_count, (struct archive_entry*), (override));
+        MOCK_METHOD(void, archive_entry_set_hardlink, (struct archive_entry*, const char*), (override));
+        MOCK_METHOD(void, archive_entry_xattr_add_entry, (struct archive_entry*, const char*, const void*, size_t), (override));
+        MOCK_METHOD(int, archive_entry_xattr_reset, (struct archive_entry*), (override));
+        MOCK_METHOD(int, archive_entry_xattr_next, (struct archive_entry*, const char**, const void**, size_t*), (override));
+        MOCK_METHOD(la_int64_t, archive_filter_bytes, (struct archive*, int), (override));
+    };
+
+#endif // MOCK_LIBARCHIVE_WRAPPER_H
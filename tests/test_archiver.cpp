@@ -1,77 +1,211 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
-#include "archiver.h"
-#include "ILibarchive_wrapper.h"
+#include "archiver.tpp"
+#include "mock_libarchive_wrapper.h"
 #include "status.h"
-
-extern "C"{
-#include <archive.h>
-#include <archive_entry.h>
-}
+#include <filesystem>
+#include <fstream>
+#include <vector>
 
 using ::testing::_;
+using ::testing::DoAll;
 using ::testing::Return;
+using ::testing::SaveArg;
+using ::testing::SetArgPointee;
+using ::testing::StrEq;
 
-// Mock class for ILibArchiveWrapper
-class MockLibArchiveWrapper : public ILibArchiveWrapper {
-    public:
-        MOCK_METHOD(struct archive*, archive_read_new, (), (override));
-        MOCK_METHOD(int, archive_read_support_filter_all, (struct archive*), (override));
-        MOCK_METHOD(int, archive_read_support_format_all, (struct archive*), (override));
-        MOCK_METHOD(int, archive_read_open_filename, (struct archive*, const char*, size_t), (override));
-        MOCK_METHOD(int, archive_read_next_header, (struct archive*, struct archive_entry**), (override));
-        MOCK_METHOD(int, archive_read_data_block, (struct archive*, const void**, size_t*, int64_t*), (override));
-        MOCK_METHOD(int, archive_read_close, (struct archive*), (override));
-        MOCK_METHOD(int, archive_read_free, (struct archive*), (override));
-        MOCK_METHOD(struct archive*, archive_write_new, (), (override));
-        MOCK_METHOD(int, archive_write_add_filter_xz, (struct archive*), (override));
-        MOCK_METHOD(int, archive_write_set_format_pax_restricted, (struct archive*), (override));
-        MOCK_METHOD(int, archive_write_open_filename, (struct archive*, const char*), (override));
-        MOCK_METHOD(int, archive_write_header, (struct archive*, struct archive_entry*), (override));
-        MOCK_METHOD(int, archive_write_data, (struct archive*, const void*, size_t), (override));
-        MOCK_METHOD(int, archive_write_close, (struct archive*), (override));
-        MOCK_METHOD(int, archive_write_free, (struct archive*), (override));
-        MOCK_METHOD(struct archive_entry*, archive_entry_new, (), (override));
-        MOCK_METHOD(void, archive_entry_free, (struct archive_entry*), (override));
-        MOCK_METHOD(void, archive_entry_set_pathname, (struct archive_entry*, const char*), (override));
-        MOCK_METHOD(void, archive_entry_set_size, (struct archive_entry*, int64_t), (override));
-        MOCK_METHOD(void, archive_entry_set_filetype, (struct archive_entry*, unsigned int), (override));
-        MOCK_METHOD(void, archive_entry_set_perm, (struct archive_entry*, unsigned int), (override));
-        MOCK_METHOD(int, archive_write_disk_set_options, (struct archive*, int), (override));
-        MOCK_METHOD(const char*, archive_error_string, (struct archive*), (override));
-        MOCK_METHOD(int, archive_write_disk_set_standard_lookup, (struct archive*), (override));
-        MOCK_METHOD(struct archive*, archive_write_disk_new, (), (override));
-        MOCK_METHOD(int, archive_write_finish_entry, (struct archive*), (override));
-        MOCK_METHOD(int64_t, archive_entry_size, (struct archive_entry*), (override));
-        MOCK_METHOD(const char*, archive_entry_pathname, (struct archive_entry*), (override));
-        MOCK_METHOD(int, archive_write_data_block, (struct archive*, const void*, size_t, int64_t), (override));
-    };
+using MockArchiver = BasicArchiver<MockLibArchiveWrapper>;
 
 // Test case: Extract returns CriticalError when archive_read_new() returns NULL
 TEST(ArchiverTest, Extract_ReturnsCriticalError_WhenArchiveReadNewReturnsNull) {
     auto mockLibArchive = std::make_unique<MockLibArchiveWrapper>();
     EXPECT_CALL(*mockLibArchive, archive_read_new()).WillOnce(Return(nullptr));
 
-    Archiver archiver(std::move(mockLibArchive));
+    MockArchiver archiver(std::move(mockLibArchive));
     Status status = archiver.Extract("test_archive.tar.gz");
 
     EXPECT_EQ(status, CriticalError);
 }
 
-// Test case: Extract returns CannotOpenFile when archive_read_open_filename() fails
+// Test case: Extract returns CannotOpenFile when archive_read_open_filename() fails and frees both handles
 TEST(ArchiverTest, Extract_ReturnsCannotOpenFile_WhenArchiveReadOpenFilenameFails) {
     auto mockLibArchive = std::make_unique<MockLibArchiveWrapper>();
-    struct archive* mockArchive;
+    struct archive* mockArchive = reinterpret_cast<struct archive*>(0x1);
+    struct archive* mockDisk = reinterpret_cast<struct archive*>(0x2);
     EXPECT_CALL(*mockLibArchive, archive_read_new()).WillOnce(Return(mockArchive));
     EXPECT_CALL(*mockLibArchive, archive_read_support_filter_all(mockArchive)).Times(1);
     EXPECT_CALL(*mockLibArchive, archive_read_support_format_all(mockArchive)).Times(1);
-    EXPECT_CALL(*mockLibArchive, archive_write_disk_new()).WillOnce(Return(mockArchive));
-    EXPECT_CALL(*mockLibArchive, archive_write_disk_set_options(mockArchive, _)).Times(1);
-    EXPECT_CALL(*mockLibArchive, archive_write_disk_set_standard_lookup(mockArchive)).Times(1);
+    EXPECT_CALL(*mockLibArchive, archive_write_disk_new()).WillOnce(Return(mockDisk));
+    EXPECT_CALL(*mockLibArchive, archive_write_disk_set_options(mockDisk, _)).Times(1);
+    EXPECT_CALL(*mockLibArchive, archive_write_disk_set_standard_lookup(mockDisk)).Times(1);
     EXPECT_CALL(*mockLibArchive, archive_read_open_filename(mockArchive, _, _)).WillOnce(Return(ARCHIVE_FATAL));
+    EXPECT_CALL(*mockLibArchive, archive_read_free(mockArchive)).Times(1);
+    EXPECT_CALL(*mockLibArchive, archive_write_free(mockArchive)).Times(0);
+    EXPECT_CALL(*mockLibArchive, archive_write_free(mockDisk)).Times(1);
 
-    Archiver archiver(std::move(mockLibArchive));
+    MockArchiver archiver(std::move(mockLibArchive));
     Status status = archiver.Extract("test_archive.tar.gz");
 
     EXPECT_EQ(status, CannotOpenFile);
 }
+
+// Test case: the requested thread count is passed to the xz filter
+TEST(ArchiverTest, Constructor_SetsXzThreads_WhenThreadCountGiven) {
+    auto mockLibArchive = std::make_unique<MockLibArchiveWrapper>();
+    EXPECT_CALL(*mockLibArchive, archive_write_add_filter_xz(_)).Times(1);
+    EXPECT_CALL(*mockLibArchive, archive_write_set_filter_option(_, StrEq("xz"), StrEq("threads"), StrEq("4"))).WillOnce(Return(ARCHIVE_OK));
+    EXPECT_CALL(*mockLibArchive, archive_write_open_filename(_, StrEq("test_archive.tar.xz"))).WillOnce(Return(ARCHIVE_OK));
+
+    ArchiverOptions options;
+    options.threads = 4;
+    MockArchiver archiver("test_archive.tar.xz", std::move(mockLibArchive), options);
+}
+
+// Test case: the zstd profile adds the zstd filter with level, long mode and threads
+TEST(ArchiverTest, Constructor_ConfiguresZstdFilter_WhenZstdSelected) {
+    auto mockLibArchive = std::make_unique<MockLibArchiveWrapper>();
+    EXPECT_CALL(*mockLibArchive, archive_write_add_filter_xz(_)).Times(0);
+    EXPECT_CALL(*mockLibArchive, archive_write_add_filter_zstd(_)).WillOnce(Return(ARCHIVE_OK));
+    EXPECT_CALL(*mockLibArchive, archive_write_set_filter_option(_, StrEq("zstd"), StrEq("compression-level"), StrEq("19"))).WillOnce(Return(ARCHIVE_OK));
+    EXPECT_CALL(*mockLibArchive, archive_write_set_filter_option(_, StrEq("zstd"), StrEq("long"), StrEq("27"))).WillOnce(Return(ARCHIVE_OK));
+    EXPECT_CALL(*mockLibArchive, archive_write_set_filter_option(_, StrEq("zstd"), StrEq("threads"), StrEq("2"))).WillOnce(Return(ARCHIVE_OK));
+    EXPECT_CALL(*mockLibArchive, archive_write_open_filename(_, StrEq("test_archive.tar.zst"))).WillOnce(Return(ARCHIVE_OK));
+
+    ArchiverOptions options;
+    options.codec = Codec::Zstd;
+    options.level = 19;
+    options.longMode = true;
+    options.threads = 2;
+    MockArchiver archiver("test_archive" + CodecExtension(options.codec), std::move(mockLibArchive), options);
+}
+
+// Test case: the lz4 and none profiles add their filter and no thread option
+TEST(ArchiverTest, Constructor_ConfiguresSingleThreadedFilters) {
+    auto lz4LibArchive = std::make_unique<MockLibArchiveWrapper>();
+    EXPECT_CALL(*lz4LibArchive, archive_write_add_filter_lz4(_)).WillOnce(Return(ARCHIVE_OK));
+    EXPECT_CALL(*lz4LibArchive, archive_write_set_filter_option(_, StrEq("lz4"), StrEq("compression-level"), StrEq("1"))).WillOnce(Return(ARCHIVE_OK));
+    ArchiverOptions lz4Options;
+    lz4Options.codec = Codec::Lz4;
+    lz4Options.level = 1;
+    MockArchiver lz4Archiver("test_archive.tar.lz4", std::move(lz4LibArchive), lz4Options);
+
+    auto noneLibArchive = std::make_unique<MockLibArchiveWrapper>();
+    EXPECT_CALL(*noneLibArchive, archive_write_add_filter_none(_)).WillOnce(Return(ARCHIVE_OK));
+    EXPECT_CALL(*noneLibArchive, archive_write_set_filter_option(_, _, _, _)).Times(0);
+    ArchiverOptions noneOptions;
+    noneOptions.codec = Codec::None;
+    MockArchiver noneArchiver("test_archive.tar", std::move(noneLibArchive), noneOptions);
+}
+
+// Test case: a rejected filter aborts the construction
+TEST(ArchiverTest, Constructor_Throws_WhenFilterUnavailable) {
+    auto mockLibArchive = std::make_unique<MockLibArchiveWrapper>();
+    EXPECT_CALL(*mockLibArchive, archive_write_add_filter_gzip(_)).WillOnce(Return(ARCHIVE_FATAL));
+    EXPECT_CALL(*mockLibArchive, archive_error_string(_)).WillRepeatedly(Return("mock failure"));
+
+    ArchiverOptions options;
+    options.codec = Codec::Gzip;
+    EXPECT_THROW(MockArchiver("test_archive.tar.gz", std::move(mockLibArchive), options), std::runtime_error);
+}
+
+// Test case: List reports entry headers and skips their data instead of reading it
+TEST(ArchiverTest, List_SkipsEntryData) {
+    std::filesystem::path location = std::filesystem::temp_directory_path() / "test_archiver_list.tar";
+    std::ofstream(location, std::ios::binary) << std::string(1024, '\0');
+
+    auto mockLibArchive = std::make_unique<MockLibArchiveWrapper>();
+    struct archive* mockArchive = reinterpret_cast<struct archive*>(0x1);
+    struct archive_entry* mockEntry = reinterpret_cast<struct archive_entry*>(0x2);
+    EXPECT_CALL(*mockLibArchive, archive_read_new()).WillOnce(Return(mockArchive));
+    EXPECT_CALL(*mockLibArchive, archive_read_open_filename(mockArchive, StrEq(location.c_str()), _)).WillOnce(Return(ARCHIVE_OK));
+    EXPECT_CALL(*mockLibArchive, archive_read_next_header(mockArchive, _))
+        .WillOnce(DoAll(SetArgPointee<1>(mockEntry), Return(ARCHIVE_OK)))
+        .WillOnce(Return(ARCHIVE_EOF));
+    EXPECT_CALL(*mockLibArchive, archive_entry_pathname(mockEntry)).WillRepeatedly(Return("dir/a.txt"));
+    EXPECT_CALL(*mockLibArchive, archive_entry_size(mockEntry)).WillOnce(Return(5));
+    EXPECT_CALL(*mockLibArchive, archive_entry_mode(mockEntry)).WillOnce(Return(AE_IFREG | 0644));
+    EXPECT_CALL(*mockLibArchive, archive_entry_mtime(mockEntry)).WillOnce(Return(7));
+    EXPECT_CALL(*mockLibArchive, archive_entry_mtime_nsec(mockEntry)).WillOnce(Return(8));
+    EXPECT_CALL(*mockLibArchive, archive_read_data_skip(mockArchive)).WillOnce(Return(ARCHIVE_OK));
+    EXPECT_CALL(*mockLibArchive, archive_read_data_block(_, _, _, _)).Times(0);
+
+    MockArchiver archiver(std::move(mockLibArchive));
+    std::vector<ArchiveListEntry> entries;
+    Status status = archiver.List(location.string(), [&](const ArchiveListEntry& entry) { entries.push_back(entry); });
+    std::filesystem::remove(location);
+
+    EXPECT_EQ(status, Success);
+    ASSERT_EQ(entries.size(), 1u);
+    EXPECT_EQ(entries[0].path, "dir/a.txt");
+    EXPECT_EQ(entries[0].size, 5);
+    EXPECT_EQ(entries[0].mode, static_cast<unsigned int>(AE_IFREG | 0644));
+    EXPECT_EQ(entries[0].mtime, 7000000008);
+}
+
+// Test case: an output callback receives the archive in large blocks instead of a file being opened
+TEST(ArchiverTest, Constructor_WritesToOutputCallback) {
+    auto mockLibArchive = std::make_unique<MockLibArchiveWrapper>();
+    void* client = nullptr;
+    archive_write_callback* writeCallback = nullptr;
+    EXPECT_CALL(*mockLibArchive, archive_write_open_filename(_, _)).Times(0);
+    EXPECT_CALL(*mockLibArchive, archive_write_set_bytes_per_block(_, ARCHIVE_OUTPUT_BLOCK_SIZE)).Times(1);
+    EXPECT_CALL(*mockLibArchive, archive_write_open(_, _, _, _, _))
+        .WillOnce(DoAll(SaveArg<1>(&client), SaveArg<3>(&writeCallback), Return(ARCHIVE_OK)));
+
+    std::string received;
+    ArchiverOptions options;
+    options.outputCallback = [&received](const char* data, size_t length) {
+        received.append(data, length);
+        return received.size() < 8;
+    };
+    MockArchiver archiver("test_archive.tar.xz", std::move(mockLibArchive), options);
+
+    ASSERT_NE(writeCallback, nullptr);
+    EXPECT_EQ(writeCallback(nullptr, client, "block", 5), 5);
+    EXPECT_EQ(writeCallback(nullptr, client, "block", 5), -1);
+    EXPECT_EQ(received, "blockblock");
+}
+
+// Test case: an output descriptor is handed to libarchive instead of a file name
+TEST(ArchiverTest, Constructor_WritesToOutputFd) {
+    auto mockLibArchive = std::make_unique<MockLibArchiveWrapper>();
+    EXPECT_CALL(*mockLibArchive, archive_write_open_filename(_, _)).Times(0);
+    EXPECT_CALL(*mockLibArchive, archive_write_set_bytes_per_block(_, ARCHIVE_OUTPUT_BLOCK_SIZE)).Times(1);
+    EXPECT_CALL(*mockLibArchive, archive_write_open_fd(_, 9)).WillOnce(Return(ARCHIVE_OK));
+
+    ArchiverOptions options;
+    options.outputFd = 9;
+    MockArchiver archiver("test_archive.tar.xz", std::move(mockLibArchive), options);
+}
+
+// Test case: the stats count the archived files and their bytes, and the archive size once finished
+TEST(ArchiverTest, GetStats_CountsArchivedFilesAndBytes) {
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "test_archiver_stats";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "dir");
+    std::ofstream(root / "dir/a.txt") << "abc";
+    std::ofstream(root / "dir/b.txt") << "defgh";
+    std::string location = (root / "stats.tar.xz").string();
+
+    auto mockLibArchive = std::make_unique<MockLibArchiveWrapper>();
+    struct archive* mockArchive = reinterpret_cast<struct archive*>(0x1);
+    EXPECT_CALL(*mockLibArchive, archive_write_new()).WillOnce(Return(mockArchive));
+    EXPECT_CALL(*mockLibArchive, archive_write_open_filename(mockArchive, StrEq(location))).WillOnce(Return(ARCHIVE_OK));
+    EXPECT_CALL(*mockLibArchive, archive_write_data(mockArchive, _, _)).WillRepeatedly(Return(ARCHIVE_OK));
+    EXPECT_CALL(*mockLibArchive, archive_filter_bytes(mockArchive, -1)).WillRepeatedly(Return(4));
+    EXPECT_CALL(*mockLibArchive, archive_write_close(mockArchive)).WillOnce(Return(ARCHIVE_OK));
+
+    MockArchiver archiver(location, std::move(mockLibArchive));
+    EXPECT_EQ(archiver.ArchiveItem(std::filesystem::directory_entry(root / "dir")), Success);
+    EXPECT_EQ(archiver.Finish(), Success);
+    EXPECT_EQ(archiver.Finish(), Success);
+    ArchiverStats stats = archiver.GetStats();
+    std::filesystem::remove_all(root);
+
+    EXPECT_EQ(stats.files, 2u);
+    EXPECT_EQ(stats.bytesRead, 8u);
+    EXPECT_EQ(stats.bytesWritten, 4u);
+    EXPECT_DOUBLE_EQ(stats.compressionRatio, 2.0);
+    EXPECT_GT(stats.totalNs, 0u);
+    EXPECT_GE(stats.totalNs, stats.compressNs);
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include "checkpoint.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string JournalPath(const std::string& name) {
+    std::string filename = (std::filesystem::temp_directory_path() / name).string();
+    std::filesystem::remove(filename);
+    return filename;
+}
+
+Checkpoint MakeCheckpoint(uint64_t offset, const std::string& item, const std::string& last) {
+    Checkpoint checkpoint;
+    checkpoint.offset = offset;
+    checkpoint.item = item;
+    checkpoint.last = last;
+    checkpoint.toc = "toc" + std::to_string(offset) + ";";
+    checkpoint.checksums = "sum" + std::to_string(offset) + "\n";
+    ManifestEntry entry;
+    entry.path = last;
+    entry.size = offset;
+    entry.mtime = -1;
+    entry.inode = 7;
+    entry.contentHash = 0xfeedULL;
+    AppendRecord(checkpoint.records, entry);
+    return checkpoint;
+}
+
+} // namespace
+
+// Test case: Resume folds all checkpoints into the progress and lists the items completed before the last one
+TEST(CheckpointTest, Resume_AccumulatesCheckpointsAndDoneItems) {
+    std::string filename = JournalPath("test_checkpoint_resume.journal");
+    Checkpoint progress;
+    std::vector<std::string> doneItems;
+    EXPECT_EQ(CheckpointJournal::Resume(filename, Codec::Zstd, progress, doneItems), nullptr);
+
+    auto journal = CheckpointJournal::Create(filename, Codec::Zstd);
+    ASSERT_NE(journal, nullptr);
+    ASSERT_EQ(journal->Append(MakeCheckpoint(100, "/srv/a", "/srv/a/x")), Success);
+    ASSERT_EQ(journal->Append(MakeCheckpoint(200, "/srv/b", "/srv/b/y")), Success);
+    ASSERT_EQ(journal->Append(MakeCheckpoint(300, "/srv/b", "/srv/b/z")), Success);
+    journal.reset();
+
+    EXPECT_EQ(CheckpointJournal::Resume(filename, Codec::Xz, progress, doneItems), nullptr);
+    journal = CheckpointJournal::Resume(filename, Codec::Zstd, progress, doneItems);
+    ASSERT_NE(journal, nullptr);
+    EXPECT_EQ(progress.offset, 300u);
+    EXPECT_EQ(progress.item, "/srv/b");
+    EXPECT_EQ(progress.last, "/srv/b/z");
+    EXPECT_EQ(progress.toc, "toc100;toc200;toc300;");
+    EXPECT_EQ(progress.checksums, "sum100\nsum200\nsum300\n");
+    EXPECT_EQ(doneItems, std::vector<std::string>{"/srv/a"});
+
+    std::vector<std::string> paths;
+    size_t position = 0;
+    ManifestEntry entry;
+    while (NextRecord(progress.records, position, entry)) {
+        paths.emplace_back(entry.path);
+        EXPECT_EQ(entry.mtime, -1);
+        EXPECT_EQ(entry.contentHash, 0xfeedULL);
+    }
+    EXPECT_EQ(paths, (std::vector<std::string>{"/srv/a/x", "/srv/b/y", "/srv/b/z"}));
+
+    journal->Remove();
+    EXPECT_FALSE(std::filesystem::exists(filename));
+}
+
+// Test case: a checkpoint torn by a crash is dropped, and later checkpoints are appended after the intact ones
+TEST(CheckpointTest, Resume_DropsTornCheckpoint) {
+    std::string filename = JournalPath("test_checkpoint_torn.journal");
+    auto journal = CheckpointJournal::Create(filename, Codec::Lz4);
+    ASSERT_NE(journal, nullptr);
+    ASSERT_EQ(journal->Append(MakeCheckpoint(100, "/srv/a", "/srv/a/x")), Success);
+    journal.reset();
+    uint64_t intact = std::filesystem::file_size(filename);
+    {
+        std::ofstream torn(filename, std::ios::binary | std::ios::app);
+        torn << std::string(20, '\x01');
+    }
+
+    Checkpoint progress;
+    std::vector<std::string> doneItems;
+    journal = CheckpointJournal::Resume(filename, Codec::Lz4, progress, doneItems);
+    ASSERT_NE(journal, nullptr);
+    EXPECT_EQ(progress.offset, 100u);
+    EXPECT_EQ(std::filesystem::file_size(filename), intact);
+    ASSERT_EQ(journal->Append(MakeCheckpoint(200, "/srv/a", "/srv/a/y")), Success);
+    journal.reset();
+
+    journal = CheckpointJournal::Resume(filename, Codec::Lz4, progress, doneItems);
+    ASSERT_NE(journal, nullptr);
+    EXPECT_EQ(progress.offset, 200u);
+    EXPECT_EQ(progress.last, "/srv/a/y");
+    EXPECT_TRUE(doneItems.empty());
+    journal->Remove();
+}
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include "checksums.h"
+#include "xxhash64.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Test case: checksum lists use the xxhsum format and read back, escaped paths included
+TEST(ChecksumsTest, AppendChecksum_WritesXxhsumLinesThatParseBack) {
+    std::string list;
+    AppendChecksum(list, "dir/empty.txt", Xxh64::Hash("", 0));
+    AppendChecksum(list, "odd\nname\\x", 0x1234);
+    EXPECT_EQ(list.substr(0, list.find('\n') + 1), "ef46db3751d8e999  dir/empty.txt\n");
+    EXPECT_EQ(list.substr(list.find('\n') + 1), "\\0000000000001234  odd\\nname\\\\x\n");
+
+    std::map<std::string, uint64_t> digests;
+    ASSERT_TRUE(ParseChecksums(list, digests));
+    std::map<std::string, uint64_t> expected = {
+        {"dir/empty.txt", 0xef46db3751d8e999ULL},
+        {"odd\nname\\x", 0x1234},
+    };
+    EXPECT_EQ(digests, expected);
+    EXPECT_FALSE(ParseChecksums("not a checksum\n", digests));
+}
+
+// Test case: entries hashed on several threads, in blocks and with holes, match a single-pass hash
+TEST(ChecksumsTest, HashPool_MatchesSequentialHashes) {
+    std::vector<std::string> contents;
+    for (int i = 0; i < 40; i++) {
+        contents.push_back(std::string(static_cast<size_t>(i) * 100000, static_cast<char>('a' + i % 26)));
+    }
+
+    HashPool pool(3);
+    for (size_t i = 0; i < contents.size(); i++) {
+        pool.Begin("file" + std::to_string(i));
+        /* uneven pieces, so the blocks handed to the threads are refilled across calls */
+        for (size_t offset = 0; offset < contents[i].size(); offset += 70001) {
+            pool.Update(contents[i].data() + offset, std::min<size_t>(70001, contents[i].size() - offset));
+        }
+        pool.End();
+    }
+    pool.Begin("sparse");
+    pool.Update("data", 4);
+    pool.Zeros(3000000);
+    pool.Update("tail", 4);
+    pool.End();
+
+    auto digests = pool.Finish();
+    ASSERT_EQ(digests.size(), contents.size() + 1);
+    for (size_t i = 0; i < contents.size(); i++) {
+        EXPECT_EQ(digests[i].first, "file" + std::to_string(i));
+        EXPECT_EQ(digests[i].second, Xxh64::Hash(contents[i].data(), contents[i].size())) << i;
+    }
+    std::string sparse = "data" + std::string(3000000, '\0') + "tail";
+    EXPECT_EQ(digests.back().second, Xxh64::Hash(sparse.data(), sparse.size()));
+}
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include "chunker.h"
+#include "dedup_store.h"
+#include "codec.h"
+#include "status.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<char> RandomData(size_t size, unsigned int seed) {
+    std::mt19937 generator(seed);
+    std::vector<char> data(size);
+    for (auto& byte : data) {
+        byte = static_cast<char>(generator() & 0xff);
+    }
+    return data;
+}
+
+std::vector<std::string> Chunks(const std::vector<char>& data) {
+    std::vector<std::string> chunks;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+    for (size_t start = 0; start < data.size();) {
+        size_t cut = Chunker::FindCut(bytes + start, data.size() - start);
+        chunks.emplace_back(data.data() + start, cut);
+        start += cut;
+    }
+    return chunks;
+}
+
+std::filesystem::path CleanDirectory(const std::string& name) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    return directory;
+}
+
+} // namespace
+
+// Test case: chunk boundaries move with the content, so an insertion only changes nearby chunks
+TEST(DedupStoreTest, Chunker_ResynchronisesAfterInsertion) {
+    std::vector<char> original = RandomData(0x400000, 1);
+    std::vector<char> edited = original;
+    edited.insert(edited.begin() + 0x100000, 100, 'x');
+
+    std::vector<std::string> before = Chunks(original);
+    std::vector<std::string> after = Chunks(edited);
+    for (const auto& chunk : before) {
+        EXPECT_LE(chunk.size(), static_cast<size_t>(CHUNK_MAX_SIZE));
+    }
+    for (size_t i = 0; i + 1 < before.size(); i++) {
+        EXPECT_GE(before[i].size(), static_cast<size_t>(CHUNK_MIN_SIZE));
+    }
+
+    std::set<std::string> known(before.begin(), before.end());
+    size_t changed = 0;
+    for (const auto& chunk : after) {
+        changed += known.count(chunk) == 0;
+    }
+    EXPECT_LE(changed, 2u);
+}
+
+// Test case: chunks are stored once and can be read back after reopening the store
+TEST(DedupStoreTest, Put_StoresDuplicatesOnce) {
+    std::filesystem::path directory = CleanDirectory("test_dedup_store_put");
+    std::vector<char> compressible(0x10000, 'a');
+    std::vector<char> random = RandomData(0x8000, 2);
+
+    ChunkId first;
+    ChunkId second;
+    ChunkId other;
+    {
+        auto store = DedupStore::Open(directory.string(), CODEC_DEFAULT_LEVEL);
+        ASSERT_NE(store, nullptr);
+        ASSERT_EQ(store->Put(compressible.data(), compressible.size(), first), Success);
+        ASSERT_EQ(store->Put(compressible.data(), compressible.size(), second), Success);
+        ASSERT_EQ(store->Put(random.data(), random.size(), other), Success);
+        EXPECT_TRUE(first == second);
+        EXPECT_EQ(store->NewChunks(), 2u);
+        EXPECT_EQ(store->DuplicateChunks(), 1u);
+    }
+
+    auto store = DedupStore::Open(directory.string(), CODEC_DEFAULT_LEVEL);
+    ASSERT_NE(store, nullptr);
+    std::vector<char> data;
+    ASSERT_EQ(store->Get(first, data), Success);
+    EXPECT_EQ(data, compressible);
+    ASSERT_EQ(store->Get(other, data), Success);
+    EXPECT_EQ(data, random);
+
+    std::filesystem::remove_all(directory);
+}
+
+// Test case: sessions sharing a store keep each other's index records and find chunks stored after they opened it
+TEST(DedupStoreTest, Flush_SharedStoreKeepsAllRecords) {
+    std::filesystem::path directory = CleanDirectory("test_dedup_store_shared");
+    auto first = DedupStore::Open(directory.string(), CODEC_DEFAULT_LEVEL);
+    auto second = DedupStore::Open(directory.string(), CODEC_DEFAULT_LEVEL);
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+
+    std::vector<ChunkId> firstIds(8);
+    std::vector<ChunkId> secondIds(8);
+    for (unsigned int i = 0; i < 8; i++) {
+        std::vector<char> a = RandomData(0x1000, 100 + i);
+        std::vector<char> b = RandomData(0x1000, 200 + i);
+        ASSERT_EQ(first->Put(a.data(), a.size(), firstIds[i]), Success);
+        ASSERT_EQ(second->Put(b.data(), b.size(), secondIds[i]), Success);
+        ASSERT_EQ(first->Flush(), Success);
+        ASSERT_EQ(second->Flush(), Success);
+    }
+
+    std::vector<char> data;
+    ASSERT_EQ(first->Get(secondIds[7], data), Success);
+    EXPECT_EQ(data, RandomData(0x1000, 207));
+    first.reset();
+    second.reset();
+
+    auto store = DedupStore::Open(directory.string(), CODEC_DEFAULT_LEVEL);
+    ASSERT_NE(store, nullptr);
+    for (unsigned int i = 0; i < 8; i++) {
+        ASSERT_EQ(store->Get(firstIds[i], data), Success);
+        EXPECT_EQ(data, RandomData(0x1000, 100 + i));
+        ASSERT_EQ(store->Get(secondIds[i], data), Success);
+        EXPECT_EQ(data, RandomData(0x1000, 200 + i));
+    }
+    std::filesystem::remove_all(directory);
+}
+
+// Test case: files written through a DedupArchive are restored byte for byte
+TEST(DedupStoreTest, Extract_RestoresArchivedFiles) {
+    std::filesystem::path directory = CleanDirectory("test_dedup_store_archive");
+    std::string archiveName = (directory / "archive.bttf").string();
+    std::vector<char> content = RandomData(0x300000, 3);
+
+    {
+        auto archive = DedupArchive::Create(archiveName, (directory / "store").string(), 0);
+        ASSERT_NE(archive, nullptr);
+        for (const char* name : {"data/one.bin", "data/copy.bin"}) {
+            archive->BeginFile(name);
+            for (size_t offset = 0; offset < content.size(); offset += 77777) {
+                size_t length = std::min<size_t>(77777, content.size() - offset);
+                ASSERT_EQ(archive->Write(content.data() + offset, length), Success);
+            }
+            ASSERT_EQ(archive->EndFile(0, true), Success);
+        }
+        archive->BeginFile("empty.txt");
+        ASSERT_EQ(archive->EndFile(0, true), Success);
+        ASSERT_EQ(archive->Close(), Success);
+    }
+    EXPECT_TRUE(DedupArchive::IsDedupArchive(archiveName));
+
+    std::filesystem::path previous = std::filesystem::current_path();
+    std::filesystem::create_directories(directory / "restore");
+    std::filesystem::current_path(directory / "restore");
+    Status status = DedupArchive::Extract(archiveName, "");
+    std::filesystem::current_path(previous);
+    ASSERT_EQ(status, Success);
+
+    for (const char* name : {"data/one.bin", "data/copy.bin"}) {
+        std::ifstream file(directory / "restore" / name, std::ios::binary);
+        std::vector<char> restored((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        EXPECT_EQ(restored, content) << name;
+    }
+    EXPECT_EQ(std::filesystem::file_size(directory / "restore" / "empty.txt"), 0u);
+
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include "dir_listing.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::filesystem::path MakeDirectory(const std::string& name, int files) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    for (int i = 0; i < files; i++) {
+        /* created out of order, so the listing has to sort */
+        std::ofstream(directory / ("file" + std::to_string((i * 7919) % files))) << i;
+    }
+    return directory;
+}
+
+} // namespace
+
+// Test case: pages hold every entry once, in byte order, and At agrees with them
+TEST(DirListingTest, Page_ReturnsAllEntriesSorted) {
+    std::filesystem::path directory = MakeDirectory("test_dir_listing_sorted", 1000);
+    std::filesystem::create_directory(directory / "subdir");
+    std::vector<std::string> expected;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        expected.push_back(entry.path().filename().string());
+    }
+    std::sort(expected.begin(), expected.end());
+
+    auto listing = DirListing::Open(directory.string(), 64);
+    ASSERT_NE(listing, nullptr);
+    EXPECT_EQ(listing->Size(), expected.size());
+    EXPECT_EQ(listing->PageCount(), (expected.size() + 63) / 64);
+
+    std::vector<std::string> listed;
+    for (size_t page = 0; page < listing->PageCount(); page++) {
+        for (const auto& entry : listing->Page(page)) {
+            listed.push_back(entry.name);
+            EXPECT_EQ(entry.directory, entry.name == "subdir") << entry.name;
+        }
+    }
+    EXPECT_EQ(listed, expected);
+    EXPECT_TRUE(listing->Page(listing->PageCount()).empty());
+
+    /* backwards, each page is found from a remembered boundary */
+    for (size_t index = expected.size(); index-- > 0;) {
+        ListingEntry entry;
+        ASSERT_TRUE(listing->At(index, entry));
+        EXPECT_EQ(entry.name, expected[index]);
+    }
+    ListingEntry entry;
+    EXPECT_FALSE(listing->At(expected.size(), entry));
+
+    std::filesystem::remove_all(directory);
+}
+
+// Test case: the current page is served without reading the directory again until it changes
+TEST(DirListingTest, Page_RereadsOnlyAfterDirectoryChanges) {
+    std::filesystem::path directory = MakeDirectory("test_dir_listing_cache", 100);
+    auto listing = DirListing::Open(directory.string(), 10);
+    ASSERT_NE(listing, nullptr);
+
+    ASSERT_EQ(listing->Page(3).size(), 10u);
+    size_t scans = listing->Scans();
+    listing->Page(3);
+    EXPECT_EQ(listing->Size(), 100u);
+    EXPECT_EQ(listing->Scans(), scans);
+
+    std::ofstream(directory / "file00") << "new";
+    EXPECT_EQ(listing->Size(), 101u);
+    EXPECT_GT(listing->Scans(), scans);
+    ListingEntry entry;
+    ASSERT_TRUE(listing->At(1, entry));
+    EXPECT_EQ(entry.name, "file00");
+
+    EXPECT_EQ(DirListing::Open((directory / "missing").string()), nullptr);
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include "dir_walker.h"
+#include "status.h"
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+
+namespace {
+
+std::filesystem::path CreateTree() {
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "test_dir_walker";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "a" / "b" / "c");
+    std::filesystem::create_directories(root / "d");
+    std::ofstream(root / "top.txt") << "1";
+    std::ofstream(root / "a" / "one.txt") << "22";
+    std::ofstream(root / "a" / "b" / "c" / "deep.txt") << "333";
+    std::ofstream(root / "d" / "other.txt") << "4444";
+    std::filesystem::create_symlink(root / "a", root / "link");
+    return root;
+}
+
+} // namespace
+
+// Test case: Walk reports every file once with its size and does not follow symlinks
+TEST(DirWalkerTest, Walk_VisitsAllFilesWithSizes) {
+    std::filesystem::path root = CreateTree();
+
+    std::mutex lock;
+    std::map<std::string, uint64_t> files;
+    std::set<std::string> links;
+    DirWalker walker(4, true);
+    Status status = walker.Walk(root.string(), [&](const WalkEntry& entry) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (entry.type == DT_REG) {
+            files[entry.path] = entry.size;
+        } else if (entry.type == DT_LNK) {
+            links.insert(entry.path);
+        }
+    });
+
+    EXPECT_EQ(status, Success);
+    std::map<std::string, uint64_t> expected = {
+        {(root / "top.txt").string(), 1},
+        {(root / "a" / "one.txt").string(), 2},
+        {(root / "a" / "b" / "c" / "deep.txt").string(), 3},
+        {(root / "d" / "other.txt").string(), 4},
+    };
+    EXPECT_EQ(files, expected);
+    EXPECT_EQ(links, std::set<std::string>{(root / "link").string()});
+
+    std::filesystem::remove_all(root);
+}
+
+// Test case: Start/Next streams the same entries as a blocking walk
+TEST(DirWalkerTest, Next_StreamsEntriesFromBackgroundWalk) {
+    std::filesystem::path root = CreateTree();
+
+    std::set<std::string> files;
+    DirWalker walker(2);
+    walker.Start(root.string());
+    WalkEntry entry;
+    while (walker.Next(entry)) {
+        if (entry.type == DT_REG) {
+            files.insert(entry.path);
+        }
+    }
+
+    EXPECT_EQ(files.size(), 4u);
+    EXPECT_EQ(files.count((root / "a" / "b" / "c" / "deep.txt").string()), 1u);
+
+    std::filesystem::remove_all(root);
+}
+
+// Test case: a missing root is reported as AccessFileFailed
+TEST(DirWalkerTest, Walk_ReturnsAccessFileFailed_WhenRootMissing) {
+    DirWalker walker(1);
+    Status status = walker.Walk("/nonexistent/test_dir_walker", [](const WalkEntry&) {});
+    EXPECT_EQ(status, AccessFileFailed);
+}
+
+// Test case: Stop ends a streamed walk early from another thread
+TEST(DirWalkerTest, Stop_EndsStreamedWalk) {
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "test_dir_walker_stop";
+    std::filesystem::remove_all(root);
+    /* more entries than the stream buffers, so the walk cannot finish before Stop */
+    for (int i = 0; i < 200; i++) {
+        std::filesystem::path directory = root / ("dir" + std::to_string(i));
+        std::filesystem::create_directories(directory);
+        for (int j = 0; j < 100; j++) {
+            std::ofstream(directory / ("file" + std::to_string(j))) << j;
+        }
+    }
+
+    DirWalker walker(2);
+    walker.Start(root.string());
+    WalkEntry entry;
+    ASSERT_TRUE(walker.Next(entry));
+    std::thread([&walker]() { walker.Stop(); }).join();
+    size_t entries = 1;
+    while (walker.Next(entry)) {
+        entries++;
+    }
+    EXPECT_LT(entries, 200u * 101u);
+
+    std::filesystem::remove_all(root);
+}
+
+// Test case: an ordered walk reports entries sorted depth first, and resumes right after a given path
+TEST(DirWalkerTest, Ordered_WalksSortedAndResumesAfterPath) {
+    std::filesystem::path root = CreateTree();
+    auto walk = [&root](const std::string& after) {
+        std::vector<std::string> paths;
+        DirWalker walker(4, false, true);
+        if (!after.empty()) {
+            walker.ResumeAfter((root / after).string());
+        }
+        walker.Start(root.string());
+        WalkEntry entry;
+        while (walker.Next(entry)) {
+            paths.push_back(entry.path.substr(root.string().size() + 1));
+        }
+        return paths;
+    };
+
+    std::vector<std::string> all = {"a", "a/b", "a/b/c", "a/b/c/deep.txt", "a/one.txt", "d", "d/other.txt", "link", "top.txt"};
+    EXPECT_EQ(walk(""), all);
+    EXPECT_EQ(walk("a/b/c/deep.txt"), std::vector<std::string>(all.begin() + 4, all.end()));
+    /* a directory as resume point: its contents follow it */
+    EXPECT_EQ(walk("d"), std::vector<std::string>(all.begin() + 6, all.end()));
+    /* a path that vanished since: the walk continues with what sorts after it */
+    EXPECT_EQ(walk("a/b/gone.txt"), std::vector<std::string>(all.begin() + 4, all.end()));
+    EXPECT_TRUE(walk("top.txt").empty());
+
+    std::filesystem::remove_all(root);
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "disk_writer.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const int64_t MTIME = 1700000000LL * 1000000000LL + 123456789;
+
+fs::path MakeRoot(const std::string& name) {
+    fs::path root = fs::temp_directory_path() / name;
+    fs::remove_all(root);
+    fs::create_directories(root);
+    return root;
+}
+
+std::string ReadFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+} // namespace
+
+// Test case: files are created with their parents, written at block offsets and given their metadata
+TEST(DiskWriterTest, EndFile_WritesDataAndMetadata) {
+    fs::path root = MakeRoot("test_disk_writer_file");
+    auto writer = DiskWriter::Open(root.string(), Durability::PerFile);
+    ASSERT_NE(writer, nullptr);
+
+    DiskFile file;
+    ASSERT_EQ(writer->BeginFile(DiskEntry{"./a/b/file.txt", 0640, MTIME, 10}, file), Success);
+    EXPECT_EQ(writer->WriteBlock(file, "world", 5, 5), Success);
+    EXPECT_EQ(writer->WriteBlock(file, "hello", 5, 0), Success);
+    EXPECT_EQ(writer->EndFile(file), Success);
+    EXPECT_EQ(writer->Finish(), Success);
+
+    EXPECT_EQ(ReadFile(root / "a/b/file.txt"), "helloworld");
+    struct stat st;
+    ASSERT_EQ(stat((root / "a/b/file.txt").c_str(), &st), 0);
+    EXPECT_EQ(st.st_mode & 07777, 0640u);
+    EXPECT_EQ(st.st_mtim.tv_sec, MTIME / 1000000000LL);
+    EXPECT_EQ(st.st_mtim.tv_nsec, MTIME % 1000000000LL);
+    fs::remove_all(root);
+}
+
+// Test case: directory metadata survives the creation of children and is applied by Finish
+TEST(DiskWriterTest, Finish_AppliesDirectoryMetadataAfterChildren) {
+    fs::path root = MakeRoot("test_disk_writer_dir");
+    auto writer = DiskWriter::Open(root.string(), Durability::SyncAtEnd);
+    ASSERT_NE(writer, nullptr);
+
+    EXPECT_EQ(writer->MakeDirectory(DiskEntry{"dir/", 0750, MTIME, 0}), Success);
+    DiskFile file;
+    ASSERT_EQ(writer->BeginFile(DiskEntry{"dir/file", 0644, MTIME, 0}, file), Success);
+    EXPECT_EQ(writer->EndFile(file), Success);
+    EXPECT_EQ(writer->Link(DiskEntry{"dir/link", 0644, MTIME, 0}, "dir/file"), Success);
+    EXPECT_EQ(writer->Finish(), Success);
+
+    struct stat st;
+    ASSERT_EQ(stat((root / "dir").c_str(), &st), 0);
+    EXPECT_EQ(st.st_mode & 07777, 0750u);
+    EXPECT_EQ(st.st_mtim.tv_sec, MTIME / 1000000000LL);
+    ASSERT_EQ(stat((root / "dir/link").c_str(), &st), 0);
+    EXPECT_EQ(st.st_nlink, 2u);
+    fs::remove_all(root);
+}
+
+// Test case: paths leaving the destination are refused
+TEST(DiskWriterTest, BeginFile_RejectsParentReferences) {
+    fs::path root = MakeRoot("test_disk_writer_escape");
+    auto writer = DiskWriter::Open((root / "inner").string(), Durability::None);
+    EXPECT_EQ(writer, nullptr);
+    fs::create_directories(root / "inner");
+    writer = DiskWriter::Open((root / "inner").string(), Durability::None);
+    ASSERT_NE(writer, nullptr);
+
+    DiskFile file;
+    EXPECT_EQ(writer->BeginFile(DiskEntry{"../escaped", 0644, 0, 0}, file), AccessFileFailed);
+    EXPECT_EQ(writer->Link(DiskEntry{"link", 0644, 0, 0}, "../escaped"), AccessFileFailed);
+    EXPECT_FALSE(fs::exists(root / "escaped"));
+    fs::remove_all(root);
+}
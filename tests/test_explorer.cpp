@@ -55,3 +55,25 @@ TEST(ExplorerTest, SelectItemToArchive_ValidFileSelection) {
     std::filesystem::remove(tempFile);
     std::filesystem::remove(tempDir);
 }
+
+// Test case: entries past the first page can be paged to and selected by their index
+TEST(ExplorerTest, SelectItemToArchive_SelectsEntryOnLaterPage) {
+    std::filesystem::path tempDir = std::filesystem::temp_directory_path() / "test_explorer_pages";
+    std::filesystem::create_directory(tempDir);
+    for (int i = 119; i >= 0; i--) {
+        char name[32];
+        snprintf(name, sizeof(name), "file_%03d.txt", i);
+        std::ofstream(tempDir / name) << i;
+    }
+
+    Explorer explorer(tempDir.string());
+    MockCin mockInput("N\nN\nP\n60\n");
+
+    std::filesystem::directory_entry selectedLocation;
+    Status status = explorer.SelectItemToArchive(&selectedLocation);
+
+    EXPECT_EQ(status, Success);
+    EXPECT_EQ(selectedLocation.path(), tempDir / "file_060.txt");
+
+    std::filesystem::remove_all(tempDir);
+}
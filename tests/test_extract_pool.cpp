@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include "extract_pool.h"
+#include "mock_libarchive_wrapper.h"
+#include "status.h"
+
+using ::testing::_;
+using ::testing::Return;
+
+namespace {
+
+ExtractJob MakeJob(struct archive_entry* entry, size_t size) {
+    ExtractJob job;
+    job.entry = entry;
+    job.data.assign(size, 'x');
+    job.blocks.emplace_back(0, size);
+    return job;
+}
+
+} // namespace
+
+// Test case: every submitted job is written and finished on a worker's own disk handle
+TEST(ExtractPoolTest, Finish_WritesAllJobsOnWorkerHandles) {
+    MockLibArchiveWrapper mockLibArchive;
+    struct archive* disk = reinterpret_cast<struct archive*>(0x10);
+    struct archive_entry* entry = reinterpret_cast<struct archive_entry*>(0x20);
+    EXPECT_CALL(mockLibArchive, archive_write_disk_new()).Times(2).WillRepeatedly(Return(disk));
+    EXPECT_CALL(mockLibArchive, archive_write_disk_set_options(disk, ARCHIVE_EXTRACT_PERM)).Times(2);
+    EXPECT_CALL(mockLibArchive, archive_write_disk_set_standard_lookup(disk)).Times(2);
+    EXPECT_CALL(mockLibArchive, archive_write_header(disk, entry)).Times(3).WillRepeatedly(Return(ARCHIVE_OK));
+    EXPECT_CALL(mockLibArchive, archive_write_data_block(disk, _, 100, 0)).Times(3).WillRepeatedly(Return(ARCHIVE_OK));
+    EXPECT_CALL(mockLibArchive, archive_write_finish_entry(disk)).Times(3).WillRepeatedly(Return(ARCHIVE_OK));
+    EXPECT_CALL(mockLibArchive, archive_entry_free(entry)).Times(3);
+    EXPECT_CALL(mockLibArchive, archive_write_close(disk)).Times(2);
+    EXPECT_CALL(mockLibArchive, archive_write_free(disk)).Times(2);
+
+    ExtractPool pool(mockLibArchive, 2, ARCHIVE_EXTRACT_PERM);
+    for (int i = 0; i < 3; i++) {
+        pool.Submit(MakeJob(entry, 100));
+    }
+    pool.Drain();
+
+    EXPECT_EQ(pool.Finish(), Success);
+}
+
+// Test case: a failing header is reported by Finish
+TEST(ExtractPoolTest, Finish_ReturnsAccessFileFailed_WhenHeaderFails) {
+    MockLibArchiveWrapper mockLibArchive;
+    struct archive* disk = reinterpret_cast<struct archive*>(0x10);
+    struct archive_entry* entry = reinterpret_cast<struct archive_entry*>(0x20);
+    EXPECT_CALL(mockLibArchive, archive_write_disk_new()).WillOnce(Return(disk));
+    EXPECT_CALL(mockLibArchive, archive_write_header(disk, entry)).WillOnce(Return(ARCHIVE_FATAL));
+    EXPECT_CALL(mockLibArchive, archive_error_string(disk)).WillRepeatedly(Return("mock failure"));
+    EXPECT_CALL(mockLibArchive, archive_entry_free(entry)).Times(1);
+
+    ExtractPool pool(mockLibArchive, 1, 0);
+    pool.Submit(MakeJob(entry, 10));
+
+    EXPECT_EQ(pool.Finish(), AccessFileFailed);
+}
+
+// Test case: a failing data block is reported by Finish even though the entry could be finished
+TEST(ExtractPoolTest, Finish_ReturnsAccessFileFailed_WhenDataBlockFails) {
+    MockLibArchiveWrapper mockLibArchive;
+    struct archive* disk = reinterpret_cast<struct archive*>(0x10);
+    struct archive_entry* entry = reinterpret_cast<struct archive_entry*>(0x20);
+    EXPECT_CALL(mockLibArchive, archive_write_disk_new()).WillOnce(Return(disk));
+    EXPECT_CALL(mockLibArchive, archive_write_header(disk, entry)).WillOnce(Return(ARCHIVE_OK));
+    EXPECT_CALL(mockLibArchive, archive_write_data_block(disk, _, 10, 0)).WillOnce(Return(ARCHIVE_FATAL));
+    EXPECT_CALL(mockLibArchive, archive_write_finish_entry(disk)).WillOnce(Return(ARCHIVE_OK));
+    EXPECT_CALL(mockLibArchive, archive_error_string(disk)).WillRepeatedly(Return("mock failure"));
+    EXPECT_CALL(mockLibArchive, archive_entry_free(entry)).Times(1);
+
+    ExtractPool pool(mockLibArchive, 1, 0);
+    pool.Submit(MakeJob(entry, 10));
+
+    EXPECT_EQ(pool.Finish(), AccessFileFailed);
+}
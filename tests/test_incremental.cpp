@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include "archiver.h"
+#include "libarchive_wrapper.h"
+#include "manifest.h"
+#include <archive.h>
+#include <archive_entry.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+fs::path MakeRoot(const std::string& name) {
+    fs::path root = fs::temp_directory_path() / name;
+    fs::remove_all(root);
+    fs::create_directories(root);
+    return root;
+}
+
+void WriteFile(const fs::path& path, const std::string& content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream file(path, std::ios::binary);
+    file << content;
+}
+
+std::string ReadFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+ArchiverOptions PackOptions() {
+    ArchiverOptions options;
+    options.codec = Codec::Zstd;
+    options.threads = 1;
+    options.walkerThreads = 2;
+    return options;
+}
+
+Status Pack(const fs::path& archive, const fs::path& tree, const ArchiverOptions& options) {
+    Archiver archiver(archive.string(), std::make_unique<LibArchiveWrapper>(), options);
+    Status status = archiver.ArchiveItem(fs::directory_entry(tree));
+    Status finishStatus = archiver.Finish();
+    return status != Success ? status : finishStatus;
+}
+
+Status Unpack(const fs::path& archive, const fs::path& destination, bool nativeWriter) {
+    ArchiverOptions options;
+    options.extractDirectory = destination.string();
+    options.extractThreads = 4;
+    options.nativeWriter = nativeWriter;
+    Archiver archiver(std::make_unique<LibArchiveWrapper>(), options);
+    return archiver.Extract(archive.string());
+}
+
+} // namespace
+
+// Test case: files named like whiteouts are ordinary files in a full archive and are restored and verified
+TEST(IncrementalTest, FullArchive_KeepsWhiteoutNamedFiles) {
+    fs::path root = MakeRoot("test_incremental_names");
+    WriteFile(root / "tree/foo", "foo");
+    WriteFile(root / "tree/.wh.foo", "not a whiteout");
+    WriteFile(root / "tree/d/.wh..wh.opq", "opaque");
+
+    fs::path archive = root / "full.tar.zst";
+    ASSERT_EQ(Pack(archive, root / "tree", PackOptions()), Success);
+    ASSERT_EQ(Unpack(archive, root / "out", false), Success);
+
+    EXPECT_EQ(ReadFile(root / "out/tree/foo"), "foo");
+    EXPECT_EQ(ReadFile(root / "out/tree/.wh.foo"), "not a whiteout");
+    EXPECT_EQ(ReadFile(root / "out/tree/d/.wh..wh.opq"), "opaque");
+
+    Archiver verifier(std::make_unique<LibArchiveWrapper>(), ArchiverOptions());
+    VerifyResult result;
+    EXPECT_EQ(verifier.Verify(archive.string(), result), Success);
+    EXPECT_EQ(result.verified, 3u);
+    EXPECT_TRUE(result.missing.empty());
+    fs::remove_all(root);
+}
+
+// Test case: reproducible archives of the same tree are byte-identical even with several walker threads
+TEST(IncrementalTest, FullArchive_ReproducibleIsByteIdentical) {
+    fs::path root = MakeRoot("test_incremental_reproducible");
+    for (int i = 0; i < 64; i++) {
+        for (int j = 0; j < 4; j++) {
+            WriteFile(root / "tree" / ("d" + std::to_string(i)) / ("f" + std::to_string(j)), std::string(i * 4 + j, 'x'));
+        }
+    }
+
+    ArchiverOptions options = PackOptions();
+    options.walkerThreads = 4;
+    options.reproducible = true;
+    ASSERT_EQ(Pack(root / "first.tar.zst", root / "tree", options), Success);
+    ASSERT_EQ(Pack(root / "second.tar.zst", root / "tree", options), Success);
+    EXPECT_EQ(ReadFile(root / "first.tar.zst"), ReadFile(root / "second.tar.zst"));
+    fs::remove_all(root);
+}
+
+// Test case: a full archive followed by an incremental one restores the latest tree, deletions and type changes included
+TEST(IncrementalTest, Incremental_AppliesDeletionsBeforeNewFiles) {
+    for (bool nativeWriter : {false, true}) {
+        SCOPED_TRACE(nativeWriter ? "native writer" : "libarchive writer");
+        fs::path root = MakeRoot("test_incremental_replace");
+        fs::path tree = root / "tree";
+        WriteFile(tree / "kept.txt", "kept");
+        WriteFile(tree / "changed.txt", "old");
+        WriteFile(tree / "gone.txt", "gone");
+        WriteFile(tree / "d/f", "file");
+        WriteFile(tree / "d/.wh.g", "whiteout named");
+        WriteFile(tree / "e/x", "below a directory");
+        WriteFile(tree / "e/y/z", "deeper below it");
+        for (int i = 0; i < 32; i++) {
+            WriteFile(tree / "many" / ("file" + std::to_string(i)), std::string(i * 100, 'x'));
+        }
+
+        fs::path full = root / "full.tar.zst";
+        ASSERT_EQ(Pack(full, tree, PackOptions()), Success);
+
+        fs::remove(tree / "gone.txt");
+        fs::remove(tree / "d/f");
+        WriteFile(tree / "d/f/x", "now a directory");
+        WriteFile(tree / "changed.txt", "new content");
+        WriteFile(tree / "d/g", "beside the whiteout named file");
+        fs::remove_all(tree / "e");
+        WriteFile(tree / "e", "now a file");
+
+        fs::path incremental = root / "incremental.tar.zst";
+        ArchiverOptions options = PackOptions();
+        options.baseManifest = full.string() + MANIFEST_SUFFIX;
+        ASSERT_EQ(Pack(incremental, tree, options), Success);
+
+        fs::path out = root / "out";
+        ASSERT_EQ(Unpack(full, out, nativeWriter), Success);
+        ASSERT_EQ(Unpack(incremental, out, nativeWriter), Success);
+
+        EXPECT_EQ(ReadFile(out / "tree/kept.txt"), "kept");
+        EXPECT_EQ(ReadFile(out / "tree/changed.txt"), "new content");
+        EXPECT_FALSE(fs::exists(out / "tree/gone.txt"));
+        EXPECT_EQ(ReadFile(out / "tree/d/f/x"), "now a directory");
+        EXPECT_EQ(ReadFile(out / "tree/d/.wh.g"), "whiteout named");
+        EXPECT_EQ(ReadFile(out / "tree/d/g"), "beside the whiteout named file");
+        EXPECT_EQ(ReadFile(out / "tree/e"), "now a file");
+        EXPECT_EQ(fs::file_size(out / "tree/many/file31"), 3100u);
+        fs::remove_all(root);
+    }
+}
+
+// Test case: whiteouts pointing outside the extraction directory are refused
+TEST(IncrementalTest, Extract_RefusesWhiteoutsOutsideTarget) {
+    fs::path root = MakeRoot("test_incremental_escape");
+    WriteFile(root / "victim", "keep me");
+    fs::create_directories(root / "out/inside");
+    fs::create_symlink(root, root / "out/link");
+
+    fs::path archive = root / "crafted.tar";
+    struct archive* writer = archive_write_new();
+    archive_write_set_format_pax_restricted(writer);
+    ASSERT_EQ(archive_write_open_filename(writer, archive.c_str()), ARCHIVE_OK);
+    for (const std::string& target : {std::string("../victim"), (root / "victim").string(), std::string("link/victim")}) {
+        struct archive_entry* entry = archive_entry_new();
+        archive_entry_set_pathname(entry, ".wh.victim");
+        archive_entry_set_filetype(entry, AE_IFREG);
+        archive_entry_set_perm(entry, 0644);
+        archive_entry_set_size(entry, 0);
+        archive_entry_xattr_add_entry(entry, "bttf.whiteout", target.data(), target.size());
+        ASSERT_EQ(archive_write_header(writer, entry), ARCHIVE_OK);
+        archive_entry_free(entry);
+    }
+    archive_write_close(writer);
+    archive_write_free(writer);
+
+    EXPECT_EQ(Unpack(archive, root / "out", false), AccessFileFailed);
+    EXPECT_EQ(ReadFile(root / "victim"), "keep me");
+    EXPECT_TRUE(fs::exists(root / "out/inside"));
+    EXPECT_FALSE(fs::exists(root / "out/.wh.victim"));
+    fs::remove_all(root);
+}
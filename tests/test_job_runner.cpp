@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "job_runner.h"
+#include "status.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+std::string WriteManifest(const std::string& name, const std::string& content) {
+    std::string filename = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream file(filename);
+    file << content;
+    return filename;
+}
+
+} // namespace
+
+// Test case: pack and unpack lines are parsed with their settings, and defaults fill the rest
+TEST(JobRunnerTest, ParseJobManifest_ReadsPackAndUnpackJobs) {
+    std::string filename = WriteManifest("test_job_runner_valid.jobs",
+        "# nightly jobs\n"
+        "\n"
+        "pack /srv/a /backup/a.tar.zst codec=zstd level=3 reproducible seekable\n"
+        "pack \"/srv/with space\" /backup/b.tar.xz checkpoint\n"
+        "unpack /backup/c.tar.xz /restore/c native-writer\n");
+    ArchiverOptions defaults;
+    defaults.codec = Codec::Xz;
+    defaults.ioUring = true;
+
+    std::vector<Job> jobs;
+    ASSERT_EQ(ParseJobManifest(filename, defaults, jobs), Success);
+    ASSERT_EQ(jobs.size(), 3u);
+
+    EXPECT_EQ(jobs[0].kind, JobKind::Pack);
+    EXPECT_EQ(jobs[0].source, "/srv/a");
+    EXPECT_EQ(jobs[0].target, "/backup/a.tar.zst");
+    EXPECT_EQ(jobs[0].options.codec, Codec::Zstd);
+    EXPECT_EQ(jobs[0].options.level, 3);
+    EXPECT_TRUE(jobs[0].options.seekable);
+    EXPECT_TRUE(jobs[0].options.reproducible);
+    EXPECT_TRUE(jobs[0].options.ioUring);
+
+    EXPECT_EQ(jobs[1].source, "/srv/with space");
+    EXPECT_EQ(jobs[1].options.codec, Codec::Xz);
+    EXPECT_TRUE(jobs[1].options.seekable);
+    EXPECT_TRUE(jobs[1].options.checkpoint);
+    EXPECT_FALSE(jobs[0].options.checkpoint);
+
+    EXPECT_EQ(jobs[2].kind, JobKind::Unpack);
+    EXPECT_EQ(jobs[2].source, "/backup/c.tar.xz");
+    EXPECT_EQ(jobs[2].options.extractDirectory, "/restore/c");
+    EXPECT_TRUE(jobs[2].options.nativeWriter);
+}
+
+// Test case: malformed lines and missing manifests are rejected without partial results
+TEST(JobRunnerTest, ParseJobManifest_RejectsInvalidLines) {
+    std::vector<Job> jobs;
+    for (const char* content : {"pack /srv/a\n", "copy /srv/a /b\n", "pack /srv/a /b.tar.lz4 codec=lz4 level=42\n",
+                                "unpack /b.tar /c seekable\n", "pack \"/srv/a /b.tar\n"}) {
+        std::string filename = WriteManifest("test_job_runner_invalid.jobs", std::string("pack /ok /ok.tar\n") + content);
+        EXPECT_EQ(ParseJobManifest(filename, {}, jobs), TooManyArgs) << content;
+        EXPECT_TRUE(jobs.empty()) << content;
+    }
+    EXPECT_EQ(ParseJobManifest("/nonexistent/test.jobs", {}, jobs), CannotOpenFile);
+}
+
+// Test case: running jobs never hold more than the thread budget, never exceed the parallel limit and keep their status order
+TEST(JobRunnerTest, Run_SplitsBudgetAndReportsEveryJob) {
+    std::vector<Job> jobs(12);
+    for (size_t i = 0; i < jobs.size(); i++) {
+        jobs[i].kind = i % 2 == 0 ? JobKind::Pack : JobKind::Unpack;
+        jobs[i].source = std::to_string(i);
+        jobs[i].options.prefetchBytes = 8 << 20;
+    }
+
+    std::mutex mutex;
+    int running = 0;
+    int peak = 0;
+    unsigned int threads = 0;
+    uint64_t prefetch = 0;
+    std::vector<size_t> reported;
+    JobRunner runner(8, 3);
+    std::vector<Status> statuses = runner.Run(jobs, [&](const Job& job) {
+        /* walker and compression of a pack job, decoder and writers of an unpack job */
+        unsigned int used = job.kind == JobKind::Pack ? job.options.walkerThreads + job.options.threads
+                                                      : job.options.extractThreads + 1;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            peak = std::max(peak, ++running);
+            threads += used;
+            prefetch += job.options.prefetchBytes;
+            EXPECT_LE(threads, 8u);
+            EXPECT_LE(prefetch, 8u << 20);
+        }
+        EXPECT_GE(used, 2u);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --running;
+            threads -= used;
+            prefetch -= job.options.prefetchBytes;
+        }
+        return job.source == "4" || job.source == "9" ? WriteFailed : Success;
+    }, [&](size_t index, Status) {
+        reported.push_back(index);
+    });
+
+    ASSERT_EQ(statuses.size(), jobs.size());
+    for (size_t i = 0; i < statuses.size(); i++) {
+        EXPECT_EQ(statuses[i], i == 4 || i == 9 ? WriteFailed : Success) << i;
+    }
+    EXPECT_LE(peak, 3);
+    EXPECT_EQ(reported.size(), jobs.size());
+    EXPECT_EQ(JobRunner::Aggregate(statuses), WriteFailed);
+    EXPECT_EQ(JobRunner::Aggregate({Success, Success}), Success);
+    EXPECT_EQ(JobRunner::Aggregate({Success, NotFound, WriteFailed}), NotFound);
+}
+
+// Test case: no more jobs run than there are threads, and a job running alone gets the whole budget
+TEST(JobRunnerTest, Run_CapsSlotsAtBudget) {
+    std::vector<Job> jobs(6);
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    JobRunner runner(2, 8);
+    runner.Run(jobs, [&](const Job& job) {
+        int now = ++running;
+        int previous = peak.load();
+        while (now > previous && !peak.compare_exchange_weak(previous, now)) {}
+        EXPECT_EQ(job.options.walkerThreads + job.options.threads, 2u);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        --running;
+        return Success;
+    });
+    EXPECT_LE(peak.load(), 2);
+
+    JobRunner single(16, 4);
+    std::vector<Status> statuses = single.Run(std::vector<Job>(1), [&](const Job& job) {
+        EXPECT_EQ(job.options.walkerThreads, 4u);
+        EXPECT_EQ(job.options.threads, 12u);
+        return Success;
+    });
+    EXPECT_EQ(statuses, std::vector<Status>{Success});
+}
@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include "link_table.h"
+#include <string>
+
+// Test case: every added file is found again with its first path, also after the table has grown
+TEST(LinkTableTest, Find_ReturnsFirstPathAfterGrowth) {
+    LinkTable table;
+    for (uint64_t inode = 1; inode <= 100000; inode++) {
+        table.Add(1, inode, "dir/file" + std::to_string(inode));
+    }
+    table.Add(1, 42, "dir/second");
+    EXPECT_EQ(table.Size(), 100000u);
+
+    std::string path;
+    uint64_t hash = 1;
+    ASSERT_TRUE(table.Find(1, 42, path, hash));
+    EXPECT_EQ(path, "dir/file42");
+    EXPECT_EQ(hash, 0u);
+    ASSERT_TRUE(table.Find(1, 99999, path, hash));
+    EXPECT_EQ(path, "dir/file99999");
+    EXPECT_FALSE(table.Find(1, 100001, path, hash));
+
+    table.Clear();
+    EXPECT_FALSE(table.Find(1, 42, path, hash));
+}
+
+// Test case: equal inode numbers on different devices are different files
+TEST(LinkTableTest, Find_DistinguishesDevices) {
+    LinkTable table;
+    table.Add(1, 7, "a");
+    table.Add(2, 7, "b");
+    table.SetContentHash(2, 7, 0xabcdef);
+
+    std::string path;
+    uint64_t hash;
+    ASSERT_TRUE(table.Find(1, 7, path, hash));
+    EXPECT_EQ(path, "a");
+    EXPECT_EQ(hash, 0u);
+    ASSERT_TRUE(table.Find(2, 7, path, hash));
+    EXPECT_EQ(path, "b");
+    EXPECT_EQ(hash, 0xabcdefu);
+    EXPECT_FALSE(table.Find(3, 7, path, hash));
+}
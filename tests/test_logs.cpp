@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+/* debug messages compiled out, warnings and errors kept */
+#define LOG_MIN_LEVEL 2
+#include "logs.h"
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+/* Redirects std::cout while a test runs; the runtime level is read once, so set it before the first message. */
+class LogsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        setenv("NAVTOR_DEBUG_LOG", "debug", 1);
+        Previous = std::cout.rdbuf(Output.rdbuf());
+    }
+
+    void TearDown() override {
+        std::cout.rdbuf(Previous);
+    }
+
+    std::ostringstream Output;
+    std::streambuf* Previous = nullptr;
+};
+
+} // namespace
+
+// Test case: messages are written in order by the background writer once flushed
+TEST_F(LogsTest, LogPrint_WritesMessagesInOrder) {
+    log_print(LOG_LEVEL_WARNING, "first", 1, "two");
+    log_print(LOG_LEVEL_ERROR, "second");
+    log_flush();
+
+    EXPECT_EQ(Output.str(), "first 1 two\nsecond\n");
+}
+
+// Test case: messages below the compile-time level are removed along with their arguments
+TEST_F(LogsTest, DebugPrint_IsCompiledOutBelowMinimumLevel) {
+    int evaluated = 0;
+    debug_print("debug", ++evaluated);
+    log_print(LOG_LEVEL_INFO, "info", ++evaluated);
+    log_print(LOG_LEVEL_WARNING, "warning", evaluated);
+    log_flush();
+
+    EXPECT_EQ(evaluated, 0);
+    EXPECT_EQ(Output.str(), "warning 0\n");
+}
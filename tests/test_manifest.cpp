@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include "manifest.h"
+#include "xxhash64.h"
+#include "status.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+
+std::string ManifestPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+} // namespace
+
+// Test case: every written entry can be found again with all its fields
+TEST(ManifestTest, Write_ThenFind_ReturnsRecordedEntries) {
+    std::string filename = ManifestPath("test_manifest_roundtrip.manifest");
+
+    ManifestWriter writer;
+    for (int i = 0; i < 1000; i++) {
+        std::string path = "dir" + std::to_string(i % 10) + "/file" + std::to_string(i);
+        ManifestEntry entry;
+        entry.path = path;
+        entry.size = i;
+        entry.mtime = 1700000000000000000LL + i;
+        entry.inode = 5000 + i;
+        entry.contentHash = Xxh64::Hash(path.data(), path.size());
+        writer.Add(entry);
+    }
+    ASSERT_EQ(writer.Write(filename), Success);
+
+    auto manifest = Manifest::Open(filename);
+    ASSERT_NE(manifest, nullptr);
+    EXPECT_EQ(manifest->Size(), 1000u);
+    for (int i = 0; i < 1000; i++) {
+        std::string path = "dir" + std::to_string(i % 10) + "/file" + std::to_string(i);
+        ManifestEntry entry;
+        size_t index;
+        ASSERT_TRUE(manifest->Find(path, entry, index)) << path;
+        EXPECT_EQ(entry.path, path);
+        EXPECT_EQ(entry.size, static_cast<uint64_t>(i));
+        EXPECT_EQ(entry.mtime, 1700000000000000000LL + i);
+        EXPECT_EQ(entry.inode, static_cast<uint64_t>(5000 + i));
+        EXPECT_EQ(entry.contentHash, Xxh64::Hash(path.data(), path.size()));
+        EXPECT_EQ(manifest->At(index).path, path);
+    }
+
+    std::filesystem::remove(filename);
+}
+
+// Test case: unknown paths are not found
+TEST(ManifestTest, Find_ReturnsFalse_ForUnknownPath) {
+    std::string filename = ManifestPath("test_manifest_missing.manifest");
+
+    ManifestWriter writer;
+    ManifestEntry entry;
+    entry.path = "a.txt";
+    writer.Add(entry);
+    ASSERT_EQ(writer.Write(filename), Success);
+
+    auto manifest = Manifest::Open(filename);
+    ASSERT_NE(manifest, nullptr);
+    size_t index;
+    EXPECT_TRUE(manifest->Find("a.txt", entry, index));
+    EXPECT_FALSE(manifest->Find("b.txt", entry, index));
+    EXPECT_FALSE(manifest->Find("a.tx", entry, index));
+
+    std::filesystem::remove(filename);
+}
+
+// Test case: files that are not manifests are rejected
+TEST(ManifestTest, Open_ReturnsNull_ForMalformedFile) {
+    std::string filename = ManifestPath("test_manifest_malformed.manifest");
+    std::ofstream(filename) << "definitely not a manifest, just some text";
+
+    EXPECT_EQ(Manifest::Open(filename), nullptr);
+    EXPECT_EQ(Manifest::Open(ManifestPath("test_manifest_does_not_exist.manifest")), nullptr);
+
+    std::filesystem::remove(filename);
+}
+
+// Test case: a manifest whose record points past the path blob is rejected
+TEST(ManifestTest, Open_ReturnsNull_ForPathOutOfRange) {
+    std::string filename = ManifestPath("test_manifest_out_of_range.manifest");
+    ManifestWriter writer;
+    ManifestEntry entry;
+    entry.path = "a.txt";
+    writer.Add(entry);
+    entry.path = "b.txt";
+    writer.Add(entry);
+    ASSERT_EQ(writer.Write(filename), Success);
+    ASSERT_NE(Manifest::Open(filename), nullptr);
+
+    /* pathLength of the second record, behind the 32 byte header and the 56 byte first record */
+    {
+        std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(32 + 56 + 16);
+        uint32_t length = 0x10000;
+        file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    }
+    EXPECT_EQ(Manifest::Open(filename), nullptr);
+
+    std::filesystem::remove(filename);
+}
@@ -0,0 +1,416 @@
+#include <gtest/gtest.h>
+#include "read_pipeline.h"
+#include "status.h"
+#include "xxhash64.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Test case: the pipeline reproduces file content in order, framed by Begin/End
+TEST(ReadPipelineTest, Next_ReturnsFileContentInOrder) {
+    std::filesystem::path tempFile = std::filesystem::temp_directory_path() / "test_read_pipeline.bin";
+    std::string content;
+    for (size_t i = 0; i < 3 * PIPELINE_BUFFER_SIZE + 123; i++) {
+        content.push_back(static_cast<char>(i * 31));
+    }
+    std::ofstream(tempFile, std::ios::binary) << content;
+
+    bool pending = true;
+    ReadPipeline pipeline([&](std::string& path) {
+        path = tempFile.string();
+        return std::exchange(pending, false);
+    });
+
+    std::vector<FileChunk::Kind> kinds;
+    std::string readBack;
+    FileChunk chunk;
+    while (pipeline.Next(chunk)) {
+        kinds.push_back(chunk.kind);
+        if (chunk.kind == FileChunk::Begin) {
+            EXPECT_EQ(chunk.size, content.size());
+        } else if (chunk.kind == FileChunk::Data) {
+            readBack.append(chunk.data, chunk.size);
+        } else if (chunk.kind == FileChunk::End) {
+            EXPECT_EQ(chunk.status, Success);
+        }
+        pipeline.Release(chunk);
+    }
+
+    EXPECT_EQ(readBack, content);
+    ASSERT_GE(kinds.size(), 2u);
+    EXPECT_EQ(kinds.front(), FileChunk::Begin);
+    EXPECT_EQ(kinds.back(), FileChunk::End);
+
+    std::filesystem::remove(tempFile);
+}
+
+// Test case: a file that cannot be opened is reported in its End chunk
+TEST(ReadPipelineTest, Next_ReportsMissingFile) {
+    bool pending = true;
+    ReadPipeline pipeline([&](std::string& path) {
+        path = "/nonexistent/test_read_pipeline.bin";
+        return std::exchange(pending, false);
+    });
+
+    Status endStatus = Success;
+    FileChunk chunk;
+    while (pipeline.Next(chunk)) {
+        if (chunk.kind == FileChunk::End) {
+            endStatus = chunk.status;
+        }
+        pipeline.Release(chunk);
+    }
+
+    EXPECT_EQ(endStatus, WriteFailed);
+}
+
+// Test case: large files are published as slices of a mapping instead of pooled buffers
+TEST(ReadPipelineTest, Next_MapsLargeFiles) {
+    std::filesystem::path tempFile = std::filesystem::temp_directory_path() / "test_read_pipeline_large.bin";
+    std::string content(MMAP_THRESHOLD + MMAP_SLICE_SIZE / 2, 'x');
+    for (size_t i = 0; i < content.size(); i += 4096) {
+        content[i] = static_cast<char>(i / 4096);
+    }
+    std::ofstream(tempFile, std::ios::binary) << content;
+
+    bool pending = true;
+    ReadPipeline pipeline([&](std::string& path) {
+        path = tempFile.string();
+        return std::exchange(pending, false);
+    });
+
+    std::string readBack;
+    FileChunk chunk;
+    while (pipeline.Next(chunk)) {
+        if (chunk.kind == FileChunk::Data) {
+            EXPECT_EQ(chunk.buffer, FileChunk::NoBuffer);
+            EXPECT_NE(chunk.mapping, nullptr);
+            readBack.append(chunk.data, chunk.size);
+        }
+        pipeline.Release(chunk);
+    }
+
+    EXPECT_EQ(readBack, content);
+
+    std::filesystem::remove(tempFile);
+}
+
+// Test case: with io_uring, reads kept in flight are still published in file order
+TEST(ReadPipelineTest, Next_ReadsThroughIoRing) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "test_read_pipeline_ring";
+    std::filesystem::create_directories(directory);
+    std::vector<std::string> files;
+    std::vector<std::string> contents;
+    for (size_t n = 0; n < 4; n++) {
+        std::string content;
+        for (size_t i = 0; i < (n + 1) * 5 * PIPELINE_BUFFER_SIZE + n; i++) {
+            content.push_back(static_cast<char>(i * 7 + n));
+        }
+        files.push_back((directory / std::to_string(n)).string());
+        contents.push_back(content);
+        std::ofstream(files.back(), std::ios::binary) << content;
+    }
+
+    size_t next = 0;
+    ReadPipeline pipeline([&](std::string& path) {
+        if (next == files.size()) {
+            return false;
+        }
+        path = files[next++];
+        return true;
+    }, true);
+
+    std::vector<std::string> readBack;
+    FileChunk chunk;
+    while (pipeline.Next(chunk)) {
+        if (chunk.kind == FileChunk::Begin) {
+            readBack.emplace_back();
+        } else if (chunk.kind == FileChunk::Data) {
+            readBack.back().append(chunk.data, chunk.size);
+        } else if (chunk.kind == FileChunk::End) {
+            EXPECT_EQ(chunk.status, Success);
+        }
+        pipeline.Release(chunk);
+    }
+
+    EXPECT_EQ(readBack, contents);
+    std::filesystem::remove_all(directory);
+}
+
+// Test case: the ring reader waits while the consumer holds every buffer and loses none of them
+TEST(ReadPipelineTest, Next_ReadsThroughIoRingWhileBuffersAreHeld) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "test_read_pipeline_ring_held";
+    std::filesystem::create_directories(directory);
+    std::string content;
+    for (size_t i = 0; i < 4 * PIPELINE_BUFFER_COUNT * PIPELINE_BUFFER_SIZE / 3; i++) {
+        content.push_back(static_cast<char>(i * 13));
+    }
+    std::string file = (directory / "held").string();
+    std::ofstream(file, std::ios::binary) << content;
+
+    std::vector<std::string> files(3, file);
+    size_t next = 0;
+    ReadPipeline pipeline([&](std::string& path) {
+        if (next == files.size()) {
+            return false;
+        }
+        path = files[next++];
+        return true;
+    }, true, nullptr, 0);
+
+    std::string readBack;
+    std::vector<FileChunk> held;
+    FileChunk chunk;
+    while (pipeline.Next(chunk)) {
+        if (chunk.kind == FileChunk::Data) {
+            readBack.append(chunk.data, chunk.size);
+        } else if (chunk.kind == FileChunk::End) {
+            EXPECT_EQ(chunk.status, Success);
+        }
+        held.push_back(chunk);
+        /* hand the buffers back in bursts, so the reader repeatedly finds none free */
+        if (held.size() == PIPELINE_BUFFER_COUNT) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            for (const auto& item : held) {
+                pipeline.Release(item);
+            }
+            held.clear();
+        }
+    }
+    for (const auto& item : held) {
+        pipeline.Release(item);
+    }
+
+    EXPECT_EQ(readBack, content + content + content);
+    std::filesystem::remove_all(directory);
+}
+
+// Test case: a sparse file is read region by region, holes still count in its hash
+TEST(ReadPipelineTest, Next_SkipsHolesOfSparseFile) {
+    std::filesystem::path tempFile = std::filesystem::temp_directory_path() / "test_read_pipeline_sparse.bin";
+    const off_t size = 16 * 0x100000;
+    std::string block(PIPELINE_BUFFER_SIZE, 's');
+    int fd = open(tempFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_EQ(ftruncate(fd, size), 0);
+    ASSERT_EQ(pwrite(fd, block.data(), block.size(), 8 * 0x100000), static_cast<ssize_t>(block.size()));
+    close(fd);
+    std::string content(size, '\0');
+    content.replace(8 * 0x100000, block.size(), block);
+
+    bool pending = true;
+    ReadPipeline pipeline([&](std::string& path) {
+        path = tempFile.string();
+        return std::exchange(pending, false);
+    });
+
+    std::string readBack(size, '\0');
+    uint64_t dataBytes = 0;
+    FileChunk chunk;
+    while (pipeline.Next(chunk)) {
+        if (chunk.kind == FileChunk::Begin) {
+            EXPECT_TRUE(chunk.sparse);
+            ASSERT_EQ(chunk.regions.size(), 1u);
+            EXPECT_EQ(chunk.regions[0].offset, 8 * 0x100000);
+        } else if (chunk.kind == FileChunk::Data) {
+            readBack.replace(chunk.offset, chunk.size, chunk.data, chunk.size);
+            dataBytes += chunk.size;
+        } else if (chunk.kind == FileChunk::End) {
+            EXPECT_EQ(chunk.status, Success);
+            Xxh64 hash;
+            hash.Update(content.data(), content.size());
+            EXPECT_EQ(chunk.contentHash, hash.Digest());
+        }
+        pipeline.Release(chunk);
+    }
+
+    EXPECT_LT(dataBytes, static_cast<uint64_t>(size));
+    EXPECT_EQ(readBack, content);
+    std::filesystem::remove(tempFile);
+}
+
+// Test case: later hard links of a file point at the first one and are not read again
+TEST(ReadPipelineTest, Next_ReportsLaterHardLinks) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "test_read_pipeline_links";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::ofstream(directory / "first", std::ios::binary) << std::string(PIPELINE_BUFFER_SIZE + 5, 'l');
+    std::filesystem::create_hard_link(directory / "first", directory / "second");
+    std::vector<std::string> files = {(directory / "first").string(), (directory / "second").string()};
+
+    size_t next = 0;
+    LinkTable links;
+    ReadPipeline pipeline([&](std::string& path) {
+        if (next == files.size()) {
+            return false;
+        }
+        path = files[next++];
+        return true;
+    }, false, &links);
+
+    std::vector<std::string> targets;
+    std::vector<uint64_t> hashes;
+    size_t dataChunks = 0;
+    FileChunk chunk;
+    while (pipeline.Next(chunk)) {
+        if (chunk.kind == FileChunk::Begin) {
+            targets.push_back(chunk.linkTarget);
+        } else if (chunk.kind == FileChunk::Data) {
+            dataChunks++;
+        } else if (chunk.kind == FileChunk::End) {
+            EXPECT_EQ(chunk.status, Success);
+            hashes.push_back(chunk.contentHash);
+        }
+        pipeline.Release(chunk);
+    }
+
+    EXPECT_EQ(targets, (std::vector<std::string>{"", files[0]}));
+    EXPECT_EQ(dataChunks, 2u);
+    ASSERT_EQ(hashes.size(), 2u);
+    EXPECT_EQ(hashes[0], hashes[1]);
+    std::filesystem::remove_all(directory);
+}
+
+// Test case: a link whose read failed is not referenced, the next link is read in its place
+TEST(ReadPipelineTest, Next_ReadsNextLinkIfFirstFailed) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "test_read_pipeline_failed_link";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::ofstream(directory / "first", std::ios::binary) << std::string((PIPELINE_BUFFER_COUNT + 8) * PIPELINE_BUFFER_SIZE, 'l');
+    std::filesystem::create_hard_link(directory / "first", directory / "second");
+    std::vector<std::string> files = {(directory / "first").string(), (directory / "second").string()};
+
+    size_t next = 0;
+    LinkTable links;
+    /* no prefetch window: the second link is opened after the first was read */
+    ReadPipeline pipeline([&](std::string& path) {
+        if (next == files.size()) {
+            return false;
+        }
+        path = files[next++];
+        return true;
+    }, false, &links, 0);
+
+    std::vector<std::string> targets;
+    std::vector<Status> statuses;
+    FileChunk chunk;
+    while (pipeline.Next(chunk)) {
+        if (chunk.kind == FileChunk::Begin) {
+            targets.push_back(chunk.linkTarget);
+            if (targets.size() == 1) {
+                /* the reader holds every buffer until this chunk is released */
+                std::filesystem::resize_file(directory / "first", PIPELINE_BUFFER_SIZE);
+            }
+        } else if (chunk.kind == FileChunk::End) {
+            statuses.push_back(chunk.status);
+        }
+        pipeline.Release(chunk);
+    }
+
+    EXPECT_EQ(targets, (std::vector<std::string>{"", ""}));
+    EXPECT_EQ(statuses, (std::vector<Status>{WriteFailed, Success}));
+    std::string target;
+    uint64_t hash = 0;
+    struct stat st;
+    ASSERT_EQ(stat(files[1].c_str(), &st), 0);
+    EXPECT_TRUE(links.Find(st.st_dev, st.st_ino, target, hash));
+    EXPECT_EQ(target, files[1]);
+    std::filesystem::remove_all(directory);
+}
+
+// Test case: upcoming files are taken into the prefetch window before the current one is published
+TEST(ReadPipelineTest, Next_OpensFilesAheadInWindow) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "test_read_pipeline_window";
+    std::filesystem::create_directories(directory);
+    std::vector<std::string> files;
+    for (size_t n = 0; n < 5; n++) {
+        files.push_back((directory / std::to_string(n)).string());
+        std::ofstream(files.back(), std::ios::binary) << std::string(1000 + n, 'w');
+    }
+    files.push_back((directory / "missing").string());
+
+    std::atomic<size_t> taken{0};
+    ReadPipeline pipeline([&](std::string& path) {
+        size_t next = taken++;
+        if (next >= files.size()) {
+            return false;
+        }
+        path = files[next];
+        return true;
+    }, false, nullptr, PREFETCH_WINDOW_BYTES);
+
+    std::vector<std::string> begins;
+    std::vector<Status> statuses;
+    FileChunk chunk;
+    while (pipeline.Next(chunk)) {
+        if (chunk.kind == FileChunk::Begin) {
+            if (begins.empty()) {
+                EXPECT_EQ(taken.load(), files.size() + 1);
+            }
+            begins.push_back(chunk.path);
+        } else if (chunk.kind == FileChunk::End) {
+            statuses.push_back(chunk.status);
+        }
+        pipeline.Release(chunk);
+    }
+
+    EXPECT_EQ(begins, files);
+    ASSERT_EQ(statuses.size(), files.size());
+    EXPECT_EQ(statuses.front(), Success);
+    EXPECT_EQ(statuses.back(), WriteFailed);
+    std::filesystem::remove_all(directory);
+}
+
+// Test case: only the size announced in the Begin chunk is read, whether the file grows or shrinks meanwhile
+TEST(ReadPipelineTest, Next_ReadsSizeAtOpenOnly) {
+    std::filesystem::path tempFile = std::filesystem::temp_directory_path() / "test_read_pipeline_resize.bin";
+    std::string content((PIPELINE_BUFFER_COUNT + 8) * PIPELINE_BUFFER_SIZE, 'a');
+    for (bool grow : {true, false}) {
+        SCOPED_TRACE(grow ? "grows" : "shrinks");
+        std::ofstream(tempFile, std::ios::binary) << content;
+
+        bool pending = true;
+        ReadPipeline pipeline([&](std::string& path) {
+            path = tempFile.string();
+            return std::exchange(pending, false);
+        });
+
+        std::string readBack;
+        Status endStatus = Success;
+        uint64_t hash = 0;
+        FileChunk chunk;
+        while (pipeline.Next(chunk)) {
+            if (chunk.kind == FileChunk::Begin) {
+                EXPECT_EQ(chunk.size, content.size());
+                /* the reader holds every buffer until this chunk is released */
+                if (grow) {
+                    std::ofstream(tempFile, std::ios::binary | std::ios::app) << std::string(PIPELINE_BUFFER_SIZE, 'b');
+                } else {
+                    std::filesystem::resize_file(tempFile, content.size() / 2);
+                }
+            } else if (chunk.kind == FileChunk::Data) {
+                readBack.append(chunk.data, chunk.size);
+            } else if (chunk.kind == FileChunk::End) {
+                endStatus = chunk.status;
+                hash = chunk.contentHash;
+            }
+            pipeline.Release(chunk);
+        }
+
+        if (grow) {
+            EXPECT_EQ(endStatus, Success);
+            EXPECT_EQ(readBack, content);
+            EXPECT_EQ(hash, Xxh64::Hash(content.data(), content.size()));
+        } else {
+            EXPECT_EQ(endStatus, WriteFailed);
+            EXPECT_LT(readBack.size(), content.size());
+        }
+    }
+    std::filesystem::remove(tempFile);
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include "seekable.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <lzma.h>
+#include <unistd.h>
+
+namespace {
+
+std::string XzStream(const std::string& data) {
+    std::vector<uint8_t> buffer(lzma_stream_buffer_bound(data.size()));
+    size_t position = 0;
+    lzma_ret ret = lzma_easy_buffer_encode(1, LZMA_CHECK_CRC64, nullptr,
+        reinterpret_cast<const uint8_t*>(data.data()), data.size(), buffer.data(), &position, buffer.size());
+    EXPECT_EQ(ret, LZMA_OK);
+    return std::string(reinterpret_cast<const char*>(buffer.data()), position);
+}
+
+bool Locate(const std::string& content, TocEntry& toc) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "test_seekable.bin";
+    std::ofstream(path, std::ios::binary) << content;
+    int fd = open(path.c_str(), O_RDONLY);
+    bool found = LocateToc(fd, toc);
+    close(fd);
+    std::filesystem::remove(path);
+    return found;
+}
+
+} // namespace
+
+// Test case: every path added to a table of contents is found with its own frame
+TEST(SeekableTest, FindTocEntry_ReturnsFrameOfPath) {
+    std::string toc;
+    AppendTocEntry(toc, "dir/a.txt", TocEntry{0, 100});
+    AppendTocEntry(toc, "dir/b.txt", TocEntry{0, 100});
+    AppendTocEntry(toc, "dir/c.txt", TocEntry{100, 42});
+
+    TocEntry entry;
+    ASSERT_TRUE(FindTocEntry(toc, "dir/c.txt", entry));
+    EXPECT_EQ(entry.frameOffset, 100u);
+    EXPECT_EQ(entry.frameSize, 42u);
+    ASSERT_TRUE(FindTocEntry(toc, "dir/b.txt", entry));
+    EXPECT_EQ(entry.frameOffset, 0u);
+    EXPECT_FALSE(FindTocEntry(toc, "dir/", entry));
+    EXPECT_FALSE(FindTocEntry(toc.substr(0, toc.size() - 1), "dir/c.txt", entry));
+}
+
+// Test case: the trailer of zstd and lz4 archives points at the last frame
+TEST(SeekableTest, LocateToc_ReadsTrailer) {
+    std::string frames(1000, 'f');
+    std::string content = frames + std::string(37, 't') + SeekableTrailer(Codec::Zstd, frames.size());
+
+    TocEntry toc;
+    ASSERT_TRUE(Locate(content, toc));
+    EXPECT_EQ(toc.frameOffset, 1000u);
+    EXPECT_EQ(toc.frameSize, 37u);
+    EXPECT_TRUE(SeekableTrailer(Codec::Xz, 0).empty());
+    EXPECT_FALSE(Locate(frames, toc));
+}
+
+// Test case: in xz archives the last stream is found through its footer and index
+TEST(SeekableTest, LocateToc_FindsLastXzStream) {
+    std::string first = XzStream(std::string(100000, 'a'));
+    std::string last = XzStream("table of contents");
+
+    TocEntry toc;
+    ASSERT_TRUE(Locate(first + last, toc));
+    EXPECT_EQ(toc.frameOffset, first.size());
+    EXPECT_EQ(toc.frameSize, last.size());
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include "size_estimator.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::filesystem::path CreateTree(const std::string& name, int directories, int files) {
+    std::filesystem::path root = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(root);
+    for (int i = 0; i < directories; i++) {
+        std::filesystem::path directory = root / ("dir" + std::to_string(i));
+        std::filesystem::create_directories(directory);
+        for (int j = 0; j < files; j++) {
+            std::ofstream(directory / ("file" + std::to_string(j))) << std::string(1000, 'x');
+        }
+    }
+    std::ofstream(root / "empty");
+    return root;
+}
+
+/* "compresses" every sample to half its size */
+bool Halve(const char*, size_t length, uint64_t& compressed) {
+    compressed = length / 2;
+    return true;
+}
+
+} // namespace
+
+// Test case: Estimate counts every regular file and extrapolates the sampled ratio
+TEST(SizeEstimatorTest, Estimate_CountsFilesAndAppliesSampledRatio) {
+    std::filesystem::path root = CreateTree("test_size_estimator_sync", 4, 25);
+    std::atomic<int> samples{0};
+
+    SizeEstimate estimate = SizeEstimator::Estimate(root.string(), [&samples](const char* data, size_t length, uint64_t& compressed) {
+        samples++;
+        return Halve(data, length, compressed);
+    }, 2);
+
+    EXPECT_TRUE(estimate.complete);
+    EXPECT_EQ(estimate.files, 101u);
+    EXPECT_EQ(estimate.bytes, 100000u);
+    /* the 1st, 2nd, 4th, ... 64th non-empty file */
+    EXPECT_EQ(samples, 7);
+    EXPECT_EQ(estimate.sampleBytes, 7000u);
+    EXPECT_EQ(estimate.ArchiveBytes(), 50000u);
+
+    SizeEstimate file = SizeEstimator::Estimate((root / "dir0" / "file0").string(), Halve);
+    EXPECT_EQ(file.files, 1u);
+    EXPECT_EQ(file.ArchiveBytes(), 500u);
+
+    std::filesystem::remove_all(root);
+}
+
+// Test case: background scans report their result, and Cancel drops unfinished ones
+TEST(SizeEstimatorTest, Start_ScansInBackgroundUntilCancelled) {
+    std::filesystem::path root = CreateTree("test_size_estimator_async", 3, 10);
+
+    SizeEstimator estimator(Halve, 1);
+    SizeEstimate estimate;
+    EXPECT_FALSE(estimator.Get(root.string(), estimate));
+    estimator.Start(root.string());
+    ASSERT_TRUE(estimator.Get(root.string(), estimate));
+    for (int i = 0; i < 500 && !estimate.complete; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        estimator.Get(root.string(), estimate);
+    }
+    ASSERT_TRUE(estimate.complete);
+    EXPECT_EQ(estimate.files, 31u);
+    EXPECT_EQ(estimate.bytes, 30000u);
+
+    /* a scan cancelled while it may still be sampling leaves no estimate, and the destructor does not hang */
+    SizeEstimator slow([](const char* data, size_t length, uint64_t& compressed) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return Halve(data, length, compressed);
+    }, 1);
+    slow.Start(root.string());
+    slow.Cancel();
+    EXPECT_FALSE(slow.Get(root.string(), estimate));
+
+    /* finished estimates survive Cancel */
+    estimator.Cancel();
+    EXPECT_TRUE(estimator.Get(root.string(), estimate));
+
+    std::filesystem::remove_all(root);
+}
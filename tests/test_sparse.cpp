@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include "sparse.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+/* Creates a file of size bytes with data only at the given offsets. */
+std::filesystem::path MakeSparseFile(const std::string& name, off_t size, const std::vector<off_t>& offsets) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    EXPECT_EQ(ftruncate(fd, size), 0);
+    std::string block(SPARSE_SCAN_BLOCK, 'd');
+    for (off_t offset : offsets) {
+        EXPECT_EQ(pwrite(fd, block.data(), block.size(), offset), static_cast<ssize_t>(block.size()));
+    }
+    close(fd);
+    return path;
+}
+
+bool Find(const std::filesystem::path& path, std::vector<SparseRegion>& regions) {
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    EXPECT_EQ(fstat(fd, &st), 0);
+    bool sparse = FindDataRegions(fd, st, regions);
+    EXPECT_EQ(lseek(fd, 0, SEEK_CUR), 0);
+    close(fd);
+    std::filesystem::remove(path);
+    return sparse;
+}
+
+} // namespace
+
+// Test case: only blocks that are entirely zero are reported as zero
+TEST(SparseTest, IsZeroBlock_DetectsAnyNonZeroByte) {
+    std::vector<char> block(SPARSE_SCAN_BLOCK + 7, 0);
+    EXPECT_TRUE(IsZeroBlock(block.data(), block.size()));
+    block[SPARSE_SCAN_BLOCK + 3] = 1;
+    EXPECT_FALSE(IsZeroBlock(block.data(), block.size()));
+    block[SPARSE_SCAN_BLOCK + 3] = 0;
+    block[100] = 1;
+    EXPECT_FALSE(IsZeroBlock(block.data(), block.size()));
+    EXPECT_TRUE(IsZeroBlock(SparseZeros(), SPARSE_ZEROS_SIZE));
+}
+
+// Test case: the data regions of a file with holes are found in order
+TEST(SparseTest, FindDataRegions_ReportsDataBetweenHoles) {
+    const off_t size = 64 * 0x100000;
+    std::vector<SparseRegion> regions;
+    ASSERT_TRUE(Find(MakeSparseFile("test_sparse_holes.bin", size, {0, 32 * 0x100000}), regions));
+
+    ASSERT_EQ(regions.size(), 2u);
+    EXPECT_EQ(regions[0].offset, 0);
+    EXPECT_GE(regions[0].length, SPARSE_SCAN_BLOCK);
+    EXPECT_EQ(regions[1].offset, 32 * 0x100000);
+    EXPECT_LT(regions[1].offset + regions[1].length, size);
+
+    EXPECT_TRUE(Find(MakeSparseFile("test_sparse_empty.bin", size, {}), regions));
+    EXPECT_TRUE(regions.empty());
+}
+
+// Test case: files without holes are read whole
+TEST(SparseTest, FindDataRegions_ReturnsFalseForDenseFile) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "test_sparse_dense.bin";
+    std::ofstream(path, std::ios::binary) << std::string(3 * SPARSE_SCAN_BLOCK, 'x');
+    std::vector<SparseRegion> regions;
+    EXPECT_FALSE(Find(path, regions));
+    EXPECT_TRUE(regions.empty());
+}